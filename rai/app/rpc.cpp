@@ -103,6 +103,13 @@ void rai::AppRpcHandler::ProcessImpl()
             StatsClear();
         }
     }
+    else if (action == "store_stats")
+    {
+        if (!CheckLocal_())
+        {
+            StoreStats();
+        }
+    }
     else if (action == "subscription")
     {
         Subscription();
@@ -819,6 +826,11 @@ void rai::AppRpcHandler::StatsClear()
     }
 }
 
+void rai::AppRpcHandler::StoreStats()
+{
+    StoreStats_(app_.store_);
+}
+
 void rai::AppRpcHandler::Subscription()
 {
     rai::Account account;
@@ -43,6 +43,7 @@ public:
     void Stats();
     void StatsVerbose();
     void StatsClear();
+    void StoreStats();
     void Subscription();
     void Subscriptions();
     void SubscriptionCount();
@@ -197,6 +197,17 @@ bool rai::Block::CheckSignature() const
     return CheckSignature_();
 }
 
+bool rai::Block::SignatureChecked() const
+{
+    return signature_checked_;
+}
+
+void rai::Block::SetSignatureChecked(bool error) const
+{
+    signature_error_ = error;
+    signature_checked_ = true;
+}
+
 bool rai::Block::operator!=(const rai::Block& other) const
 {
     return !(*this == other);
@@ -2070,6 +2081,36 @@ std::unique_ptr<rai::Block> rai::DeserializeBlock(rai::ErrorCode& error_code,
     return result;
 }
 
+void rai::CheckSignatures(const std::vector<std::shared_ptr<rai::Block>>& blocks)
+{
+    std::vector<rai::PublicKey> public_keys;
+    std::vector<rai::uint256_union> messages;
+    std::vector<rai::Signature> signatures;
+    std::vector<std::shared_ptr<rai::Block>> unchecked;
+    for (const auto& block : blocks)
+    {
+        if (block == nullptr || block->SignatureChecked())
+        {
+            continue;
+        }
+        public_keys.push_back(block->Account());
+        messages.push_back(block->Hash());
+        signatures.push_back(block->Signature());
+        unchecked.push_back(block);
+    }
+    if (unchecked.empty())
+    {
+        return;
+    }
+
+    std::vector<bool> results;
+    rai::ValidateMessages(public_keys, messages, signatures, results);
+    for (size_t i = 0; i < unchecked.size(); ++i)
+    {
+        unchecked[i]->SetSignatureChecked(results[i]);
+    }
+}
+
 std::unique_ptr<rai::Block> rai::DeserializeBlockUnverify(
     rai::ErrorCode& error_code, rai::Stream& stream)
 {
@@ -2123,3 +2164,262 @@ std::unique_ptr<rai::Block> rai::DeserializeBlockUnverify(
 
     return result;
 }
+
+rai::BlockView::BlockView()
+    : data_(nullptr),
+      size_(0),
+      representative_offset_(0),
+      balance_offset_(0),
+      link_offset_(0),
+      extensions_offset_(0),
+      chain_offset_(0),
+      signature_offset_(0)
+{
+}
+
+bool rai::BlockView::Parse(const uint8_t* data, size_t size)
+{
+    // type, opcode, credit, counter, timestamp, height, account, previous
+    size_t constexpr common_size = 1 + 1 + 2 + 4 + 8 + 8 + 32 + 32;
+    size_t constexpr signature_size = 64;
+    data_ = data;
+    size_ = size;
+    if (data_ == nullptr || size_ < common_size)
+    {
+        return true;
+    }
+
+    size_t offset = common_size;
+    switch (Type())
+    {
+        case rai::BlockType::TX_BLOCK:
+        {
+            representative_offset_ = offset;
+            offset += 32;
+            balance_offset_ = offset;
+            offset += 16;
+            link_offset_ = offset;
+            offset += 32;
+            if (size_ < offset + sizeof(uint32_t))
+            {
+                return true;
+            }
+            uint32_t extensions_length = Read_<uint32_t>(offset);
+            if (rai::TxBlock::CheckExtensionsLength(extensions_length))
+            {
+                return true;
+            }
+            offset += sizeof(uint32_t);
+            extensions_offset_ = offset;
+            offset += extensions_length;
+            break;
+        }
+        case rai::BlockType::REP_BLOCK:
+        {
+            balance_offset_ = offset;
+            offset += 16;
+            link_offset_ = offset;
+            offset += 32;
+            if (HasChain())
+            {
+                chain_offset_ = offset;
+                offset += sizeof(uint32_t);
+            }
+            break;
+        }
+        case rai::BlockType::AD_BLOCK:
+        {
+            representative_offset_ = offset;
+            offset += 32;
+            balance_offset_ = offset;
+            offset += 16;
+            link_offset_ = offset;
+            offset += 32;
+            break;
+        }
+        default:
+        {
+            return true;
+        }
+    }
+
+    signature_offset_ = offset;
+    if (size_ < signature_offset_ + signature_size)
+    {
+        return true;
+    }
+    size_ = signature_offset_ + signature_size;
+    return false;
+}
+
+std::unique_ptr<rai::Block> rai::BlockView::Materialize(
+    rai::ErrorCode& error_code) const
+{
+    rai::BufferStream stream(data_, size_);
+    return rai::DeserializeBlockUnverify(error_code, stream);
+}
+
+rai::BlockHash rai::BlockView::Hash() const
+{
+    // the hashed fields are exactly the serialized bytes before the signature
+    int ret;
+    rai::uint256_union result;
+    blake2b_state hash;
+
+    ret = blake2b_init(&hash, sizeof(result.bytes));
+    assert(0 == ret);
+
+    ret = blake2b_update(&hash, data_, signature_offset_);
+    assert(0 == ret);
+
+    ret = blake2b_final(&hash, result.bytes.data(), sizeof(result.bytes));
+    assert(0 == ret);
+    return result;
+}
+
+rai::BlockHash rai::BlockView::Previous() const
+{
+    rai::BlockHash result;
+    Read_(56, result.bytes);
+    return result;
+}
+
+rai::Signature rai::BlockView::Signature() const
+{
+    rai::Signature result;
+    Read_(signature_offset_, result.bytes);
+    return result;
+}
+
+rai::BlockType rai::BlockView::Type() const
+{
+    return static_cast<rai::BlockType>(data_[0]);
+}
+
+rai::BlockOpcode rai::BlockView::Opcode() const
+{
+    return static_cast<rai::BlockOpcode>(data_[1]);
+}
+
+rai::Account rai::BlockView::Account() const
+{
+    rai::Account result;
+    Read_(24, result.bytes);
+    return result;
+}
+
+rai::Amount rai::BlockView::Balance() const
+{
+    rai::Amount result;
+    Read_(balance_offset_, result.bytes);
+    return result;
+}
+
+uint16_t rai::BlockView::Credit() const
+{
+    return Read_<uint16_t>(2);
+}
+
+uint32_t rai::BlockView::Counter() const
+{
+    return Read_<uint32_t>(4);
+}
+
+uint64_t rai::BlockView::Timestamp() const
+{
+    return Read_<uint64_t>(8);
+}
+
+uint64_t rai::BlockView::Height() const
+{
+    return Read_<uint64_t>(16);
+}
+
+rai::uint256_union rai::BlockView::Link() const
+{
+    rai::uint256_union result;
+    Read_(link_offset_, result.bytes);
+    return result;
+}
+
+rai::Account rai::BlockView::Representative() const
+{
+    if (!HasRepresentative())
+    {
+        return rai::Account(0);
+    }
+
+    rai::Account result;
+    Read_(representative_offset_, result.bytes);
+    return result;
+}
+
+bool rai::BlockView::HasRepresentative() const
+{
+    return Type() != rai::BlockType::REP_BLOCK;
+}
+
+std::vector<uint8_t> rai::BlockView::Extensions() const
+{
+    const uint8_t* data = ExtensionsData();
+    return std::vector<uint8_t>(data, data + ExtensionsLength());
+}
+
+const uint8_t* rai::BlockView::ExtensionsData() const
+{
+    if (Type() != rai::BlockType::TX_BLOCK)
+    {
+        return nullptr;
+    }
+    return data_ + extensions_offset_;
+}
+
+uint32_t rai::BlockView::ExtensionsLength() const
+{
+    if (Type() != rai::BlockType::TX_BLOCK)
+    {
+        return 0;
+    }
+    return Read_<uint32_t>(extensions_offset_ - sizeof(uint32_t));
+}
+
+bool rai::BlockView::HasChain() const
+{
+    return Type() == rai::BlockType::REP_BLOCK
+           && Opcode() == rai::BlockOpcode::BIND;
+}
+
+rai::Chain rai::BlockView::Chain() const
+{
+    if (!HasChain())
+    {
+        return rai::Chain::INVALID;
+    }
+    return static_cast<rai::Chain>(Read_<uint32_t>(chain_offset_));
+}
+
+const uint8_t* rai::BlockView::Data() const
+{
+    return data_;
+}
+
+size_t rai::BlockView::Size() const
+{
+    return size_;
+}
+
+template <typename T>
+T rai::BlockView::Read_(size_t offset) const
+{
+    T result;
+    std::copy(data_ + offset, data_ + offset + sizeof(result),
+              reinterpret_cast<uint8_t*>(&result));
+    boost::endian::big_to_native_inplace(result);
+    return result;
+}
+
+template <size_t N>
+void rai::BlockView::Read_(size_t offset, std::array<uint8_t, N>& bytes) const
+{
+    std::copy(data_ + offset, data_ + offset + N, bytes.begin());
+}
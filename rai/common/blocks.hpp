@@ -42,6 +42,8 @@ public:
     rai::BlockHash Hash() const;
     std::string Json() const;
     bool CheckSignature() const;
+    bool SignatureChecked() const;
+    void SetSignatureChecked(bool) const;
     bool operator!=(const rai::Block&) const;
     bool ForkWith(const rai::Block&) const;
     bool Limited() const;
@@ -272,6 +274,53 @@ private:
     rai::Signature signature_;
 };
 
+// Read-only view of a serialized block, the fields are decoded on access
+// straight from the buffer which must outlive the view (e.g. a value read in
+// an LMDB read transaction)
+class BlockView
+{
+public:
+    BlockView();
+    bool Parse(const uint8_t*, size_t);
+    std::unique_ptr<rai::Block> Materialize(rai::ErrorCode&) const;
+    rai::BlockHash Hash() const;
+    rai::BlockHash Previous() const;
+    rai::Signature Signature() const;
+    rai::BlockType Type() const;
+    rai::BlockOpcode Opcode() const;
+    rai::Account Account() const;
+    rai::Amount Balance() const;
+    uint16_t Credit() const;
+    uint32_t Counter() const;
+    uint64_t Timestamp() const;
+    uint64_t Height() const;
+    rai::uint256_union Link() const;
+    rai::Account Representative() const;
+    bool HasRepresentative() const;
+    std::vector<uint8_t> Extensions() const;
+    const uint8_t* ExtensionsData() const;
+    uint32_t ExtensionsLength() const;
+    bool HasChain() const;
+    rai::Chain Chain() const;
+    const uint8_t* Data() const;
+    size_t Size() const;
+
+private:
+    template <typename T>
+    T Read_(size_t) const;
+    template <size_t N>
+    void Read_(size_t, std::array<uint8_t, N>&) const;
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t representative_offset_;
+    size_t balance_offset_;
+    size_t link_offset_;
+    size_t extensions_offset_;
+    size_t chain_offset_;
+    size_t signature_offset_;
+};
+
 class BlockVisitor
 {
 public:
@@ -338,4 +387,7 @@ std::unique_ptr<rai::Block> DeserializeBlockJson(rai::ErrorCode&,
 std::unique_ptr<rai::Block> DeserializeBlock(rai::ErrorCode&, rai::Stream&);
 std::unique_ptr<rai::Block> DeserializeBlockUnverify(rai::ErrorCode&,
                                                      rai::Stream&);
+
+// Verify the signatures of blocks in batch and cache the results
+void CheckSignatures(const std::vector<std::shared_ptr<rai::Block>>&);
 }  // namespace rai
\ No newline at end of file
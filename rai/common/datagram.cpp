@@ -0,0 +1,179 @@
+#include <rai/common/datagram.hpp>
+
+size_t constexpr rai::Datagram::CAPACITY;
+size_t constexpr rai::DatagramPool::CHUNK_SIZE;
+size_t constexpr rai::UdpBatch::MAX_PREFIX_SIZE;
+size_t constexpr rai::UdpBatch::MAX_DATAGRAMS;
+
+rai::Datagram::Datagram() : size_(0), refs_(0), pool_(nullptr), next_(nullptr)
+{
+}
+
+uint8_t* rai::Datagram::Data()
+{
+    return bytes_.data();
+}
+
+const uint8_t* rai::Datagram::Data() const
+{
+    return bytes_.data();
+}
+
+size_t rai::Datagram::Size() const
+{
+    return size_;
+}
+
+void rai::Datagram::Resize(size_t size)
+{
+    assert(size <= rai::Datagram::CAPACITY);
+    size_ = std::min(size, rai::Datagram::CAPACITY);
+}
+
+void rai::intrusive_ptr_add_ref(rai::Datagram* datagram)
+{
+    datagram->refs_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void rai::intrusive_ptr_release(rai::Datagram* datagram)
+{
+    if (datagram->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        datagram->pool_->Release_(datagram);
+    }
+}
+
+rai::DatagramPool::DatagramPool() : free_(nullptr), free_count_(0), acquired_(0)
+{
+}
+
+rai::DatagramPtr rai::DatagramPool::Acquire()
+{
+    rai::Datagram* datagram = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_ == nullptr)
+        {
+            Grow_();
+        }
+        datagram = free_;
+        free_ = datagram->next_;
+        --free_count_;
+        ++acquired_;
+    }
+
+    datagram->next_ = nullptr;
+    datagram->size_ = 0;
+    return rai::DatagramPtr(datagram);
+}
+
+size_t rai::DatagramPool::Chunks() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size();
+}
+
+size_t rai::DatagramPool::Free() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_count_;
+}
+
+void rai::DatagramPool::Status(rai::Ptree& ptree) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ptree.put("chunks", std::to_string(chunks_.size()));
+    ptree.put("datagrams",
+              std::to_string(chunks_.size() * rai::DatagramPool::CHUNK_SIZE));
+    ptree.put("free", std::to_string(free_count_));
+    ptree.put("acquired", std::to_string(acquired_));
+}
+
+rai::DatagramPool& rai::DatagramPool::Global()
+{
+    static rai::DatagramPool* pool = new rai::DatagramPool;
+    return *pool;
+}
+
+void rai::DatagramPool::Release_(rai::Datagram* datagram)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    datagram->next_ = free_;
+    free_ = datagram;
+    ++free_count_;
+}
+
+void rai::DatagramPool::Grow_()
+{
+    size_t size = rai::DatagramPool::CHUNK_SIZE;
+    std::unique_ptr<rai::Datagram[]> chunk(new rai::Datagram[size]);
+    for (size_t i = 0; i < size; ++i)
+    {
+        chunk[i].pool_ = this;
+        chunk[i].next_ = free_;
+        free_ = &chunk[i];
+    }
+    free_count_ += size;
+    chunks_.push_back(std::move(chunk));
+}
+
+rai::UdpBatch::UdpBatch() : offset_(0), size_(0)
+{
+}
+
+void rai::UdpBatch::Reset(const rai::DatagramPtr& payload, size_t offset)
+{
+    assert(payload != nullptr && offset <= payload->Size());
+    payload_ = payload;
+    offset_ = offset;
+    size_ = 0;
+}
+
+bool rai::UdpBatch::Add(const boost::asio::ip::udp::endpoint& remote,
+                        const uint8_t* prefix, size_t size)
+{
+    assert(size <= rai::UdpBatch::MAX_PREFIX_SIZE);
+    if (size_ >= rai::UdpBatch::MAX_DATAGRAMS
+        || size > rai::UdpBatch::MAX_PREFIX_SIZE)
+    {
+        return true;
+    }
+    remotes_[size_] = remote;
+    std::copy(prefix, prefix + size, prefixes_[size_].begin());
+    prefix_sizes_[size_] = size;
+    ++size_;
+    return false;
+}
+
+size_t rai::UdpBatch::Size() const
+{
+    return size_;
+}
+
+const uint8_t* rai::UdpBatch::Payload() const
+{
+    return payload_ == nullptr ? nullptr : payload_->Data() + offset_;
+}
+
+size_t rai::UdpBatch::PayloadSize() const
+{
+    return payload_ == nullptr ? 0 : payload_->Size() - offset_;
+}
+
+rai::DatagramPtr rai::UdpBatch::Assemble(size_t index) const
+{
+    assert(index < size_);
+    size_t prefix_size = prefix_sizes_[index];
+    if (prefix_size + PayloadSize() > rai::Datagram::CAPACITY)
+    {
+        return nullptr;
+    }
+
+    rai::DatagramPtr datagram = rai::DatagramPool::Global().Acquire();
+    std::copy(prefixes_[index].begin(),
+              prefixes_[index].begin() + prefix_size, datagram->Data());
+    std::copy(Payload(), Payload() + PayloadSize(),
+              datagram->Data() + prefix_size);
+    datagram->Resize(prefix_size + PayloadSize());
+    return datagram;
+}
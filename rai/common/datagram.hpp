@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+#include <rai/common/util.hpp>
+
+namespace rai
+{
+class DatagramPool;
+
+// Fixed size buffer for one udp datagram, owned by a DatagramPool and
+// returned to it when the last DatagramPtr is released
+class Datagram
+{
+public:
+    Datagram();
+    uint8_t* Data();
+    const uint8_t* Data() const;
+    size_t Size() const;
+    void Resize(size_t);
+
+    // 1500 MTU - 20 bytes IP header - 8 bytes UDP header
+    static size_t constexpr CAPACITY = 1472;
+
+private:
+    friend class rai::DatagramPool;
+    friend void intrusive_ptr_add_ref(rai::Datagram*);
+    friend void intrusive_ptr_release(rai::Datagram*);
+
+    std::array<uint8_t, CAPACITY> bytes_;
+    size_t size_;
+    std::atomic<uint32_t> refs_;
+    rai::DatagramPool* pool_;
+    rai::Datagram* next_;
+};
+void intrusive_ptr_add_ref(rai::Datagram*);
+void intrusive_ptr_release(rai::Datagram*);
+
+using DatagramPtr = boost::intrusive_ptr<rai::Datagram>;
+
+// Free list of datagram buffers. It grows by CHUNK_SIZE buffers when it runs
+// dry and never shrinks, so a node in a steady state sends and receives
+// without touching the allocator. The pool must outlive its datagrams
+class DatagramPool
+{
+public:
+    DatagramPool();
+    rai::DatagramPtr Acquire();
+    size_t Chunks() const;
+    size_t Free() const;
+    void Status(rai::Ptree&) const;
+
+    // shared by the network code, never destroyed before exit
+    static rai::DatagramPool& Global();
+
+    static size_t constexpr CHUNK_SIZE = 64;
+
+private:
+    friend void intrusive_ptr_release(rai::Datagram*);
+    void Release_(rai::Datagram*);
+    void Grow_();
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<rai::Datagram[]>> chunks_;
+    rai::Datagram* free_;
+    size_t free_count_;
+    uint64_t acquired_;
+};
+
+// Datagrams that share a payload and differ in a short prefix, such as one
+// message sent to many peers with their own proxy headers. The payload lives
+// in a pooled datagram and the datagrams in fixed arrays, so building and
+// sending a batch does not touch the allocator
+class UdpBatch
+{
+public:
+    UdpBatch();
+    // the payload starts at the offset, the bytes before it are replaced by
+    // the prefix of each datagram
+    void Reset(const rai::DatagramPtr&, size_t);
+    // returns true if the batch is full
+    bool Add(const boost::asio::ip::udp::endpoint&, const uint8_t*, size_t);
+    size_t Size() const;
+    const uint8_t* Payload() const;
+    size_t PayloadSize() const;
+    // prefix and payload of one datagram in a pooled buffer, nullptr if they
+    // do not fit
+    rai::DatagramPtr Assemble(size_t) const;
+
+    static size_t constexpr MAX_PREFIX_SIZE = 32;
+    static size_t constexpr MAX_DATAGRAMS = 32;
+
+    rai::DatagramPtr payload_;
+    size_t offset_;
+    size_t size_;
+    std::array<boost::asio::ip::udp::endpoint, MAX_DATAGRAMS> remotes_;
+    std::array<std::array<uint8_t, MAX_PREFIX_SIZE>, MAX_DATAGRAMS> prefixes_;
+    std::array<size_t, MAX_DATAGRAMS> prefix_sizes_;
+};
+}  // namespace rai
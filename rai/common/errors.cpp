@@ -566,6 +566,104 @@ std::string rai::ErrorString(rai::ErrorCode error_code)
         {
             return "Ledger outdated";
         }
+        case rai::ErrorCode::LEDGER_BLOCK_INDEX_MIGRATION:
+        {
+            return "Failed to migrate block index";
+        }
+        case rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT:
+        {
+            return "Failed to update the snapshot of ledger memory tables";
+        }
+        case rai::ErrorCode::LEDGER_PARALLEL_SCAN:
+        {
+            return "Failed to scan the ledger in parallel";
+        }
+        case rai::ErrorCode::LEDGER_RECEIVABLES_INDEX:
+        {
+            return "Failed to build the receivables index";
+        }
+        case rai::ErrorCode::LEDGER_PRUNE:
+        {
+            return "Failed to prune the ledger";
+        }
+        case rai::ErrorCode::SNAPSHOT_EXPORT:
+        {
+            return "Failed to export the ledger snapshot";
+        }
+        case rai::ErrorCode::SNAPSHOT_EXISTS:
+        {
+            return "The snapshot already exists in the target directory";
+        }
+        case rai::ErrorCode::SNAPSHOT_MANIFEST:
+        {
+            return "Invalid snapshot manifest or the snapshot does not match "
+                   "it";
+        }
+        case rai::ErrorCode::SNAPSHOT_CHECKSUM:
+        {
+            return "Snapshot checksum mismatch";
+        }
+        case rai::ErrorCode::SNAPSHOT_IMPORT:
+        {
+            return "Failed to import the ledger snapshot";
+        }
+        case rai::ErrorCode::SNAPSHOT_LEDGER_EXISTS:
+        {
+            return "The ledger already exists, please remove data.ldb before "
+                   "importing a snapshot";
+        }
+        case rai::ErrorCode::CMD_MISS_FILE:
+        {
+            return "Please specify file parameter to run the command";
+        }
+        case rai::ErrorCode::STORE_ENGINE:
+        {
+            return "Unsupported storage engine";
+        }
+        case rai::ErrorCode::STORE_DURABILITY:
+        {
+            return "Unsupported storage durability profile";
+        }
+        case rai::ErrorCode::LEDGER_COUNTERS:
+        {
+            return "Failed to update ledger counters";
+        }
+        case rai::ErrorCode::LEDGER_RETENTION:
+        {
+            return "Failed to expire ledger rollbacks or forks";
+        }
+        case rai::ErrorCode::STORE_STATS:
+        {
+            return "Failed to collect storage statistics";
+        }
+        case rai::ErrorCode::MDB_READER_CHECK:
+        {
+            return "Failed to clear stale lmdb readers";
+        }
+        case rai::ErrorCode::LONG_TRANSACTION:
+        {
+            return "Transaction open for too long";
+        }
+        case rai::ErrorCode::UDP_SEND:
+        {
+            return "Failed to send udp datagrams";
+        }
+        case rai::ErrorCode::MESSAGE_TOO_LARGE:
+        {
+            return "Message does not fit in a datagram";
+        }
+        case rai::ErrorCode::MDB_ENV_SET_MAXREADERS:
+        {
+            return "Failed to set MDB environment max readers";
+        }
+        case rai::ErrorCode::MDB_TXN_COMMIT:
+        {
+            return "Failed to commit MDB transaction";
+        }
+        case rai::ErrorCode::SNAPSHOT_RUNNING:
+        {
+            return "A snapshot export is already running";
+        }
         case rai::ErrorCode::JSON_GENERIC:
         {
             return "Failed to parse json";
@@ -1076,6 +1174,74 @@ std::string rai::ErrorString(rai::ErrorCode error_code)
         {
             return "Failed to parse cross_chain.bsc from config file";
         }
+        case rai::ErrorCode::JSON_CONFIG_ACCOUNT_INFO_CACHE_SIZE:
+        {
+            return "Failed to parse account_info_cache_size from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_FULL_HISTORY:
+        {
+            return "Failed to parse full_history from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_PRUNE_DEPTH:
+        {
+            return "Failed to parse prune_depth from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_PRUNE_AGE:
+        {
+            return "Failed to parse prune_age from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_STORE_ENGINE:
+        {
+            return "Failed to parse store_engine from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_STORE_DURABILITY:
+        {
+            return "Failed to parse store_durability from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_STORE_MAP_SIZE:
+        {
+            return "Failed to parse store_map_size from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_STORE_SYNC_INTERVAL:
+        {
+            return "Failed to parse store_sync_interval from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_STORE_SYNC_COMMITS:
+        {
+            return "Failed to parse store_sync_commits from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_ROLLBACK_MAX_AGE:
+        {
+            return "Failed to parse rollback_max_age from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_ROLLBACK_MAX_PER_ACCOUNT:
+        {
+            return "Failed to parse rollback_max_per_account from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_FORK_MAX_AGE:
+        {
+            return "Failed to parse fork_max_age from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_FORK_MAX_PER_ACCOUNT:
+        {
+            return "Failed to parse fork_max_per_account from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_UDP_RECEIVE_SOCKETS:
+        {
+            return "Failed to parse udp_receive_sockets from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_MESSAGE_DISPATCH:
+        {
+            return "Failed to parse message_dispatch from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_INGRESS_LIMIT:
+        {
+            return "Failed to parse ingress_limit from config file";
+        }
+        case rai::ErrorCode::JSON_CONFIG_DENSE_BLOCK_INDEX:
+        {
+            return "Failed to parse dense_block_index from config file";
+        }
         case rai::ErrorCode::RPC_GENERIC:
         {
             return "[RPC] Internal server error";
@@ -1552,6 +1718,10 @@ std::string rai::ErrorString(rai::ErrorCode error_code)
         {
             return "Failed to delete binding count from ledger";
         }
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_RECEIVABLES_CONFIRM:
+        {
+            return "Failed to update confirmed receivables in ledger";
+        }
         case rai::ErrorCode::BLOCK_PROCESS_ROLLBACK_REWARDED:
         {
             return "Rollback rewarded block";
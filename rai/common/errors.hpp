@@ -147,6 +147,30 @@ enum class ErrorCode : int
     BINDING_IGNORED                      = 137,
     CROSS_CHAIN_MESSAGE_DESTINATION      = 138,
     LEDGER_OUTDATED                      = 139,
+    LEDGER_BLOCK_INDEX_MIGRATION         = 140,
+    LEDGER_MEMORY_TABLES_SNAPSHOT        = 141,
+    LEDGER_PARALLEL_SCAN                 = 142,
+    LEDGER_RECEIVABLES_INDEX             = 143,
+    LEDGER_PRUNE                         = 144,
+    SNAPSHOT_EXPORT                      = 145,
+    SNAPSHOT_EXISTS                      = 146,
+    SNAPSHOT_MANIFEST                    = 147,
+    SNAPSHOT_CHECKSUM                    = 148,
+    SNAPSHOT_IMPORT                      = 149,
+    SNAPSHOT_LEDGER_EXISTS               = 150,
+    CMD_MISS_FILE                        = 151,
+    STORE_ENGINE                         = 152,
+    STORE_DURABILITY                     = 153,
+    LEDGER_COUNTERS                      = 154,
+    LEDGER_RETENTION                     = 155,
+    STORE_STATS                          = 156,
+    MDB_READER_CHECK                     = 157,
+    LONG_TRANSACTION                     = 158,
+    UDP_SEND                             = 159,
+    MESSAGE_TOO_LARGE                    = 160,
+    MDB_ENV_SET_MAXREADERS               = 161,
+    MDB_TXN_COMMIT                       = 163,
+    SNAPSHOT_RUNNING                     = 164,
 
     // json parsing errors: 200 ~ 299
     JSON_GENERIC                                    = 200,
@@ -376,6 +400,7 @@ enum class ErrorCode : int
     BLOCK_PROCESS_LEDGER_BINDING_COUNT_PUT    = 439,
     BLOCK_PROCESS_LEDGER_BINDING_ENTRY_DEL    = 440,
     BLOCK_PROCESS_LEDGER_BINDING_COUNT_DEL    = 441,
+    BLOCK_PROCESS_LEDGER_RECEIVABLES_CONFIRM  = 442,
 
     BLOCK_PROCESS_ROLLBACK_REWARDED          = 488,
     BLOCK_PROCESS_CONFIRM_BLOCK_MISS         = 489,
@@ -569,6 +594,23 @@ enum class ErrorCode : int
     JSON_CONFIG_CROSS_CHAIN_BSC_TEST                = 1104,
     JSON_CONFIG_CROSS_CHAIN_ETH                     = 1105,
     JSON_CONFIG_CROSS_CHAIN_BSC                     = 1106,
+    JSON_CONFIG_ACCOUNT_INFO_CACHE_SIZE             = 1107,
+    JSON_CONFIG_FULL_HISTORY                        = 1108,
+    JSON_CONFIG_PRUNE_DEPTH                         = 1109,
+    JSON_CONFIG_PRUNE_AGE                           = 1110,
+    JSON_CONFIG_STORE_ENGINE                        = 1111,
+    JSON_CONFIG_STORE_DURABILITY                    = 1112,
+    JSON_CONFIG_STORE_MAP_SIZE                      = 1114,
+    JSON_CONFIG_STORE_SYNC_INTERVAL                 = 1115,
+    JSON_CONFIG_STORE_SYNC_COMMITS                  = 1116,
+    JSON_CONFIG_ROLLBACK_MAX_AGE                    = 1117,
+    JSON_CONFIG_ROLLBACK_MAX_PER_ACCOUNT            = 1118,
+    JSON_CONFIG_FORK_MAX_AGE                        = 1119,
+    JSON_CONFIG_FORK_MAX_PER_ACCOUNT                = 1120,
+    JSON_CONFIG_UDP_RECEIVE_SOCKETS                 = 1121,
+    JSON_CONFIG_MESSAGE_DISPATCH                    = 1122,
+    JSON_CONFIG_INGRESS_LIMIT                       = 1123,
+    JSON_CONFIG_DENSE_BLOCK_INDEX                   = 1124,
 
     
     MAX = 1200
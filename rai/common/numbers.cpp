@@ -1088,6 +1088,74 @@ bool rai::ValidateMessage(const rai::PublicKey& public_key,
     return ret != 0;
 }
 
+bool rai::ValidateMessages(const std::vector<rai::PublicKey>& public_keys,
+                           const std::vector<rai::uint256_union>& messages,
+                           const std::vector<rai::uint512_union>& signatures,
+                           std::vector<bool>& results)
+{
+    size_t size = public_keys.size();
+    results.assign(size, true);
+    if (messages.size() != size || signatures.size() != size)
+    {
+        return true;
+    }
+
+    // ed25519_sign_open rejects a signature whose S has any of the top three
+    // bits set but ed25519_sign_open_batch does not, such signatures are
+    // rejected here so the result never depends on the batch size
+    std::vector<size_t> canonical;
+    canonical.reserve(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        if ((signatures[i].bytes[63] & 224) == 0)
+        {
+            canonical.push_back(i);
+        }
+    }
+
+    size_t count = canonical.size();
+    std::vector<const unsigned char*> m(count);
+    std::vector<size_t> mlen(count);
+    std::vector<const unsigned char*> pk(count);
+    std::vector<const unsigned char*> rs(count);
+    std::vector<int> valid(count, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t index = canonical[i];
+        m[i]    = messages[index].bytes.data();
+        mlen[i] = messages[index].bytes.size();
+        pk[i]   = public_keys[index].bytes.data();
+        rs[i]   = signatures[index].bytes.data();
+    }
+
+    // ed25519_sign_open_batch verifies each item of a failed batch one by one,
+    // so the per item results are exact
+    bool error = count != size;
+    for (size_t begin = 0; begin < count;
+         begin += rai::MAX_VALIDATE_MESSAGES_BATCH)
+    {
+        size_t num =
+            std::min(count - begin, rai::MAX_VALIDATE_MESSAGES_BATCH);
+        int ret = ed25519_sign_open_batch(
+            m.data() + begin, mlen.data() + begin, pk.data() + begin,
+            rs.data() + begin, num, valid.data() + begin);
+        if (ret != 0)
+        {
+            error = true;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        results[canonical[i]] = valid[i] != 1;
+        if (valid[i] != 1)
+        {
+            error = true;
+        }
+    }
+    return error;
+}
+
 rai::PublicKey rai::GeneratePublicKey(const rai::PrivateKey& private_key)
 {
     rai::PublicKey result;
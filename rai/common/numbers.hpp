@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/algorithm/string.hpp>
 #include <cryptopp/osrng.h>
@@ -194,6 +195,14 @@ rai::uint512_union SignMessage(const rai::RawKey&, const rai::PublicKey&,
 bool ValidateMessage(const rai::PublicKey&, const rai::uint256_union&,
                      const rai::uint512_union&);
 
+// Batch version of ValidateMessage, results[i] is set to true if the i-th
+// signature is invalid. Returns true if any of the signatures is invalid.
+bool ValidateMessages(const std::vector<rai::PublicKey>&,
+                      const std::vector<rai::uint256_union>&,
+                      const std::vector<rai::uint512_union>&,
+                      std::vector<bool>&);
+size_t constexpr MAX_VALIDATE_MESSAGES_BATCH = 64;
+
 rai::PublicKey GeneratePublicKey(const rai::PrivateKey&);
 uint64_t Random(uint64_t, uint64_t);
 }  // namespace rai
@@ -124,6 +124,40 @@ bool rai::StreamEnd(rai::Stream& stream)
     return true == error;
 }
 
+rai::ArrayStream::ArrayStream(uint8_t* data, size_t size) : overflow_(0)
+{
+    setp(data, data + size);
+}
+
+size_t rai::ArrayStream::Size() const
+{
+    return pptr() - pbase();
+}
+
+bool rai::ArrayStream::Overflow() const
+{
+    return overflow_ > 0;
+}
+
+std::streamsize rai::ArrayStream::xsputn(const uint8_t* data,
+                                         std::streamsize size)
+{
+    std::streamsize count = std::min<std::streamsize>(size, epptr() - pptr());
+    std::copy(data, data + count, pptr());
+    pbump(static_cast<int>(count));
+    overflow_ += size - count;
+    return size;
+}
+
+rai::ArrayStream::int_type rai::ArrayStream::overflow(int_type c)
+{
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        ++overflow_;
+    }
+    return traits_type::not_eof(c);
+}
+
 std::string rai::BytesToHex(const uint8_t* data, size_t size)
 {
     if (size == 0)
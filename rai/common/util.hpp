@@ -154,6 +154,23 @@ using BufferStream = boost::iostreams::stream_buffer<
     boost::iostreams::basic_array_source<uint8_t>>;
 using VectorStream = boost::iostreams::stream_buffer<
     boost::iostreams::back_insert_device<std::vector<uint8_t>>>;
+
+// Writes into a caller owned buffer without allocating. Bytes past the end
+// are dropped and counted, so Overflow() tells that the output was truncated
+class ArrayStream : public rai::Stream
+{
+public:
+    ArrayStream(uint8_t*, size_t);
+    size_t Size() const;
+    bool Overflow() const;
+
+protected:
+    std::streamsize xsputn(const uint8_t*, std::streamsize) override;
+    int_type overflow(int_type) override;
+
+private:
+    size_t overflow_;
+};
 using Ptree = boost::property_tree::ptree;
 
 std::string BytesToHex(const uint8_t* data, size_t size);
@@ -420,4 +437,16 @@ std::string MilliToSecondString(uint64_t);
         throw std::runtime_error(reason); \
     }
 
+// name of the calling function when used as a default argument
+#if defined(__clang__)
+#if __has_builtin(__builtin_FUNCTION)
+#define RAI_CALLER_FUNCTION __builtin_FUNCTION()
+#endif
+#elif defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+#define RAI_CALLER_FUNCTION __builtin_FUNCTION()
+#endif
+#ifndef RAI_CALLER_FUNCTION
+#define RAI_CALLER_FUNCTION "unknown"
+#endif
+
 #define RAI_TODO 1
@@ -3595,3 +3595,84 @@ TEST(blocks, DeserializeBlock_AdBlock)
     ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
     ASSERT_EQ(block, *ptr);
 }
+
+TEST(BlockView, parse)
+{
+    rai::Account account;
+    rai::BlockHash hash;
+    rai::Account representive;
+    rai::Amount balance;
+    rai::uint256_union link;
+    rai::RawKey raw_key;
+    rai::PublicKey public_key;
+
+    account.DecodeHex(
+        "B0311EA55708D6A53C75CDBF88300259C6D018522FE3D4D0A242E431F9E8B6D0");
+    representive.DecodeHex(
+        "0311B25E0D1E1D7724BBA5BD523954F1DBCFC01CB8671D55ED2D32C7549FB252");
+    balance.DecodeDec("1");
+    link.DecodeHex(
+        "B0311EA55708D6A53C75CDBF88300259C6D018522FE3D4D0A242E431F9E8B6D0");
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    public_key.DecodeHex(
+        "B0311EA55708D6A53C75CDBF88300259C6D018522FE3D4D0A242E431F9E8B6D0");
+
+    rai::TxBlock block(rai::BlockOpcode::SEND, 1, 2, 1541128318, 3, account,
+                       hash, representive, balance, link, 11,
+                       {0, 1, 0, 7, 'r', 'a', 'i', 'c', 'o', 'i', 'n'}, raw_key,
+                       public_key);
+    std::vector<uint8_t> bytes;
+    {
+        rai::VectorStream stream(bytes);
+        block.Serialize(stream);
+        // trailing bytes, e.g. the successor stored in the ledger
+        rai::Write(stream, link.bytes);
+    }
+
+    rai::BlockView view;
+    bool error = view.Parse(bytes.data(), bytes.size());
+    ASSERT_FALSE(error);
+    ASSERT_EQ(block.Size(), view.Size());
+    ASSERT_EQ(block.Hash(), view.Hash());
+    ASSERT_EQ(block.Type(), view.Type());
+    ASSERT_EQ(block.Opcode(), view.Opcode());
+    ASSERT_EQ(block.Credit(), view.Credit());
+    ASSERT_EQ(block.Counter(), view.Counter());
+    ASSERT_EQ(block.Timestamp(), view.Timestamp());
+    ASSERT_EQ(block.Height(), view.Height());
+    ASSERT_EQ(block.Account(), view.Account());
+    ASSERT_EQ(block.Previous(), view.Previous());
+    ASSERT_EQ(block.Representative(), view.Representative());
+    ASSERT_EQ(block.Balance(), view.Balance());
+    ASSERT_EQ(block.Link(), view.Link());
+    ASSERT_EQ(block.Extensions(), view.Extensions());
+    ASSERT_EQ(11, view.ExtensionsLength());
+    ASSERT_EQ(block.Signature(), view.Signature());
+    ASSERT_FALSE(view.HasChain());
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    std::unique_ptr<rai::Block> ptr = view.Materialize(error_code);
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    ASSERT_EQ(block, *ptr);
+
+    error = view.Parse(bytes.data(), block.Size() - 1);
+    ASSERT_TRUE(error);
+
+    rai::AdBlock ad_block(rai::BlockOpcode::DESTROY, 1, 1, 1541128318, 1,
+                          account, hash, representive, balance, link, raw_key,
+                          public_key);
+    bytes.clear();
+    {
+        rai::VectorStream stream(bytes);
+        ad_block.Serialize(stream);
+    }
+    error = view.Parse(bytes.data(), bytes.size());
+    ASSERT_FALSE(error);
+    ASSERT_EQ(ad_block.Hash(), view.Hash());
+    ASSERT_EQ(ad_block.Representative(), view.Representative());
+    ASSERT_EQ(ad_block.Balance(), view.Balance());
+    ASSERT_EQ(ad_block.Link(), view.Link());
+    ASSERT_EQ(ad_block.Signature(), view.Signature());
+    ASSERT_TRUE(view.Extensions().empty());
+}
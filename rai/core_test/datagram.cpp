@@ -0,0 +1,164 @@
+#include <rai/common/datagram.hpp>
+#include <gtest/gtest.h>
+#include <rai/core_test/test_util.hpp>
+#include <rai/common/numbers.hpp>
+#include <rai/node/message.hpp>
+
+TEST(ArrayStream, Overflow)
+{
+    std::array<uint8_t, 8> buffer;
+    rai::ArrayStream stream(buffer.data(), buffer.size());
+    rai::Write(stream, static_cast<uint32_t>(0x01020304));
+    ASSERT_EQ(4, stream.Size());
+    ASSERT_FALSE(stream.Overflow());
+    ASSERT_EQ(1, buffer[0]);
+    ASSERT_EQ(4, buffer[3]);
+
+    rai::Write(stream, static_cast<uint32_t>(5));
+    ASSERT_EQ(8, stream.Size());
+    ASSERT_FALSE(stream.Overflow());
+
+    rai::Write(stream, static_cast<uint8_t>(6));
+    ASSERT_EQ(8, stream.Size());
+    ASSERT_TRUE(stream.Overflow());
+}
+
+TEST(DatagramPool, RefCount)
+{
+    rai::DatagramPool pool;
+    ASSERT_EQ(0, pool.Chunks());
+    {
+        rai::DatagramPtr datagram = pool.Acquire();
+        ASSERT_EQ(1, pool.Chunks());
+        ASSERT_EQ(rai::DatagramPool::CHUNK_SIZE - 1, pool.Free());
+        ASSERT_EQ(0, datagram->Size());
+        {
+            rai::DatagramPtr copy(datagram);
+        }
+        ASSERT_EQ(rai::DatagramPool::CHUNK_SIZE - 1, pool.Free());
+    }
+    ASSERT_EQ(rai::DatagramPool::CHUNK_SIZE, pool.Free());
+
+    std::vector<rai::DatagramPtr> datagrams;
+    for (size_t i = 0; i <= rai::DatagramPool::CHUNK_SIZE; ++i)
+    {
+        datagrams.push_back(pool.Acquire());
+    }
+    ASSERT_EQ(2, pool.Chunks());
+    datagrams.clear();
+    ASSERT_EQ(2 * rai::DatagramPool::CHUNK_SIZE, pool.Free());
+}
+
+// Serializing messages into pooled datagrams and passing them around must
+// not touch the allocator once the pool is warm
+TEST(DatagramPool, Allocations)
+{
+    rai::DatagramPool pool;
+    std::vector<rai::DatagramPtr> in_flight;
+    in_flight.reserve(16);
+    for (size_t i = 0; i < in_flight.capacity(); ++i)
+    {
+        in_flight.push_back(pool.Acquire());
+    }
+    in_flight.clear();
+
+    rai::Account account(1);
+    std::vector<std::pair<rai::Account, rai::Endpoint>> peers;
+    for (uint32_t i = 0; i < rai::KeepliveMessage::MAX_PEERS; ++i)
+    {
+        peers.emplace_back(rai::Account(i + 2),
+                           rai::Endpoint(rai::IP(0x7F000001), 7000 + i));
+    }
+    rai::KeepliveMessage keeplive(peers, account, 4);
+    std::shared_ptr<rai::Block> block(new rai::TxBlock(
+        rai::BlockOpcode::SEND, 1, 1, 1541128318, 1, account, rai::BlockHash(),
+        account, rai::Amount(1), rai::uint256_union(2), 11,
+        {0, 2, 0, 7, 'r', 'a', 'i', 'c', 'o', 'i', 'n'}));
+    rai::PublishMessage publish(block);
+    std::vector<const rai::Message*> messages{&keeplive, &publish};
+
+    std::vector<uint8_t> expected;
+    publish.ToBytes(expected);
+
+    bool overflow = false;
+    bool mismatch = false;
+    uint64_t allocations = 0;
+    {
+        TestAllocationCounter counter;
+        for (uint64_t i = 0; i < 10000; ++i)
+        {
+            const rai::Message& message = *messages[i % messages.size()];
+            rai::DatagramPtr datagram = pool.Acquire();
+            size_t size = 0;
+            overflow |= message.ToBytes(datagram->Data(),
+                                        rai::Datagram::CAPACITY, size);
+            datagram->Resize(size);
+            if (&message == &publish)
+            {
+                mismatch |= datagram->Size() != expected.size()
+                            || !std::equal(expected.begin(), expected.end(),
+                                           datagram->Data());
+            }
+
+            in_flight.push_back(datagram);
+            if (in_flight.size() == in_flight.capacity())
+            {
+                in_flight.clear();
+            }
+        }
+        allocations = counter.Count();
+    }
+    ASSERT_EQ(0, allocations);
+    ASSERT_FALSE(overflow);
+    ASSERT_FALSE(mismatch);
+    ASSERT_EQ(1, pool.Chunks());
+
+    // broadcasts share one payload between direct and proxied peers, and
+    // proxied sends measure the payload in pooled datagrams too
+    rai::Endpoint peer(rai::IP(0x7F000001), 7001);
+    rai::Endpoint proxy(rai::IP(0x7F000002), 7002);
+    rai::UdpBatch batch;
+    publish.EnableProxy(peer);
+    uint16_t payload_length = publish.header_.payload_length_;
+    bool full = false;
+    {
+        TestAllocationCounter counter;
+        for (uint64_t i = 0; i < 10000; ++i)
+        {
+            publish.EnableProxy(peer);
+            overflow |= publish.ToBatch(pool.Acquire(), batch);
+            full |= publish.AddToBatch(batch, peer);
+            full |= publish.AddToBatch(batch, proxy, peer);
+        }
+        allocations = counter.Count();
+    }
+    ASSERT_EQ(0, allocations);
+    ASSERT_FALSE(overflow);
+    ASSERT_FALSE(full);
+    ASSERT_FALSE(publish.GetFlag(rai::MessageFlags::PROXY));
+
+    ASSERT_EQ(2, batch.Size());
+    ASSERT_EQ(payload_length, batch.PayloadSize());
+    ASSERT_EQ(expected.size(), batch.offset_ + batch.PayloadSize());
+    ASSERT_EQ(peer, batch.remotes_[0]);
+    rai::DatagramPtr direct = batch.Assemble(0);
+    ASSERT_NE(nullptr, direct);
+    ASSERT_EQ(expected.size(), direct->Size());
+    ASSERT_TRUE(
+        std::equal(expected.begin(), expected.end(), direct->Data()));
+
+    ASSERT_EQ(proxy, batch.remotes_[1]);
+    rai::DatagramPtr proxied = batch.Assemble(1);
+    ASSERT_NE(nullptr, proxied);
+    rai::BufferStream stream(proxied->Data(), proxied->Size());
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::MessageHeader header(error_code, stream);
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    ASSERT_TRUE(header.GetFlag(rai::MessageFlags::PROXY));
+    ASSERT_EQ(peer, header.peer_endpoint_);
+    ASSERT_EQ(payload_length, header.payload_length_);
+    ASSERT_EQ(batch.prefix_sizes_[1] + payload_length, proxied->Size());
+    ASSERT_TRUE(std::equal(batch.Payload(),
+                           batch.Payload() + batch.PayloadSize(),
+                           proxied->Data() + batch.prefix_sizes_[1]));
+}
@@ -0,0 +1,207 @@
+#include <rai/node/dispatcher.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <gtest/gtest.h>
+#include <rai/core_test/test_util.hpp>
+
+namespace
+{
+std::vector<uint8_t> Bytes(rai::MessageType type, uint8_t id)
+{
+    std::vector<uint8_t> bytes;
+    {
+        rai::VectorStream stream(bytes);
+        rai::MessageHeader(type).Serialize(stream);
+        rai::Write(stream, id);
+    }
+    return bytes;
+}
+
+// Records the processed messages, the first one holds its worker until
+// Release() so the test can fill the queues behind it
+class Recorder
+{
+public:
+    Recorder() : held_(true), entered_(false)
+    {
+    }
+
+    void Handle(const rai::Endpoint& remote, rai::Stream& stream)
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::MessageHeader header(error_code, stream);
+        uint8_t id = 0;
+        rai::Read(stream, id);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        entered_ = true;
+        condition_.notify_all();
+        condition_.wait(lock, [this]() { return !held_; });
+        processed_.emplace_back(header.type_, id);
+        condition_.notify_all();
+    }
+
+    bool WaitEntered()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return !condition_.wait_for(lock, std::chrono::seconds(30),
+                                    [this]() { return entered_; });
+    }
+
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        held_ = false;
+        condition_.notify_all();
+    }
+
+    bool Wait(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return !condition_.wait_for(lock, std::chrono::seconds(30), [&]() {
+            return processed_.size() >= count;
+        });
+    }
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool held_;
+    bool entered_;
+    std::vector<std::pair<rai::MessageType, uint8_t>> processed_;
+};
+
+rai::MessageHandler Handler(Recorder& recorder)
+{
+    return [&recorder](const rai::Endpoint& remote, rai::Stream& stream) {
+        recorder.Handle(remote, stream);
+    };
+}
+
+void Push(rai::MessageDispatcher& dispatcher, rai::MessageType type,
+          uint8_t id)
+{
+    std::vector<uint8_t> bytes = Bytes(type, id);
+    dispatcher.Push(rai::Endpoint(rai::IP(0x7F000001), 7000), bytes.data(),
+                    bytes.size());
+}
+
+rai::Ptree QueueStatus(const rai::MessageDispatcher& dispatcher,
+                       rai::MessageType type)
+{
+    rai::Ptree ptree;
+    dispatcher.Status(ptree);
+    for (const auto& i : ptree.get_child("queues"))
+    {
+        if (i.second.get<std::string>("type")
+            == rai::MessageTypeToString(type))
+        {
+            return i.second;
+        }
+    }
+    return rai::Ptree();
+}
+
+rai::MessageQueueOptions& Options(rai::MessageDispatcherConfig& config,
+                                  rai::MessageType type)
+{
+    return config.queues_[static_cast<size_t>(type)];
+}
+}  // namespace
+
+TEST(MessageDispatcher, Weights)
+{
+    rai::MessageDispatcherConfig config;
+    config.workers_ = 1;
+    Options(config, rai::MessageType::KEEPLIVE).weight_ = 2;
+    Options(config, rai::MessageType::PUBLISH).weight_ = 3;
+    Options(config, rai::MessageType::CONFIRM).weight_ = 1;
+
+    Recorder recorder;
+    rai::MessageDispatcher dispatcher(config, Handler(recorder));
+    Push(dispatcher, rai::MessageType::HANDSHAKE, 0);
+    ASSERT_FALSE(recorder.WaitEntered());
+    for (uint8_t i = 0; i < 6; ++i)
+    {
+        Push(dispatcher, rai::MessageType::PUBLISH, i);
+    }
+    for (uint8_t i = 0; i < 2; ++i)
+    {
+        Push(dispatcher, rai::MessageType::CONFIRM, i);
+        Push(dispatcher, rai::MessageType::KEEPLIVE, i);
+    }
+    ASSERT_EQ(10, dispatcher.Size());
+    recorder.Release();
+    ASSERT_FALSE(recorder.Wait(11));
+    dispatcher.Stop();
+
+    // each queue is served up to its weight per round, in type order
+    std::vector<std::pair<rai::MessageType, uint8_t>> expected{
+        {rai::MessageType::HANDSHAKE, 0}, {rai::MessageType::KEEPLIVE, 0},
+        {rai::MessageType::KEEPLIVE, 1},  {rai::MessageType::PUBLISH, 0},
+        {rai::MessageType::PUBLISH, 1},   {rai::MessageType::PUBLISH, 2},
+        {rai::MessageType::CONFIRM, 0},   {rai::MessageType::PUBLISH, 3},
+        {rai::MessageType::PUBLISH, 4},   {rai::MessageType::PUBLISH, 5},
+        {rai::MessageType::CONFIRM, 1}};
+    ASSERT_EQ(expected, recorder.processed_);
+    ASSERT_EQ(0, dispatcher.Size());
+    ASSERT_EQ(6, QueueStatus(dispatcher, rai::MessageType::PUBLISH)
+                     .get<size_t>("processed"));
+}
+
+TEST(MessageDispatcher, DropPolicy)
+{
+    rai::MessageDispatcherConfig config;
+    config.workers_ = 1;
+    Options(config, rai::MessageType::PUBLISH) =
+        rai::MessageQueueOptions(2, 1, rai::MessageDropPolicy::NEWEST);
+    Options(config, rai::MessageType::CONFIRM) =
+        rai::MessageQueueOptions(2, 1, rai::MessageDropPolicy::OLDEST);
+
+    Recorder recorder;
+    rai::MessageDispatcher dispatcher(config, Handler(recorder));
+    Push(dispatcher, rai::MessageType::HANDSHAKE, 0);
+    ASSERT_FALSE(recorder.WaitEntered());
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        Push(dispatcher, rai::MessageType::PUBLISH, i);
+        Push(dispatcher, rai::MessageType::CONFIRM, i);
+    }
+    ASSERT_EQ(4, dispatcher.Size());
+    for (auto type : {rai::MessageType::PUBLISH, rai::MessageType::CONFIRM})
+    {
+        rai::Ptree status = QueueStatus(dispatcher, type);
+        ASSERT_EQ(2, status.get<size_t>("depth"));
+        ASSERT_EQ(1, status.get<size_t>("dropped"));
+    }
+    recorder.Release();
+    ASSERT_FALSE(recorder.Wait(5));
+    dispatcher.Stop();
+
+    // a full NEWEST queue rejects the arrival, an OLDEST one evicts its head
+    std::vector<std::pair<rai::MessageType, uint8_t>> expected{
+        {rai::MessageType::HANDSHAKE, 0}, {rai::MessageType::PUBLISH, 0},
+        {rai::MessageType::CONFIRM, 1},   {rai::MessageType::PUBLISH, 1},
+        {rai::MessageType::CONFIRM, 2}};
+    ASSERT_EQ(expected, recorder.processed_);
+}
+
+TEST(MessageDispatcher, Stop)
+{
+    rai::MessageDispatcherConfig config;
+    config.workers_ = 4;
+    Recorder recorder;
+    recorder.Release();
+    rai::MessageDispatcher dispatcher(config, Handler(recorder));
+
+    // idle workers wake up and are joined
+    dispatcher.Stop();
+    rai::Ptree ptree;
+    dispatcher.Status(ptree);
+    ASSERT_EQ(4, ptree.get<size_t>("workers"));
+
+    Push(dispatcher, rai::MessageType::PUBLISH, 0);
+    ASSERT_EQ(0, dispatcher.Size());
+    dispatcher.Stop();
+    ASSERT_TRUE(recorder.processed_.empty());
+}
@@ -1,10 +1,30 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <thread>
 #include <gtest/gtest.h>
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 #include <boost/filesystem.hpp>
 #include <rai/core_test/config.hpp>
 #include <rai/core_test/test_util.hpp>
 #include <rai/secure/ledger.hpp>
+#include <rai/secure/snapshot.hpp>
 
-TEST(Ledger, Abort)
+// tests that do not depend on the ledger file run against every engine
+class LedgerEngine : public ::testing::TestWithParam<rai::StoreEngineType>
+{
+};
+
+INSTANTIATE_TEST_CASE_P(Ledger, LedgerEngine,
+                        ::testing::Values(rai::StoreEngineType::LMDB,
+                                          rai::StoreEngineType::MEMORY));
+
+TEST_P(LedgerEngine, Abort)
 {
     auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
     auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
@@ -20,7 +40,7 @@ TEST(Ledger, Abort)
 
     {
         rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-        rai::Store store(error_code, data_file);
+        rai::Store store(error_code, data_file, GetParam());
         rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
 
         {
@@ -117,4 +137,2200 @@ TEST(Ledger, Abort)
 
     boost::filesystem::remove(data_file);
     boost::filesystem::remove(lock_file);
-}
\ No newline at end of file
+}
+TEST_P(LedgerEngine, BlockCache)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, GetParam());
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+
+        rai::RawKey raw_key;
+        raw_key.data_.DecodeHex(
+            "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+        rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+        rai::TxBlock block(rai::BlockOpcode::SEND, 1, 1, 1541128318, 1,
+                           public_key, rai::BlockHash(1), public_key,
+                           rai::Amount(1), rai::uint256_union(2), 0,
+                           std::vector<uint8_t>(), raw_key, public_key);
+        rai::BlockHash hash = block.Hash();
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = ledger.BlockPut(transaction, hash, block);
+            EXPECT_EQ(false, error);
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            std::shared_ptr<rai::Block> block_l(nullptr);
+            bool error = ledger.BlockGet(transaction, hash, block_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(block, *block_l);
+            error = ledger.BlockGet(transaction, hash, block_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(block, *block_l);
+        }
+
+        rai::Ptree status;
+        ledger.BlockCacheStatus(status);
+        EXPECT_EQ("1", status.get<std::string>("hits"));
+        EXPECT_EQ("1", status.get<std::string>("misses"));
+        EXPECT_EQ("1", status.get<std::string>("size"));
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = ledger.BlockDel(transaction, hash);
+            EXPECT_EQ(false, error);
+            transaction.Abort();
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            std::shared_ptr<rai::Block> block_l(nullptr);
+            bool error = ledger.BlockGet(transaction, hash, block_l);
+            EXPECT_EQ(false, error);
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = ledger.BlockDel(transaction, hash);
+            EXPECT_EQ(false, error);
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            std::shared_ptr<rai::Block> block_l(nullptr);
+            bool error = ledger.BlockGet(transaction, hash, block_l);
+            EXPECT_EQ(true, error);
+        }
+
+        // a block committed after the snapshot of a reader was taken must not
+        // reach it through the cache
+        {
+            rai::Transaction reader(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+            {
+                rai::Transaction transaction(error_code, ledger, true);
+                EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+                bool error = ledger.BlockPut(transaction, hash, block);
+                EXPECT_EQ(false, error);
+            }
+
+            {
+                rai::Transaction transaction(error_code, ledger, false);
+                EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+                std::shared_ptr<rai::Block> block_l(nullptr);
+                bool error = ledger.BlockGet(transaction, hash, block_l);
+                EXPECT_EQ(false, error);
+            }
+
+            std::shared_ptr<rai::Block> block_l(nullptr);
+            bool error = ledger.BlockGet(reader, hash, block_l);
+            EXPECT_EQ(true, error);
+            error = ledger.BlockGet(reader, block.Account(), block.Height(),
+                                    block_l);
+            EXPECT_EQ(true, error);
+
+            rai::ErrorCode error_code_l = reader.Renew();
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code_l);
+            error = ledger.BlockGet(reader, hash, block_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(block, *block_l);
+        }
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST_P(LedgerEngine, AccountInfoCache)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, GetParam());
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+
+        rai::Account account(1);
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, rai::BlockHash(2));
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = ledger.AccountInfoPut(transaction, account, info);
+            EXPECT_EQ(false, error);
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info_l;
+            bool error = ledger.AccountInfoGet(transaction, account, info_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(info.head_, info_l.head_);
+        }
+
+        rai::Ptree status;
+        ledger.AccountInfoCacheStatus(status);
+        EXPECT_EQ("1", status.get<std::string>("hits"));
+        EXPECT_EQ("0", status.get<std::string>("misses"));
+        EXPECT_EQ("1", status.get<std::string>("size"));
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info_l(info);
+            info_l.head_ = 3;
+            bool error = ledger.AccountInfoPut(transaction, account, info_l);
+            EXPECT_EQ(false, error);
+            error = ledger.AccountInfoGet(transaction, account, info_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(rai::BlockHash(3), info_l.head_);
+            transaction.Abort();
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info_l;
+            bool error = ledger.AccountInfoGet(transaction, account, info_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(info.head_, info_l.head_);
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = ledger.AccountInfoDel(transaction, account);
+            EXPECT_EQ(false, error);
+        }
+
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info_l;
+            bool error = ledger.AccountInfoGet(transaction, account, info_l);
+            EXPECT_EQ(true, error);
+        }
+
+        // readers racing with commits: the account info and the version are
+        // written together, so a reader must see them from the same snapshot
+        // whether the account info comes from the cache or not
+        auto commit = [&](uint32_t version) {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info_l(info);
+            info_l.head_ = version;
+            bool error = ledger.AccountInfoPut(transaction, account, info_l);
+            EXPECT_EQ(false, error);
+            error = ledger.VersionPut(transaction, version);
+            EXPECT_EQ(false, error);
+        };
+        commit(1);
+
+        std::atomic<bool> stopped(false);
+        std::atomic<uint32_t> mismatches(0);
+        std::vector<std::thread> readers;
+        for (size_t i = 0; i < 2; ++i)
+        {
+            readers.emplace_back([&]() {
+                while (!stopped)
+                {
+                    rai::ErrorCode error_code_l = rai::ErrorCode::SUCCESS;
+                    rai::Transaction transaction(error_code_l, ledger, false);
+                    uint32_t version = 0;
+                    bool error = ledger.VersionGet(transaction, version);
+                    rai::AccountInfo info_l;
+                    if (!error)
+                    {
+                        error =
+                            ledger.AccountInfoGet(transaction, account, info_l);
+                    }
+                    if (error_code_l != rai::ErrorCode::SUCCESS || error
+                        || info_l.head_ != rai::BlockHash(version))
+                    {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+
+        for (uint32_t version = 2; version <= 1000; ++version)
+        {
+            commit(version);
+        }
+        stopped = true;
+        for (auto& i : readers)
+        {
+            i.join();
+        }
+        EXPECT_EQ(0, mismatches);
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST(Ledger, BlockIndex)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 20; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), rai::uint256_union(2),
+            0, std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE, false,
+                           false,
+                           rai::Ledger::DEFAULT_ACCOUNT_INFO_CACHE_SIZE, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(true, ledger.BlockIndexDense());
+
+        rai::Transaction transaction(error_code, ledger, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            rai::BlockHash successor(0);
+            if (i + 1 < blocks.size())
+            {
+                successor = blocks[i + 1]->Hash();
+            }
+            bool error = ledger.BlockPut(transaction, blocks[i]->Hash(),
+                                         *blocks[i], successor);
+            EXPECT_EQ(false, error);
+        }
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+        info.head_height_ = blocks.back()->Height();
+        info.head_ = blocks.back()->Hash();
+        bool error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+
+        std::vector<std::shared_ptr<rai::Block>> range;
+        error = ledger.BlocksRange(transaction, public_key, 5, 4, range);
+        EXPECT_EQ(false, error);
+        ASSERT_EQ(4, range.size());
+        for (size_t i = 0; i < range.size(); ++i)
+        {
+            EXPECT_EQ(*blocks[5 + i], *range[i]);
+        }
+        error = ledger.BlocksRange(transaction, public_key, 17, 10, range);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(3, range.size());
+
+        // pretend the ledger was created before the dense index existed
+        error = ledger.VersionPut(transaction, 1);
+        EXPECT_EQ(false, error);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE, false,
+                           false,
+                           rai::Ledger::DEFAULT_ACCOUNT_INFO_CACHE_SIZE, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(false, ledger.BlockIndexDense());
+
+        bool finished = false;
+        size_t loops = 0;
+        while (!finished && loops < 100)
+        {
+            error_code = ledger.BlockIndexMigrate(3, finished);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            ++loops;
+        }
+        EXPECT_EQ(true, finished);
+        EXPECT_EQ(true, ledger.BlockIndexDense());
+
+        rai::Transaction transaction(error_code, ledger, false);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        uint32_t version = 0;
+        bool error = ledger.VersionGet(transaction, version);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(3, version);
+        for (const auto& block : blocks)
+        {
+            std::shared_ptr<rai::Block> block_l(nullptr);
+            error = ledger.BlockGet(transaction, public_key, block->Height(),
+                                    block_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(*block, *block_l);
+        }
+        std::shared_ptr<rai::Block> block_l(nullptr);
+        error = ledger.BlockGet(transaction, public_key, 20, block_l);
+        EXPECT_EQ(true, error);
+    }
+
+    // the dense index is off by default, heights are found by the sparse walk
+    // and indexed again once it is turned back on
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(false, ledger.BlockIndexDense());
+        bool finished = false;
+        error_code = ledger.BlockIndexMigrate(3, finished);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(true, finished);
+        EXPECT_EQ(false, ledger.BlockIndexDense());
+
+        rai::Transaction transaction(error_code, ledger, false);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        for (const auto& block : blocks)
+        {
+            std::shared_ptr<rai::Block> block_l(nullptr);
+            bool error = ledger.BlockGet(transaction, public_key,
+                                         block->Height(), block_l);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(*block, *block_l);
+        }
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE, false,
+                           false,
+                           rai::Ledger::DEFAULT_ACCOUNT_INFO_CACHE_SIZE, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(false, ledger.BlockIndexDense());
+        bool finished = false;
+        size_t loops = 0;
+        while (!finished && loops < 100)
+        {
+            error_code = ledger.BlockIndexMigrate(3, finished);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            ++loops;
+        }
+        EXPECT_EQ(true, finished);
+        EXPECT_EQ(true, ledger.BlockIndexDense());
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST(Ledger, MemoryTablesSnapshot)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), rai::uint256_union(2),
+            0, std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        rai::Transaction transaction(error_code, ledger, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            rai::BlockHash successor(0);
+            if (i + 1 < blocks.size())
+            {
+                successor = blocks[i + 1]->Hash();
+            }
+            bool error = ledger.BlockPut(transaction, blocks[i]->Hash(),
+                                         *blocks[i], successor);
+            EXPECT_EQ(false, error);
+        }
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+        info.head_height_ = blocks[4]->Height();
+        info.head_ = blocks[4]->Hash();
+        bool error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+    }
+
+    {
+        // the accounts changed since the last checkpoint are replayed
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Amount weight;
+        bool error = ledger.RepWeightGet(public_key, weight);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(rai::Amount(96), weight);
+
+        rai::Transaction transaction(error_code, ledger, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::AccountInfo info;
+        error = ledger.AccountInfoGet(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+        info.head_height_ = blocks.back()->Height();
+        info.head_ = blocks.back()->Hash();
+        error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Amount weight;
+        bool error = ledger.RepWeightGet(public_key, weight);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(rai::Amount(91), weight);
+        rai::Amount total;
+        ledger.RepWeightTotalGet(total);
+        EXPECT_EQ(rai::Amount(91), total);
+
+        error_code = ledger.MemoryTablesCheckpoint();
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    }
+
+    {
+        // loaded from the snapshot alone
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Amount weight;
+        bool error = ledger.RepWeightGet(public_key, weight);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(rai::Amount(91), weight);
+    }
+
+    {
+        // a commit that bypasses the ledger, like one of an older binary
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::MdbTransaction transaction(error_code, store.env_, nullptr, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+        info.head_height_ = blocks[2]->Height();
+        info.head_ = blocks[2]->Hash();
+        std::vector<uint8_t> bytes;
+        {
+            rai::VectorStream stream(bytes);
+            info.Serialize(stream);
+        }
+        rai::MdbVal key(public_key);
+        rai::MdbVal value(bytes.size(), bytes.data());
+        bool error = store.Put(transaction, store.accounts_, key, value);
+        EXPECT_EQ(false, error);
+    }
+
+    {
+        // the marker no longer matches the last commit, the tables are
+        // rebuilt by a full scan
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Amount weight;
+        bool error = ledger.RepWeightGet(public_key, weight);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(rai::Amount(98), weight);
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+namespace
+{
+// returns true if the memory tables marker matches the last commit
+bool MemoryTablesMarkerCurrent(const boost::filesystem::path& data_file)
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, data_file);
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    rai::MdbTransaction transaction(error_code, store.env_, nullptr, false);
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+    std::vector<uint8_t> bytes;
+    {
+        rai::VectorStream stream(bytes);
+        rai::Write(stream, rai::MetaKey::MEMORY_TABLES_SEQUENCE);
+    }
+    rai::MdbVal value;
+    bool error = store.Get(transaction, store.meta_,
+                           rai::MdbVal(bytes.size(), bytes.data()), value);
+    if (error)
+    {
+        return false;
+    }
+    uint64_t marker = 0;
+    rai::BufferStream stream(value.Data(), value.Size());
+    error = rai::Read(stream, marker);
+    return !error && marker == store.TxnId(transaction);
+}
+}  // namespace
+
+TEST(Ledger, MemoryTablesSequence)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 3; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), rai::uint256_union(2),
+            0, std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        rai::Transaction transaction(error_code, ledger, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        bool error = ledger.BlockPut(transaction, blocks[0]->Hash(),
+                                     *blocks[0], blocks[1]->Hash());
+        EXPECT_EQ(false, error);
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+        error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+    }
+    EXPECT_TRUE(MemoryTablesMarkerCurrent(data_file));
+
+    {
+        // a write that touches no account, like a block index migration or
+        // a sweep, keeps the marker current
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        rai::Transaction transaction(error_code, ledger, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        bool error = ledger.BlockPut(transaction, blocks[1]->Hash(),
+                                     *blocks[1], blocks[2]->Hash());
+        EXPECT_EQ(false, error);
+    }
+    EXPECT_TRUE(MemoryTablesMarkerCurrent(data_file));
+
+    {
+        // reopening loads the snapshot and keeps the marker current
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Amount weight;
+        bool error = ledger.RepWeightGet(public_key, weight);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(rai::Amount(100), weight);
+    }
+    EXPECT_TRUE(MemoryTablesMarkerCurrent(data_file));
+
+    {
+        // a commit outside of the ledger still leaves the marker behind
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::MdbTransaction transaction(error_code, store.env_, nullptr, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Account account(1);
+        bool error = store.Put(transaction, store.accounts_changed_,
+                               rai::MdbVal(account), rai::MdbVal(account));
+        EXPECT_EQ(false, error);
+    }
+    EXPECT_FALSE(MemoryTablesMarkerCurrent(data_file));
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST_P(LedgerEngine, ParallelScan)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, GetParam());
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        std::set<rai::Account> accounts;
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            for (uint32_t i = 0; i < 1000; ++i)
+            {
+                rai::Account account(i);
+                account.bytes[0] = static_cast<uint8_t>(i * 7);
+                rai::AccountInfo info(rai::BlockType::TX_BLOCK,
+                                      rai::BlockHash(i + 1));
+                bool error = ledger.AccountInfoPut(transaction, account, info);
+                EXPECT_EQ(false, error);
+                accounts.insert(account);
+            }
+        }
+
+        for (size_t shards : {1, 3, 8, 256})
+        {
+            std::vector<std::vector<rai::Account>> results(shards);
+            error_code = ledger.ParallelScan(
+                store.accounts_, shards,
+                [&](size_t shard, rai::Transaction& transaction,
+                    rai::Iterator& i) -> rai::ErrorCode {
+                    rai::Account account;
+                    rai::AccountInfo info;
+                    bool error = ledger.AccountInfoGet(i, account, info);
+                    if (error)
+                    {
+                        return rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET;
+                    }
+                    results[shard].push_back(account);
+                    return rai::ErrorCode::SUCCESS;
+                });
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+            std::set<rai::Account> scanned;
+            size_t count = 0;
+            for (const auto& result : results)
+            {
+                count += result.size();
+                scanned.insert(result.begin(), result.end());
+            }
+            EXPECT_EQ(accounts.size(), count);
+            EXPECT_EQ(accounts, scanned);
+        }
+
+        error_code = ledger.ParallelScan(
+            store.accounts_, 4,
+            [&](size_t shard, rai::Transaction& transaction,
+                rai::Iterator& i) -> rai::ErrorCode {
+                return rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET;
+            });
+        EXPECT_EQ(rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET, error_code);
+
+        error_code = ledger.ParallelScan(
+            store.accounts_, 0,
+            [&](size_t shard, rai::Transaction& transaction,
+                rai::Iterator& i) -> rai::ErrorCode {
+                return rai::ErrorCode::SUCCESS;
+            });
+        EXPECT_EQ(rai::ErrorCode::LEDGER_PARALLEL_SCAN, error_code);
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST_P(LedgerEngine, ReceivablesIndex)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    rai::Account destination(2);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), destination, 0,
+            std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, GetParam());
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(true, ledger.ReceivablesIndexed());
+
+        rai::Transaction transaction(error_code, ledger, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            rai::BlockHash successor(0);
+            if (i + 1 < blocks.size())
+            {
+                successor = blocks[i + 1]->Hash();
+            }
+            bool error = ledger.BlockPut(transaction, blocks[i]->Hash(),
+                                         *blocks[i], successor);
+            EXPECT_EQ(false, error);
+        }
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+        info.head_height_ = blocks.back()->Height();
+        info.head_ = blocks.back()->Hash();
+        info.confirmed_height_ = 3;
+        bool error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            // amounts out of height order
+            rai::ReceivableInfo receivable(public_key,
+                                           rai::Amount((i * 7) % 10 + 1),
+                                           blocks[i]->Timestamp());
+            error = ledger.ReceivableInfoPut(transaction, destination,
+                                             blocks[i]->Hash(), receivable);
+            EXPECT_EQ(false, error);
+        }
+
+        rai::ReceivableInfos receivables;
+        error = ledger.ReceivableInfosGet(
+            transaction, destination, rai::ReceivableInfosType::CONFIRMED,
+            receivables);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(4, receivables.size());
+
+        receivables.clear();
+        error = ledger.ReceivableInfosGet(
+            transaction, destination, rai::ReceivableInfosType::NOT_CONFIRMED,
+            receivables, 3);
+        EXPECT_EQ(false, error);
+        ASSERT_EQ(3, receivables.size());
+        // heights 4 ~ 9 carry the amounts 9, 6, 3, 10, 7, 4
+        auto it = receivables.begin();
+        EXPECT_EQ(rai::Amount(10), it->first.amount_);
+        EXPECT_EQ(blocks[7]->Hash(), it->second);
+        ++it;
+        EXPECT_EQ(rai::Amount(9), it->first.amount_);
+        ++it;
+        EXPECT_EQ(rai::Amount(7), it->first.amount_);
+
+        info.confirmed_height_ = 6;
+        error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+        error = ledger.ReceivablesConfirmedSet(transaction, public_key, 4, 6,
+                                               true);
+        EXPECT_EQ(false, error);
+
+        error = ledger.ReceivableInfoDel(transaction, destination,
+                                         blocks[0]->Hash());
+        EXPECT_EQ(false, error);
+
+        receivables.clear();
+        error = ledger.ReceivableInfosGet(
+            transaction, destination, rai::ReceivableInfosType::CONFIRMED,
+            receivables);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(6, receivables.size());
+
+        receivables.clear();
+        error = ledger.ReceivableInfosGet(
+            transaction, destination, rai::ReceivableInfosType::ALL,
+            receivables);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(9, receivables.size());
+
+        rai::ReceivableInfosAll receivables_all;
+        error = ledger.ReceivableInfosGet(
+            transaction, rai::ReceivableInfosType::NOT_CONFIRMED,
+            receivables_all);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(3, receivables_all.size());
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST_P(LedgerEngine, Prune)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    rai::Account destination(2);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 20; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), destination, 0,
+            std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, GetParam());
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE, false,
+                           false,
+                           rai::Ledger::DEFAULT_ACCOUNT_INFO_CACHE_SIZE, true);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                rai::BlockHash successor(0);
+                if (i + 1 < blocks.size())
+                {
+                    successor = blocks[i + 1]->Hash();
+                }
+                bool error = ledger.BlockPut(transaction, blocks[i]->Hash(),
+                                             *blocks[i], successor);
+                EXPECT_EQ(false, error);
+            }
+            rai::AccountInfo info(rai::BlockType::TX_BLOCK,
+                                  blocks[0]->Hash());
+            info.head_height_ = blocks.back()->Height();
+            info.head_ = blocks.back()->Hash();
+            info.confirmed_height_ = info.head_height_;
+            bool error = ledger.AccountInfoPut(transaction, public_key, info);
+            EXPECT_EQ(false, error);
+
+            // an unreceived send stops the tail
+            rai::ReceivableInfo receivable(public_key, rai::Amount(1),
+                                           blocks[12]->Timestamp());
+            error = ledger.ReceivableInfoPut(transaction, destination,
+                                             blocks[12]->Hash(), receivable);
+            EXPECT_EQ(false, error);
+        }
+
+        rai::Account cursor(0);
+        bool finished = false;
+        error_code = ledger.Prune(5, 0, 1000, cursor, finished);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(true, finished);
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info;
+            bool error = ledger.AccountInfoGet(transaction, public_key, info);
+            EXPECT_EQ(false, error);
+            EXPECT_EQ(12, info.tail_height_);
+            EXPECT_EQ(blocks[12]->Hash(), info.tail_);
+            EXPECT_EQ(false,
+                      ledger.BlockExists(transaction, blocks[11]->Hash()));
+            EXPECT_EQ(true,
+                      ledger.BlockExists(transaction, blocks[12]->Hash()));
+            std::shared_ptr<rai::Block> block(nullptr);
+            error = ledger.BlockGet(transaction, public_key, 5, block);
+            EXPECT_EQ(true, error);
+
+            error = ledger.ReceivableInfoDel(transaction, destination,
+                                             blocks[12]->Hash());
+            EXPECT_EQ(false, error);
+        }
+
+        // the depth keeps heights 15 ~ 19
+        error_code = ledger.Prune(5, 0, 2, cursor, finished);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(false, finished);
+        error_code = ledger.Prune(5, 0, 2, cursor, finished);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        rai::Transaction transaction(error_code, ledger, false);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::AccountInfo info;
+        bool error = ledger.AccountInfoGet(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(15, info.tail_height_);
+        std::shared_ptr<rai::Block> block(nullptr);
+        error = ledger.BlockGet(transaction, public_key, 15, block);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(*blocks[15], *block);
+
+        rai::Ptree status;
+        ledger.PruneStatus(status);
+        EXPECT_EQ("15", status.get<std::string>("pruned_blocks"));
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST(Ledger, Snapshot)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+    auto snapshot_dir = boost::filesystem::current_path() / "snapshot_test";
+    auto import_dir = boost::filesystem::current_path() / "snapshot_import";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+    boost::filesystem::remove_all(snapshot_dir);
+    boost::filesystem::remove_all(import_dir);
+    boost::filesystem::create_directories(import_dir);
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), rai::uint256_union(2),
+            0, std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    rai::SnapshotManifest exported;
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                rai::BlockHash successor(0);
+                if (i + 1 < blocks.size())
+                {
+                    successor = blocks[i + 1]->Hash();
+                }
+                bool error = ledger.BlockPut(transaction, blocks[i]->Hash(),
+                                             *blocks[i], successor);
+                EXPECT_EQ(false, error);
+            }
+            rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+            info.head_height_ = blocks.back()->Height();
+            info.head_ = blocks.back()->Hash();
+            bool error = ledger.AccountInfoPut(transaction, public_key, info);
+            EXPECT_EQ(false, error);
+        }
+
+        error_code = rai::SnapshotExport(store, snapshot_dir, exported);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(3, exported.ledger_version_);
+        EXPECT_EQ(1, exported.account_count_);
+        EXPECT_NE(rai::uint256_union(0), exported.heads_);
+        EXPECT_NE(0, exported.size_);
+        EXPECT_TRUE(
+            boost::filesystem::exists(snapshot_dir / "manifest.json"));
+
+        rai::SnapshotManifest again;
+        error_code = rai::SnapshotExport(store, snapshot_dir, again);
+        EXPECT_EQ(rai::ErrorCode::SNAPSHOT_EXISTS, error_code);
+    }
+
+    {
+        rai::SnapshotManifest imported;
+        rai::ErrorCode error_code =
+            rai::SnapshotImport(snapshot_dir, import_dir, imported);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_TRUE(imported.Match(exported));
+
+        error_code = rai::SnapshotImport(snapshot_dir, import_dir, imported);
+        EXPECT_EQ(rai::ErrorCode::SNAPSHOT_LEDGER_EXISTS, error_code);
+    }
+
+    {
+        // the imported ledger opens as a regular node ledger
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, import_dir / "data.ldb");
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Transaction transaction(error_code, ledger, false);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::AccountInfo info;
+        bool error = ledger.AccountInfoGet(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(blocks.back()->Hash(), info.head_);
+        std::shared_ptr<rai::Block> block(nullptr);
+        error = ledger.BlockGet(transaction, blocks[5]->Hash(), block);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(*blocks[5], *block);
+    }
+
+    {
+        // a damaged snapshot is rejected and nothing is installed
+        boost::filesystem::remove_all(import_dir);
+        boost::filesystem::create_directories(import_dir);
+        std::ofstream stream((snapshot_dir / "data.ldb").string(),
+                             std::ios::out | std::ios::binary | std::ios::app);
+        stream << "junk";
+        stream.close();
+
+        rai::SnapshotManifest imported;
+        rai::ErrorCode error_code =
+            rai::SnapshotImport(snapshot_dir, import_dir, imported);
+        EXPECT_EQ(rai::ErrorCode::SNAPSHOT_CHECKSUM, error_code);
+        EXPECT_FALSE(boost::filesystem::exists(import_dir / "data.ldb"));
+    }
+
+    boost::filesystem::remove_all(snapshot_dir);
+    boost::filesystem::remove_all(import_dir);
+}
+
+TEST_P(LedgerEngine, ReadTransactionPool)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, GetParam());
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+
+        rai::Account account(1);
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, rai::BlockHash(2));
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = ledger.AccountInfoPut(transaction, account, info);
+            EXPECT_EQ(false, error);
+        }
+
+        for (int i = 0; i < 2; ++i)
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info_l;
+            bool error = ledger.AccountInfoGet(transaction, account, info_l);
+            EXPECT_EQ(false, error);
+        }
+
+        rai::Ptree status;
+        ledger.ReadTransactionPoolStatus(status);
+        EXPECT_EQ(1, status.get<size_t>("idle"));
+        EXPECT_LE(1, status.get<uint64_t>("reuses"));
+
+        // the pool is capped well below the reader limit, which is above
+        // the 126 readers lmdb allows by default
+        store.env_.ReadTransactionPoolSize(rai::MdbEnv::MAX_READERS);
+        ledger.ReadTransactionPoolStatus(status);
+        EXPECT_EQ(rai::MdbEnv::MAX_READ_TRANSACTION_POOL_SIZE,
+                  status.get<size_t>("pool_size"));
+        {
+            std::vector<std::unique_ptr<rai::Transaction>> readers;
+            for (size_t i = 0; i < 200; ++i)
+            {
+                readers.emplace_back(
+                    new rai::Transaction(error_code, ledger, false));
+                EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            }
+        }
+        store.env_.ReadTransactionPoolSize(
+            rai::MdbEnv::READ_TRANSACTION_POOL_SIZE);
+
+        // a renewed transaction must see the latest commit
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = ledger.AccountInfoDel(transaction, account);
+            EXPECT_EQ(false, error);
+        }
+        {
+            rai::Transaction transaction(error_code, ledger, false);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::AccountInfo info_l;
+            bool error = ledger.AccountInfoGet(transaction, account, info_l);
+            EXPECT_EQ(true, error);
+        }
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+TEST_P(LedgerEngine, GetMany)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 3; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), rai::Account(2), 0,
+            std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, GetParam());
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            for (uint64_t i = 1; i <= 100; i += 2)
+            {
+                rai::AccountInfo info(rai::BlockType::TX_BLOCK,
+                                      rai::BlockHash(i));
+                bool error =
+                    ledger.AccountInfoPut(transaction, rai::Account(i), info);
+                EXPECT_EQ(false, error);
+            }
+            for (const auto& block : blocks)
+            {
+                bool error =
+                    ledger.BlockPut(transaction, block->Hash(), *block);
+                EXPECT_EQ(false, error);
+            }
+        }
+
+        // unsorted, with duplicates, missing keys and a key past the end
+        std::vector<rai::Account> accounts{
+            rai::Account(51), rai::Account(4), rai::Account(1),
+            rai::Account(99), rai::Account(51), rai::Account(1000),
+            rai::Account(3)};
+        rai::Transaction transaction(error_code, ledger, false);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        std::vector<rai::AccountInfo> infos;
+        bool error = ledger.AccountInfoGetMany(transaction, accounts, infos);
+        EXPECT_EQ(false, error);
+        ASSERT_EQ(accounts.size(), infos.size());
+        for (size_t i = 0; i < accounts.size(); ++i)
+        {
+            rai::AccountInfo info;
+            bool missing =
+                ledger.AccountInfoGet(transaction, accounts[i], info);
+            EXPECT_EQ(missing, !infos[i].Valid());
+            if (!missing)
+            {
+                EXPECT_EQ(accounts[i], infos[i].head_);
+            }
+        }
+
+        std::vector<rai::BlockHash> hashes{blocks[2]->Hash(),
+                                           rai::BlockHash(7),
+                                           blocks[0]->Hash()};
+        std::vector<std::shared_ptr<rai::Block>> blocks_l;
+        error = ledger.BlockGetMany(transaction, hashes, blocks_l);
+        EXPECT_EQ(false, error);
+        ASSERT_EQ(3, blocks_l.size());
+        ASSERT_NE(nullptr, blocks_l[0]);
+        EXPECT_EQ(*blocks[2], *blocks_l[0]);
+        EXPECT_EQ(nullptr, blocks_l[1]);
+        ASSERT_NE(nullptr, blocks_l[2]);
+        EXPECT_EQ(*blocks[0], *blocks_l[2]);
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+
+#ifndef _WIN32
+// A child process commits one account per transaction together with a marker
+// holding the last account written, and is killed in the middle of it. The
+// reopened ledger must hold exactly the accounts up to the marker
+TEST_P(LedgerEngine, Counters)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    rai::Account destination(2);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), destination, 0,
+            std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, data_file, GetParam());
+    rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+    {
+        rai::Transaction transaction(error_code, ledger, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            bool error =
+                ledger.BlockPut(transaction, blocks[i]->Hash(), *blocks[i]);
+            EXPECT_EQ(false, error);
+            rai::ReceivableInfo receivable(public_key, rai::Amount(i + 1),
+                                           blocks[i]->Timestamp());
+            error = ledger.ReceivableInfoPut(transaction, destination,
+                                             blocks[i]->Hash(), receivable);
+            EXPECT_EQ(false, error);
+        }
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+        info.head_height_ = blocks.back()->Height();
+        info.head_ = blocks.back()->Hash();
+        info.confirmed_height_ = 3;
+        bool error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+        error =
+            ledger.ForkPut(transaction, public_key, 5, *blocks[5], *blocks[6]);
+        EXPECT_EQ(false, error);
+        error =
+            ledger.ForkPut(transaction, public_key, 5, *blocks[5], *blocks[7]);
+        EXPECT_EQ(false, error);
+
+        // pending changes are visible to the writing transaction
+        rai::LedgerCounters counters;
+        error = ledger.LedgerCountersGet(transaction, counters);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(10, counters.Get(rai::LedgerCounterType::BLOCKS));
+        EXPECT_EQ(1, counters.Get(rai::LedgerCounterType::FORKS));
+    }
+
+    {
+        rai::Transaction transaction(error_code, ledger, false);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::LedgerCounters stored;
+        bool error = ledger.LedgerCountersGet(transaction, stored);
+        EXPECT_EQ(false, error);
+        rai::LedgerCounters computed;
+        error = ledger.LedgerCountersCompute(transaction, computed);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(computed, stored);
+        EXPECT_EQ(10, stored.Get(rai::LedgerCounterType::BLOCKS));
+        EXPECT_EQ(10,
+                  stored.Get(rai::LedgerCounterType::BLOCK_OPCODE,
+                             static_cast<uint32_t>(rai::BlockOpcode::SEND)));
+        EXPECT_EQ(4, stored.Get(rai::LedgerCounterType::CONFIRMED_BLOCKS));
+        EXPECT_EQ(10, stored.Get(rai::LedgerCounterType::RECEIVABLES));
+        EXPECT_EQ(55, stored.Get(rai::LedgerCounterType::RECEIVABLE_AMOUNT));
+        EXPECT_EQ(1, stored.Get(rai::LedgerCounterType::FORKS));
+    }
+
+    {
+        rai::Transaction transaction(error_code, ledger, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        bool error = ledger.BlockDel(transaction, blocks[9]->Hash());
+        EXPECT_EQ(false, error);
+        error = ledger.ReceivableInfoDel(transaction, destination,
+                                         blocks[9]->Hash());
+        EXPECT_EQ(false, error);
+        error = ledger.ForkDel(transaction, public_key);
+        EXPECT_EQ(false, error);
+        rai::AccountInfo info;
+        error = ledger.AccountInfoGet(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+        info.confirmed_height_ = 6;
+        error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+
+        // an aborted nested transaction leaves the counters alone
+        {
+            rai::Transaction nested(error_code, transaction);
+            ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            error = ledger.BlockDel(nested, blocks[8]->Hash());
+            EXPECT_EQ(false, error);
+            nested.Abort();
+        }
+    }
+
+    {
+        rai::Transaction transaction(error_code, ledger, false);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::LedgerCounters stored;
+        bool error = ledger.LedgerCountersGet(transaction, stored);
+        EXPECT_EQ(false, error);
+        rai::LedgerCounters computed;
+        error = ledger.LedgerCountersCompute(transaction, computed);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(computed, stored);
+        EXPECT_EQ(9, stored.Get(rai::LedgerCounterType::BLOCKS));
+        EXPECT_EQ(7, stored.Get(rai::LedgerCounterType::CONFIRMED_BLOCKS));
+        EXPECT_EQ(9, stored.Get(rai::LedgerCounterType::RECEIVABLES));
+        EXPECT_EQ(45, stored.Get(rai::LedgerCounterType::RECEIVABLE_AMOUNT));
+        EXPECT_EQ(0, stored.Get(rai::LedgerCounterType::FORKS));
+    }
+
+    // rebuild repairs drifted counters
+    {
+        rai::Transaction transaction(error_code, ledger, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::LedgerCounters drifted;
+        drifted.Add(rai::LedgerCounterType::BLOCKS, 0, 100);
+        bool error = ledger.LedgerCountersPut(transaction, drifted);
+        EXPECT_EQ(false, error);
+    }
+    {
+        rai::Transaction transaction(error_code, ledger, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::LedgerCounters stored;
+        bool error = ledger.LedgerCountersGet(transaction, stored);
+        EXPECT_EQ(false, error);
+        rai::LedgerCounters computed;
+        error = ledger.LedgerCountersCompute(transaction, computed);
+        EXPECT_EQ(false, error);
+        EXPECT_NE(computed, stored);
+        error = ledger.LedgerCountersPut(transaction, computed);
+        EXPECT_EQ(false, error);
+        error = ledger.LedgerCountersGet(transaction, stored);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(computed, stored);
+    }
+}
+
+TEST_P(LedgerEngine, Retention)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    rai::BlockHash previous(0);
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        std::shared_ptr<rai::Block> block(new rai::TxBlock(
+            rai::BlockOpcode::SEND, 1, 1, 1541128318 + i, i, public_key,
+            previous, public_key, rai::Amount(100 - i), rai::Account(2), 0,
+            std::vector<uint8_t>(), raw_key, public_key));
+        previous = block->Hash();
+        blocks.push_back(block);
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, data_file, GetParam());
+    rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    ledger.RetentionSet(rai::RetentionPolicy(2, 2), rai::RetentionPolicy(2, 0));
+
+    {
+        rai::Transaction transaction(error_code, ledger, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            bool error = ledger.RollbackBlockPut(
+                transaction, blocks[i]->Hash(), *blocks[i]);
+            EXPECT_EQ(false, error);
+        }
+        bool error =
+            ledger.ForkPut(transaction, public_key, 1, *blocks[1], *blocks[2]);
+        EXPECT_EQ(false, error);
+        error =
+            ledger.ForkPut(transaction, public_key, 2, *blocks[2], *blocks[3]);
+        EXPECT_EQ(false, error);
+        rai::AccountInfo info(rai::BlockType::TX_BLOCK, blocks[0]->Hash());
+        info.head_height_ = blocks.back()->Height();
+        info.head_ = blocks.back()->Hash();
+        info.forks_ = 2;
+        error = ledger.AccountInfoPut(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+    }
+
+    // the per account limit applies immediately
+    rai::Ptree status;
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, ledger.RetentionStatus(status));
+    EXPECT_EQ("2", status.get<std::string>("rollbacks"));
+    EXPECT_EQ("2", status.get<std::string>("forks"));
+    EXPECT_EQ("1", status.get<std::string>("swept_rollbacks"));
+
+    // an aborted transaction sweeps nothing
+    {
+        rai::Transaction transaction(error_code, ledger, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Transaction child(error_code, transaction);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        bool error = ledger.RollbackBlockPut(child, blocks[3]->Hash(),
+                                             *blocks[3]);
+        EXPECT_EQ(false, error);
+        child.Abort();
+    }
+    status.clear();
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, ledger.RetentionStatus(status));
+    EXPECT_EQ("2", status.get<std::string>("rollbacks"));
+    EXPECT_EQ("1", status.get<std::string>("swept_rollbacks"));
+
+    {
+        rai::Transaction transaction(error_code, ledger, false);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        std::shared_ptr<rai::Block> first(nullptr);
+        std::shared_ptr<rai::Block> second(nullptr);
+        bool error =
+            ledger.ForkGet(transaction, public_key, 2, first, second);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(*blocks[3], *second);
+    }
+
+    bool finished = false;
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, ledger.RetentionSweep(512, finished));
+    EXPECT_EQ(true, finished);
+    status.clear();
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, ledger.RetentionStatus(status));
+    EXPECT_EQ("2", status.get<std::string>("rollbacks"));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(3100));
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, ledger.RetentionSweep(1, finished));
+    EXPECT_EQ(false, finished);
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, ledger.RetentionSweep(512, finished));
+    EXPECT_EQ(true, finished);
+
+    status.clear();
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, ledger.RetentionStatus(status));
+    EXPECT_EQ("0", status.get<std::string>("rollbacks"));
+    EXPECT_EQ("0", status.get<std::string>("forks"));
+    EXPECT_EQ("3", status.get<std::string>("swept_rollbacks"));
+    EXPECT_EQ("2", status.get<std::string>("swept_forks"));
+
+    {
+        rai::Transaction transaction(error_code, ledger, false);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::AccountInfo info;
+        bool error = ledger.AccountInfoGet(transaction, public_key, info);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(0, info.forks_);
+        rai::LedgerCounters counters;
+        error = ledger.LedgerCountersGet(transaction, counters);
+        EXPECT_EQ(false, error);
+        EXPECT_EQ(0, counters.Get(rai::LedgerCounterType::FORKS));
+    }
+}
+
+TEST_P(LedgerEngine, StoreStats)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, data_file, GetParam());
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    {
+        rai::MdbTransaction transaction(error_code, store.env_, nullptr, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        for (uint64_t i = 0; i < 100; ++i)
+        {
+            rai::Account account(i);
+            std::vector<uint8_t> bytes(i < 90 ? 100 : 1000, 0);
+            rai::MdbVal value(bytes.size(), bytes.data());
+            bool error = store.Put(transaction, store.accounts_,
+                                   rai::MdbVal(account), value);
+            EXPECT_EQ(false, error);
+        }
+    }
+
+    rai::Ptree stats;
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, store.Stats(stats, 1000));
+    EXPECT_EQ(GetParam() == rai::StoreEngineType::LMDB,
+              stats.get_child_optional("env").is_initialized());
+    EXPECT_LT(40, stats.get<size_t>("table_count"));
+
+    bool found = false;
+    for (const auto& i : stats.get_child("tables"))
+    {
+        if (i.second.get<std::string>("name") != "accounts")
+        {
+            continue;
+        }
+        found = true;
+        EXPECT_EQ("100", i.second.get<std::string>("entries"));
+        EXPECT_EQ("100", i.second.get<std::string>("samples"));
+        std::map<std::string, std::string> values;
+        for (const auto& j : i.second.get_child("value_sizes"))
+        {
+            values[j.second.get<std::string>("max_size")] =
+                j.second.get<std::string>("count");
+        }
+        EXPECT_EQ("90", values["128"]);
+        EXPECT_EQ("10", values["1024"]);
+    }
+    EXPECT_EQ(true, found);
+}
+
+TEST_P(LedgerEngine, TransactionRegistry)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, data_file, GetParam());
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    rai::Ledger ledger(error_code, store, rai::LedgerType::INVALID);
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    {
+        rai::Transaction transaction(error_code, ledger, true);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        EXPECT_EQ(false, ledger.VersionPut(transaction, 1));
+        EXPECT_EQ(rai::ErrorCode::MDB_TXN_BEGIN, transaction.Renew());
+    }
+
+    rai::Ptree status;
+    {
+        rai::Transaction transaction(error_code, ledger, false);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        ledger.TransactionsStatus(status, true);
+        EXPECT_EQ("1", status.get<std::string>("open"));
+        EXPECT_EQ("1", status.get<std::string>("open_read"));
+        EXPECT_NE("", status.get<std::string>("oldest.site"));
+        EXPECT_EQ(1, status.get_child("transactions").size());
+
+        {
+            rai::Transaction write(error_code, ledger, true);
+            ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            EXPECT_EQ(false, ledger.VersionPut(write, 2));
+        }
+
+        // the snapshot is kept until it is renewed
+        uint32_t version = 0;
+        EXPECT_EQ(false, ledger.VersionGet(transaction, version));
+        EXPECT_EQ(1, version);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, transaction.Renew());
+        EXPECT_EQ(false, ledger.VersionGet(transaction, version));
+        EXPECT_EQ(2, version);
+
+        std::vector<rai::TransactionInfo> long_transactions;
+        EXPECT_EQ(rai::ErrorCode::SUCCESS,
+                  ledger.TransactionsCheck(long_transactions));
+        EXPECT_EQ(true, long_transactions.empty());
+    }
+
+    status.clear();
+    ledger.TransactionsStatus(status, false);
+    EXPECT_EQ("0", status.get<std::string>("open"));
+    EXPECT_EQ("0", status.get<std::string>("oldest_age_ms"));
+    EXPECT_EQ("1", status.get<std::string>("reader_checks"));
+}
+
+TEST(Ledger, TransactionRegistryConcurrent)
+{
+    rai::TransactionRegistry registry;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        threads.emplace_back([&registry]() {
+            for (size_t j = 0; j < 10000; ++j)
+            {
+                uint64_t id = registry.Add("test", j % 2 == 0);
+                registry.Renew(id);
+                registry.Remove(id);
+            }
+        });
+    }
+    uint64_t kept = registry.Add("kept", false);
+    for (auto& i : threads)
+    {
+        i.join();
+    }
+
+    EXPECT_EQ(1, registry.Size());
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::vector<rai::TransactionInfo> reported = registry.Report(5);
+    ASSERT_EQ(1, reported.size());
+    EXPECT_EQ(kept, reported[0].id_);
+    EXPECT_EQ(true, registry.Report(5).empty());
+
+    rai::Ptree status;
+    registry.Status(status, false);
+    EXPECT_EQ("1", status.get<std::string>("open"));
+    EXPECT_EQ("1", status.get<std::string>("reported"));
+    registry.Remove(kept);
+    EXPECT_EQ(0, registry.Size());
+    EXPECT_EQ(0, registry.OldestAge());
+}
+
+// A killed process must neither lose nor tear a committed transaction,
+// whatever the durability profile. The profiles only differ on an os crash
+// or a power loss, which this test doesn't simulate
+TEST(Ledger, CrashConsistency)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    std::vector<rai::StoreDurability> profiles{
+        rai::StoreDurability::FULL, rai::StoreDurability::META_ASYNC,
+        rai::StoreDurability::PERIODIC};
+    for (auto durability : profiles)
+    {
+        boost::filesystem::remove(data_file);
+        boost::filesystem::remove(lock_file);
+
+        rai::MdbEnvOptions options;
+        options.durability_ = durability;
+        options.map_size_ = 1024 * 1024 * 1024;
+        options.sync_interval_ = 10;
+        options.sync_commits_ = 16;
+
+        int fds[2];
+        ASSERT_EQ(0, pipe(fds));
+        pid_t pid = fork();
+        ASSERT_NE(-1, pid);
+        if (pid == 0)
+        {
+            close(fds[0]);
+            rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+            rai::Store store(error_code, data_file, options);
+            if (error_code != rai::ErrorCode::SUCCESS)
+            {
+                _exit(1);
+            }
+            rai::Account marker(0);
+            for (uint64_t i = 1; i < 10000000; ++i)
+            {
+                // nested like the block processor does
+                rai::Account account(i);
+                rai::MdbTransaction transaction(error_code, store.env_,
+                                                nullptr, true);
+                rai::MdbTransaction child(error_code, store.env_, transaction,
+                                          true);
+                if (error_code != rai::ErrorCode::SUCCESS)
+                {
+                    _exit(1);
+                }
+                bool error = store.Put(child, store.accounts_,
+                                       rai::MdbVal(account),
+                                       rai::MdbVal(account));
+                error |= store.Put(child, store.accounts_,
+                                   rai::MdbVal(marker), rai::MdbVal(account));
+                if (error)
+                {
+                    _exit(1);
+                }
+                child.Commit();
+                transaction.Commit();
+
+                // the parent waits for the first commit before the kill
+                if (i == 1)
+                {
+                    char byte = 0;
+                    if (write(fds[1], &byte, 1) != 1)
+                    {
+                        _exit(1);
+                    }
+                    close(fds[1]);
+                }
+            }
+            _exit(0);
+        }
+
+        close(fds[1]);
+        char byte = 0;
+        ssize_t size = read(fds[0], &byte, 1);
+        close(fds[0]);
+        if (size != 1)
+        {
+            waitpid(pid, nullptr, 0);
+        }
+        ASSERT_EQ(1, size);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        kill(pid, SIGKILL);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFSIGNALED(status));
+
+        {
+            rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+            rai::Store store(error_code, data_file, options);
+            ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::MdbTransaction transaction(error_code, store.env_, nullptr,
+                                            false);
+            ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+            rai::Account marker(0);
+            rai::MdbVal value;
+            bool error = store.Get(transaction, store.accounts_,
+                                   rai::MdbVal(marker), value);
+            ASSERT_EQ(false, error);
+            rai::Account last = value.uint256_union();
+
+            rai::Account expected(0);
+            for (rai::StoreIterator i(transaction, store.accounts_), n(nullptr);
+                 i != n; ++i)
+            {
+                EXPECT_EQ(expected, i->first.uint256_union());
+                expected += 1;
+            }
+            EXPECT_EQ(last + 1, expected);
+        }
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+#endif
+
+#if EXECUTE_LONG_TIME_CASE
+TEST(Ledger, ReadTransactionPool_performance)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+
+    if (boost::filesystem::exists(data_file))
+    {
+        boost::filesystem::remove(data_file);
+    }
+    if (boost::filesystem::exists(lock_file))
+    {
+        boost::filesystem::remove(lock_file);
+    }
+
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+
+        uint64_t accounts = 10000;
+        {
+            rai::Transaction transaction(error_code, ledger, true);
+            ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            for (uint64_t i = 1; i <= accounts; ++i)
+            {
+                rai::AccountInfo info(rai::BlockType::TX_BLOCK,
+                                      rai::BlockHash(i));
+                bool error =
+                    ledger.AccountInfoPut(transaction, rai::Account(i), info);
+                ASSERT_EQ(false, error);
+            }
+        }
+
+        // the same work as the account_info RPC: one read transaction and
+        // one account lookup per request
+        uint64_t requests = 1000000;
+        std::vector<size_t> pool_sizes = {
+            0, size_t(rai::MdbEnv::READ_TRANSACTION_POOL_SIZE)};
+        for (size_t pool_size : pool_sizes)
+        {
+            store.env_.ReadTransactionPoolSize(pool_size);
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < requests; ++i)
+            {
+                rai::Transaction transaction(error_code, ledger, false);
+                ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+                rai::AccountInfo info;
+                bool error = ledger.AccountInfoGet(
+                    transaction, rai::Account(i % accounts + 1), info);
+                ASSERT_EQ(false, error);
+            }
+            auto duration =
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+            std::cout << "account_info with read transaction pool size "
+                      << pool_size << ": " << requests * 1000 / (duration + 1)
+                      << " QPS" << std::endl;
+        }
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
+#endif
+
+TEST(Ledger, MemoryEngine)
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, boost::filesystem::path(),
+                     rai::StoreEngineType::MEMORY);
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+
+    rai::Account account_1(1);
+    rai::Account account_2(2);
+    rai::MdbVal key_1(account_1);
+    rai::MdbVal key_2(account_2);
+    rai::MdbVal value(account_1);
+    {
+        // a reader keeps the snapshot taken when it began
+        rai::MdbTransaction reader(error_code, store.env_, nullptr, false);
+        EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        {
+            rai::MdbTransaction transaction(error_code, store.env_, nullptr,
+                                            true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error =
+                store.Put(transaction, store.accounts_, key_1, value);
+            EXPECT_EQ(false, error);
+
+            // an aborted child leaves the parent untouched
+            rai::MdbTransaction child(error_code, store.env_, transaction,
+                                      true);
+            EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            error = store.Put(child, store.accounts_, key_2, value);
+            EXPECT_EQ(false, error);
+            child.Abort();
+        }
+        rai::MdbVal value_l;
+        bool error = store.Get(reader, store.accounts_, key_1, value_l);
+        EXPECT_EQ(true, error);
+        error = store.Put(reader, store.accounts_, key_1, value);
+        EXPECT_EQ(true, error);
+    }
+
+    rai::MdbTransaction transaction(error_code, store.env_, nullptr, false);
+    EXPECT_EQ(rai::ErrorCode::SUCCESS, error_code);
+    rai::MdbVal value_l;
+    bool error = store.Get(transaction, store.accounts_, key_1, value_l);
+    EXPECT_EQ(false, error);
+    error = store.Get(transaction, store.accounts_, key_2, value_l);
+    EXPECT_EQ(true, error);
+    MDB_stat stat;
+    error = store.Stat(transaction, store.accounts_, stat);
+    EXPECT_EQ(false, error);
+    EXPECT_EQ(1, stat.ms_entries);
+}
+
+TEST(Ledger, MemoryEngineCursor)
+{
+    rai::MemoryEngine engine;
+    MDB_txn* txn = nullptr;
+    int ret = engine.TxnBegin(nullptr, true, &txn);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    MDB_dbi dbi = 0;
+    ret = engine.DbiOpen(txn, "table", MDB_CREATE, &dbi);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+
+    auto to_val = [](const std::string& str) {
+        MDB_val val;
+        val.mv_size = str.size();
+        val.mv_data = const_cast<char*>(str.data());
+        return val;
+    };
+    auto to_string = [](const MDB_val& val) {
+        return std::string(reinterpret_cast<const char*>(val.mv_data),
+                           val.mv_size);
+    };
+    auto key_of = [](uint32_t i) {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%08u", i);
+        return std::string(buffer);
+    };
+
+    size_t count = 1000;
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string key = key_of(i * 2);
+        MDB_val key_l = to_val(key);
+        MDB_val value_l = to_val(key);
+        ret = engine.Put(txn, dbi, &key_l, &value_l);
+        EXPECT_EQ(MDB_SUCCESS, ret);
+    }
+    ret = engine.TxnCommit(txn);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+
+    // a reader keeps its snapshot while the writer modifies the table
+    MDB_txn* reader = nullptr;
+    ret = engine.TxnBegin(nullptr, false, &reader);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    ret = engine.TxnBegin(nullptr, true, &txn);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    std::string key_0 = key_of(0);
+    MDB_val key_l = to_val(key_0);
+    MDB_val value_l;
+    ret = engine.Del(txn, dbi, &key_l, &value_l);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    std::string key_1 = key_of(1);
+    key_l = to_val(key_1);
+    value_l = to_val(key_1);
+    ret = engine.Put(txn, dbi, &key_l, &value_l);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    ret = engine.TxnCommit(txn);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+
+    MDB_stat stat;
+    ret = engine.Stat(reader, dbi, &stat);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(count, stat.ms_entries);
+    std::unique_ptr<rai::StoreCursor> cursor;
+    ret = engine.CursorOpen(reader, dbi, cursor);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    ret = cursor->Get(&key_l, &value_l, MDB_FIRST);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(key_0, to_string(key_l));
+    engine.TxnAbort(reader);
+
+    ret = engine.TxnBegin(nullptr, false, &reader);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    ret = engine.CursorOpen(reader, dbi, cursor);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    ret = cursor->Get(&key_l, &value_l, MDB_GET_CURRENT);
+    EXPECT_EQ(EINVAL, ret);
+    ret = cursor->Get(&key_l, &value_l, MDB_FIRST);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(key_1, to_string(key_l));
+    ret = cursor->Get(&key_l, &value_l, MDB_PREV);
+    EXPECT_EQ(MDB_NOTFOUND, ret);
+
+    // walks the whole table backwards
+    ret = cursor->Get(&key_l, &value_l, MDB_LAST);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(key_of((count - 1) * 2), to_string(key_l));
+    size_t entries = 1;
+    while (cursor->Get(&key_l, &value_l, MDB_PREV) == MDB_SUCCESS)
+    {
+        ++entries;
+    }
+    EXPECT_EQ(count, entries);
+
+    std::string key_3 = key_of(3);
+    key_l = to_val(key_3);
+    ret = cursor->Get(&key_l, &value_l, MDB_SET);
+    EXPECT_EQ(MDB_NOTFOUND, ret);
+    key_l = to_val(key_3);
+    ret = cursor->Get(&key_l, &value_l, MDB_SET_RANGE);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(key_of(4), to_string(key_l));
+    ret = cursor->Get(&key_l, &value_l, MDB_NEXT);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(key_of(6), to_string(key_l));
+    ret = cursor->Get(&key_l, &value_l, MDB_PREV_NODUP);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(key_of(4), to_string(key_l));
+    ret = cursor->Get(&key_l, &value_l, MDB_NEXT_DUP);
+    EXPECT_EQ(MDB_NOTFOUND, ret);
+    ret = cursor->Get(&key_l, &value_l, MDB_FIRST_DUP);
+    EXPECT_EQ(MDB_INCOMPATIBLE, ret);
+
+    key_l = to_val(key_1);
+    value_l = to_val(key_1);
+    ret = cursor->Get(&key_l, &value_l, MDB_GET_BOTH);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    key_l = to_val(key_1);
+    value_l = to_val(key_0);
+    ret = cursor->Get(&key_l, &value_l, MDB_GET_BOTH);
+    EXPECT_EQ(MDB_NOTFOUND, ret);
+    key_l = to_val(key_1);
+    value_l = to_val(key_0);
+    ret = cursor->Get(&key_l, &value_l, MDB_GET_BOTH_RANGE);
+    EXPECT_EQ(MDB_SUCCESS, ret);
+    EXPECT_EQ(key_1, to_string(value_l));
+    cursor.reset();
+    engine.TxnAbort(reader);
+}
+
+TEST(Ledger, StoreDurabilityNested)
+{
+    auto data_file = boost::filesystem::current_path() / "ledger_test.ldb";
+    auto lock_file = boost::filesystem::current_path() / "ledger_test.ldb-lock";
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+
+    rai::MdbEnvOptions options;
+    options.map_size_ = 1024 * 1024 * 1024;
+
+    // the block processor nests a transaction under every write
+    std::vector<rai::StoreDurability> profiles{
+        rai::StoreDurability::FULL, rai::StoreDurability::META_ASYNC,
+        rai::StoreDurability::PERIODIC};
+    for (auto durability : profiles)
+    {
+        boost::filesystem::remove(data_file);
+        boost::filesystem::remove(lock_file);
+        options.durability_ = durability;
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Store store(error_code, data_file, options);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::Account account(1);
+        {
+            rai::MdbTransaction transaction(error_code, store.env_, nullptr,
+                                            true);
+            ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            rai::MdbTransaction child(error_code, store.env_, transaction,
+                                      true);
+            ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+            bool error = store.Put(child, store.accounts_,
+                                   rai::MdbVal(account), rai::MdbVal(account));
+            EXPECT_EQ(false, error);
+        }
+        rai::MdbTransaction transaction(error_code, store.env_, nullptr,
+                                        false);
+        ASSERT_EQ(rai::ErrorCode::SUCCESS, error_code);
+        rai::MdbVal value;
+        bool error = store.Get(transaction, store.accounts_,
+                               rai::MdbVal(account), value);
+        EXPECT_EQ(false, error);
+    }
+
+    boost::filesystem::remove(data_file);
+    boost::filesystem::remove(lock_file);
+}
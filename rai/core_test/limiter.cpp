@@ -0,0 +1,177 @@
+#include <chrono>
+#include <gtest/gtest.h>
+#include <rai/core_test/test_util.hpp>
+#include <rai/common/parameters.hpp>
+#include <rai/node/limiter.hpp>
+
+namespace
+{
+std::vector<uint8_t> Header(rai::MessageType type)
+{
+    std::vector<uint8_t> bytes;
+    {
+        rai::VectorStream stream(bytes);
+        rai::MessageHeader(type).Serialize(stream);
+    }
+    return bytes;
+}
+
+rai::Endpoint Remote(uint32_t ip)
+{
+    return rai::Endpoint(rai::IP(ip), 7000);
+}
+
+size_t Allowed(rai::IngressLimiter& limiter, uint32_t ip,
+               const std::vector<uint8_t>& header,
+               const std::chrono::steady_clock::time_point& now, size_t count)
+{
+    size_t allowed = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (limiter.Allow(Remote(ip), header.data(), header.size(), now))
+        {
+            ++allowed;
+        }
+    }
+    return allowed;
+}
+
+size_t StatusCount(const rai::IngressLimiter& limiter, const std::string& key)
+{
+    rai::Ptree ptree;
+    limiter.Status(ptree);
+    return ptree.get<size_t>(key);
+}
+
+rai::IngressLimitConfig Config()
+{
+    rai::IngressLimitConfig config;
+    config.budgets_[static_cast<size_t>(rai::MessageType::KEEPLIVE)] =
+        rai::IngressBudget(2, 4);
+    return config;
+}
+}  // namespace
+
+TEST(IngressLimiter, Burst)
+{
+    rai::IngressLimiter limiter(Config());
+    auto keeplive = Header(rai::MessageType::KEEPLIVE);
+    auto publish = Header(rai::MessageType::PUBLISH);
+    auto now = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(4, Allowed(limiter, 0x0A000001, keeplive, now, 10));
+    ASSERT_EQ(0, Allowed(limiter, 0x0A000001, keeplive, now, 1));
+    // other ips and other message types keep their own budgets
+    ASSERT_EQ(4, Allowed(limiter, 0x0A000002, keeplive, now, 10));
+    ASSERT_EQ(1, Allowed(limiter, 0x0A000001, publish, now, 1));
+
+    // a qualified representative gets twice the budget, and so does the
+    // proxy in front of it
+    rai::Account account(1);
+    std::vector<rai::IngressPeerInfo> peers;
+    peers.emplace_back(account, rai::QUALIFIED_REP_WEIGHT,
+                       rai::IP(0x0A000003), rai::IP(0x0A000004));
+    limiter.Refresh(peers);
+    ASSERT_EQ(8, Allowed(limiter, 0x0A000003, keeplive, now, 20));
+    ASSERT_EQ(8, Allowed(limiter, 0x0A000004, keeplive, now, 20));
+    ASSERT_EQ(1, StatusCount(limiter, "accounts"));
+}
+
+TEST(IngressLimiter, Refill)
+{
+    rai::IngressLimiter limiter(Config());
+    auto keeplive = Header(rai::MessageType::KEEPLIVE);
+    auto now = std::chrono::steady_clock::now();
+
+    ASSERT_EQ(4, Allowed(limiter, 0x0A000001, keeplive, now, 10));
+    now += std::chrono::milliseconds(500);
+    ASSERT_EQ(1, Allowed(limiter, 0x0A000001, keeplive, now, 10));
+    now += std::chrono::seconds(1);
+    ASSERT_EQ(2, Allowed(limiter, 0x0A000001, keeplive, now, 10));
+    // refills up to the burst only
+    now += std::chrono::seconds(60);
+    ASSERT_EQ(4, Allowed(limiter, 0x0A000001, keeplive, now, 10));
+}
+
+TEST(IngressLimiter, Overflow)
+{
+    rai::IngressLimiter limiter(Config());
+    auto keeplive = Header(rai::MessageType::KEEPLIVE);
+    auto now = std::chrono::steady_clock::now();
+
+    // fill shard 0, its ips are multiples of SHARDS
+    for (uint32_t i = 0; i < rai::IngressLimiter::MAX_KEYS_PER_SHARD; ++i)
+    {
+        uint32_t ip = 0x0B000000 + i * rai::IngressLimiter::SHARDS;
+        ASSERT_EQ(1, Allowed(limiter, ip, keeplive, now, 1));
+    }
+    ASSERT_EQ(rai::IngressLimiter::MAX_KEYS_PER_SHARD,
+              StatusCount(limiter, "ips"));
+
+    // unknown ips of one /24 share a bucket beyond the limit
+    ASSERT_EQ(4, Allowed(limiter, 0x0C000010, keeplive, now, 10));
+    ASSERT_EQ(0, Allowed(limiter, 0x0C000020, keeplive, now, 10));
+    ASSERT_EQ(rai::IngressLimiter::MAX_KEYS_PER_SHARD,
+              StatusCount(limiter, "ips"));
+    ASSERT_EQ(16, StatusCount(limiter, "overflow_dropped"));
+
+    // other prefixes are not starved by the flooded one
+    ASSERT_EQ(4, Allowed(limiter, 0x0C000110, keeplive, now, 10));
+    ASSERT_EQ(4, Allowed(limiter, 0x0C000210, keeplive, now, 10));
+
+    // known peers are always admitted with their own buckets
+    std::vector<rai::IngressPeerInfo> peers;
+    peers.emplace_back(rai::Account(1), rai::Amount(0), rai::IP(0x0C000030),
+                       rai::IP());
+    limiter.Refresh(peers);
+    ASSERT_EQ(4, Allowed(limiter, 0x0C000030, keeplive, now, 10));
+    ASSERT_EQ(rai::IngressLimiter::MAX_KEYS_PER_SHARD + 1,
+              StatusCount(limiter, "ips"));
+}
+
+TEST(IngressLimiter, Purge)
+{
+    rai::IngressLimiter limiter(Config());
+    auto keeplive = Header(rai::MessageType::KEEPLIVE);
+    auto now = std::chrono::steady_clock::now();
+
+    std::vector<rai::IngressPeerInfo> peers;
+    peers.emplace_back(rai::Account(1), rai::Amount(0), rai::IP(0x0A000001),
+                       rai::IP());
+    limiter.Refresh(peers);
+    ASSERT_EQ(1, Allowed(limiter, 0x0A000001, keeplive, now, 1));
+    ASSERT_EQ(1, Allowed(limiter, 0x0A000002, keeplive, now, 1));
+    ASSERT_EQ(2, StatusCount(limiter, "ips"));
+    ASSERT_EQ(1, StatusCount(limiter, "accounts"));
+
+    limiter.Purge(now + std::chrono::seconds(30));
+    ASSERT_EQ(2, StatusCount(limiter, "ips"));
+    ASSERT_EQ(1, Allowed(limiter, 0x0A000002, keeplive,
+                         now + std::chrono::seconds(30), 1));
+
+    limiter.Purge(now + rai::IngressLimiter::IDLE_CUTOFF
+                  + std::chrono::seconds(1));
+    ASSERT_EQ(1, StatusCount(limiter, "ips"));
+    ASSERT_EQ(0, StatusCount(limiter, "accounts"));
+
+    limiter.Purge(now + std::chrono::seconds(120));
+    ASSERT_EQ(0, StatusCount(limiter, "ips"));
+    // a purged key starts again with a full burst
+    ASSERT_EQ(4, Allowed(limiter, 0x0A000001, keeplive,
+                         now + std::chrono::seconds(120), 10));
+}
+
+TEST(IngressLimitConfig, ZeroRate)
+{
+    rai::IngressLimitConfig config;
+    rai::Ptree ptree;
+    ptree.put("budgets.keeplive.rate", "0");
+    ASSERT_EQ(rai::ErrorCode::JSON_CONFIG_INGRESS_LIMIT,
+              config.DeserializeJson(ptree));
+
+    ptree.put("budgets.keeplive.rate", "3");
+    ASSERT_EQ(rai::ErrorCode::SUCCESS, config.DeserializeJson(ptree));
+    ASSERT_EQ(3, config.budgets_[static_cast<size_t>(
+                                     rai::MessageType::KEEPLIVE)]
+                     .rate_);
+}
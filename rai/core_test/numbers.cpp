@@ -1,9 +1,11 @@
 #include <rai/common/numbers.hpp>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <gtest/gtest.h>
 #include <rai/core_test/test_util.hpp>
+#include <rai/core_test/config.hpp>
 
 using std::string;
 
@@ -711,6 +713,146 @@ TEST(PublicKey, generate)
     ASSERT_EQ(pub_expect, pub);
 }
 
+namespace
+{
+void TestSignMessages(size_t num, std::vector<rai::PublicKey>& public_keys,
+                      std::vector<rai::uint256_union>& messages,
+                      std::vector<rai::uint512_union>& signatures)
+{
+    public_keys.clear();
+    messages.clear();
+    signatures.clear();
+    for (size_t i = 0; i < num; ++i)
+    {
+        rai::RawKey private_key;
+        rai::random_pool.GenerateBlock(private_key.data_.bytes.data(),
+                                       private_key.data_.bytes.size());
+        rai::PublicKey public_key = rai::GeneratePublicKey(private_key.data_);
+        rai::uint256_union message;
+        rai::random_pool.GenerateBlock(message.bytes.data(),
+                                       message.bytes.size());
+        public_keys.push_back(public_key);
+        messages.push_back(message);
+        signatures.push_back(
+            rai::SignMessage(private_key, public_key, message));
+    }
+}
+}  // namespace
+
+TEST(ValidateMessages, batch)
+{
+    std::vector<rai::PublicKey> public_keys;
+    std::vector<rai::uint256_union> messages;
+    std::vector<rai::uint512_union> signatures;
+    std::vector<bool> results;
+
+    for (size_t num : {0, 1, 3, 4, 64, 65, 130})
+    {
+        TestSignMessages(num, public_keys, messages, signatures);
+        ASSERT_EQ(false, rai::ValidateMessages(public_keys, messages,
+                                               signatures, results));
+        ASSERT_EQ(num, results.size());
+        for (size_t i = 0; i < num; ++i)
+        {
+            ASSERT_EQ(false, results[i]);
+        }
+    }
+
+    TestSignMessages(130, public_keys, messages, signatures);
+    signatures[0].bytes[0] ^= 0x1;
+    messages[64].bytes[31] ^= 0x1;
+    public_keys[129] = public_keys[128];
+    ASSERT_EQ(true, rai::ValidateMessages(public_keys, messages, signatures,
+                                          results));
+    for (size_t i = 0; i < 130; ++i)
+    {
+        bool expect = i == 0 || i == 64 || i == 129;
+        ASSERT_EQ(expect, results[i]);
+        ASSERT_EQ(expect, rai::ValidateMessage(public_keys[i], messages[i],
+                                               signatures[i]));
+    }
+
+    signatures.pop_back();
+    ASSERT_EQ(true, rai::ValidateMessages(public_keys, messages, signatures,
+                                          results));
+}
+
+// S + 2L is accepted by ed25519_sign_open_batch, which reduces S modulo the
+// group order, but rejected by ed25519_sign_open
+TEST(ValidateMessages, non_canonical)
+{
+    std::vector<rai::PublicKey> public_keys;
+    std::vector<rai::uint256_union> messages;
+    std::vector<rai::uint512_union> signatures;
+    std::vector<bool> results;
+    TestSignMessages(64, public_keys, messages, signatures);
+
+    std::array<uint8_t, 32> order_2 = {
+        0xda, 0xa7, 0xeb, 0xb9, 0x34, 0xc6, 0x24, 0xb0, 0xac, 0x39, 0xef,
+        0x45, 0xbd, 0xf3, 0xbd, 0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20};
+    rai::uint512_union& signature = signatures[10];
+    uint32_t carry = 0;
+    for (size_t i = 0; i < order_2.size(); ++i)
+    {
+        uint32_t sum = signature.bytes[32 + i] + order_2[i] + carry;
+        signature.bytes[32 + i] = static_cast<uint8_t>(sum);
+        carry = sum >> 8;
+    }
+    ASSERT_EQ(0, carry);
+    ASSERT_NE(0, signature.bytes[63] & 224);
+    ASSERT_EQ(true, rai::ValidateMessage(public_keys[10], messages[10],
+                                         signature));
+
+    ASSERT_EQ(true, rai::ValidateMessages(public_keys, messages, signatures,
+                                          results));
+    for (size_t i = 0; i < 64; ++i)
+    {
+        ASSERT_EQ(i == 10, results[i]);
+    }
+}
+
+#if EXECUTE_LONG_TIME_CASE
+TEST(ValidateMessages, performance)
+{
+    std::vector<rai::PublicKey> public_keys;
+    std::vector<rai::uint256_union> messages;
+    std::vector<rai::uint512_union> signatures;
+    std::vector<bool> results;
+    size_t total = 4096;
+
+    for (size_t batch : {8, 16, 32, 64, 128, 256})
+    {
+        TestSignMessages(batch, public_keys, messages, signatures);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < total / batch; ++i)
+        {
+            for (size_t j = 0; j < batch; ++j)
+            {
+                ASSERT_EQ(false, rai::ValidateMessage(
+                                     public_keys[j], messages[j], signatures[j]));
+            }
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < total / batch; ++i)
+        {
+            ASSERT_EQ(false, rai::ValidateMessages(public_keys, messages,
+                                                   signatures, results));
+        }
+        auto t3 = std::chrono::high_resolution_clock::now();
+
+        auto single = std::chrono::duration_cast<std::chrono::microseconds>(
+                          t2 - t1).count();
+        auto batched = std::chrono::duration_cast<std::chrono::microseconds>(
+                           t3 - t2).count();
+        std::cout << "batch " << batch << ": single " << total * 1000000 / single
+                  << " open/second, batch " << total * 1000000 / batched
+                  << " open/second" << std::endl;
+    }
+}
+#endif
+
 TEST(AccountParser, parse)
 {
     rai::AccountParser parser(
@@ -1,7 +1,9 @@
 #include <rai/core_test/test_util.hpp>
 
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -12,6 +14,53 @@ using std::cout;
 using std::string;
 using std::endl;
 
+namespace
+{
+thread_local uint64_t* allocations = nullptr;
+}  // namespace
+
+// The replacement only forwards to malloc unless a TestAllocationCounter is
+// alive on the calling thread, so the other tests see the default behaviour
+void* operator new(size_t size)
+{
+    if (allocations != nullptr)
+    {
+        ++*allocations;
+    }
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+TestAllocationCounter::TestAllocationCounter()
+    : count_(0), previous_(allocations)
+{
+    allocations = &count_;
+}
+
+TestAllocationCounter::~TestAllocationCounter()
+{
+    allocations = previous_;
+}
+
+uint64_t TestAllocationCounter::Count() const
+{
+    return count_;
+}
+
 void TestShowHex(const unsigned char* text, size_t size)
 {
     cout << std::hex << std::uppercase << std::noshowbase << std::setfill('0');
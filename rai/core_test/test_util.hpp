@@ -6,3 +6,18 @@ void TestShowHex(const unsigned char* text, size_t size);
 bool TestDecodeHex(const std::string& in, unsigned char out[], size_t max_out);
 bool TestDecodeHex(const std::string& in, std::vector<uint8_t>& out);
 void TestShowJson(const rai::Ptree&, const std::string&);
+
+// Counts the operator new calls made by the current thread while it is alive
+class TestAllocationCounter
+{
+public:
+    TestAllocationCounter();
+    ~TestAllocationCounter();
+    TestAllocationCounter(const TestAllocationCounter&) = delete;
+    TestAllocationCounter& operator=(const TestAllocationCounter&) = delete;
+    uint64_t Count() const;
+
+private:
+    uint64_t count_;
+    uint64_t* previous_;
+};
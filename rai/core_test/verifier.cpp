@@ -0,0 +1,142 @@
+#include <rai/node/verifier.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <gtest/gtest.h>
+#include <rai/core_test/test_util.hpp>
+#include <rai/common/numbers.hpp>
+
+namespace
+{
+std::shared_ptr<rai::Block> SignedBlock(const rai::RawKey& raw_key,
+                                        const rai::PublicKey& public_key,
+                                        uint64_t height)
+{
+    return std::shared_ptr<rai::Block>(new rai::TxBlock(
+        rai::BlockOpcode::SEND, 1, 1, 1541128318 + height, height, public_key,
+        rai::BlockHash(height), public_key, rai::Amount(100),
+        rai::uint256_union(2), 0, std::vector<uint8_t>(), raw_key,
+        public_key));
+}
+
+class Results
+{
+public:
+    void Add(size_t index, bool error)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        results_[index] = error;
+        condition_.notify_all();
+    }
+
+    bool Wait(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return !condition_.wait_for(lock, std::chrono::seconds(30), [&]() {
+            return results_.size() >= count;
+        });
+    }
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::map<size_t, bool> results_;
+};
+}  // namespace
+
+TEST(SignatureVerifier, Batch)
+{
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    rai::RawKey other_key;
+    other_key.data_.DecodeHex(
+        "5F9E0E5BC4D1B0B2C7B2E59E1A2C0A7A0F6E7A33C1E8C7A64D3C1B5E2A4F7D90");
+
+    // every 7th block carries a broken signature, every 5th task also checks
+    // a signed message, every 11th one of them a tampered message
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    std::vector<std::vector<rai::SignatureCheck>> checks;
+    std::vector<bool> expected;
+    for (uint64_t i = 0; i < 200; ++i)
+    {
+        auto block = SignedBlock(raw_key, public_key, i);
+        bool error = false;
+        if (i % 7 == 3)
+        {
+            // signed by another key
+            block = SignedBlock(other_key, public_key, i);
+            error = true;
+        }
+        blocks.push_back(block);
+
+        std::vector<rai::SignatureCheck> task_checks;
+        if (i % 5 == 0)
+        {
+            rai::uint256_union message(i);
+            rai::Signature signature =
+                rai::SignMessage(raw_key, public_key, message);
+            if (i % 11 == 0)
+            {
+                message = rai::uint256_union(i + 1);
+                error = true;
+            }
+            task_checks.push_back({public_key, message, signature});
+        }
+        checks.push_back(task_checks);
+        expected.push_back(error);
+    }
+
+    Results results;
+    rai::Ptree ptree;
+    {
+        rai::SignatureVerifier verifier(2);
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            bool error = verifier.Add(
+                {blocks[i]}, checks[i],
+                [&results, i](bool error) { results.Add(i, error); });
+            ASSERT_FALSE(error);
+        }
+        ASSERT_FALSE(results.Wait(blocks.size()));
+        verifier.Status(ptree);
+    }
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        ASSERT_EQ(expected[i], results.results_[i]);
+        ASSERT_TRUE(blocks[i]->SignatureChecked());
+    }
+    ASSERT_EQ(240, ptree.get<size_t>("signatures"));
+    ASSERT_LE(240 / rai::SignatureVerifier::MAX_BATCH,
+              ptree.get<size_t>("batches"));
+    ASSERT_GE(200, ptree.get<size_t>("batches"));
+    ASSERT_EQ(0, ptree.get<size_t>("tasks"));
+}
+
+TEST(SignatureVerifier, Checked)
+{
+    rai::RawKey raw_key;
+    raw_key.data_.DecodeHex(
+        "34F0A37AAD20F4A260F0A5B3CB3D7FB50673212263E58A380BC10474BB039CE4");
+    rai::PublicKey public_key = rai::GeneratePublicKey(raw_key.data_);
+    auto block = SignedBlock(raw_key, public_key, 1);
+    ASSERT_FALSE(block->CheckSignature());
+
+    // known signatures are reported right away on the calling thread
+    rai::SignatureVerifier verifier(1);
+    bool called = false;
+    bool result = true;
+    ASSERT_FALSE(verifier.Add({block}, [&](bool error) {
+        called = true;
+        result = error;
+    }));
+    ASSERT_TRUE(called);
+    ASSERT_FALSE(result);
+
+    verifier.Stop();
+    ASSERT_TRUE(verifier.Add({block}, {{public_key, rai::uint256_union(1),
+                                        rai::Signature()}},
+                             [](bool) {}));
+}
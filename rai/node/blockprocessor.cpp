@@ -66,6 +66,8 @@ rai::BlockOperation rai::StringToBlockOperation(const std::string& str)
     }
 }
 
+std::chrono::microseconds constexpr rai::BlockProcessor::MAX_BATCH_TIME;
+
 rai::BlockForced::BlockForced(rai::BlockOperation operation,
                               const std::shared_ptr<rai::Block>& block)
     : operation_(static_cast<uint64_t>(operation)), block_(block)
@@ -83,7 +85,13 @@ rai::BlockProcessor::BlockProcessor(rai::Node& node)
       ledger_(node.ledger_),
       operation_(static_cast<uint64_t>(rai::BlockOperation::DYNAMIC_BEGIN)),
       stopped_(false),
-      thread_([this]() { this->Run(); })
+      batches_(0),
+      batch_blocks_(0),
+      batch_size_last_(0),
+      batch_size_max_(0),
+      queue_depth_max_(0),
+      thread_([this]() { this->Run(); }),
+      verifier_(std::thread::hardware_concurrency() / 2)
 {
 }
 
@@ -93,34 +101,82 @@ rai::BlockProcessor::~BlockProcessor()
 }
 
 void rai::BlockProcessor::Add(const std::shared_ptr<rai::Block>& block)
+{
+    bool error = verifier_.Add({block}, [this, block](bool error) {
+        if (error)
+        {
+            rai::Stats::Add(rai::ErrorCode::SIGNATURE);
+            Drop_(block, rai::ErrorCode::SIGNATURE);
+            return;
+        }
+        Add_(block);
+    });
+    if (error)
+    {
+        Drop_(block, rai::ErrorCode::SUCCESS);
+    }
+}
+
+bool rai::BlockProcessor::Verify(
+    const std::vector<std::shared_ptr<rai::Block>>& blocks,
+    const std::function<void(bool)>& callback)
+{
+    return verifier_.Add(blocks, callback);
+}
+
+bool rai::BlockProcessor::Verify(
+    const std::vector<std::shared_ptr<rai::Block>>& blocks,
+    const std::vector<rai::SignatureCheck>& checks,
+    const std::function<void(bool)>& callback)
+{
+    return verifier_.Add(blocks, checks, callback);
+}
+
+void rai::BlockProcessor::Add_(const std::shared_ptr<rai::Block>& block)
 {
     uint64_t priority = Priority_(block);
     auto now = std::chrono::steady_clock::now();
     OrderedKey key{priority, now};
     BlockInfo block_info{key, block->Hash(), block};
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto ret = blocks_.insert(block_info);
-    if (!ret.second)
+    std::shared_ptr<rai::Block> dropped;
     {
-        rai::BlockProcessResult result{rai::BlockOperation::DROP,
-                                       rai::ErrorCode::SUCCESS, 0};
-        block_observer_(result, block);
-        node_.dumpers_.block_.Dump(result, block);
-        return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto ret = blocks_.insert(block_info);
+        if (!ret.second)
+        {
+            dropped = block;
+        }
+        else
+        {
+            if (blocks_.size() > rai::BlockProcessor::MAX_BLOCKS)
+            {
+                auto it = blocks_.rbegin();
+                dropped = it->block_;
+                blocks_.erase((++it).base());
+            }
+
+            if (blocks_.size() > queue_depth_max_)
+            {
+                queue_depth_max_ = blocks_.size();
+            }
+            condition_.notify_all();
+        }
     }
 
-    if (blocks_.size() > rai::BlockProcessor::MAX_BLOCKS)
+    // the observers may call back into the processor
+    if (dropped != nullptr)
     {
-        auto it = blocks_.rbegin();
-        rai::BlockProcessResult result{rai::BlockOperation::DROP,
-                                       rai::ErrorCode::SUCCESS, 0};
-        block_observer_(result, it->block_);
-        node_.dumpers_.block_.Dump(result, it->block_);
-        blocks_.erase((++it).base());
+        Drop_(dropped, rai::ErrorCode::SUCCESS);
     }
+}
 
-    condition_.notify_all();
+void rai::BlockProcessor::Drop_(const std::shared_ptr<rai::Block>& block,
+                                rai::ErrorCode error_code)
+{
+    rai::BlockProcessResult result{rai::BlockOperation::DROP, error_code, 0};
+    block_observer_(result, block);
+    node_.dumpers_.block_.Dump(result, block);
 }
 
 void rai::BlockProcessor::AddForced(const rai::BlockForced& forced)
@@ -193,7 +249,7 @@ void rai::BlockProcessor::Run()
             blocks_.erase(it);
 
             lock.unlock();
-            ProcessBlock_(block_info.block_, false);
+            ProcessBlocks_(block_info.block_);
             lock.lock();
         }
         else
@@ -214,6 +270,7 @@ void rai::BlockProcessor::Stop()
         stopped_ = true;
     }
     condition_.notify_all();
+    verifier_.Stop();
     if (thread_.joinable())
     {
         thread_.join();
@@ -229,6 +286,16 @@ void rai::BlockProcessor::Status(rai::Ptree& status) const
     status.put("blocks_count", std::to_string(blocks_.size()));
     status.put("forks_count", std::to_string(blocks_fork_.size()));
     status.put("forced_count", std::to_string(blocks_forced_.size()));
+    status.put("unchecked_count", std::to_string(verifier_.Size()));
+    rai::Ptree verifier;
+    verifier_.Status(verifier);
+    status.put("signature_batches", verifier.get<std::string>("batches"));
+    status.put("queue_depth_max", std::to_string(queue_depth_max_));
+    status.put("batches", std::to_string(batches_));
+    status.put("batch_size_last", std::to_string(batch_size_last_));
+    status.put("batch_size_max", std::to_string(batch_size_max_));
+    status.put("batch_size_average",
+               std::to_string(batches_ == 0 ? 0 : batch_blocks_ / batches_));
 }
 
 uint64_t rai::BlockProcessor::Priority_(
@@ -276,126 +343,266 @@ uint64_t rai::BlockProcessor::DynamicOpration_()
 void rai::BlockProcessor::ProcessBlock_(const std::shared_ptr<rai::Block>& block,
                                         bool ignore_fork)
 {
-    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::BlockProcessed processed{block, rai::ErrorCode::SUCCESS, nullptr,
+                                  true};
     {
-        rai::Transaction transaction(error_code, ledger_, true);
-        if (error_code != rai::ErrorCode::SUCCESS)
+        rai::Transaction transaction(processed.error_code_, ledger_, true);
+        if (processed.error_code_ == rai::ErrorCode::SUCCESS)
+        {
+            ProcessBlock_(transaction, block, ignore_fork, processed);
+            if (transaction.Commit())
+            {
+                processed.error_code_ = rai::ErrorCode::MDB_TXN_COMMIT;
+                processed.fork_ = nullptr;
+            }
+        }
+        else
         {
             // log
-            rai::Stats::Add(error_code, "BlockProcessor::ProcessBlock_");
-            rai::BlockProcessResult result{rai::BlockOperation::DROP,
-                                           error_code, 0};
-            block_observer_(result, block);
-            node_.dumpers_.block_.Dump(result, block);
-            return;
+            rai::Stats::Add(processed.error_code_,
+                            "BlockProcessor::ProcessBlock_");
         }
+    }
+
+    BlockProcessed_(processed);
+}
+
+void rai::BlockProcessor::ProcessBlock_(
+    rai::Transaction& parent, const std::shared_ptr<rai::Block>& block,
+    bool ignore_fork, rai::BlockProcessed& processed)
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    processed = rai::BlockProcessed{block, error_code, nullptr, true};
 
-        error_code = AppendBlock_(transaction, block);
-        switch (error_code)
+    // nested transaction, a failed block is rolled back without touching the
+    // other blocks of the same batch
+    rai::Transaction transaction(error_code, parent);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code, "BlockProcessor::ProcessBlock_");
+        processed.error_code_ = error_code;
+        return;
+    }
+
+    error_code = AppendBlock_(transaction, block);
+    switch (error_code)
+    {
+        case rai::ErrorCode::SUCCESS:
+        case rai::ErrorCode::BLOCK_PROCESS_SIGNATURE:
+        case rai::ErrorCode::BLOCK_PROCESS_EXISTS:
+        case rai::ErrorCode::BLOCK_PROCESS_PREVIOUS:
+        case rai::ErrorCode::BLOCK_PROCESS_OPCODE:
+        case rai::ErrorCode::BLOCK_PROCESS_CREDIT:
+        case rai::ErrorCode::BLOCK_PROCESS_COUNTER:
+        case rai::ErrorCode::BLOCK_PROCESS_TIMESTAMP:
+        case rai::ErrorCode::BLOCK_PROCESS_BALANCE:
+        case rai::ErrorCode::BLOCK_PROCESS_UNRECEIVABLE:
+        case rai::ErrorCode::BLOCK_PROCESS_UNREWARDABLE:
+        case rai::ErrorCode::BLOCK_PROCESS_PRUNED:
+        case rai::ErrorCode::BLOCK_PROCESS_TYPE_MISMATCH:
+        case rai::ErrorCode::BLOCK_PROCESS_REPRESENTATIVE:
+        case rai::ErrorCode::BLOCK_PROCESS_LINK:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BLOCK_PUT:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_SUCCESSOR_SET:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BLOCK_GET:
+        case rai::ErrorCode::BLOCK_PROCESS_TYPE_UNKNOWN:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_RECEIVABLE_INFO_PUT:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_RECEIVABLE_INFO_DEL:
+        case rai::ErrorCode::BLOCK_PROCESS_ACCOUNT_EXCEED_TRANSACTIONS:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_REWARDABLE_INFO_PUT:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_REWARDABLE_INFO_DEL:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_ACCOUNT_INFO_PUT:
+        case rai::ErrorCode::BLOCK_PROCESS_CHAIN:
+        case rai::ErrorCode::BLOCK_PROCESS_BINDING_COUNT:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BINDING_ENTRY_PUT:
+        case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BINDING_COUNT_PUT:
+        case rai::ErrorCode::BLOCK_PROCESS_GAP_PREVIOUS:
+        case rai::ErrorCode::BLOCK_PROCESS_GAP_RECEIVE_SOURCE:
+        case rai::ErrorCode::BLOCK_PROCESS_GAP_REWARD_SOURCE:
         {
-            case rai::ErrorCode::SUCCESS:
-            {
-                node_.QueueGapCaches(block->Hash());
-                node_.Publish(block);
-                break;
-            }
-            case rai::ErrorCode::BLOCK_PROCESS_SIGNATURE:
-            case rai::ErrorCode::BLOCK_PROCESS_EXISTS:
-            case rai::ErrorCode::BLOCK_PROCESS_PREVIOUS:
-            case rai::ErrorCode::BLOCK_PROCESS_OPCODE:
-            case rai::ErrorCode::BLOCK_PROCESS_CREDIT:
-            case rai::ErrorCode::BLOCK_PROCESS_COUNTER:
-            case rai::ErrorCode::BLOCK_PROCESS_TIMESTAMP:
-            case rai::ErrorCode::BLOCK_PROCESS_BALANCE:
-            case rai::ErrorCode::BLOCK_PROCESS_UNRECEIVABLE:
-            case rai::ErrorCode::BLOCK_PROCESS_UNREWARDABLE:
-            case rai::ErrorCode::BLOCK_PROCESS_PRUNED:
-            case rai::ErrorCode::BLOCK_PROCESS_TYPE_MISMATCH:
-            case rai::ErrorCode::BLOCK_PROCESS_REPRESENTATIVE:
-            case rai::ErrorCode::BLOCK_PROCESS_LINK:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BLOCK_PUT:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_SUCCESSOR_SET:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BLOCK_GET:
-            case rai::ErrorCode::BLOCK_PROCESS_TYPE_UNKNOWN:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_RECEIVABLE_INFO_PUT:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_RECEIVABLE_INFO_DEL:
-            case rai::ErrorCode::BLOCK_PROCESS_ACCOUNT_EXCEED_TRANSACTIONS:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_REWARDABLE_INFO_PUT:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_REWARDABLE_INFO_DEL:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_ACCOUNT_INFO_PUT:
-            case rai::ErrorCode::BLOCK_PROCESS_CHAIN:
-            case rai::ErrorCode::BLOCK_PROCESS_BINDING_COUNT:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BINDING_ENTRY_PUT:
-            case rai::ErrorCode::BLOCK_PROCESS_LEDGER_BINDING_COUNT_PUT:
+            break;
+        }
+        case rai::ErrorCode::BLOCK_PROCESS_FORK:
+        {
+            if (ignore_fork)
             {
+                processed.notify_ = false;
                 break;
             }
-            case rai::ErrorCode::BLOCK_PROCESS_GAP_PREVIOUS:
+            rai::Stats::AddDetail(
+                error_code, "account=", block->Account().StringAccount(),
+                ", height=", block->Height(),
+                ", hash=", block->Hash().StringHex());
+            std::shared_ptr<rai::Block> block_l(nullptr);
+            bool error = ledger_.BlockGet(transaction, block->Account(),
+                                          block->Height(), block_l);
+            if (error)
             {
-                rai::GapInfo gap(block->Previous(), block);
-                node_.previous_gap_cache_.Insert(gap);
+                error_code = rai::ErrorCode::BLOCK_PROCESS_LEDGER_INCONSISTENT;
+                rai::Stats::AddDetail(
+                    error_code,
+                    "BlockProcessor::ProcessBlock_: get block by account=",
+                    block->Account().StringAccount(),
+                    ", height=", block->Height());
                 break;
             }
-            case rai::ErrorCode::BLOCK_PROCESS_GAP_RECEIVE_SOURCE:
+            processed.fork_ = block_l;
+            break;
+        }
+        default:
+        {
+            assert(0);
+        }
+    }
+
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        transaction.Abort();
+    }
+    processed.error_code_ = error_code;
+}
+
+void rai::BlockProcessor::ProcessBlocks_(
+    const std::shared_ptr<rai::Block>& first)
+{
+    std::vector<rai::BlockProcessed> batch;
+    batch.reserve(rai::BlockProcessor::MAX_BATCH_BLOCKS);
+    bool committed = false;
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Transaction transaction(error_code, ledger_, true);
+        if (error_code != rai::ErrorCode::SUCCESS)
+        {
+            // log
+            rai::Stats::Add(error_code, "BlockProcessor::ProcessBlocks_");
+            rai::BlockProcessed processed{first, error_code, nullptr, true};
+            BlockProcessed_(processed);
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<rai::Block> block(first);
+        while (block != nullptr)
+        {
+            rai::BlockProcessed processed;
+            ProcessBlock_(transaction, block, false, processed);
+            batch.push_back(processed);
+            block = nullptr;
+
+            if (batch.size() >= rai::BlockProcessor::MAX_BATCH_BLOCKS
+                || std::chrono::steady_clock::now() - start
+                       >= rai::BlockProcessor::MAX_BATCH_TIME)
             {
-                rai::GapInfo gap(block->Link(), block);
-                node_.receive_source_gap_cache_.Insert(gap);
                 break;
             }
-            case rai::ErrorCode::BLOCK_PROCESS_GAP_REWARD_SOURCE:
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_ || blocks_.empty() || !blocks_fork_.empty()
+                || !blocks_forced_.empty())
             {
-                rai::GapInfo gap(block->Link(), block);
-                node_.reward_source_gap_cache_.Insert(gap);
                 break;
             }
-            case rai::ErrorCode::BLOCK_PROCESS_FORK:
+            auto it = blocks_.begin();
+            block = it->block_;
+            blocks_.erase(it);
+        }
+        committed = !transaction.Commit();
+    }
+
+    if (committed)
+    {
+        // the batch is committed, it's safe to expose the blocks to others now
+        for (const auto& processed : batch)
+        {
+            BlockProcessed_(processed);
+        }
+    }
+    else
+    {
+        // nothing of the batch reached the ledger, the blocks are processed
+        // again one by one so only those failing to commit are dropped
+        for (const auto& processed : batch)
+        {
+            ProcessBlock_(processed.block_, false);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++batches_;
+    batch_blocks_ += batch.size();
+    batch_size_last_ = batch.size();
+    if (batch.size() > batch_size_max_)
+    {
+        batch_size_max_ = batch.size();
+    }
+}
+
+void rai::BlockProcessor::BlockProcessed_(
+    const rai::BlockProcessed& processed)
+{
+    if (!processed.notify_)
+    {
+        return;
+    }
+
+    const std::shared_ptr<rai::Block>& block = processed.block_;
+    rai::ErrorCode error_code = processed.error_code_;
+    switch (error_code)
+    {
+        case rai::ErrorCode::SUCCESS:
+        {
+            node_.QueueGapCaches(block->Hash());
+            node_.Publish(block);
+            break;
+        }
+        case rai::ErrorCode::BLOCK_PROCESS_GAP_PREVIOUS:
+        {
+            rai::GapInfo gap(block->Previous(), block);
+            node_.previous_gap_cache_.Insert(gap);
+            break;
+        }
+        case rai::ErrorCode::BLOCK_PROCESS_GAP_RECEIVE_SOURCE:
+        {
+            rai::GapInfo gap(block->Link(), block);
+            node_.receive_source_gap_cache_.Insert(gap);
+            break;
+        }
+        case rai::ErrorCode::BLOCK_PROCESS_GAP_REWARD_SOURCE:
+        {
+            rai::GapInfo gap(block->Link(), block);
+            node_.reward_source_gap_cache_.Insert(gap);
+            break;
+        }
+        case rai::ErrorCode::BLOCK_PROCESS_FORK:
+        {
+            if (processed.fork_ != nullptr)
             {
-                if (ignore_fork)
-                {
-                    transaction.Abort();
-                    return;
-                }
-                rai::Stats::AddDetail(
-                    error_code, "account=", block->Account().StringAccount(),
-                    ", height=", block->Height(),
-                    ", hash=", block->Hash().StringHex());
-                std::shared_ptr<rai::Block> block_l(nullptr);
-                bool error = ledger_.BlockGet(transaction, block->Account(),
-                                              block->Height(), block_l);
-                if (error)
-                {
-                    error_code =
-                        rai::ErrorCode::BLOCK_PROCESS_LEDGER_INCONSISTENT;
-                    rai::Stats::AddDetail(
-                        error_code,
-                        "BlockProcessor::ProcessBlock_: get block by account=",
-                        block->Account().StringAccount(),
-                        ", height=", block->Height());
-                    break;
-                }
-                rai::BlockFork fork{block_l, block, true};
+                rai::BlockFork fork{processed.fork_, block, true};
                 AddFork(fork);
-                break;
-            }
-            default:
-            {
-                assert(0);
             }
+            break;
         }
-
-        if (error_code != rai::ErrorCode::SUCCESS)
+        default:
         {
-            transaction.Abort();
+            break;
         }
     }
 
+    rai::BlockOperation operation = rai::BlockOperation::APPEND;
+    if (error_code == rai::ErrorCode::MDB_TXN_BEGIN
+        || error_code == rai::ErrorCode::MDB_TXN_COMMIT)
+    {
+        operation = rai::BlockOperation::DROP;
+    }
+
     // stat
-    if (error_code != rai::ErrorCode::SUCCESS)
+    if (error_code != rai::ErrorCode::SUCCESS
+        && operation != rai::BlockOperation::DROP)
     {
         rai::Stats::Add(error_code);
     }
 
-    rai::BlockProcessResult result{rai::BlockOperation::APPEND, error_code, 0};
+    rai::BlockProcessResult result{operation, error_code, 0};
     block_observer_(result, block);
     node_.dumpers_.block_.Dump(result, block);
 }
@@ -452,8 +659,14 @@ void rai::BlockProcessor::ProcessBlockFork_(
             return;
         }
 
-        if (info.forks_
-            < rai::MaxAllowedForks(rai::CurrentTimestamp(), head->Credit()) + 2)
+        uint64_t max_forks =
+            rai::MaxAllowedForks(rai::CurrentTimestamp(), head->Credit()) + 2;
+        uint32_t retention = ledger_.ForkRetention().max_per_account_;
+        if (retention > 0 && retention < max_forks)
+        {
+            max_forks = retention;
+        }
+        if (info.forks_ < max_forks)
         {
             error =
                 ledger_.ForkPut(transaction, account, height, *first, *second);
@@ -1979,6 +2192,12 @@ public:
                 && account_info_.confirmed_height_ > account_info_.head_height_)
             {
                 account_info_.confirmed_height_ = rai::Block::INVALID_HEIGHT;
+                error = ledger_.ReceivablesConfirmedSet(
+                    transaction_, block.Account(), 0,
+                    account_info_.head_height_, false);
+                IF_ERROR_RETURN(
+                    error,
+                    rai::ErrorCode::BLOCK_PROCESS_LEDGER_RECEIVABLES_CONFIRM);
             }
             error = ledger_.AccountInfoPut(transaction_, block.Account(),
                                            account_info_);
@@ -2357,6 +2576,14 @@ rai::ErrorCode rai::BlockProcessor::ConfirmBlock_(
             ledger_.AccountInfoPut(transaction, block->Account(), account_info);
         IF_ERROR_RETURN(error,
                         rai::ErrorCode::BLOCK_PROCESS_LEDGER_ACCOUNT_INFO_PUT);
+
+        uint64_t from = last_confirm_height == rai::Block::INVALID_HEIGHT
+                            ? 0
+                            : last_confirm_height + 1;
+        error = ledger_.ReceivablesConfirmedSet(transaction, block->Account(),
+                                                from, block->Height(), true);
+        IF_ERROR_RETURN(
+            error, rai::ErrorCode::BLOCK_PROCESS_LEDGER_RECEIVABLES_CONFIRM);
     }
 
     return rai::ErrorCode::SUCCESS;
@@ -14,6 +14,7 @@
 #include <rai/secure/store.hpp>
 #include <rai/secure/ledger.hpp>
 #include <rai/node/blockquery.hpp>
+#include <rai/node/verifier.hpp>
 
 namespace rai
 {
@@ -65,13 +66,30 @@ public:
     uint64_t last_confirm_height_;
 };
 
+class BlockProcessed
+{
+public:
+    std::shared_ptr<rai::Block> block_;
+    rai::ErrorCode error_code_;
+    std::shared_ptr<rai::Block> fork_;
+    bool notify_;
+};
+
 class Node;
 class BlockProcessor
 {
 public:
     BlockProcessor(rai::Node&);
     ~BlockProcessor();
+    // queues the block once its signature has been verified
     void Add(const std::shared_ptr<rai::Block>&);
+    // verifies the signatures on the verifier threads, see
+    // rai::SignatureVerifier::Add
+    bool Verify(const std::vector<std::shared_ptr<rai::Block>>&,
+                const std::function<void(bool)>&);
+    bool Verify(const std::vector<std::shared_ptr<rai::Block>>&,
+                const std::vector<rai::SignatureCheck>&,
+                const std::function<void(bool)>&);
     void AddForced(const rai::BlockForced&);
     void AddFork(const rai::BlockFork&);
     bool Busy() const;
@@ -82,6 +100,9 @@ public:
     static size_t constexpr MAX_BLOCKS = 256 * 1024;
     static size_t constexpr MAX_BLOCKS_FORK = 128 * 1024;
     static size_t constexpr BUSY_PERCENTAGE = 60;
+    static size_t constexpr MAX_BATCH_BLOCKS = 256;
+    static std::chrono::microseconds constexpr MAX_BATCH_TIME =
+        std::chrono::microseconds(50000);
 
     class OrderedKey
     {
@@ -116,8 +137,14 @@ public:
 
 private:
     static uint64_t Priority_(const std::shared_ptr<rai::Block>&);
+    void Add_(const std::shared_ptr<rai::Block>&);
+    void Drop_(const std::shared_ptr<rai::Block>&, rai::ErrorCode);
     uint64_t DynamicOpration_();
     void ProcessBlock_(const std::shared_ptr<rai::Block>&, bool);
+    void ProcessBlock_(rai::Transaction&, const std::shared_ptr<rai::Block>&,
+                       bool, rai::BlockProcessed&);
+    void ProcessBlocks_(const std::shared_ptr<rai::Block>&);
+    void BlockProcessed_(const rai::BlockProcessed&);
     void ProcessBlockFork_(const std::shared_ptr<rai::Block>&,
                            const std::shared_ptr<rai::Block>&);
     void ProcessBlockForced_(uint64_t, const std::shared_ptr<rai::Block>&);
@@ -169,9 +196,15 @@ private:
     std::deque<rai::BlockForced> blocks_forced_;
     std::deque<rai::BlockFork> blocks_fork_;
     bool stopped_;
+    uint64_t batches_;
+    uint64_t batch_blocks_;
+    size_t batch_size_last_;
+    size_t batch_size_max_;
+    size_t queue_depth_max_;
     //mutex end
 
     std::condition_variable condition_;
     std::thread thread_;
+    rai::SignatureVerifier verifier_;
 };
 }  // namespace rai
\ No newline at end of file
@@ -725,11 +725,7 @@ rai::ErrorCode rai::Bootstrap::RunFull_()
         rai::Transaction transaction(error_code, node_.ledger_, false);
         IF_NOT_SUCCESS_RETURN(error_code);
 
-        auto data = client->Accounts();
-        for (size_t i = 0; i < client->Size(); ++i)
-        {
-            StartSync_(transaction, data[i], count);
-        }
+        StartSync_(transaction, *client, count);
 
         if (client->Finished())
         {
@@ -789,11 +785,7 @@ rai::ErrorCode rai::Bootstrap::RunLight_()
         rai::Transaction transaction(error_code, node_.ledger_, false);
         IF_NOT_SUCCESS_RETURN(error_code);
 
-        auto data = client->Accounts();
-        for (size_t i = 0; i < client->Size(); ++i)
-        {
-            StartSync_(transaction, data[i], count);
-        }
+        StartSync_(transaction, *client, count);
 
         if (client->Finished())
         {
@@ -904,14 +896,51 @@ void rai::Bootstrap::Wait_()
     waiting_ = false;
 }
 
+void rai::Bootstrap::StartSync_(rai::Transaction& transaction,
+                                const rai::BootstrapClient& client,
+                                uint32_t batch) const
+{
+    const auto& data = client.Accounts();
+    std::vector<rai::Account> accounts;
+    accounts.reserve(client.Size());
+    for (size_t i = 0; i < client.Size(); ++i)
+    {
+        accounts.push_back(data[i].account_);
+    }
+
+    std::vector<rai::AccountInfo> infos;
+    bool error =
+        node_.ledger_.AccountInfoGetMany(transaction, accounts, infos);
+    if (error)
+    {
+        // falls back to one lookup per account, an account whose info
+        // still can't be read is synced from height 0
+        rai::Stats::Add(rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET,
+                        "Bootstrap::StartSync_");
+        infos.assign(accounts.size(), rai::AccountInfo());
+        for (size_t i = 0; i < accounts.size(); ++i)
+        {
+            error = node_.ledger_.AccountInfoGet(transaction, accounts[i],
+                                                 infos[i]);
+            if (error)
+            {
+                infos[i] = rai::AccountInfo();
+            }
+        }
+    }
+
+    for (size_t i = 0; i < accounts.size(); ++i)
+    {
+        StartSync_(transaction, data[i], infos[i], batch);
+    }
+}
+
 void rai::Bootstrap::StartSync_(rai::Transaction& transaction,
                                 const rai::BootstrapAccount& data,
+                                const rai::AccountInfo& info,
                                 uint32_t batch) const
 {
-    rai::AccountInfo info;
-    bool error = node_.ledger_.AccountInfoGet(transaction, data.account_, info);
-    bool account_exists = !error && info.Valid();
-    if (!account_exists)
+    if (!info.Valid())
     {
         node_.syncer_.Add(data.account_, 0, true, batch);
         return;
@@ -933,8 +962,8 @@ void rai::Bootstrap::StartSync_(rai::Transaction& transaction,
             return;
         }
         std::shared_ptr<rai::Block> block(nullptr);
-        error = node_.ledger_.BlockGet(transaction, data.account_, data.height_,
-                                       block);
+        bool error = node_.ledger_.BlockGet(transaction, data.account_,
+                                            data.height_, block);
         if (error || block == nullptr)
         {
             rai::Stats::Add(rai::ErrorCode::LEDGER_BLOCK_GET,
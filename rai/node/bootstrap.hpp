@@ -117,8 +117,10 @@ private:
     rai::ErrorCode RunLight_();
     rai::ErrorCode RunFork_();
     void Wait_();
-    void StartSync_(rai::Transaction&, const rai::BootstrapAccount&,
+    void StartSync_(rai::Transaction&, const rai::BootstrapClient&,
                     uint32_t) const;
+    void StartSync_(rai::Transaction&, const rai::BootstrapAccount&,
+                    const rai::AccountInfo&, uint32_t) const;
 
     rai::Node& node_;
     std::atomic<bool> stopped_;
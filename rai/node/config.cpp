@@ -9,7 +9,18 @@ rai::NodeConfig::NodeConfig()
       daily_forward_times_(rai::NodeConfig::DEFAULT_DAILY_FORWARD_TIMES),
       election_concurrency_(rai::Elections::ELECTION_CONCURRENCY),
       enable_rich_list_(false),
-      enable_delegator_list_(false)
+      enable_delegator_list_(false),
+      account_info_cache_size_(rai::Ledger::DEFAULT_ACCOUNT_INFO_CACHE_SIZE),
+      dense_block_index_(false),
+      full_history_(true),
+      prune_depth_(rai::Ledger::DEFAULT_PRUNE_DEPTH),
+      prune_age_(rai::Ledger::DEFAULT_PRUNE_AGE),
+      store_options_(),
+      rollback_max_age_(rai::Ledger::DEFAULT_ROLLBACK_MAX_AGE),
+      rollback_max_per_account_(rai::Ledger::DEFAULT_ROLLBACK_MAX_PER_ACCOUNT),
+      fork_max_age_(rai::Ledger::DEFAULT_FORK_MAX_AGE),
+      fork_max_per_account_(0),
+      udp_receive_sockets_(rai::UdpNetwork::DEFAULT_RECEIVE_SOCKETS)
 {
     switch (rai::RAI_NETWORK)
     {
@@ -137,6 +148,155 @@ rai::ErrorCode rai::NodeConfig::DeserializeJson(bool& upgraded,
                 return error_code;
             }
         }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_ACCOUNT_INFO_CACHE_SIZE;
+        auto account_info_cache_size_o =
+            ptree.get_optional<size_t>("account_info_cache_size");
+        if (account_info_cache_size_o)
+        {
+            account_info_cache_size_ = *account_info_cache_size_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_DENSE_BLOCK_INDEX;
+        auto dense_block_index_o =
+            ptree.get_optional<bool>("dense_block_index");
+        if (dense_block_index_o)
+        {
+            dense_block_index_ = *dense_block_index_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_FULL_HISTORY;
+        auto full_history_o = ptree.get_optional<bool>("full_history");
+        if (full_history_o)
+        {
+            full_history_ = *full_history_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_PRUNE_DEPTH;
+        auto prune_depth_o = ptree.get_optional<uint64_t>("prune_depth");
+        if (prune_depth_o)
+        {
+            prune_depth_ = *prune_depth_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_PRUNE_AGE;
+        auto prune_age_o = ptree.get_optional<uint64_t>("prune_age");
+        if (prune_age_o)
+        {
+            prune_age_ = *prune_age_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_STORE_ENGINE;
+        auto store_engine_o = ptree.get_optional<std::string>("store_engine");
+        if (store_engine_o)
+        {
+            store_options_.engine_ =
+                rai::StringToStoreEngineType(*store_engine_o);
+            if (store_options_.engine_ == rai::StoreEngineType::INVALID)
+            {
+                return error_code;
+            }
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_STORE_DURABILITY;
+        auto store_durability_o =
+            ptree.get_optional<std::string>("store_durability");
+        if (store_durability_o)
+        {
+            store_options_.durability_ =
+                rai::StringToStoreDurability(*store_durability_o);
+            if (store_options_.durability_ == rai::StoreDurability::INVALID)
+            {
+                return error_code;
+            }
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_STORE_MAP_SIZE;
+        auto store_map_size_o = ptree.get_optional<uint64_t>("store_map_size");
+        if (store_map_size_o)
+        {
+            if (*store_map_size_o == 0 || *store_map_size_o > 1024 * 1024)
+            {
+                return error_code;
+            }
+            store_options_.map_size_ = *store_map_size_o * 1024 * 1024 * 1024;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_STORE_SYNC_INTERVAL;
+        auto store_sync_interval_o =
+            ptree.get_optional<uint64_t>("store_sync_interval");
+        if (store_sync_interval_o)
+        {
+            if (*store_sync_interval_o == 0)
+            {
+                return error_code;
+            }
+            store_options_.sync_interval_ = *store_sync_interval_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_STORE_SYNC_COMMITS;
+        auto store_sync_commits_o =
+            ptree.get_optional<uint64_t>("store_sync_commits");
+        if (store_sync_commits_o)
+        {
+            store_options_.sync_commits_ = *store_sync_commits_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_ROLLBACK_MAX_AGE;
+        auto rollback_max_age_o =
+            ptree.get_optional<uint64_t>("rollback_max_age");
+        if (rollback_max_age_o)
+        {
+            rollback_max_age_ = *rollback_max_age_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_ROLLBACK_MAX_PER_ACCOUNT;
+        auto rollback_max_per_account_o =
+            ptree.get_optional<uint32_t>("rollback_max_per_account");
+        if (rollback_max_per_account_o)
+        {
+            rollback_max_per_account_ = *rollback_max_per_account_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_FORK_MAX_AGE;
+        auto fork_max_age_o = ptree.get_optional<uint64_t>("fork_max_age");
+        if (fork_max_age_o)
+        {
+            fork_max_age_ = *fork_max_age_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_FORK_MAX_PER_ACCOUNT;
+        auto fork_max_per_account_o =
+            ptree.get_optional<uint32_t>("fork_max_per_account");
+        if (fork_max_per_account_o)
+        {
+            fork_max_per_account_ = *fork_max_per_account_o;
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_UDP_RECEIVE_SOCKETS;
+        auto udp_receive_sockets_o =
+            ptree.get_optional<uint32_t>("udp_receive_sockets");
+        if (udp_receive_sockets_o)
+        {
+            udp_receive_sockets_ =
+                std::max<uint32_t>(1, *udp_receive_sockets_o);
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_MESSAGE_DISPATCH;
+        auto message_dispatch_o = ptree.get_child_optional("message_dispatch");
+        if (message_dispatch_o)
+        {
+            error_code = message_dispatch_.DeserializeJson(*message_dispatch_o);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+
+        error_code = rai::ErrorCode::JSON_CONFIG_INGRESS_LIMIT;
+        auto ingress_limit_o = ptree.get_child_optional("ingress_limit");
+        if (ingress_limit_o)
+        {
+            error_code = ingress_limit_.DeserializeJson(*ingress_limit_o);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
     }
     catch (...)
     {
@@ -147,7 +307,7 @@ rai::ErrorCode rai::NodeConfig::DeserializeJson(bool& upgraded,
 
 void rai::NodeConfig::SerializeJson(rai::Ptree& ptree) const
 {
-    ptree.put("version", "6");
+    ptree.put("version", "15");
     ptree.put("address", address_.to_string());
     ptree.put("port", port_);
     ptree.put("io_threads", io_threads_);
@@ -169,6 +329,34 @@ void rai::NodeConfig::SerializeJson(rai::Ptree& ptree) const
     ptree.put("enable_rich_list", enable_rich_list_);
     ptree.put("enable_delegator_list", enable_delegator_list_);
     ptree.put("validator_url", validator_url_.String());
+    ptree.put("account_info_cache_size",
+              std::to_string(account_info_cache_size_));
+    ptree.put("dense_block_index", dense_block_index_);
+    ptree.put("full_history", full_history_);
+    ptree.put("prune_depth", std::to_string(prune_depth_));
+    ptree.put("prune_age", std::to_string(prune_age_));
+    ptree.put("store_engine",
+              rai::StoreEngineTypeToString(store_options_.engine_));
+    ptree.put("store_durability",
+              rai::StoreDurabilityToString(store_options_.durability_));
+    ptree.put("store_map_size",
+              std::to_string(store_options_.map_size_ / (1024 * 1024 * 1024)));
+    ptree.put("store_sync_interval",
+              std::to_string(store_options_.sync_interval_));
+    ptree.put("store_sync_commits",
+              std::to_string(store_options_.sync_commits_));
+    ptree.put("rollback_max_age", std::to_string(rollback_max_age_));
+    ptree.put("rollback_max_per_account",
+              std::to_string(rollback_max_per_account_));
+    ptree.put("fork_max_age", std::to_string(fork_max_age_));
+    ptree.put("fork_max_per_account", std::to_string(fork_max_per_account_));
+    ptree.put("udp_receive_sockets", std::to_string(udp_receive_sockets_));
+    rai::Ptree message_dispatch;
+    message_dispatch_.SerializeJson(message_dispatch);
+    ptree.add_child("message_dispatch", message_dispatch);
+    rai::Ptree ingress_limit;
+    ingress_limit_.SerializeJson(ingress_limit);
+    ptree.add_child("ingress_limit", ingress_limit);
 }
 
 rai::ErrorCode rai::NodeConfig::UpgradeJson(bool& upgraded, uint32_t version,
@@ -208,6 +396,60 @@ rai::ErrorCode rai::NodeConfig::UpgradeJson(bool& upgraded, uint32_t version,
             IF_NOT_SUCCESS_RETURN(error_code);
         }
         case 6:
+        {
+            upgraded = true;
+            error_code = UpgradeV6V7(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 7:
+        {
+            upgraded = true;
+            error_code = UpgradeV7V8(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 8:
+        {
+            upgraded = true;
+            error_code = UpgradeV8V9(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 9:
+        {
+            upgraded = true;
+            error_code = UpgradeV9V10(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 10:
+        {
+            upgraded = true;
+            error_code = UpgradeV10V11(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 11:
+        {
+            upgraded = true;
+            error_code = UpgradeV11V12(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 12:
+        {
+            upgraded = true;
+            error_code = UpgradeV12V13(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 13:
+        {
+            upgraded = true;
+            error_code = UpgradeV13V14(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 14:
+        {
+            upgraded = true;
+            error_code = UpgradeV14V15(ptree);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 15:
         {
             break;
         }
@@ -276,5 +518,105 @@ rai::ErrorCode rai::NodeConfig::UpgradeV5V6(rai::Ptree& ptree) const
 
     ptree.put("validator_url", validator_url_.String());
 
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV6V7(rai::Ptree& ptree) const
+{
+    ptree.put("version", 7);
+
+    ptree.put("account_info_cache_size",
+              std::to_string(account_info_cache_size_));
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV7V8(rai::Ptree& ptree) const
+{
+    ptree.put("version", 8);
+
+    ptree.put("full_history", full_history_);
+    ptree.put("prune_depth", std::to_string(prune_depth_));
+    ptree.put("prune_age", std::to_string(prune_age_));
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV8V9(rai::Ptree& ptree) const
+{
+    ptree.put("version", 9);
+
+    ptree.put("store_engine",
+              rai::StoreEngineTypeToString(store_options_.engine_));
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV9V10(rai::Ptree& ptree) const
+{
+    ptree.put("version", 10);
+
+    ptree.put("store_durability",
+              rai::StoreDurabilityToString(store_options_.durability_));
+    ptree.put("store_map_size",
+              std::to_string(store_options_.map_size_ / (1024 * 1024 * 1024)));
+    ptree.put("store_sync_interval",
+              std::to_string(store_options_.sync_interval_));
+    ptree.put("store_sync_commits",
+              std::to_string(store_options_.sync_commits_));
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV10V11(rai::Ptree& ptree) const
+{
+    ptree.put("version", 11);
+
+    ptree.put("rollback_max_age", std::to_string(rollback_max_age_));
+    ptree.put("rollback_max_per_account",
+              std::to_string(rollback_max_per_account_));
+    ptree.put("fork_max_age", std::to_string(fork_max_age_));
+    ptree.put("fork_max_per_account", std::to_string(fork_max_per_account_));
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV11V12(rai::Ptree& ptree) const
+{
+    ptree.put("version", 12);
+
+    ptree.put("udp_receive_sockets", std::to_string(udp_receive_sockets_));
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV12V13(rai::Ptree& ptree) const
+{
+    ptree.put("version", 13);
+
+    rai::Ptree message_dispatch;
+    message_dispatch_.SerializeJson(message_dispatch);
+    ptree.add_child("message_dispatch", message_dispatch);
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV13V14(rai::Ptree& ptree) const
+{
+    ptree.put("version", 14);
+
+    rai::Ptree ingress_limit;
+    ingress_limit_.SerializeJson(ingress_limit);
+    ptree.add_child("ingress_limit", ingress_limit);
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::NodeConfig::UpgradeV14V15(rai::Ptree& ptree) const
+{
+    ptree.put("version", 15);
+
+    ptree.put("dense_block_index", dense_block_index_);
+
     return rai::ErrorCode::SUCCESS;
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <rai/common/log.hpp>
 #include <rai/common/numbers.hpp>
 #include <rai/common/chain.hpp>
+#include <rai/secure/lmdb.hpp>
+#include <rai/node/dispatcher.hpp>
+#include <rai/node/limiter.hpp>
 
 namespace rai
 {
@@ -21,6 +24,15 @@ public:
     rai::ErrorCode UpgradeV3V4(rai::Ptree&) const;
     rai::ErrorCode UpgradeV4V5(rai::Ptree&) const;
     rai::ErrorCode UpgradeV5V6(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV6V7(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV7V8(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV8V9(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV9V10(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV10V11(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV11V12(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV12V13(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV13V14(rai::Ptree&) const;
+    rai::ErrorCode UpgradeV14V15(rai::Ptree&) const;
 
     static uint32_t constexpr DEFAULT_DAILY_FORWARD_TIMES = 12;
 
@@ -36,6 +48,24 @@ public:
     bool enable_rich_list_;
     bool enable_delegator_list_;
     rai::Url validator_url_;
+    size_t account_info_cache_size_;
+    // index every block height instead of every BLOCKS_PER_INDEX heights,
+    // faster height lookups for more disk; pruning needs it
+    bool dense_block_index_;
+    bool full_history_;
+    uint64_t prune_depth_;
+    uint64_t prune_age_;
+    // the map size is configured in GB
+    rai::MdbEnvOptions store_options_;
+    // seconds, 0 keeps rollbacks and forks forever
+    uint64_t rollback_max_age_;
+    uint32_t rollback_max_per_account_;
+    uint64_t fork_max_age_;
+    uint32_t fork_max_per_account_;
+    // sockets sharing the udp port, only linux uses more than one
+    uint32_t udp_receive_sockets_;
+    rai::MessageDispatcherConfig message_dispatch_;
+    rai::IngressLimitConfig ingress_limit_;
 };
 
 }
\ No newline at end of file
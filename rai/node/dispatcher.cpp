@@ -0,0 +1,371 @@
+#include <rai/node/dispatcher.hpp>
+
+#include <rai/common/stat.hpp>
+
+namespace
+{
+rai::MessageQueueOptions DefaultQueueOptions(rai::MessageType type)
+{
+    switch (type)
+    {
+        case rai::MessageType::PUBLISH:
+        case rai::MessageType::CONFIRM:
+        {
+            return rai::MessageQueueOptions(
+                4096, 8, rai::MessageDropPolicy::OLDEST);
+        }
+        case rai::MessageType::FORK:
+        case rai::MessageType::CONFLICT:
+        {
+            return rai::MessageQueueOptions(
+                4096, 4, rai::MessageDropPolicy::NEWEST);
+        }
+        case rai::MessageType::QUERY:
+        {
+            return rai::MessageQueueOptions(
+                1024, 2, rai::MessageDropPolicy::NEWEST);
+        }
+        case rai::MessageType::KEEPLIVE:
+        {
+            return rai::MessageQueueOptions(
+                1024, 1, rai::MessageDropPolicy::NEWEST);
+        }
+        case rai::MessageType::BOOTSTRAP:
+        {
+            return rai::MessageQueueOptions(
+                4096, 1, rai::MessageDropPolicy::NEWEST);
+        }
+        default:
+        {
+            return rai::MessageQueueOptions(
+                4096, 2, rai::MessageDropPolicy::NEWEST);
+        }
+    }
+}
+
+uint64_t Microseconds(const std::chrono::steady_clock::duration& duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+        .count();
+}
+}  // namespace
+
+std::string rai::MessageDropPolicyToString(rai::MessageDropPolicy policy)
+{
+    switch (policy)
+    {
+        case rai::MessageDropPolicy::NEWEST:
+        {
+            return "newest";
+        }
+        case rai::MessageDropPolicy::OLDEST:
+        {
+            return "oldest";
+        }
+        default:
+        {
+            return "invalid";
+        }
+    }
+}
+
+rai::MessageDropPolicy rai::StringToMessageDropPolicy(const std::string& str)
+{
+    if (str == "newest")
+    {
+        return rai::MessageDropPolicy::NEWEST;
+    }
+    else if (str == "oldest")
+    {
+        return rai::MessageDropPolicy::OLDEST;
+    }
+    else
+    {
+        return rai::MessageDropPolicy::INVALID;
+    }
+}
+
+rai::MessageQueueOptions::MessageQueueOptions()
+    : capacity_(4096), weight_(1), drop_(rai::MessageDropPolicy::NEWEST)
+{
+}
+
+rai::MessageQueueOptions::MessageQueueOptions(size_t capacity, uint32_t weight,
+                                              rai::MessageDropPolicy drop)
+    : capacity_(capacity), weight_(weight), drop_(drop)
+{
+}
+
+rai::MessageDispatcherConfig::MessageDispatcherConfig()
+    : workers_(rai::MessageDispatcherConfig::DEFAULT_WORKERS)
+{
+    for (size_t i = 0; i < queues_.size(); ++i)
+    {
+        queues_[i] = DefaultQueueOptions(static_cast<rai::MessageType>(i));
+    }
+}
+
+rai::ErrorCode rai::MessageDispatcherConfig::DeserializeJson(
+    const rai::Ptree& ptree)
+{
+    try
+    {
+        auto workers_o = ptree.get_optional<uint32_t>("workers");
+        if (workers_o)
+        {
+            workers_ = std::max<uint32_t>(1, *workers_o);
+        }
+
+        auto queues_o = ptree.get_child_optional("queues");
+        if (!queues_o)
+        {
+            return rai::ErrorCode::SUCCESS;
+        }
+
+        for (size_t i = 1; i < queues_.size(); ++i)
+        {
+            std::string type =
+                rai::MessageTypeToString(static_cast<rai::MessageType>(i));
+            auto queue_o = queues_o->get_child_optional(type);
+            if (!queue_o)
+            {
+                continue;
+            }
+
+            rai::MessageQueueOptions& options = queues_[i];
+            auto capacity_o = queue_o->get_optional<size_t>("capacity");
+            if (capacity_o)
+            {
+                options.capacity_ = std::max<size_t>(1, *capacity_o);
+            }
+
+            auto weight_o = queue_o->get_optional<uint32_t>("weight");
+            if (weight_o)
+            {
+                options.weight_ = std::max<uint32_t>(1, *weight_o);
+            }
+
+            auto drop_o = queue_o->get_optional<std::string>("drop");
+            if (drop_o)
+            {
+                options.drop_ = rai::StringToMessageDropPolicy(*drop_o);
+                if (options.drop_ == rai::MessageDropPolicy::INVALID)
+                {
+                    return rai::ErrorCode::JSON_CONFIG_MESSAGE_DISPATCH;
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        return rai::ErrorCode::JSON_CONFIG_MESSAGE_DISPATCH;
+    }
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+void rai::MessageDispatcherConfig::SerializeJson(rai::Ptree& ptree) const
+{
+    ptree.put("workers", std::to_string(workers_));
+    rai::Ptree queues;
+    for (size_t i = 1; i < queues_.size(); ++i)
+    {
+        const rai::MessageQueueOptions& options = queues_[i];
+        rai::Ptree queue;
+        queue.put("capacity", std::to_string(options.capacity_));
+        queue.put("weight", std::to_string(options.weight_));
+        queue.put("drop", rai::MessageDropPolicyToString(options.drop_));
+        queues.add_child(
+            rai::MessageTypeToString(static_cast<rai::MessageType>(i)),
+            queue);
+    }
+    ptree.add_child("queues", queues);
+}
+
+rai::MessageQueue::MessageQueue()
+    : credits_(0),
+      pushed_(0),
+      processed_(0),
+      dropped_(0),
+      wait_total_(0),
+      wait_max_(0),
+      process_total_(0),
+      process_max_(0)
+{
+}
+
+rai::MessageDispatcher::MessageDispatcher(
+    const rai::MessageDispatcherConfig& config,
+    const rai::MessageHandler& handler)
+    : handler_(handler), stopped_(false), size_(0), cursor_(0)
+{
+    for (size_t i = 0; i < queues_.size(); ++i)
+    {
+        queues_[i].options_ = config.queues_[i];
+        queues_[i].credits_ = config.queues_[i].weight_;
+    }
+
+    for (uint32_t i = 0; i < config.workers_; ++i)
+    {
+        threads_.emplace_back([this]() { this->Run_(); });
+    }
+}
+
+rai::MessageDispatcher::~MessageDispatcher()
+{
+    Stop();
+}
+
+void rai::MessageDispatcher::Push(const rai::Endpoint& remote,
+                                  const uint8_t* data, size_t size)
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::BufferStream stream(data, size);
+    rai::MessageHeader header(error_code, stream);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code);
+        return;
+    }
+
+    rai::QueuedMessage message;
+    message.remote_ = remote;
+    message.bytes_.assign(data, data + size);
+    message.arrival_ = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_)
+        {
+            return;
+        }
+
+        rai::MessageQueue& queue =
+            queues_[static_cast<size_t>(header.type_)];
+        if (queue.messages_.size() >= queue.options_.capacity_)
+        {
+            ++queue.dropped_;
+            if (queue.options_.drop_ != rai::MessageDropPolicy::OLDEST)
+            {
+                return;
+            }
+            queue.messages_.pop_front();
+            --size_;
+        }
+        queue.messages_.push_back(std::move(message));
+        ++queue.pushed_;
+        ++size_;
+    }
+    condition_.notify_one();
+}
+
+void rai::MessageDispatcher::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_)
+        {
+            return;
+        }
+        stopped_ = true;
+    }
+    condition_.notify_all();
+    for (auto& i : threads_)
+    {
+        if (i.joinable())
+        {
+            i.join();
+        }
+    }
+}
+
+size_t rai::MessageDispatcher::Size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+void rai::MessageDispatcher::Status(rai::Ptree& ptree) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ptree.put("workers", std::to_string(threads_.size()));
+    ptree.put("size", std::to_string(size_));
+
+    rai::Ptree queues;
+    for (size_t i = 1; i < queues_.size(); ++i)
+    {
+        const rai::MessageQueue& queue = queues_[i];
+        rai::Ptree entry;
+        entry.put("type", rai::MessageTypeToString(
+                              static_cast<rai::MessageType>(i)));
+        entry.put("depth", std::to_string(queue.messages_.size()));
+        entry.put("capacity", std::to_string(queue.options_.capacity_));
+        entry.put("weight", std::to_string(queue.options_.weight_));
+        entry.put("drop", rai::MessageDropPolicyToString(queue.options_.drop_));
+        entry.put("pushed", std::to_string(queue.pushed_));
+        entry.put("processed", std::to_string(queue.processed_));
+        entry.put("dropped", std::to_string(queue.dropped_));
+        uint64_t processed = queue.processed_;
+        entry.put("wait_average_us",
+                  std::to_string(
+                      processed == 0 ? 0 : queue.wait_total_ / processed));
+        entry.put("wait_max_us", std::to_string(queue.wait_max_));
+        entry.put("process_average_us",
+                  std::to_string(
+                      processed == 0 ? 0 : queue.process_total_ / processed));
+        entry.put("process_max_us", std::to_string(queue.process_max_));
+        queues.push_back(std::make_pair("", entry));
+    }
+    ptree.put_child("queues", queues);
+}
+
+void rai::MessageDispatcher::Run_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopped_)
+    {
+        if (size_ == 0)
+        {
+            condition_.wait(lock);
+            continue;
+        }
+
+        rai::MessageQueue* queue = Next_();
+        rai::QueuedMessage message(std::move(queue->messages_.front()));
+        queue->messages_.pop_front();
+        --size_;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        rai::BufferStream stream(message.bytes_.data(), message.bytes_.size());
+        handler_(message.remote_, stream);
+        auto end = std::chrono::steady_clock::now();
+        uint64_t wait = Microseconds(start - message.arrival_);
+        uint64_t process = Microseconds(end - start);
+
+        lock.lock();
+        ++queue->processed_;
+        queue->wait_total_ += wait;
+        queue->wait_max_ = std::max(queue->wait_max_, wait);
+        queue->process_total_ += process;
+        queue->process_max_ = std::max(queue->process_max_, process);
+    }
+}
+
+// Deficit round robin: a queue is served until its credits run out or it is
+// empty, then the cursor moves on and the queue is refilled to its weight.
+// Must be called with the lock held and at least one message queued
+rai::MessageQueue* rai::MessageDispatcher::Next_()
+{
+    while (true)
+    {
+        rai::MessageQueue& queue = queues_[cursor_];
+        if (!queue.messages_.empty() && queue.credits_ > 0)
+        {
+            --queue.credits_;
+            return &queue;
+        }
+        queue.credits_ = queue.options_.weight_;
+        cursor_ = (cursor_ + 1) % queues_.size();
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <rai/common/errors.hpp>
+#include <rai/common/util.hpp>
+#include <rai/node/message.hpp>
+
+namespace rai
+{
+enum class MessageDropPolicy : uint32_t
+{
+    INVALID = 0,
+    NEWEST  = 1,  // a full queue rejects the arriving message
+    OLDEST  = 2,  // a full queue evicts its oldest message
+};
+std::string MessageDropPolicyToString(rai::MessageDropPolicy);
+rai::MessageDropPolicy StringToMessageDropPolicy(const std::string&);
+
+class MessageQueueOptions
+{
+public:
+    MessageQueueOptions();
+    MessageQueueOptions(size_t, uint32_t, rai::MessageDropPolicy);
+
+    size_t capacity_;
+    // messages taken from the queue per scheduling round
+    uint32_t weight_;
+    rai::MessageDropPolicy drop_;
+};
+
+class MessageDispatcherConfig
+{
+public:
+    MessageDispatcherConfig();
+    rai::ErrorCode DeserializeJson(const rai::Ptree&);
+    void SerializeJson(rai::Ptree&) const;
+
+    static uint32_t constexpr DEFAULT_WORKERS = 4;
+    static size_t constexpr QUEUES =
+        static_cast<size_t>(rai::MessageType::MAX);
+
+    uint32_t workers_;
+    // indexed by rai::MessageType
+    std::array<rai::MessageQueueOptions, QUEUES> queues_;
+};
+
+class QueuedMessage
+{
+public:
+    rai::Endpoint remote_;
+    std::vector<uint8_t> bytes_;
+    std::chrono::steady_clock::time_point arrival_;
+};
+
+class MessageQueue
+{
+public:
+    MessageQueue();
+
+    rai::MessageQueueOptions options_;
+    std::deque<rai::QueuedMessage> messages_;
+    uint32_t credits_;
+    uint64_t pushed_;
+    uint64_t processed_;
+    uint64_t dropped_;
+    // microseconds
+    uint64_t wait_total_;
+    uint64_t wait_max_;
+    uint64_t process_total_;
+    uint64_t process_max_;
+};
+
+// processes one datagram on a worker thread
+using MessageHandler =
+    std::function<void(const rai::Endpoint&, rai::Stream&)>;
+
+// Receive threads only read the message header and queue the datagram by
+// type, workers drain the queues in weighted round robin so a flood of one
+// type cannot delay the others
+class MessageDispatcher
+{
+public:
+    MessageDispatcher(const rai::MessageDispatcherConfig&,
+                      const rai::MessageHandler&);
+    ~MessageDispatcher();
+    void Push(const rai::Endpoint&, const uint8_t*, size_t);
+    void Stop();
+    size_t Size() const;
+    void Status(rai::Ptree&) const;
+
+private:
+    void Run_();
+    rai::MessageQueue* Next_();
+
+    rai::MessageHandler handler_;
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopped_;
+    size_t size_;
+    size_t cursor_;
+    std::array<rai::MessageQueue, rai::MessageDispatcherConfig::QUEUES>
+        queues_;
+    std::vector<std::thread> threads_;
+};
+}  // namespace rai
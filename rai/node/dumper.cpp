@@ -71,6 +71,12 @@ void rai::MessageDumper::Dump(bool send, const rai::Endpoint& remote,
     ++index_;
 }
 
+bool rai::MessageDumper::On() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return on_;
+}
+
 rai::Ptree rai::MessageDumper::Get() const
 {
     rai::Ptree result;
@@ -121,50 +127,7 @@ void rai::MessageDumper::Off()
 
 std::string rai::MessageDumper::ToString(rai::MessageType type)
 {
-    switch (type)
-    {
-        case rai::MessageType::INVALID:
-        {
-            return "invalid";
-        }
-        case rai::MessageType::HANDSHAKE:
-        {
-            return "handshake";
-        }
-        case rai::MessageType::KEEPLIVE:
-        {
-            return "keeplive";
-        }
-        case rai::MessageType::PUBLISH:
-        {
-            return "publish";
-        }
-        case rai::MessageType::CONFIRM:
-        {
-            return "confirm";
-        }
-        case rai::MessageType::QUERY:
-        {
-            return "query";
-        }
-        case rai::MessageType::FORK:
-        {
-            return "fork";
-        }
-        case rai::MessageType::CONFLICT:
-        {
-            return "conflict";
-        }
-        case rai::MessageType::BOOTSTRAP:
-        {
-            return "bootstrap";
-        }
-        default:
-        {
-            return "unknown(" + std::to_string(static_cast<uint32_t>(type))
-                   + ")";
-        }
-    }
+    return rai::MessageTypeToString(type);
 }
 
 rai::Ptree rai::MessageDumper::ParseMessageNormal(
@@ -28,6 +28,7 @@ public:
     void Dump(bool, const rai::Endpoint&, const std::vector<uint8_t>&);
     void Dump(bool, const rai::Endpoint&, const uint8_t*, size_t);
     void Dump(bool, const rai::Endpoint&, std::vector<uint8_t>&&);
+    bool On() const;
     rai::Ptree Get() const;
     void On(const std::string&, const std::string&);
     void Off();
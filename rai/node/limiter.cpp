@@ -0,0 +1,460 @@
+#include <rai/node/limiter.hpp>
+
+#include <algorithm>
+#include <rai/common/parameters.hpp>
+
+uint32_t constexpr rai::IngressLimitConfig::DEFAULT_REP_MAX_FACTOR;
+size_t constexpr rai::IngressShard::OVERFLOW_BUCKETS;
+size_t constexpr rai::IngressLimiter::SHARDS;
+size_t constexpr rai::IngressLimiter::MAX_KEYS_PER_SHARD;
+size_t constexpr rai::IngressLimiter::TOP_OFFENDERS;
+std::chrono::seconds constexpr rai::IngressLimiter::IDLE_CUTOFF;
+
+namespace
+{
+rai::IngressBudget DefaultBudget(rai::MessageType type)
+{
+    switch (type)
+    {
+        case rai::MessageType::HANDSHAKE:
+        case rai::MessageType::KEEPLIVE:
+        {
+            return rai::IngressBudget(4, 16);
+        }
+        case rai::MessageType::CONFIRM:
+        {
+            return rai::IngressBudget(1024, 4096);
+        }
+        case rai::MessageType::FORK:
+        case rai::MessageType::CONFLICT:
+        case rai::MessageType::WEIGHT:
+        {
+            return rai::IngressBudget(64, 256);
+        }
+        case rai::MessageType::BOOTSTRAP:
+        {
+            return rai::IngressBudget(16, 64);
+        }
+        default:
+        {
+            return rai::IngressBudget(256, 1024);
+        }
+    }
+}
+
+// known peers always get their own buckets, unknown ips only while the shard
+// has room
+rai::IngressBuckets& Buckets(rai::IngressShard& shard, uint32_t ip, bool known)
+{
+    auto it = shard.ips_.find(ip);
+    if (it != shard.ips_.end())
+    {
+        return it->second;
+    }
+    if (!known && shard.ips_.size() >= rai::IngressLimiter::MAX_KEYS_PER_SHARD)
+    {
+        // multiplicative hash of the /24 prefix, the low bits of ip already
+        // selected the shard
+        uint32_t index = ((ip >> 8) * 2654435761u) >> 24;
+        return shard.overflow_[index % rai::IngressShard::OVERFLOW_BUCKETS];
+    }
+    return shard.ips_[ip];
+}
+
+size_t ShardIndex(uint32_t ip)
+{
+    return ip % rai::IngressLimiter::SHARDS;
+}
+
+size_t ShardIndex(const rai::Account& account)
+{
+    return std::hash<rai::Account>()(account) % rai::IngressLimiter::SHARDS;
+}
+
+template <typename Map>
+void PurgeIdle(Map& map, const std::chrono::steady_clock::time_point& cutoff)
+{
+    for (auto i = map.begin(); i != map.end();)
+    {
+        if (i->second.last_ < cutoff)
+        {
+            i = map.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void PutOffenders(rai::Ptree& ptree, const std::string& name,
+                  std::vector<std::pair<uint64_t, std::string>>& offenders)
+{
+    size_t count = std::min(offenders.size(),
+                            rai::IngressLimiter::TOP_OFFENDERS);
+    std::partial_sort(offenders.begin(), offenders.begin() + count,
+                      offenders.end(),
+                      std::greater<std::pair<uint64_t, std::string>>());
+    rai::Ptree entries;
+    for (size_t i = 0; i < count; ++i)
+    {
+        rai::Ptree entry;
+        entry.put(name, offenders[i].second);
+        entry.put("dropped", std::to_string(offenders[i].first));
+        entries.push_back(std::make_pair("", entry));
+    }
+    ptree.put_child("top_" + name + "s", entries);
+}
+}  // namespace
+
+rai::IngressBudget::IngressBudget() : rate_(0), burst_(0)
+{
+}
+
+rai::IngressBudget::IngressBudget(uint32_t rate, uint32_t burst)
+    : rate_(rate), burst_(burst)
+{
+}
+
+rai::IngressLimitConfig::IngressLimitConfig()
+    : enable_(true),
+      rep_max_factor_(rai::IngressLimitConfig::DEFAULT_REP_MAX_FACTOR)
+{
+    for (size_t i = 0; i < budgets_.size(); ++i)
+    {
+        budgets_[i] = DefaultBudget(static_cast<rai::MessageType>(i));
+    }
+}
+
+rai::ErrorCode rai::IngressLimitConfig::DeserializeJson(
+    const rai::Ptree& ptree)
+{
+    try
+    {
+        auto enable_o = ptree.get_optional<bool>("enable");
+        if (enable_o)
+        {
+            enable_ = *enable_o;
+        }
+
+        auto rep_max_factor_o = ptree.get_optional<uint32_t>("rep_max_factor");
+        if (rep_max_factor_o)
+        {
+            rep_max_factor_ = std::max<uint32_t>(1, *rep_max_factor_o);
+        }
+
+        auto budgets_o = ptree.get_child_optional("budgets");
+        if (!budgets_o)
+        {
+            return rai::ErrorCode::SUCCESS;
+        }
+
+        for (size_t i = 1; i < budgets_.size(); ++i)
+        {
+            std::string type =
+                rai::MessageTypeToString(static_cast<rai::MessageType>(i));
+            auto budget_o = budgets_o->get_child_optional(type);
+            if (!budget_o)
+            {
+                continue;
+            }
+
+            rai::IngressBudget& budget = budgets_[i];
+            auto rate_o = budget_o->get_optional<uint32_t>("rate");
+            if (rate_o)
+            {
+                // a zero rate never refills, the type would be blocked for
+                // good once the burst is spent
+                if (*rate_o == 0)
+                {
+                    return rai::ErrorCode::JSON_CONFIG_INGRESS_LIMIT;
+                }
+                budget.rate_ = *rate_o;
+            }
+
+            auto burst_o = budget_o->get_optional<uint32_t>("burst");
+            if (burst_o)
+            {
+                budget.burst_ = std::max<uint32_t>(1, *burst_o);
+            }
+        }
+    }
+    catch (...)
+    {
+        return rai::ErrorCode::JSON_CONFIG_INGRESS_LIMIT;
+    }
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+void rai::IngressLimitConfig::SerializeJson(rai::Ptree& ptree) const
+{
+    ptree.put("enable", enable_);
+    ptree.put("rep_max_factor", std::to_string(rep_max_factor_));
+    rai::Ptree budgets;
+    for (size_t i = 1; i < budgets_.size(); ++i)
+    {
+        rai::Ptree budget;
+        budget.put("rate", std::to_string(budgets_[i].rate_));
+        budget.put("burst", std::to_string(budgets_[i].burst_));
+        budgets.add_child(
+            rai::MessageTypeToString(static_cast<rai::MessageType>(i)),
+            budget);
+    }
+    ptree.add_child("budgets", budgets);
+}
+
+rai::TokenBucket::TokenBucket() : tokens_(-1)
+{
+}
+
+bool rai::TokenBucket::Consume(
+    double rate, double burst, const std::chrono::steady_clock::time_point& now)
+{
+    if (tokens_ < 0)
+    {
+        tokens_ = burst;
+    }
+    else
+    {
+        double elapsed =
+            std::chrono::duration<double>(now - last_).count();
+        tokens_ = std::min(burst, tokens_ + std::max(0.0, elapsed) * rate);
+    }
+    last_ = now;
+
+    if (tokens_ < 1)
+    {
+        return false;
+    }
+    tokens_ -= 1;
+    return true;
+}
+
+rai::IngressBuckets::IngressBuckets() : dropped_(0)
+{
+}
+
+rai::IngressPeer::IngressPeer() : account_(0), factor_(0)
+{
+}
+
+rai::IngressPeerInfo::IngressPeerInfo(const rai::Account& account,
+                                      const rai::Amount& weight,
+                                      const rai::IP& ip, const rai::IP& proxy)
+    : account_(account), weight_(weight), ip_(ip), proxy_(proxy)
+{
+}
+
+rai::IngressLimiter::IngressLimiter(const rai::IngressLimitConfig& config)
+    : config_(config)
+{
+    for (size_t i = 0; i < rai::IngressLimitConfig::TYPES; ++i)
+    {
+        ip_dropped_[i] = 0;
+        account_dropped_[i] = 0;
+    }
+}
+
+bool rai::IngressLimiter::Allow(const rai::Endpoint& remote,
+                                const uint8_t* data, size_t size)
+{
+    return Allow(remote, data, size, std::chrono::steady_clock::now());
+}
+
+bool rai::IngressLimiter::Allow(
+    const rai::Endpoint& remote, const uint8_t* data, size_t size,
+    const std::chrono::steady_clock::time_point& now)
+{
+    if (!config_.enable_)
+    {
+        return true;
+    }
+
+    // magic number (2 bytes), version using, version min, type; malformed
+    // headers are left to the parser
+    if (size < 5)
+    {
+        return true;
+    }
+    size_t type = data[4];
+    if (type == 0 || type >= rai::IngressLimitConfig::TYPES)
+    {
+        return true;
+    }
+
+    uint32_t ip = remote.address().to_v4().to_ulong();
+    rai::IngressPeer peer;
+    {
+        rai::IngressShard& shard = shards_[ShardIndex(ip)];
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        auto it = shard.peers_.find(ip);
+        bool known = it != shard.peers_.end();
+        if (known)
+        {
+            peer = it->second;
+        }
+        rai::IngressBuckets& buckets = Buckets(shard, ip, known);
+        if (!Consume_(buckets, type, std::max<uint32_t>(1, peer.factor_), now))
+        {
+            ++ip_dropped_[type];
+            return false;
+        }
+    }
+
+    if (peer.account_.IsZero())
+    {
+        return true;
+    }
+
+    rai::IngressShard& shard = shards_[ShardIndex(peer.account_)];
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    // bounded by the number of peers
+    rai::IngressBuckets& buckets = shard.accounts_[peer.account_];
+    if (!Consume_(buckets, type, peer.factor_, now))
+    {
+        ++account_dropped_[type];
+        return false;
+    }
+    return true;
+}
+
+void rai::IngressLimiter::Refresh(
+    const std::vector<rai::IngressPeerInfo>& peers)
+{
+    std::array<std::unordered_map<uint32_t, rai::IngressPeer>, SHARDS> maps;
+    for (const auto& i : peers)
+    {
+        uint32_t factor = Factor_(i.weight_);
+        uint32_t ip = i.ip_.to_ulong();
+        rai::IngressPeer& peer = maps[ShardIndex(ip)][ip];
+        peer.account_ = i.account_;
+        peer.factor_ += factor;
+
+        if (!i.proxy_.is_unspecified())
+        {
+            ip = i.proxy_.to_ulong();
+            maps[ShardIndex(ip)][ip].factor_ += factor;
+        }
+    }
+
+    for (size_t i = 0; i < SHARDS; ++i)
+    {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex_);
+        shards_[i].peers_.swap(maps[i]);
+    }
+}
+
+void rai::IngressLimiter::Purge()
+{
+    Purge(std::chrono::steady_clock::now());
+}
+
+void rai::IngressLimiter::Purge(
+    const std::chrono::steady_clock::time_point& now)
+{
+    auto cutoff = now - rai::IngressLimiter::IDLE_CUTOFF;
+    for (auto& i : shards_)
+    {
+        std::lock_guard<std::mutex> lock(i.mutex_);
+        PurgeIdle(i.ips_, cutoff);
+        PurgeIdle(i.accounts_, cutoff);
+    }
+}
+
+void rai::IngressLimiter::Status(rai::Ptree& ptree) const
+{
+    ptree.put("enable", config_.enable_);
+    ptree.put("rep_max_factor", std::to_string(config_.rep_max_factor_));
+
+    rai::Ptree types;
+    for (size_t i = 1; i < rai::IngressLimitConfig::TYPES; ++i)
+    {
+        rai::Ptree entry;
+        entry.put("type", rai::MessageTypeToString(
+                              static_cast<rai::MessageType>(i)));
+        entry.put("rate", std::to_string(config_.budgets_[i].rate_));
+        entry.put("burst", std::to_string(config_.budgets_[i].burst_));
+        entry.put("ip_dropped", std::to_string(ip_dropped_[i].load()));
+        entry.put("account_dropped",
+                  std::to_string(account_dropped_[i].load()));
+        types.push_back(std::make_pair("", entry));
+    }
+    ptree.put_child("types", types);
+
+    size_t peers = 0;
+    size_t ips = 0;
+    size_t accounts = 0;
+    uint64_t overflow = 0;
+    std::vector<std::pair<uint64_t, std::string>> top_ips;
+    std::vector<std::pair<uint64_t, std::string>> top_accounts;
+    for (auto& i : shards_)
+    {
+        std::lock_guard<std::mutex> lock(i.mutex_);
+        peers += i.peers_.size();
+        ips += i.ips_.size();
+        accounts += i.accounts_.size();
+        for (const auto& j : i.overflow_)
+        {
+            overflow += j.dropped_;
+        }
+        for (const auto& j : i.ips_)
+        {
+            if (j.second.dropped_ > 0)
+            {
+                top_ips.emplace_back(j.second.dropped_,
+                                     rai::IP(j.first).to_string());
+            }
+        }
+        for (const auto& j : i.accounts_)
+        {
+            if (j.second.dropped_ > 0)
+            {
+                top_accounts.emplace_back(j.second.dropped_,
+                                          j.first.StringAccount());
+            }
+        }
+    }
+    ptree.put("peers", std::to_string(peers));
+    ptree.put("ips", std::to_string(ips));
+    ptree.put("accounts", std::to_string(accounts));
+    ptree.put("overflow_dropped", std::to_string(overflow));
+    PutOffenders(ptree, "ip", top_ips);
+    PutOffenders(ptree, "account", top_accounts);
+}
+
+bool rai::IngressLimiter::Consume_(
+    rai::IngressBuckets& buckets, size_t type, uint32_t factor,
+    const std::chrono::steady_clock::time_point& now)
+{
+    const rai::IngressBudget& budget = config_.budgets_[type];
+    buckets.last_ = now;
+    bool allowed = buckets.buckets_[type].Consume(
+        static_cast<double>(budget.rate_) * factor,
+        static_cast<double>(budget.burst_) * factor, now);
+    if (!allowed)
+    {
+        ++buckets.dropped_;
+    }
+    return allowed;
+}
+
+// 1 for ordinary peers, qualified representatives start at 2 and gain one
+// more for every tenfold of weight, up to rep_max_factor
+uint32_t rai::IngressLimiter::Factor_(const rai::Amount& weight) const
+{
+    if (weight < rai::QUALIFIED_REP_WEIGHT)
+    {
+        return 1;
+    }
+
+    uint32_t factor = 2;
+    rai::uint128_t ratio =
+        weight.Number() / rai::QUALIFIED_REP_WEIGHT.Number();
+    while (factor < config_.rep_max_factor_ && ratio >= 10)
+    {
+        ++factor;
+        ratio /= 10;
+    }
+    return std::min(factor, config_.rep_max_factor_);
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <rai/common/errors.hpp>
+#include <rai/common/numbers.hpp>
+#include <rai/common/util.hpp>
+#include <rai/node/message.hpp>
+
+namespace rai
+{
+class IngressBudget
+{
+public:
+    IngressBudget();
+    IngressBudget(uint32_t, uint32_t);
+
+    // messages per second
+    uint32_t rate_;
+    uint32_t burst_;
+};
+
+class IngressLimitConfig
+{
+public:
+    IngressLimitConfig();
+    rai::ErrorCode DeserializeJson(const rai::Ptree&);
+    void SerializeJson(rai::Ptree&) const;
+
+    static uint32_t constexpr DEFAULT_REP_MAX_FACTOR = 8;
+    static size_t constexpr TYPES = static_cast<size_t>(rai::MessageType::MAX);
+
+    bool enable_;
+    // cap of the budget multiplier granted to representatives
+    uint32_t rep_max_factor_;
+    // budgets of one ip or one account, indexed by rai::MessageType
+    std::array<rai::IngressBudget, TYPES> budgets_;
+};
+
+class TokenBucket
+{
+public:
+    TokenBucket();
+    // refills at the rate per second up to the burst, returns false when no
+    // token is left
+    bool Consume(double, double, const std::chrono::steady_clock::time_point&);
+
+    double tokens_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+class IngressBuckets
+{
+public:
+    IngressBuckets();
+
+    std::array<rai::TokenBucket, rai::IngressLimitConfig::TYPES> buckets_;
+    uint64_t dropped_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+class IngressPeer
+{
+public:
+    IngressPeer();
+
+    // zero for proxies
+    rai::Account account_;
+    uint32_t factor_;
+};
+
+// What the limiter needs to know about a connected peer
+class IngressPeerInfo
+{
+public:
+    IngressPeerInfo(const rai::Account&, const rai::Amount&, const rai::IP&,
+                    const rai::IP&);
+
+    rai::Account account_;
+    rai::Amount weight_;
+    rai::IP ip_;
+    // zero when the peer is reached directly
+    rai::IP proxy_;
+};
+
+class IngressShard
+{
+public:
+    static size_t constexpr OVERFLOW_BUCKETS = 256;
+
+    std::mutex mutex_;
+    std::unordered_map<uint32_t, rai::IngressPeer> peers_;
+    std::unordered_map<uint32_t, rai::IngressBuckets> ips_;
+    std::unordered_map<rai::Account, rai::IngressBuckets> accounts_;
+    // unknown ips beyond MAX_KEYS_PER_SHARD, selected by their /24 prefix
+    std::array<rai::IngressBuckets, OVERFLOW_BUCKETS> overflow_;
+};
+
+// Token buckets per ip and per peer account with a budget for each message
+// type. Known peers get their budget multiplied by a factor growing with
+// their representative weight, proxies by the peers behind them. The check
+// only reads the type byte of the header, so floods are dropped before any
+// parsing or copying. Known peers always get their own buckets; unknown ips
+// beyond MAX_KEYS_PER_SHARD share the overflow bucket of their /24 prefix, so
+// spoofed sources can neither grow the tables nor starve the other prefixes
+class IngressLimiter
+{
+public:
+    IngressLimiter(const rai::IngressLimitConfig&);
+    bool Allow(const rai::Endpoint&, const uint8_t*, size_t);
+    bool Allow(const rai::Endpoint&, const uint8_t*, size_t,
+               const std::chrono::steady_clock::time_point&);
+    // rebuilds the ip to peer map
+    void Refresh(const std::vector<rai::IngressPeerInfo>&);
+    // forgets the keys idle for IDLE_CUTOFF
+    void Purge();
+    void Purge(const std::chrono::steady_clock::time_point&);
+    void Status(rai::Ptree&) const;
+
+    static size_t constexpr SHARDS = 16;
+    static size_t constexpr MAX_KEYS_PER_SHARD = 4096;
+    static size_t constexpr TOP_OFFENDERS = 10;
+    static std::chrono::seconds constexpr IDLE_CUTOFF =
+        std::chrono::seconds(60);
+
+private:
+    bool Consume_(rai::IngressBuckets&, size_t, uint32_t,
+                  const std::chrono::steady_clock::time_point&);
+    uint32_t Factor_(const rai::Amount&) const;
+
+    rai::IngressLimitConfig config_;
+    mutable std::array<rai::IngressShard, SHARDS> shards_;
+    std::array<std::atomic<uint64_t>, rai::IngressLimitConfig::TYPES>
+        ip_dropped_;
+    std::array<std::atomic<uint64_t>, rai::IngressLimitConfig::TYPES>
+        account_dropped_;
+};
+}  // namespace rai
@@ -7,6 +7,54 @@
 
 size_t constexpr rai::KeepliveMessage::MAX_PEERS;
 
+std::string rai::MessageTypeToString(rai::MessageType type)
+{
+    switch (type)
+    {
+        case rai::MessageType::INVALID:
+        {
+            return "invalid";
+        }
+        case rai::MessageType::HANDSHAKE:
+        {
+            return "handshake";
+        }
+        case rai::MessageType::KEEPLIVE:
+        {
+            return "keeplive";
+        }
+        case rai::MessageType::PUBLISH:
+        {
+            return "publish";
+        }
+        case rai::MessageType::CONFIRM:
+        {
+            return "confirm";
+        }
+        case rai::MessageType::QUERY:
+        {
+            return "query";
+        }
+        case rai::MessageType::FORK:
+        {
+            return "fork";
+        }
+        case rai::MessageType::CONFLICT:
+        {
+            return "conflict";
+        }
+        case rai::MessageType::BOOTSTRAP:
+        {
+            return "bootstrap";
+        }
+        default:
+        {
+            return "unknown(" + std::to_string(static_cast<uint32_t>(type))
+                   + ")";
+        }
+    }
+}
+
 rai::MessageHeader::MessageHeader(rai::MessageType type)
     : MessageHeader(type, 0)
 {
@@ -185,15 +233,14 @@ void rai::Message::EnableProxy(const rai::Endpoint& peer_endpoint)
     header_.SetFlag(rai::MessageFlags::PROXY);
     header_.peer_endpoint_ = peer_endpoint;
 
-    std::vector<uint8_t> header_bytes;
-    {
-        rai::VectorStream stream(header_bytes);
-        header_.Serialize(stream);
-    }
-    std::vector<uint8_t> all_bytes;
-    ToBytes(all_bytes);
-    header_.payload_length_ =
-        static_cast<uint16_t>(all_bytes.size() - header_bytes.size());
+    // the sizes are measured in a pooled datagram, not in temporary vectors
+    rai::DatagramPtr datagram = rai::DatagramPool::Global().Acquire();
+    rai::ArrayStream stream(datagram->Data(), rai::Datagram::CAPACITY);
+    header_.Serialize(stream);
+    size_t header_size = stream.Size();
+    size_t size = 0;
+    ToBytes(datagram->Data(), rai::Datagram::CAPACITY, size);
+    header_.payload_length_ = static_cast<uint16_t>(size - header_size);
 }
 
 void rai::Message::DisableProxy()
@@ -207,6 +254,54 @@ void rai::Message::ToBytes(std::vector<uint8_t>& bytes) const
     Serialize(stream);
 }
 
+bool rai::Message::ToBytes(uint8_t* data, size_t capacity, size_t& size) const
+{
+    rai::ArrayStream stream(data, capacity);
+    Serialize(stream);
+    size = stream.Size();
+    return stream.Overflow();
+}
+
+bool rai::Message::ToBatch(const rai::DatagramPtr& datagram,
+                           rai::UdpBatch& batch)
+{
+    DisableProxy();
+    size_t size = 0;
+    bool error = ToBytes(datagram->Data(), rai::Datagram::CAPACITY, size);
+    IF_ERROR_RETURN(error, true);
+    datagram->Resize(size);
+
+    std::array<uint8_t, rai::UdpBatch::MAX_PREFIX_SIZE> header;
+    rai::ArrayStream stream(header.data(), header.size());
+    header_.Serialize(stream);
+    IF_ERROR_RETURN(stream.Overflow(), true);
+    batch.Reset(datagram, stream.Size());
+    return false;
+}
+
+bool rai::Message::AddToBatch(rai::UdpBatch& batch,
+                              const rai::Endpoint& peer_endpoint) const
+{
+    // the payload still carries its own header
+    return batch.Add(peer_endpoint, batch.payload_->Data(), batch.offset_);
+}
+
+bool rai::Message::AddToBatch(rai::UdpBatch& batch,
+                              const rai::Endpoint& proxy_endpoint,
+                              const rai::Endpoint& peer_endpoint) const
+{
+    rai::MessageHeader header(header_);
+    header.SetFlag(rai::MessageFlags::PROXY);
+    header.peer_endpoint_ = peer_endpoint;
+    header.payload_length_ = static_cast<uint16_t>(batch.PayloadSize());
+
+    std::array<uint8_t, rai::UdpBatch::MAX_PREFIX_SIZE> prefix;
+    rai::ArrayStream stream(prefix.data(), prefix.size());
+    header.Serialize(stream);
+    IF_ERROR_RETURN(stream.Overflow(), true);
+    return batch.Add(proxy_endpoint, prefix.data(), stream.Size());
+}
+
 rai::Endpoint rai::Message::PeerEndpoint() const
 {
     return header_.peer_endpoint_;
@@ -548,7 +643,7 @@ rai::ErrorCode rai::PublishMessage::Deserialize(rai::Stream& stream)
     }
 
     rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-    // verify in rai::Node::ReceiveBlock
+    // verify in rai::BlockProcessor::Verify
     block_ = DeserializeBlockUnverify(error_code, stream);
     return error_code;
 }
@@ -568,17 +663,8 @@ rai::ConfirmMessage::ConfirmMessage(rai::ErrorCode& error_code,
                                     const rai::MessageHeader& header)
     : Message(header)
 {
+    // the signature is verified in batches by rai::SignatureVerifier
     error_code = Deserialize(stream);
-    if (error_code != rai::ErrorCode::SUCCESS)
-    {
-        return;
-    }
-
-    bool error = rai::ValidateMessage(representative_, Hash(), signature_);
-    if (error)
-    {
-        error_code = rai::ErrorCode::MESSAGE_CONFIRM_SIGNATURE;
-    }
 }
 
 rai::ConfirmMessage::ConfirmMessage(uint64_t timestamp,
@@ -626,7 +712,8 @@ rai::ErrorCode rai::ConfirmMessage::Deserialize(rai::Stream& stream)
     IF_ERROR_RETURN(error, rai::ErrorCode::STREAM);
 
     rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-    block_ = DeserializeBlock(error_code, stream);
+    // verify in rai::BlockProcessor::Verify
+    block_ = DeserializeBlockUnverify(error_code, stream);
     IF_NOT_SUCCESS_RETURN(error_code);
 
     return rai::ErrorCode::SUCCESS;
@@ -744,7 +831,8 @@ rai::ErrorCode rai::QueryMessage::Deserialize(rai::Stream& stream)
             || QueryStatus() == rai::QueryStatus::FORK)
         {
             rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-            block_ = DeserializeBlock(error_code, stream);
+            // verify in rai::BlockProcessor::Verify
+            block_ = DeserializeBlockUnverify(error_code, stream);
             IF_NOT_SUCCESS_RETURN(error_code);
         }
     }
@@ -924,10 +1012,11 @@ void rai::ForkMessage::Serialize(rai::Stream& stream) const
 rai::ErrorCode rai::ForkMessage::Deserialize(rai::Stream& stream)
 {
     rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-    first_ = DeserializeBlock(error_code, stream);
+    // verify in rai::BlockProcessor::Verify
+    first_ = DeserializeBlockUnverify(error_code, stream);
     IF_NOT_SUCCESS_RETURN(error_code);
 
-    second_ = DeserializeBlock(error_code, stream);
+    second_ = DeserializeBlockUnverify(error_code, stream);
     IF_NOT_SUCCESS_RETURN(error_code);
 
     return rai::ErrorCode::SUCCESS;
@@ -1001,12 +1090,13 @@ rai::ErrorCode rai::ConflictMessage::Deserialize(rai::Stream& stream)
     IF_ERROR_RETURN(error, rai::ErrorCode::STREAM);
 
     rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-    block_first_ = DeserializeBlock(error_code, stream);
+    // verify in rai::BlockProcessor::Verify
+    block_first_ = DeserializeBlockUnverify(error_code, stream);
     if (error_code != rai::ErrorCode::SUCCESS)
     {
         return rai::ErrorCode::MESSAGE_CONFLICT_BLOCK;
     }
-    block_second_ = DeserializeBlock(error_code, stream);
+    block_second_ = DeserializeBlockUnverify(error_code, stream);
     if (error_code != rai::ErrorCode::SUCCESS)
     {
         return rai::ErrorCode::MESSAGE_CONFLICT_BLOCK;
@@ -1045,19 +1135,18 @@ rai::ErrorCode rai::ConflictMessage::Check_() const
         return rai::ErrorCode::MESSAGE_CONFLICT_TIMESTAMP;
     }
 
-    rai::BlockHash hash_first =
-        Hash_(timestamp_first_, representative_, *block_first_);
-    bool error =
-        rai::ValidateMessage(representative_, hash_first, signature_first_);
-    IF_ERROR_RETURN(error, rai::ErrorCode::MESSAGE_CONFLICT_SIGNATURE);
+    // the signatures are verified in batches by rai::SignatureVerifier
+    return rai::ErrorCode::SUCCESS;
+}
 
-    rai::BlockHash hash_second =
-        Hash_(timestamp_second_, representative_, *block_second_);
-    error =
-        rai::ValidateMessage(representative_, hash_second, signature_second_);
-    IF_ERROR_RETURN(error, rai::ErrorCode::MESSAGE_CONFLICT_SIGNATURE);
+rai::BlockHash rai::ConflictMessage::HashFirst() const
+{
+    return Hash_(timestamp_first_, representative_, *block_first_);
+}
 
-    return rai::ErrorCode::SUCCESS;
+rai::BlockHash rai::ConflictMessage::HashSecond() const
+{
+    return Hash_(timestamp_second_, representative_, *block_second_);
 }
 
 rai::BlockHash rai::ConflictMessage::Hash_(uint64_t timestamp,
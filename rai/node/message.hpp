@@ -31,6 +31,7 @@ enum class MessageType : uint8_t
 
     MAX
 };
+std::string MessageTypeToString(rai::MessageType);
 
 enum class MessageFlags
 {
@@ -86,6 +87,18 @@ public:
     void EnableProxy(const rai::Endpoint&);
     void DisableProxy();
     void ToBytes(std::vector<uint8_t>&) const;
+    // serializes into a caller owned buffer, returns true if the message
+    // does not fit
+    bool ToBytes(uint8_t*, size_t, size_t&) const;
+    // serializes the message without proxy header into the datagram as the
+    // shared payload of the batch, returns true if it does not fit
+    bool ToBatch(const rai::DatagramPtr&, rai::UdpBatch&);
+    // adds a datagram sent directly to the peer, or through the proxy with
+    // the proxy header in front of the payload; returns true if the batch is
+    // full
+    bool AddToBatch(rai::UdpBatch&, const rai::Endpoint&) const;
+    bool AddToBatch(rai::UdpBatch&, const rai::Endpoint&,
+                    const rai::Endpoint&) const;
     rai::Endpoint PeerEndpoint() const;
     void SetPeerEndpoint(const rai::Endpoint&);
     uint8_t Version() const;
@@ -270,6 +283,8 @@ public:
     void Serialize(rai::Stream&) const override;
     rai::ErrorCode Deserialize(rai::Stream&) override;
     void Visit(rai::MessageVisitor&) override;
+    rai::BlockHash HashFirst() const;
+    rai::BlockHash HashSecond() const;
 
     rai::Account representative_;
     uint64_t timestamp_first_;
@@ -1,5 +1,8 @@
 #include <rai/node/network.hpp>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
 #include <boost/format.hpp>
 #include <rai/node/node.hpp>
 
@@ -13,17 +16,262 @@ std::string rai::ToString(const rai::Endpoint& endpoint)
     return stream.str();
 }
 
-rai::UdpNetwork::UdpNetwork(rai::Node& node, const rai::IP& ip, uint16_t port)
-    : socket_(node.service_, rai::Endpoint(ip, port)),
-      resolver_(node.service_),
-      node_(node),
-      on_(true)
+rai::UdpSocket::UdpSocket(boost::asio::io_service& service)
+    : socket_(service), datagrams_(0), batches_(0)
+{
+}
+
+rai::UdpSockets::UdpSockets(boost::asio::io_service& service,
+                            const rai::Endpoint& endpoint, size_t size)
+    : on_(false)
+{
+#ifdef __linux__
+    size_t batch = rai::UdpSockets::BATCH_SIZE;
+#else
+    size_t batch = 1;
+    size = 1;
+#endif
+    size = std::max<size_t>(1, size);
+
+    rai::Endpoint local(endpoint);
+#ifdef __linux__
+    // SO_REUSEPORT would silently share the port with another process doing
+    // the same, such as a second node started with this config. A plain
+    // socket can not bind a port in use, so the group fails like a single
+    // socket would
+    if (size > 1 && local.port() != 0)
+    {
+        boost::asio::ip::udp::socket probe(service);
+        probe.open(local.protocol());
+        boost::system::error_code ec;
+        probe.bind(local, ec);
+        if (ec)
+        {
+            throw boost::system::system_error(
+                ec, "Failed to bind udp port " + std::to_string(local.port()));
+        }
+        probe.close(ec);
+    }
+#endif
+    for (size_t i = 0; i < size; ++i)
+    {
+        auto socket = std::make_unique<rai::UdpSocket>(service);
+        socket->socket_.open(local.protocol());
+#ifdef __linux__
+        if (size > 1)
+        {
+            int enable = 1;
+            int ret = setsockopt(socket->socket_.native_handle(), SOL_SOCKET,
+                                 SO_REUSEPORT, &enable, sizeof(enable));
+            if (ret != 0)
+            {
+                throw boost::system::system_error(boost::system::error_code(
+                    errno, boost::system::system_category()));
+            }
+        }
+#endif
+        boost::asio::socket_base::receive_buffer_size option(
+            rai::UdpSockets::RECEIVE_BUFFER_SIZE);
+        socket->socket_.set_option(option);
+        socket->socket_.bind(local);
+        // port 0 picks a free port, the other sockets join the same one
+        local = socket->socket_.local_endpoint();
+
+        socket->buffers_.resize(batch * rai::UdpSockets::MAX_DATAGRAM_SIZE);
+        socket->remotes_.resize(batch);
+        sockets_.push_back(std::move(socket));
+    }
+}
+
+void rai::UdpSockets::Start(const rai::UdpSockets::Callback& callback)
+{
+    callback_ = callback;
+    on_ = true;
+    for (const auto& i : sockets_)
+    {
+        Receive_(*i);
+    }
+}
+
+void rai::UdpSockets::Stop()
+{
+    on_ = false;
+    for (const auto& i : sockets_)
+    {
+        std::lock_guard<std::mutex> lock(i->mutex_);
+        boost::system::error_code ec;
+        i->socket_.close(ec);
+    }
+}
+
+void rai::UdpSockets::Send(
+    const uint8_t* data, size_t size, const rai::Endpoint& remote,
+    std::function<void(const boost::system::error_code&, size_t)> callback)
+{
+    rai::UdpSocket& socket = *sockets_[0];
+    std::lock_guard<std::mutex> lock(socket.mutex_);
+
+    rai::Log::NetworkSend(
+        boost::str(boost::format("Sending packet, size %1%") % size));
+    socket.socket_.async_send_to(
+        boost::asio::buffer(data, size), remote,
+        [callback](const boost::system::error_code& ec, size_t size) {
+            callback(ec, size);
+            rai::Log::NetworkSend("Packet sent");
+            // TODO: stat
+        });
+}
+
+void rai::UdpSockets::Send(const rai::DatagramPtr& datagram,
+                           const rai::Endpoint& remote)
 {
-    boost::asio::socket_base::receive_buffer_size option(16 * 1024 * 1024);
-    socket_.set_option(option);
+    rai::UdpSocket& socket = *sockets_[0];
+    std::lock_guard<std::mutex> lock(socket.mutex_);
+#ifdef __linux__
+    ssize_t ret = sendto(socket.socket_.native_handle(), datagram->Data(),
+                         datagram->Size(), MSG_DONTWAIT, remote.data(),
+                         remote.size());
+    if (ret >= 0)
+    {
+        return;
+    }
+    int error = errno;
+    if (error != EAGAIN && error != EWOULDBLOCK)
+    {
+        rai::Stats::Add(rai::ErrorCode::UDP_SEND, "errno=", error);
+        return;
+    }
+#endif
+
+    socket.socket_.async_send_to(
+        boost::asio::buffer(datagram->Data(), datagram->Size()), remote,
+        [datagram](const boost::system::error_code& ec, size_t size) {
+            if (ec)
+            {
+                rai::Stats::Add(rai::ErrorCode::UDP_SEND, "ec=", ec.message());
+            }
+        });
 }
 
-void rai::UdpNetwork::Receive()
+size_t rai::UdpSockets::Send(const rai::UdpBatch& batch)
+{
+    rai::UdpSocket& socket = *sockets_[0];
+    size_t size = batch.Size();
+    size_t sent = 0;
+    size_t syscalls = 0;
+#ifdef __linux__
+    size_t constexpr max = rai::UdpSockets::BATCH_SIZE;
+    std::array<mmsghdr, max> headers;
+    std::array<std::array<iovec, 2>, max> iovecs;
+    while (sent < size)
+    {
+        size_t count = std::min(max, size - sent);
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t index = sent + i;
+            iovecs[i][0].iov_base =
+                const_cast<uint8_t*>(batch.prefixes_[index].data());
+            iovecs[i][0].iov_len = batch.prefix_sizes_[index];
+            iovecs[i][1].iov_base = const_cast<uint8_t*>(batch.Payload());
+            iovecs[i][1].iov_len = batch.PayloadSize();
+            headers[i] = mmsghdr();
+            headers[i].msg_hdr.msg_name =
+                const_cast<sockaddr*>(batch.remotes_[index].data());
+            headers[i].msg_hdr.msg_namelen = batch.remotes_[index].size();
+            headers[i].msg_hdr.msg_iov = iovecs[i].data();
+            headers[i].msg_hdr.msg_iovlen = iovecs[i].size();
+        }
+
+        int ret = 0;
+        int error = 0;
+        {
+            std::lock_guard<std::mutex> lock(socket.mutex_);
+            ret = sendmmsg(socket.socket_.native_handle(), headers.data(),
+                           count, MSG_DONTWAIT);
+            error = errno;
+        }
+        ++syscalls;
+        if (ret > 0)
+        {
+            sent += ret;
+            continue;
+        }
+
+        // the rest waits for the socket on the asynchronous path
+        if (error == EAGAIN || error == EWOULDBLOCK)
+        {
+            break;
+        }
+        // the first datagram failed, skip it
+        rai::Stats::Add(rai::ErrorCode::UDP_SEND, "errno=", error);
+        ++sent;
+    }
+#endif
+
+    // the batch is owned by the caller, the rest is copied into pooled
+    // datagrams that stay alive until they are sent
+    for (; sent < size; ++sent)
+    {
+        rai::DatagramPtr datagram = batch.Assemble(sent);
+        if (!datagram)
+        {
+            rai::Stats::Add(rai::ErrorCode::MESSAGE_TOO_LARGE,
+                            "UdpSockets::Send");
+            continue;
+        }
+        Send(datagram, batch.remotes_[sent]);
+        ++syscalls;
+    }
+    return syscalls;
+}
+
+size_t rai::UdpSockets::Size() const
+{
+    return sockets_.size();
+}
+
+rai::Endpoint rai::UdpSockets::LocalEndpoint() const
+{
+    rai::UdpSocket& socket = *sockets_[0];
+    std::lock_guard<std::mutex> lock(socket.mutex_);
+    boost::system::error_code ec;
+    return socket.socket_.local_endpoint(ec);
+}
+
+uint64_t rai::UdpSockets::Datagrams() const
+{
+    uint64_t result = 0;
+    for (const auto& i : sockets_)
+    {
+        result += i->datagrams_;
+    }
+    return result;
+}
+
+void rai::UdpSockets::Status(rai::Ptree& ptree) const
+{
+    uint64_t datagrams = 0;
+    uint64_t batches = 0;
+    rai::Ptree sockets;
+    for (const auto& i : sockets_)
+    {
+        rai::Ptree entry;
+        entry.put("datagrams", std::to_string(i->datagrams_));
+        entry.put("batches", std::to_string(i->batches_));
+        sockets.push_back(std::make_pair("", entry));
+        datagrams += i->datagrams_;
+        batches += i->batches_;
+    }
+    ptree.put("sockets", std::to_string(sockets_.size()));
+    ptree.put("batch_size", std::to_string(sockets_[0]->remotes_.size()));
+    ptree.put("datagrams", std::to_string(datagrams));
+    ptree.put("batches", std::to_string(batches));
+    ptree.put("average_batch",
+              std::to_string(batches == 0 ? 0 : datagrams / batches));
+    ptree.put_child("per_socket", sockets);
+}
+
+void rai::UdpSockets::Receive_(rai::UdpSocket& socket)
 {
     if (!on_)
     {
@@ -32,28 +280,152 @@ void rai::UdpNetwork::Receive()
     }
     rai::Log::NetworkReceive("Receiving packet");
 
-    std::unique_lock<std::mutex> lock(socket_mutex_);
-    socket_.async_receive_from(
-        boost::asio::buffer(buffer_.data(), buffer_.size()), remote_,
-        [this](const boost::system::error_code& error, size_t size) {
-            Process(error, size);
+    std::lock_guard<std::mutex> lock(socket.mutex_);
+#ifdef __linux__
+    socket.socket_.async_wait(
+        boost::asio::ip::udp::socket::wait_read,
+        [this, &socket](const boost::system::error_code& ec) {
+            if (!on_)
+            {
+                return;
+            }
+
+            if (ec)
+            {
+                rai::Log::Network(boost::str(
+                    boost::format("UDP Receive error: %1%") % ec.message()));
+                rai::Stats::Add(rai::ErrorCode::UDP_RECEIVE, "ec=",
+                                ec.message());
+                Receive_(socket);
+                return;
+            }
+
+            Drain_(socket);
         });
+#else
+    socket.socket_.async_receive_from(
+        boost::asio::buffer(socket.buffers_.data(), socket.buffers_.size()),
+        socket.remotes_[0],
+        [this, &socket](const boost::system::error_code& ec, size_t size) {
+            if (!on_)
+            {
+                return;
+            }
+
+            if (ec)
+            {
+                rai::Log::Network(boost::str(
+                    boost::format("UDP Receive error: %1%") % ec.message()));
+                rai::Stats::Add(rai::ErrorCode::UDP_RECEIVE, "ec=",
+                                ec.message());
+            }
+            else
+            {
+                ++socket.batches_;
+                ++socket.datagrams_;
+                callback_(socket.remotes_[0], socket.buffers_.data(), size);
+            }
+            Receive_(socket);
+        });
+#endif
+}
+
+void rai::UdpSockets::Drain_(rai::UdpSocket& socket)
+{
+#ifdef __linux__
+    size_t constexpr batch = rai::UdpSockets::BATCH_SIZE;
+    std::array<mmsghdr, batch> headers;
+    std::array<iovec, batch> iovecs;
+    for (size_t round = 0; round < rai::UdpSockets::MAX_BATCHES; ++round)
+    {
+        for (size_t i = 0; i < batch; ++i)
+        {
+            iovecs[i].iov_base =
+                socket.buffers_.data() + i * rai::UdpSockets::MAX_DATAGRAM_SIZE;
+            iovecs[i].iov_len = rai::UdpSockets::MAX_DATAGRAM_SIZE;
+            headers[i] = mmsghdr();
+            headers[i].msg_hdr.msg_name = socket.remotes_[i].data();
+            headers[i].msg_hdr.msg_namelen = socket.remotes_[i].capacity();
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int count = 0;
+        int error = 0;
+        {
+            std::lock_guard<std::mutex> lock(socket.mutex_);
+            if (!on_)
+            {
+                return;
+            }
+            count = recvmmsg(socket.socket_.native_handle(), headers.data(),
+                             batch, MSG_DONTWAIT, nullptr);
+            error = errno;
+        }
+        if (count < 0)
+        {
+            if (error != EAGAIN && error != EWOULDBLOCK && error != EINTR)
+            {
+                rai::Stats::Add(rai::ErrorCode::UDP_RECEIVE, "errno=", error);
+            }
+            break;
+        }
+
+        ++socket.batches_;
+        socket.datagrams_ += count;
+        for (int i = 0; i < count; ++i)
+        {
+            const msghdr& header = headers[i].msg_hdr;
+            if (header.msg_flags & MSG_TRUNC)
+            {
+                rai::Stats::Add(rai::ErrorCode::UDP_RECEIVE,
+                                "bad size=truncated");
+                continue;
+            }
+            socket.remotes_[i].resize(header.msg_namelen);
+            callback_(socket.remotes_[i],
+                      socket.buffers_.data()
+                          + i * rai::UdpSockets::MAX_DATAGRAM_SIZE,
+                      headers[i].msg_len);
+        }
+
+        if (static_cast<size_t>(count) < batch)
+        {
+            break;
+        }
+    }
+#endif
+    Receive_(socket);
+}
+
+rai::UdpNetwork::UdpNetwork(rai::Node& node, const rai::IP& ip, uint16_t port,
+                            size_t sockets)
+    : sockets_(node.service_, rai::Endpoint(ip, port), sockets),
+      resolver_(node.service_),
+      node_(node),
+      on_(true),
+      batches_(0),
+      batch_datagrams_(0),
+      batch_syscalls_(0),
+      batch_time_total_(0),
+      batch_time_max_(0)
+{
 }
 
 void rai::UdpNetwork::Start()
 {
-    Receive();
+    sockets_.Start([this](const rai::Endpoint& remote, const uint8_t* data,
+                          size_t size) { Process(remote, data, size); });
 }
 
 void rai::UdpNetwork::Stop()
 {
     on_ = false;
-    std::unique_lock<std::mutex> lock(socket_mutex_);
-    socket_.close();
+    sockets_.Stop();
     resolver_.cancel();
 }
 
-void rai::UdpNetwork::Process(const boost::system::error_code& error,
+void rai::UdpNetwork::Process(const rai::Endpoint& remote, const uint8_t* data,
                               size_t size)
 {
     if (!on_)
@@ -61,56 +433,80 @@ void rai::UdpNetwork::Process(const boost::system::error_code& error,
         return;
     }
 
-    if (error)
-    {
-        rai::Log::Network(boost::str(boost::format("UDP Receive error: %1%")
-                                     % error.message()));
-        rai::Stats::Add(rai::ErrorCode::UDP_RECEIVE, "ec=", error.message());
-        Receive();
-        return;
-    }
-
-    if (size == 0 || size > 1472) // 1500 MTU - 20 bytes IP header - 8 bytes UDP header
+    if (size == 0 || size > rai::UdpSockets::MAX_DATAGRAM_SIZE)
     {
         rai::Stats::Add(rai::ErrorCode::UDP_RECEIVE, "bad size=", size);
-        Receive();
         return;
     }
 
-    if (rai::IsReservedIp(remote_.address().to_v4()))
+    if (rai::IsReservedIp(remote.address().to_v4()))
     {
         rai::Stats::Add(rai::ErrorCode::RESERVED_IP,
-                        "ip=", remote_.address().to_v4().to_string());
-        Receive();
+                        "ip=", remote.address().to_v4().to_string());
         return;
     }
 
-    node_.dumpers_.message_.Dump(false, remote_, buffer_.data(), size);
+    if (node_.dumpers_.message_.On())
+    {
+        node_.dumpers_.message_.Dump(false, remote, data, size);
+    }
 
     if (handler_)
     {
-        rai::BufferStream stream(buffer_.data(), size);
-        handler_(remote_, stream);
+        handler_(remote, data, size);
     }
-
-    Receive();
 }
 
 void rai::UdpNetwork::Send(
     const uint8_t* data, size_t size, const rai::Endpoint& remote,
     std::function<void(const boost::system::error_code&, size_t)> callback)
 {
-    std::unique_lock<std::mutex> lock(socket_mutex_);
+    sockets_.Send(data, size, remote, callback);
+}
+
+void rai::UdpNetwork::Send(const rai::DatagramPtr& datagram,
+                           const rai::Endpoint& remote)
+{
+    sockets_.Send(datagram, remote);
+}
 
-    rai::Log::NetworkSend(
-        boost::str(boost::format("Sending packet, size %1%") % size));
-    socket_.async_send_to(
-        boost::asio::buffer(data, size), remote,
-        [this, callback](const boost::system::error_code& ec, size_t size) {
-            callback(ec, size);
-            rai::Log::NetworkSend("Packet sent");
-            // TODO: stat
-        });
+void rai::UdpNetwork::SendBatch(
+    const rai::UdpBatch& batch,
+    const std::chrono::steady_clock::time_point& start)
+{
+    size_t syscalls = sockets_.Send(batch);
+    uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+    ++batches_;
+    batch_datagrams_ += batch.Size();
+    batch_syscalls_ += syscalls;
+    batch_time_total_ += time;
+    uint64_t max = batch_time_max_;
+    while (time > max && !batch_time_max_.compare_exchange_weak(max, time))
+    {
+    }
+}
+
+void rai::UdpNetwork::Status(rai::Ptree& ptree) const
+{
+    sockets_.Status(ptree);
+
+    uint64_t batches = batches_;
+    rai::Ptree broadcast;
+    broadcast.put("count", std::to_string(batches));
+    broadcast.put("datagrams", std::to_string(batch_datagrams_.load()));
+    broadcast.put("syscalls", std::to_string(batch_syscalls_.load()));
+    broadcast.put("latency_average_us",
+                  std::to_string(batches == 0 ? 0
+                                              : batch_time_total_ / batches));
+    broadcast.put("latency_max_us", std::to_string(batch_time_max_.load()));
+    ptree.put_child("broadcast", broadcast);
+
+    rai::Ptree datagram_pool;
+    rai::DatagramPool::Global().Status(datagram_pool);
+    ptree.put_child("datagram_pool", datagram_pool);
 }
 
 void rai::UdpNetwork::Resolve(
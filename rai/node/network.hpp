@@ -6,6 +6,7 @@
 #include <rai/common/errors.hpp>
 #include <rai/common/util.hpp>
 #include <rai/common/numbers.hpp>
+#include <rai/common/datagram.hpp>
 
 namespace rai
 {
@@ -14,36 +15,106 @@ using Endpoint = UdpEndpoint;
 
 std::string ToString(const rai::Endpoint&);
 
+class UdpSocket
+{
+public:
+    UdpSocket(boost::asio::io_service&);
+
+    boost::asio::ip::udp::socket socket_;
+    // guards the asio operations on the socket
+    std::mutex mutex_;
+    // one slot of MAX_DATAGRAM_SIZE bytes per datagram of a batch
+    std::vector<uint8_t> buffers_;
+    std::vector<rai::Endpoint> remotes_;
+    std::atomic<uint64_t> datagrams_;
+    std::atomic<uint64_t> batches_;
+};
+
+// Sockets bound to the same endpoint. On linux they share the port through
+// SO_REUSEPORT, the kernel spreads the peers over them and each socket
+// drains its queue with recvmmsg, so datagrams are received by as many io
+// threads as there are sockets and many per syscall. A port already bound by
+// another process is rejected before the group is bound. Other platforms use
+// one socket and receive one datagram at a time
+class UdpSockets
+{
+public:
+    typedef std::function<void(const rai::Endpoint&, const uint8_t*, size_t)>
+        Callback;
+
+    UdpSockets(boost::asio::io_service&, const rai::Endpoint&, size_t);
+    void Start(const Callback&);
+    void Stop();
+    // sends through the first socket
+    void Send(const uint8_t*, size_t, const rai::Endpoint&,
+              std::function<void(const boost::system::error_code&, size_t)>);
+    // fire and forget, tries a non-blocking sendto first and only falls back
+    // to the asynchronous path when the socket buffer is full
+    void Send(const rai::DatagramPtr&, const rai::Endpoint&);
+    // sends the batch through the first socket with sendmmsg where it is
+    // available, returns the number of syscalls used
+    size_t Send(const rai::UdpBatch&);
+    size_t Size() const;
+    rai::Endpoint LocalEndpoint() const;
+    uint64_t Datagrams() const;
+    void Status(rai::Ptree&) const;
+
+    // 1500 MTU - 20 bytes IP header - 8 bytes UDP header
+    static size_t constexpr MAX_DATAGRAM_SIZE = 1472;
+    static size_t constexpr BATCH_SIZE = 32;
+    // batches drained before the socket yields its io thread
+    static size_t constexpr MAX_BATCHES = 8;
+    static size_t constexpr RECEIVE_BUFFER_SIZE = 16 * 1024 * 1024;
+
+private:
+    void Receive_(rai::UdpSocket&);
+    void Drain_(rai::UdpSocket&);
+
+    std::vector<std::unique_ptr<rai::UdpSocket>> sockets_;
+    std::atomic<bool> on_;
+    Callback callback_;
+};
+
 class Node;
 class UdpNetwork
 {
 public:
-    UdpNetwork(rai::Node&, const rai::IP&, uint16_t);
-    void Receive();
+    UdpNetwork(rai::Node&, const rai::IP&, uint16_t, size_t = 1);
     void Start();
     void Stop();
-    void Process(const boost::system::error_code&, size_t);
+    void Process(const rai::Endpoint&, const uint8_t*, size_t);
     void Send(const uint8_t*, size_t, const rai::Endpoint&,
               std::function<void(const boost::system::error_code&, size_t)>);
+    void Send(const rai::DatagramPtr&, const rai::Endpoint&);
+    // the latency of a broadcast is counted from the given start time
+    void SendBatch(const rai::UdpBatch&,
+                   const std::chrono::steady_clock::time_point&);
     void Resolve(const std::string&, const std::string&,
                  std::function<void(const boost::system::error_code&,
                                     boost::asio::ip::udp::resolver::iterator)>);
+    void Status(rai::Ptree&) const;
 
     static uint16_t constexpr DEFAULT_PORT =
         rai::RAI_NETWORK == rai::RaiNetworks::LIVE ? 7175 : 54300;
+    static size_t constexpr DEFAULT_RECEIVE_SOCKETS = 4;
 
-    typedef std::function<void(const rai::Endpoint&, rai::Stream&)> Handler;
+    typedef std::function<void(const rai::Endpoint&, const uint8_t*, size_t)>
+        Handler;
     static void RegisterHandler(rai::Node&, const Handler&);
 
 private:
-    rai::Endpoint remote_;
-    std::array<uint8_t, 1024> buffer_;
-    boost::asio::ip::udp::socket socket_;
-    std::mutex socket_mutex_;
+    rai::UdpSockets sockets_;
     boost::asio::ip::udp::resolver resolver_;
     rai::Node& node_;
     std::atomic<bool> on_;
     Handler handler_;
+
+    std::atomic<uint64_t> batches_;
+    std::atomic<uint64_t> batch_datagrams_;
+    std::atomic<uint64_t> batch_syscalls_;
+    // microseconds
+    std::atomic<uint64_t> batch_time_total_;
+    std::atomic<uint64_t> batch_time_max_;
 };
 using Network = UdpNetwork;
 
@@ -308,10 +308,12 @@ rai::Node::Node(rai::ErrorCode& error_code, boost::asio::io_service& service,
       service_(service),
       alarm_(alarm),
       key_(key),
-      store_(error_code, data_path / "data.ldb"),
+      store_(error_code, data_path / "data.ldb", config.store_options_),
       ledger_(error_code, store_, rai::LedgerType::NODE,
-              config.enable_rich_list_, config.enable_delegator_list_),
-      network_(*this, config.address_, config.port_),
+              config.enable_rich_list_, config.enable_delegator_list_,
+              config.account_info_cache_size_, config.dense_block_index_),
+      network_(*this, config.address_, config.port_,
+               config.udp_receive_sockets_),
       peers_(*this),
       stopped_(ATOMIC_FLAG_INIT),
       block_processor_(*this),
@@ -322,7 +324,15 @@ rai::Node::Node(rai::ErrorCode& error_code, boost::asio::io_service& service,
       bootstrap_listener_(*this, service, config.address_, config.port_),
       subscriptions_(*this),
       rewarder_(*this, config_.forward_reward_to_, config_.daily_forward_times_),
-      validator_(*this, service_, alarm_, config.validator_url_)
+      validator_(*this, service_, alarm_, config.validator_url_),
+      prune_cursor_(0),
+      ingress_limiter_(config.ingress_limit_),
+      snapshot_exporter_(store_),
+      message_dispatcher_(config.message_dispatch_,
+                          [this](const rai::Endpoint& remote,
+                                 rai::Stream& stream) {
+                              ProcessMessage(remote, stream);
+                          })
 {
     if (error_code != rai::ErrorCode::SUCCESS)
     {
@@ -336,6 +346,12 @@ rai::Node::Node(rai::ErrorCode& error_code, boost::asio::io_service& service,
     }
     rai::random_pool.GenerateBlock(secure_.bytes.data(), secure_.bytes.size());
 
+    ledger_.RetentionSet(
+        rai::RetentionPolicy(config_.rollback_max_age_,
+                             config_.rollback_max_per_account_),
+        rai::RetentionPolicy(config_.fork_max_age_,
+                             config_.fork_max_per_account_));
+
     if (config_.callback_url_)
     {
         if (config_.callback_url_.protocol_ == "ws"
@@ -403,11 +419,16 @@ void rai::Node::RegisterNetworkHandler()
 {
     std::weak_ptr<rai::Node> node(Shared());
     rai::Network::RegisterHandler(
-        *this, [node](const rai::Endpoint& remote, rai::Stream& stream) {
+        *this,
+        [node](const rai::Endpoint& remote, const uint8_t* data, size_t size) {
             std::shared_ptr<rai::Node> node_l = node.lock();
-            if (node_l)
+            if (!node_l)
+            {
+                return;
+            }
+            if (node_l->ingress_limiter_.Allow(remote, data, size))
             {
-                node_l->ProcessMessage(remote, stream);
+                node_l->message_dispatcher_.Push(remote, data, size);
             }
         });
 }
@@ -435,6 +456,25 @@ void rai::Node::Start()
     Ongoing(std::bind(&rai::ConfirmManager::Age, &confirm_manager_),
             std::chrono::seconds(1));
     Ongoing(std::bind(&rai::Node::AgeGapCaches, this), std::chrono::seconds(1));
+    Ongoing(std::bind(&rai::Node::MigrateBlockIndex, this),
+            std::chrono::seconds(1));
+    Ongoing(std::bind(&rai::Node::CheckpointMemoryTables, this),
+            std::chrono::seconds(300));
+    if (!config_.full_history_ && !config_.dense_block_index_)
+    {
+        std::cout << "Pruning needs dense_block_index, full history is kept"
+                  << std::endl;
+    }
+    else if (!config_.full_history_)
+    {
+        Ongoing(std::bind(&rai::Node::Prune, this), std::chrono::seconds(1));
+    }
+    Ongoing(std::bind(&rai::Node::SweepRetention, this),
+            std::chrono::seconds(1));
+    Ongoing(std::bind(&rai::Node::CheckTransactions, this),
+            std::chrono::seconds(10));
+    Ongoing(std::bind(&rai::Node::RefreshIngressLimits, this),
+            std::chrono::seconds(5));
     Ongoing(std::bind(&rai::Subscriptions::Cutoff, &subscriptions_),
             std::chrono::seconds(60));
     if (rewarder_.SendInterval() > 0)
@@ -473,10 +513,13 @@ void rai::Node::Stop()
     bootstrap_listener_.Stop();
     alarm_.Stop();
     network_.Stop();
+    message_dispatcher_.Stop();
     rewarder_.Stop();
     block_processor_.Stop();
     block_queries_.Stop();
     elections_.Stop();
+    snapshot_exporter_.Stop();
+    CheckpointMemoryTables();
 }
 
 namespace
@@ -629,49 +672,60 @@ public:
             return;
         }
 
-        if (message.CheckSignature())
-        {
-            // TODO: stat
-            std::cout << "Invalid keeplive signature from " << sender_ << std::endl;
-            return;
-        }
+        std::vector<rai::SignatureCheck> checks{
+            {message.account_, message.Hash(), message.signature_}};
+        auto keeplive = std::make_shared<rai::KeepliveMessage>(message);
+        rai::Endpoint sender = sender_;
+        node_.block_processor_.Verify(
+            {}, checks, [&node = node_, keeplive, sender, peer_endpoint,
+                         from_proxy](bool error) {
+                const rai::KeepliveMessage& message = *keeplive;
+                if (error)
+                {
+                    // TODO: stat
+                    std::cout << "Invalid keeplive signature from " << sender
+                              << std::endl;
+                    return;
+                }
 
-        if (from_proxy)
-        {
-            node_.KeepliveAck(peer_endpoint, message.Hash(), node_.account_,
-                              sender_);
-        }
-        else
-        {
-            node_.KeepliveAck(peer_endpoint, message.Hash(), node_.account_,
-                              boost::none);
-        }
+                if (from_proxy)
+                {
+                    node.KeepliveAck(peer_endpoint, message.Hash(),
+                                     node.account_, sender);
+                }
+                else
+                {
+                    node.KeepliveAck(peer_endpoint, message.Hash(),
+                                     node.account_, boost::none);
+                }
 
-        node_.peers_.Contact(message.account_, message.timestamp_,
-                             message.Version(), message.VersionMin());
-        uint8_t count = 0;
-        for (const auto& peer : message.peers_)
-        {
-            if (rai::IsReservedIp(peer.second.address().to_v4()))
-            {
-                ++count;
-                continue;
-            }
+                node.peers_.Contact(message.account_, message.timestamp_,
+                                    message.Version(), message.VersionMin());
+                uint8_t count = 0;
+                for (const auto& peer : message.peers_)
+                {
+                    if (rai::IsReservedIp(peer.second.address().to_v4()))
+                    {
+                        ++count;
+                        continue;
+                    }
 
-            if (!from_proxy && (count < message.ReachablePeers())
-                && (peer_endpoint != peer.second))
-            {
-                rai::Cookie cookie(peer.second, peer_endpoint, peer.first);
-                node_.peers_.SynCookie(cookie);
-            }
-            else
-            {
-                rai::Cookie cookie(peer.second, peer.first);
-                node_.peers_.SynCookie(cookie);
-            }
+                    if (!from_proxy && (count < message.ReachablePeers())
+                        && (peer_endpoint != peer.second))
+                    {
+                        rai::Cookie cookie(peer.second, peer_endpoint,
+                                           peer.first);
+                        node.peers_.SynCookie(cookie);
+                    }
+                    else
+                    {
+                        rai::Cookie cookie(peer.second, peer.first);
+                        node.peers_.SynCookie(cookie);
+                    }
 
-            ++count;
-        }
+                    ++count;
+                }
+            });
     }
 
     void Publish(const rai::PublishMessage& message) override
@@ -776,9 +830,24 @@ public:
             return;
         }
 
-        node_.elections_.ProcessConfirm(message.representative_,
-                                        message.timestamp_, message.signature_,
-                                        message.block_, weight);
+        rai::Account representative = message.representative_;
+        uint64_t timestamp = message.timestamp_;
+        rai::Signature signature = message.signature_;
+        auto block = message.block_;
+        std::vector<rai::SignatureCheck> checks{
+            {representative, message.Hash(), signature}};
+        node_.block_processor_.Verify(
+            {block}, checks, [&node = node_, representative, timestamp,
+                              signature, block, weight](bool error) {
+                if (error)
+                {
+                    rai::Stats::Add(
+                        rai::ErrorCode::MESSAGE_CONFIRM_SIGNATURE);
+                    return;
+                }
+                node.elections_.ProcessConfirm(representative, timestamp,
+                                               signature, block, weight);
+            });
     }
 
     void Query(const rai::QueryMessage& message) override
@@ -793,10 +862,30 @@ public:
             {
                 proxy = sender_;
             }
-            node_.block_queries_.ProcessQueryAck(
-                message.sequence_, message.QueryBy(), message.account_,
-                message.height_, message.hash_, message.QueryStatus(),
-                message.block_, peer_endpoint, proxy);
+            std::vector<std::shared_ptr<rai::Block>> blocks;
+            if (message.block_ != nullptr)
+            {
+                blocks.push_back(message.block_);
+            }
+            uint64_t sequence = message.sequence_;
+            rai::QueryBy by = message.QueryBy();
+            rai::Account account = message.account_;
+            uint64_t height = message.height_;
+            rai::BlockHash hash = message.hash_;
+            rai::QueryStatus status = message.QueryStatus();
+            auto block = message.block_;
+            node_.block_processor_.Verify(
+                blocks, [&node = node_, sequence, by, account, height, hash,
+                         status, block, peer_endpoint, proxy](bool error) {
+                    if (error)
+                    {
+                        rai::Stats::Add(rai::ErrorCode::SIGNATURE);
+                        return;
+                    }
+                    node.block_queries_.ProcessQueryAck(
+                        sequence, by, account, height, hash, status, block,
+                        peer_endpoint, proxy);
+                });
         }
         else
         {
@@ -971,11 +1060,32 @@ public:
             return;
         }
 
-        node_.elections_.ProcessConflict(
-            message.representative_, message.timestamp_first_,
-            message.timestamp_second_, message.signature_first_,
-            message.signature_second_, message.block_first_,
-            message.block_second_, weight);
+        rai::Account representative = message.representative_;
+        uint64_t timestamp_first = message.timestamp_first_;
+        uint64_t timestamp_second = message.timestamp_second_;
+        rai::Signature signature_first = message.signature_first_;
+        rai::Signature signature_second = message.signature_second_;
+        auto first = message.block_first_;
+        auto second = message.block_second_;
+        std::vector<rai::SignatureCheck> checks{
+            {representative, message.HashFirst(), signature_first},
+            {representative, message.HashSecond(), signature_second}};
+        node_.block_processor_.Verify(
+            {first, second}, checks,
+            [&node = node_, representative, timestamp_first, timestamp_second,
+             signature_first, signature_second, first, second,
+             weight](bool error) {
+                if (error)
+                {
+                    rai::Stats::Add(
+                        rai::ErrorCode::MESSAGE_CONFLICT_SIGNATURE);
+                    return;
+                }
+                node.elections_.ProcessConflict(
+                    representative, timestamp_first, timestamp_second,
+                    signature_first, signature_second, first, second,
+                    weight);
+            });
     }
 
     void Weight(const rai::WeightMessage& message) override
@@ -1028,9 +1138,11 @@ void rai::Node::Send(const rai::Message& message, const rai::Endpoint& remote,
                      std::function<void(rai::Node&, const rai::Endpoint&,
                                         const std::string&)> error_callback)
 {
-    std::shared_ptr<std::vector<uint8_t>> bytes(new std::vector<uint8_t>);
-    message.ToBytes(*bytes);
-    dumpers_.message_.Dump(true, remote, *bytes);
+    rai::DatagramPtr datagram = Datagram_(message, remote);
+    if (!datagram)
+    {
+        return;
+    }
 
     std::weak_ptr<rai::Node> node(Shared());
     rai::Endpoint peer_endpoint(remote);
@@ -1038,8 +1150,8 @@ void rai::Node::Send(const rai::Message& message, const rai::Endpoint& remote,
     {
         peer_endpoint = message.PeerEndpoint();
     }
-    network_.Send(bytes->data(), bytes->size(), remote,
-                  [node, bytes, peer_endpoint, error_callback](
+    network_.Send(datagram->Data(), datagram->Size(), remote,
+                  [node, datagram, peer_endpoint, error_callback](
                       const boost::system::error_code& ec, size_t size) {
                       if (!ec)
                       {
@@ -1054,6 +1166,16 @@ void rai::Node::Send(const rai::Message& message, const rai::Endpoint& remote,
                   });
 }
 
+void rai::Node::Send(const rai::Message& message, const rai::Endpoint& remote)
+{
+    rai::DatagramPtr datagram = Datagram_(message, remote);
+    if (!datagram)
+    {
+        return;
+    }
+    network_.Send(datagram, remote);
+}
+
 void rai::Node::SendToPeer(const rai::Peer& peer, rai::Message& message)
 {
     SendByRoute(peer.Route(), message);
@@ -1082,11 +1204,7 @@ void rai::Node::SendByRoute(const rai::Route& route, rai::Message& message)
         message.DisableProxy();
     }
 
-    Send(message, receiver,
-         [](rai::Node& node, const rai::Endpoint& peer_endpoint,
-            const std::string& error) {
-             // TODO: stat
-         });
+    Send(message, receiver);
 }
 
 void rai::Node::SendCallback(const rai::Ptree& notify)
@@ -1128,10 +1246,51 @@ void rai::Node::Broadcast(rai::Message& message)
         return;
     }
 
+    // the message is serialized once into a pooled datagram, only the header
+    // differs between the routes: peers behind a proxy get the proxy header in
+    // front of the body
+    auto start = std::chrono::steady_clock::now();
+    rai::UdpBatch batch;
+    bool error =
+        message.ToBatch(rai::DatagramPool::Global().Acquire(), batch);
+    if (error)
+    {
+        rai::Stats::Add(rai::ErrorCode::MESSAGE_TOO_LARGE, "type=",
+                        rai::MessageDumper::ToString(message.header_.type_));
+        return;
+    }
+
+    static_assert(rai::Node::PEERS_PER_BROADCAST
+                      <= rai::UdpBatch::MAX_DATAGRAMS,
+                  "Broadcast batch too small");
     for (const auto& peer : peers)
     {
-        SendToPeer(peer, message);
+        rai::Route route = peer.Route();
+        if (route.use_proxy_)
+        {
+            message.AddToBatch(batch, route.proxy_endpoint_,
+                               route.peer_endpoint_);
+        }
+        else
+        {
+            message.AddToBatch(batch, route.peer_endpoint_);
+        }
     }
+
+    if (dumpers_.message_.On())
+    {
+        for (size_t i = 0; i < batch.Size(); ++i)
+        {
+            rai::DatagramPtr datagram = batch.Assemble(i);
+            if (datagram)
+            {
+                dumpers_.message_.Dump(true, batch.remotes_[i],
+                                       datagram->Data(), datagram->Size());
+            }
+        }
+    }
+
+    network_.SendBatch(batch, start);
 }
 
 void rai::Node::BroadcastAsync(const std::shared_ptr<rai::Message>& message)
@@ -1389,11 +1548,7 @@ void rai::Node::KeepliveAck(const rai::Endpoint& peer_endpoint,
         receiver = *proxy;
     }
 
-    Send(keeplive_ack, receiver,
-         [](rai::Node& node, const rai::Endpoint& peer_endpoint,
-            const std::string& error) {
-             // TODO: stat
-         });
+    Send(keeplive_ack, receiver);
 }
 
 void rai::Node::BlockQuery(uint64_t sequence, rai::QueryBy by,
@@ -1410,11 +1565,7 @@ void rai::Node::BlockQuery(uint64_t sequence, rai::QueryBy by,
         receiver = *proxy;
     }
 
-    Send(query, receiver,
-         [](rai::Node& node, const rai::Endpoint& peer_endpoint,
-            const std::string& error) {
-             // TODO: stat
-         });
+    Send(query, receiver);
 }
 
 void rai::Node::Publish(const std::shared_ptr<rai::Block>& block)
@@ -1634,24 +1785,28 @@ void rai::Node::ReceiveBlock(const std::shared_ptr<rai::Block>& block,
         }
     }
 
-    // CPU consuming operation
-    if (block->CheckSignature())
-    {
-        rai::Stats::Add(rai::ErrorCode::SIGNATURE);
-        return;
-    }
-    
-    if (confirm_to)
-    {
-        confirm_requests_.Insert(hash, *confirm_to);
-    }
-    else
-    {
-        confirm_requests_.Insert(hash);
-    }
+    // the signature is checked on the verifier threads, a block is only
+    // remembered as recent once it is known to be valid
+    block_processor_.Verify(
+        {block}, [this, block, hash, confirm_to](bool error) {
+            if (error)
+            {
+                rai::Stats::Add(rai::ErrorCode::SIGNATURE);
+                return;
+            }
 
-    recent_blocks_.Insert(block->Hash());
-    block_processor_.Add(block);
+            if (confirm_to)
+            {
+                confirm_requests_.Insert(hash, *confirm_to);
+            }
+            else
+            {
+                confirm_requests_.Insert(hash);
+            }
+
+            recent_blocks_.Insert(hash);
+            block_processor_.Add(block);
+        });
 }
 
 void rai::Node::ReceiveBlockFork(const std::shared_ptr<rai::Block>& first,
@@ -1662,9 +1817,18 @@ void rai::Node::ReceiveBlockFork(const std::shared_ptr<rai::Block>& first,
         return;
     }
 
-    recent_forks_.Insert(first->Hash(), second->Hash());
-    rai::BlockFork fork{first, second, false};
-    block_processor_.AddFork(fork);
+    block_processor_.Verify(
+        {first, second}, [this, first, second](bool error) {
+            if (error)
+            {
+                rai::Stats::Add(rai::ErrorCode::SIGNATURE);
+                return;
+            }
+
+            recent_forks_.Insert(first->Hash(), second->Hash());
+            rai::BlockFork fork{first, second, false};
+            block_processor_.AddFork(fork);
+        });
 }
 
 void rai::Node::StartElection(const std::shared_ptr<rai::Block>& block)
@@ -1731,6 +1895,100 @@ void rai::Node::QueueGapCaches(const rai::BlockHash& hash)
     }
 }
 
+void rai::Node::MigrateBlockIndex()
+{
+    bool finished = false;
+    rai::ErrorCode error_code = ledger_.BlockIndexMigrate(
+        rai::Ledger::BLOCK_INDEX_MIGRATION_BATCH, finished);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code, "Node::MigrateBlockIndex");
+    }
+}
+
+void rai::Node::CheckpointMemoryTables()
+{
+    rai::ErrorCode error_code = ledger_.MemoryTablesCheckpoint();
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code, "Node::CheckpointMemoryTables");
+    }
+}
+
+void rai::Node::Prune()
+{
+    // yield the write transaction to block processing
+    if (block_processor_.Busy())
+    {
+        return;
+    }
+
+    bool finished = false;
+    rai::ErrorCode error_code =
+        ledger_.Prune(config_.prune_depth_, config_.prune_age_,
+                      rai::Ledger::PRUNE_BATCH, prune_cursor_, finished);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code, "Node::Prune");
+    }
+}
+
+void rai::Node::SweepRetention()
+{
+    // yield the write transaction to block processing
+    if (block_processor_.Busy())
+    {
+        return;
+    }
+
+    bool finished = false;
+    rai::ErrorCode error_code =
+        ledger_.RetentionSweep(rai::Ledger::RETENTION_SWEEP_BATCH, finished);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code, "Node::SweepRetention");
+    }
+}
+
+void rai::Node::CheckTransactions()
+{
+    std::vector<rai::TransactionInfo> long_transactions;
+    rai::ErrorCode error_code = ledger_.TransactionsCheck(long_transactions);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code, "Node::CheckTransactions");
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& i : long_transactions)
+    {
+        rai::Ptree ptree;
+        i.SerializeJson(ptree, now);
+        rai::Log::Error(boost::str(
+            boost::format("Long %1% transaction opened by %2% on thread %3%, "
+                          "open for %4% ms")
+            % (i.write_ ? "write" : "read") % i.site_
+            % ptree.get<std::string>("thread")
+            % ptree.get<std::string>("age_ms")));
+    }
+}
+
+void rai::Node::RefreshIngressLimits()
+{
+    std::vector<rai::IngressPeerInfo> infos;
+    for (const auto& i : peers_.List())
+    {
+        rai::IP proxy = i.KeyProxy();
+        if (proxy == rai::Peer::InvalidIp())
+        {
+            proxy = rai::IP();
+        }
+        infos.emplace_back(i.account_, i.rep_weight_, i.KeyIp(), proxy);
+    }
+    ingress_limiter_.Refresh(infos);
+    ingress_limiter_.Purge();
+}
+
 void rai::Node::AgeGapCaches()
 {
     uint64_t cutoff = 5;
@@ -1956,6 +2214,28 @@ boost::optional<rai::SignerAddress> rai::Node::BindingQuery(
     return result;
 }
 
+rai::DatagramPtr rai::Node::Datagram_(const rai::Message& message,
+                                     const rai::Endpoint& remote)
+{
+    rai::DatagramPtr datagram = rai::DatagramPool::Global().Acquire();
+    size_t size = 0;
+    bool error = message.ToBytes(datagram->Data(), rai::Datagram::CAPACITY,
+                                 size);
+    if (error)
+    {
+        rai::Stats::Add(rai::ErrorCode::MESSAGE_TOO_LARGE, "type=",
+                        rai::MessageDumper::ToString(message.header_.type_));
+        return nullptr;
+    }
+    datagram->Resize(size);
+
+    if (dumpers_.message_.On())
+    {
+        dumpers_.message_.Dump(true, remote, datagram->Data(), size);
+    }
+    return datagram;
+}
+
 void rai::Node::ConfirmRequestAck_(const rai::BlockProcessResult& result,
                                    const std::shared_ptr<rai::Block>& block)
 {
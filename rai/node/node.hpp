@@ -23,10 +23,13 @@
 #include <rai/node/bootstrap.hpp>
 #include <rai/node/subscribe.hpp>
 #include <rai/node/dumper.hpp>
+#include <rai/node/dispatcher.hpp>
+#include <rai/node/limiter.hpp>
 #include <rai/node/rewarder.hpp>
 #include <rai/node/rpc.hpp>
 #include <rai/node/config.hpp>
 #include <rai/node/validator.hpp>
+#include <rai/node/snapshot.hpp>
 
 namespace rai
 {
@@ -198,6 +201,8 @@ public:
     void Send(const rai::Message&, const rai::Endpoint&,
               std::function<void(rai::Node&, const rai::Endpoint&,
                                  const std::string&)>);
+    // fire and forget, send errors are only counted in the stats
+    void Send(const rai::Message&, const rai::Endpoint&);
     void SendToPeer(const rai::Peer&, rai::Message&);
     void SendToRep(const rai::Account&, rai::Message&);
     void SendByRoute(const rai::Route&, rai::Message&);
@@ -256,6 +261,12 @@ public:
     void ForceAppendBlock(std::shared_ptr<rai::Block>&);
     void QueueGapCaches(const rai::BlockHash&);
     void AgeGapCaches();
+    void MigrateBlockIndex();
+    void CheckpointMemoryTables();
+    void Prune();
+    void SweepRetention();
+    void CheckTransactions();
+    void RefreshIngressLimits();
     rai::Amount RepWeight(const rai::Account&);
     rai::Amount RepWeightTotal();
     void RepWeights(rai::RepWeights&);
@@ -311,8 +322,14 @@ public:
     rai::ActiveAccounts active_accounts_;
     std::shared_ptr<rai::WebsocketClient> websocket_;
     rai::Validator validator_;
+    rai::Account prune_cursor_;
+    rai::IngressLimiter ingress_limiter_;
+    rai::SnapshotExporter snapshot_exporter_;
+    // declared last, its workers call into the members above
+    rai::MessageDispatcher message_dispatcher_;
 
 private:
+    rai::DatagramPtr Datagram_(const rai::Message&, const rai::Endpoint&);
     void ConfirmRequestAck_(const rai::BlockProcessResult&,
                             const std::shared_ptr<rai::Block>&);
     void ElectNextFork_(const rai::BlockProcessResult&,
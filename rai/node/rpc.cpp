@@ -4,6 +4,7 @@
 #include <boost/property_tree/ptree.hpp>
 #include <rai/common/log.hpp>
 #include <rai/common/stat.hpp>
+#include <rai/secure/snapshot.hpp>
 #include <rai/node/node.hpp>
 
 
@@ -259,6 +260,10 @@ void rai::NodeRpcHandler::ProcessImpl()
     {
         FullPeerCount();
     }
+    else if (action == "ledger_summary")
+    {
+        LedgerSummary();
+    }
     else if (action == "message_dump")
     {
         MessageDump();
@@ -325,6 +330,20 @@ void rai::NodeRpcHandler::ProcessImpl()
     {
         RichList();
     }
+    else if (action == "snapshot_export")
+    {
+        if (!CheckLocal_())
+        {
+            SnapshotExport();
+        }
+    }
+    else if (action == "snapshot_export_status")
+    {
+        if (!CheckLocal_())
+        {
+            SnapshotExportStatus();
+        }
+    }
     else if (action == "stats")
     {
         Stats();
@@ -347,6 +366,13 @@ void rai::NodeRpcHandler::ProcessImpl()
             Stop();
         }
     }
+    else if (action == "store_stats")
+    {
+        if (!CheckLocal_())
+        {
+            StoreStats();
+        }
+    }
     else if (action == "subscriber_count")
     {
         SubscriberCount();
@@ -399,18 +425,34 @@ void rai::NodeRpcHandler::AccountForks()
     }
 
     rai::Ptree forks;
-    rai::Iterator i = node_.ledger_.ForkLowerBound(transaction, account);
-    rai::Iterator n = node_.ledger_.ForkUpperBound(transaction, account);
-    for (; i != n; ++i)
+    uint64_t height = 0;
+    for (uint64_t i = 0; height != rai::Block::INVALID_HEIGHT; ++i)
     {
+        // the scan resumes from the height on a fresh snapshot
+        if (i > 0 && i % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+        }
+
+        rai::Account account_l(account);
         std::shared_ptr<rai::Block> first(nullptr);
         std::shared_ptr<rai::Block> second(nullptr);
-        error = node_.ledger_.ForkGet(i, first, second);
-        if (error || first->Account() != account)
+        error = node_.ledger_.NextFork(transaction, account_l, height, first,
+                                       second);
+        if (error || account_l != account)
+        {
+            break;
+        }
+        if (first->Account() != account)
         {
             transaction.Abort();
             return;
         }
+        if (height != rai::Block::INVALID_HEIGHT)
+        {
+            height += 1;
+        }
 
         rai::Ptree fork;
         rai::Ptree block_first;
@@ -426,6 +468,13 @@ void rai::NodeRpcHandler::AccountForks()
 
 void rai::NodeRpcHandler::AccountHeads()
 {
+    auto accounts_o = request_.get_child_optional("accounts");
+    if (accounts_o)
+    {
+        AccountHeadsGetMany_(*accounts_o);
+        return;
+    }
+
     rai::Account next;
     bool error = GetNext_(next);
     IF_ERROR_RETURN_VOID(error);
@@ -448,8 +497,15 @@ void rai::NodeRpcHandler::AccountHeads()
     bool more = true;
     rai::AccountInfo info;
     rai::Ptree heads;
-    while (count--)
+    for (uint64_t i = 0; i < count; ++i)
     {
+        // the scan resumes from next on a fresh snapshot
+        if (i > 0 && i % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+        }
+
         error = node_.ledger_.NextAccountInfo(transaction, next, info);
         if (error)
         {
@@ -634,8 +690,14 @@ void rai::NodeRpcHandler::ActiveAccountHeads()
     bool more = true;
     rai::AccountInfo info;
     rai::Ptree heads;
-    while (count--)
+    for (uint64_t i = 0; i < count; ++i)
     {
+        if (i > 0 && i % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+        }
+
         error = node_.active_accounts_.Next(next);
         if (error)
         {
@@ -718,11 +780,32 @@ void rai::NodeRpcHandler::BindingEntries()
         node_.ledger_.BindingLowerBound(transaction, account);
     rai::Iterator n =
         node_.ledger_.BindingUpperBound(transaction, account);
+    rai::BindingKey key;
+    rai::SignerAddress signer;
     for (; i != n; ++i)
     {
+        // the scan resumes after the last key on a fresh snapshot
+        if (count > 0 && count % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            rai::BindingKey last(key);
+            i = rai::Iterator();
+            n = rai::Iterator();
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+            i = node_.ledger_.BindingLowerBound(transaction, last);
+            n = node_.ledger_.BindingUpperBound(transaction, account);
+            if (i != n && !node_.ledger_.BindingGet(i, key, signer)
+                && key == last)
+            {
+                ++i;
+            }
+            if (i == n)
+            {
+                break;
+            }
+        }
+
         rai::Ptree entry_ptree;
-        rai::BindingKey key;
-        rai::SignerAddress signer;
         bool error = node_.ledger_.BindingGet(i, key, signer);
         if (error)
         {
@@ -1249,36 +1332,16 @@ void rai::NodeRpcHandler::BlocksQuery()
         return;
     }
 
-    std::shared_ptr<rai::Block> block(nullptr);
-    rai::BlockHash successor;
+    std::vector<std::shared_ptr<rai::Block>> blocks;
     error =
-        node_.ledger_.BlockGet(transaction, account, height, block, successor);
-    if (error)
+        node_.ledger_.BlocksRange(transaction, account, height, count, blocks);
+    if (error || blocks.empty())
     {
         error_code_ = rai::ErrorCode::LEDGER_BLOCK_GET;
         return;
     }
-
-    bool more = true;
-    std::vector<std::shared_ptr<rai::Block>> blocks;
-    blocks.push_back(block);
-    while (blocks.size() < count)
-    {
-        if (successor.IsZero())
-        {
-            more = false;
-            break;
-        }
-
-        error =
-            node_.ledger_.BlockGet(transaction, successor, block, successor);
-        if (error)
-        {
-            error_code_ = rai::ErrorCode::LEDGER_BLOCK_GET;
-            return;
-        }
-        blocks.push_back(block);
-    }
+    // more is false only when the chain ends before count blocks
+    bool more = blocks.size() >= count;
 
     rai::Ptree blocks_ptree;
     for (auto &i : blocks)
@@ -1575,6 +1638,13 @@ void rai::NodeRpcHandler::Forks()
     uint64_t i = 0;
     for (; i < count; ++i)
     {
+        // the scan resumes from (account, height) on a fresh snapshot
+        if (i > 0 && i % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+        }
+
         std::shared_ptr<rai::Block> first(nullptr);
         std::shared_ptr<rai::Block> second(nullptr);
         bool error =
@@ -1612,6 +1682,31 @@ void rai::NodeRpcHandler::FullPeerCount()
     response_.put("count", node_.peers_.FullPeerSize());
 }
 
+void rai::NodeRpcHandler::LedgerSummary()
+{
+    rai::Transaction transaction(error_code_, node_.ledger_, false);
+    IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+
+    rai::LedgerCounters counters;
+    bool error = node_.ledger_.LedgerCountersGet(transaction, counters);
+    if (error)
+    {
+        error_code_ = rai::ErrorCode::LEDGER_COUNTERS;
+        return;
+    }
+
+    size_t accounts = 0;
+    error = node_.ledger_.AccountCount(transaction, accounts);
+    if (error)
+    {
+        error_code_ = rai::ErrorCode::LEDGER_ACCOUNT_COUNT;
+        return;
+    }
+
+    response_.put("accounts", std::to_string(accounts));
+    counters.SerializeJson(response_);
+}
+
 void rai::NodeRpcHandler::MessageDump()
 {
     response_.put_child("messages", node_.dumpers_.message_.Get());
@@ -1873,10 +1968,34 @@ void rai::NodeRpcHandler::Rewardables()
         node_.ledger_.RewardableInfoLowerBound(transaction, account);
     rai::Iterator n =
         node_.ledger_.RewardableInfoUpperBound(transaction, account);
-    for (; i != n; ++i)
+    uint64_t scanned = 0;
+    rai::BlockHash hash;
+    rai::RewardableInfo info;
+    for (; i != n; ++i, ++scanned)
     {
-        rai::BlockHash hash;
-        rai::RewardableInfo info;
+        // the scan resumes after the last hash on a fresh snapshot
+        if (scanned > 0 && scanned % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            rai::BlockHash last(hash);
+            i = rai::Iterator();
+            n = rai::Iterator();
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+            i = node_.ledger_.RewardableInfoLowerBound(transaction, account,
+                                                       last);
+            n = node_.ledger_.RewardableInfoUpperBound(transaction, account);
+            if (i != n
+                && !node_.ledger_.RewardableInfoGet(i, account, hash, info)
+                && hash == last)
+            {
+                ++i;
+            }
+            if (i == n)
+            {
+                break;
+            }
+        }
+
         bool error = node_.ledger_.RewardableInfoGet(i, account, hash, info);
         if (error)
         {
@@ -1964,6 +2083,43 @@ void rai::NodeRpcHandler::Stats()
             stats_ptree.push_back(std::make_pair("", stat_ptree));
         }
     }
+    else if (*type_o == "cache")
+    {
+        rai::Ptree block_cache;
+        node_.ledger_.BlockCacheStatus(block_cache);
+        stats_ptree.put_child("block_cache", block_cache);
+        rai::Ptree account_info_cache;
+        node_.ledger_.AccountInfoCacheStatus(account_info_cache);
+        stats_ptree.put_child("account_info_cache", account_info_cache);
+        rai::Ptree read_transaction_pool;
+        node_.ledger_.ReadTransactionPoolStatus(read_transaction_pool);
+        stats_ptree.put_child("read_transaction_pool", read_transaction_pool);
+    }
+    else if (*type_o == "prune")
+    {
+        stats_ptree.put("full_history", node_.config_.full_history_);
+        node_.ledger_.PruneStatus(stats_ptree);
+    }
+    else if (*type_o == "store")
+    {
+        node_.ledger_.SyncStatus(stats_ptree);
+    }
+    else if (*type_o == "network")
+    {
+        node_.network_.Status(stats_ptree);
+    }
+    else if (*type_o == "dispatch")
+    {
+        node_.message_dispatcher_.Status(stats_ptree);
+    }
+    else if (*type_o == "ingress")
+    {
+        node_.ingress_limiter_.Status(stats_ptree);
+    }
+    else if (*type_o == "transactions")
+    {
+        node_.ledger_.TransactionsStatus(stats_ptree, false);
+    }
     else
     {
         error_code_ = rai::ErrorCode::RPC_INVALID_FIELD_TYPE;
@@ -2013,6 +2169,15 @@ void rai::NodeRpcHandler::StatsVerbose()
             stats_ptree.push_back(std::make_pair("", stat_ptree));
         }
     }
+    else if (*type_o == "retention")
+    {
+        error_code_ = node_.ledger_.RetentionStatus(stats_ptree);
+        IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+    }
+    else if (*type_o == "transactions")
+    {
+        node_.ledger_.TransactionsStatus(stats_ptree, true);
+    }
     else
     {
         error_code_ = rai::ErrorCode::RPC_INVALID_FIELD_TYPE;
@@ -2043,12 +2208,42 @@ void rai::NodeRpcHandler::StatsClear()
     }
 }
 
+void rai::NodeRpcHandler::SnapshotExport()
+{
+    boost::filesystem::path data_path = node_.store_.env_.Path().parent_path();
+    if (data_path.empty())
+    {
+        error_code_ = rai::ErrorCode::DATA_PATH;
+        return;
+    }
+
+    // the export takes minutes on a large ledger, it runs in the background
+    // and is polled with snapshot_export_status
+    boost::filesystem::path dir =
+        data_path / "snapshots" / std::to_string(rai::CurrentTimestamp());
+    error_code_ = node_.snapshot_exporter_.Start(dir);
+    IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+
+    response_.put("path", dir.string());
+    response_.put("success", "");
+}
+
+void rai::NodeRpcHandler::SnapshotExportStatus()
+{
+    node_.snapshot_exporter_.Status(response_);
+}
+
 void rai::NodeRpcHandler::Stop()
 {
     node_.Stop();
     response_.put("success", "");
 }
 
+void rai::NodeRpcHandler::StoreStats()
+{
+    StoreStats_(node_.store_);
+}
+
 void rai::NodeRpcHandler::Subscribers()
 {
     rai::Ptree ptree;
@@ -2083,6 +2278,67 @@ void rai::NodeRpcHandler::SyncerStatus()
     response_.put("queries", node_.syncer_.Queries());
 }
 
+// Heads of the listed accounts in the request order, accounts that do not
+// exist are left out
+void rai::NodeRpcHandler::AccountHeadsGetMany_(const rai::Ptree& ptree)
+{
+    std::vector<rai::Account> accounts;
+    try
+    {
+        for (const auto& i : ptree)
+        {
+            rai::Account account;
+            bool error = account.DecodeAccount(i.second.get<std::string>(""));
+            if (error)
+            {
+                error_code_ = rai::ErrorCode::RPC_INVALID_FIELD_ACCOUNT;
+                return;
+            }
+            accounts.push_back(account);
+        }
+    }
+    catch (...)
+    {
+        error_code_ = rai::ErrorCode::RPC_INVALID_FIELD_ACCOUNT;
+        return;
+    }
+    if (accounts.empty() || accounts.size() > 1000)
+    {
+        error_code_ = rai::ErrorCode::RPC_INVALID_FIELD_ACCOUNT;
+        return;
+    }
+
+    rai::Transaction transaction(error_code_, node_.ledger_, false);
+    IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+
+    std::vector<rai::AccountInfo> infos;
+    bool error =
+        node_.ledger_.AccountInfoGetMany(transaction, accounts, infos);
+    if (error)
+    {
+        error_code_ = rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET;
+        return;
+    }
+
+    rai::Ptree heads;
+    for (size_t i = 0; i < accounts.size(); ++i)
+    {
+        if (!infos[i].Valid())
+        {
+            continue;
+        }
+        rai::Ptree entry;
+        entry.put("account", accounts[i].StringAccount());
+        entry.put("type", rai::BlockTypeToString(infos[i].type_));
+        entry.put("height", std::to_string(infos[i].head_height_));
+        entry.put("head", infos[i].head_.StringHex());
+        heads.push_back(std::make_pair("", entry));
+    }
+
+    response_.put("status", "success");
+    response_.put_child("heads", heads);
+}
+
 void rai::NodeRpcHandler::AppendBlockAmount_(rai::Transaction& transaction,
                                              const rai::Block& block,
                                              const std::string& prefix)
@@ -77,6 +77,7 @@ public:
     void EventUnsubscribe();
     void Forks();
     void FullPeerCount();
+    void LedgerSummary();
     void MessageDump();
     void MessageDumpOff();
     void MessageDumpOn();
@@ -92,10 +93,13 @@ public:
     void Rewardables();
     void RewarderStatus();
     void RichList();
+    void SnapshotExport();
+    void SnapshotExportStatus();
     void Stats();
     void StatsVerbose();
     void StatsClear();
     void Stop();
+    void StoreStats();
     void Subscribers();
     void SubscriberCount();
     void Supply();
@@ -104,6 +108,7 @@ public:
     rai::Node& node_;
 
 private:
+    void AccountHeadsGetMany_(const rai::Ptree&);
     void AppendBlockAmount_(rai::Transaction&, const rai::Block&,
                             const std::string& = "");
 };
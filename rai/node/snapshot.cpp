@@ -0,0 +1,104 @@
+#include <rai/node/snapshot.hpp>
+
+#include <rai/common/stat.hpp>
+
+rai::SnapshotExporter::SnapshotExporter(rai::Store& store)
+    : store_(store),
+      running_(false),
+      stopped_(false),
+      error_code_(rai::ErrorCode::SUCCESS),
+      started_(0),
+      finished_(0)
+{
+}
+
+rai::SnapshotExporter::~SnapshotExporter()
+{
+    Stop();
+}
+
+rai::ErrorCode rai::SnapshotExporter::Start(
+    const boost::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_)
+    {
+        return rai::ErrorCode::SNAPSHOT_EXPORT;
+    }
+    if (running_)
+    {
+        return rai::ErrorCode::SNAPSHOT_RUNNING;
+    }
+
+    // the previous export has finished
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+
+    running_     = true;
+    path_        = path;
+    error_code_  = rai::ErrorCode::SUCCESS;
+    manifest_    = rai::SnapshotManifest();
+    started_     = rai::CurrentTimestamp();
+    finished_    = 0;
+    thread_      = std::thread([this, path]() { Run_(path); });
+    return rai::ErrorCode::SUCCESS;
+}
+
+void rai::SnapshotExporter::Status(rai::Ptree& ptree) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ptree.put("running", rai::BoolToString(running_));
+    if (started_ == 0)
+    {
+        return;
+    }
+
+    ptree.put("path", path_.string());
+    ptree.put("started", std::to_string(started_));
+    if (running_)
+    {
+        return;
+    }
+
+    ptree.put("finished", std::to_string(finished_));
+    if (error_code_ != rai::ErrorCode::SUCCESS)
+    {
+        ptree.put("error", rai::ErrorString(error_code_));
+        return;
+    }
+    rai::Ptree manifest;
+    manifest_.SerializeJson(manifest);
+    ptree.put_child("manifest", manifest);
+}
+
+void rai::SnapshotExporter::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+
+    // an export in progress can not be interrupted, wait for it
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void rai::SnapshotExporter::Run_(const boost::filesystem::path& path)
+{
+    rai::SnapshotManifest manifest;
+    rai::ErrorCode error_code = rai::SnapshotExport(store_, path, manifest);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        rai::Stats::Add(error_code, "SnapshotExporter::Run_");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_    = false;
+    error_code_ = error_code;
+    manifest_   = manifest;
+    finished_   = rai::CurrentTimestamp();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <rai/common/errors.hpp>
+#include <rai/common/util.hpp>
+#include <rai/secure/snapshot.hpp>
+#include <rai/secure/store.hpp>
+
+namespace rai
+{
+// Runs rai::SnapshotExport on its own thread so that copying and hashing
+// the whole ledger never blocks the io threads, one export at a time
+class SnapshotExporter
+{
+public:
+    SnapshotExporter(rai::Store&);
+    ~SnapshotExporter();
+    rai::ErrorCode Start(const boost::filesystem::path&);
+    void Status(rai::Ptree&) const;
+    void Stop();
+
+private:
+    void Run_(const boost::filesystem::path&);
+
+    rai::Store& store_;
+    mutable std::mutex mutex_;
+    bool running_;
+    bool stopped_;
+    boost::filesystem::path path_;
+    rai::ErrorCode error_code_;
+    rai::SnapshotManifest manifest_;
+    uint64_t started_;
+    uint64_t finished_;
+    std::thread thread_;
+};
+}  // namespace rai
@@ -0,0 +1,205 @@
+#include <rai/node/verifier.hpp>
+
+#include <algorithm>
+
+size_t constexpr rai::SignatureVerifier::MAX_BATCH;
+size_t constexpr rai::SignatureVerifier::MAX_TASKS;
+
+namespace
+{
+bool SignaturesChecked(const std::vector<std::shared_ptr<rai::Block>>& blocks)
+{
+    for (const auto& block : blocks)
+    {
+        if (!block->SignatureChecked())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SignaturesError(const std::vector<std::shared_ptr<rai::Block>>& blocks)
+{
+    for (const auto& block : blocks)
+    {
+        if (block->CheckSignature())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+}  // namespace
+
+size_t rai::SignatureTask::Size() const
+{
+    return blocks_.size() + checks_.size();
+}
+
+rai::SignatureVerifier::SignatureVerifier(size_t threads)
+    : stopped_(false), batches_(0), signatures_(0), dropped_(0)
+{
+    threads = std::max<size_t>(1, threads);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        threads_.emplace_back([this]() { this->Run_(); });
+    }
+}
+
+rai::SignatureVerifier::~SignatureVerifier()
+{
+    Stop();
+}
+
+bool rai::SignatureVerifier::Add(
+    const std::vector<std::shared_ptr<rai::Block>>& blocks,
+    const std::function<void(bool)>& callback)
+{
+    return Add(blocks, std::vector<rai::SignatureCheck>(), callback);
+}
+
+bool rai::SignatureVerifier::Add(
+    const std::vector<std::shared_ptr<rai::Block>>& blocks,
+    const std::vector<rai::SignatureCheck>& checks,
+    const std::function<void(bool)>& callback)
+{
+    if (checks.empty() && SignaturesChecked(blocks))
+    {
+        callback(SignaturesError(blocks));
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_)
+        {
+            return true;
+        }
+        if (tasks_.size() >= rai::SignatureVerifier::MAX_TASKS)
+        {
+            ++dropped_;
+            return true;
+        }
+        tasks_.push_back(rai::SignatureTask{blocks, checks, callback});
+    }
+    condition_.notify_one();
+    return false;
+}
+
+void rai::SignatureVerifier::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_)
+        {
+            return;
+        }
+        stopped_ = true;
+    }
+    condition_.notify_all();
+    for (auto& i : threads_)
+    {
+        if (i.joinable())
+        {
+            i.join();
+        }
+    }
+}
+
+size_t rai::SignatureVerifier::Size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+void rai::SignatureVerifier::Status(rai::Ptree& ptree) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ptree.put("threads", std::to_string(threads_.size()));
+    ptree.put("tasks", std::to_string(tasks_.size()));
+    ptree.put("batches", std::to_string(batches_));
+    ptree.put("signatures", std::to_string(signatures_));
+    ptree.put("dropped", std::to_string(dropped_));
+}
+
+void rai::SignatureVerifier::Run_()
+{
+    std::vector<rai::SignatureTask> tasks;
+    std::vector<std::shared_ptr<rai::Block>> blocks;
+    std::vector<size_t> offsets;
+    std::vector<rai::PublicKey> public_keys;
+    std::vector<rai::uint256_union> messages;
+    std::vector<rai::Signature> signatures;
+    std::vector<bool> results;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopped_)
+    {
+        if (tasks_.empty())
+        {
+            condition_.wait(lock);
+            continue;
+        }
+
+        tasks.clear();
+        size_t size = 0;
+        while (!tasks_.empty() && size < rai::SignatureVerifier::MAX_BATCH)
+        {
+            size += tasks_.front().Size();
+            tasks.push_back(std::move(tasks_.front()));
+            tasks_.pop_front();
+        }
+        ++batches_;
+        signatures_ += size;
+        lock.unlock();
+
+        // unchecked blocks first, then the checks of each task
+        blocks.clear();
+        offsets.clear();
+        public_keys.clear();
+        messages.clear();
+        signatures.clear();
+        for (const auto& task : tasks)
+        {
+            for (const auto& block : task.blocks_)
+            {
+                if (block->SignatureChecked())
+                {
+                    continue;
+                }
+                public_keys.push_back(block->Account());
+                messages.push_back(block->Hash());
+                signatures.push_back(block->Signature());
+                blocks.push_back(block);
+            }
+        }
+        for (const auto& task : tasks)
+        {
+            offsets.push_back(public_keys.size());
+            for (const auto& check : task.checks_)
+            {
+                public_keys.push_back(check.public_key_);
+                messages.push_back(check.message_);
+                signatures.push_back(check.signature_);
+            }
+        }
+
+        rai::ValidateMessages(public_keys, messages, signatures, results);
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            blocks[i]->SetSignatureChecked(results[i]);
+        }
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            const rai::SignatureTask& task = tasks[i];
+            bool error = SignaturesError(task.blocks_);
+            for (size_t j = 0; j < task.checks_.size(); ++j)
+            {
+                error |= results[offsets[i] + j];
+            }
+            task.callback_(error);
+        }
+
+        lock.lock();
+    }
+}
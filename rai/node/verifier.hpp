@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <rai/common/blocks.hpp>
+#include <rai/common/numbers.hpp>
+#include <rai/common/util.hpp>
+
+namespace rai
+{
+class SignatureCheck
+{
+public:
+    rai::PublicKey public_key_;
+    rai::uint256_union message_;
+    rai::Signature signature_;
+};
+
+class SignatureTask
+{
+public:
+    size_t Size() const;
+
+    std::vector<std::shared_ptr<rai::Block>> blocks_;
+    std::vector<rai::SignatureCheck> checks_;
+    // true if any signature is invalid
+    std::function<void(bool)> callback_;
+};
+
+// Pool of threads verifying block and message signatures off the network and
+// processing threads. Queued tasks are drained together so
+// rai::ValidateMessages can verify up to MAX_BATCH signatures in one batch
+class SignatureVerifier
+{
+public:
+    SignatureVerifier(size_t);
+    ~SignatureVerifier();
+    // the callback is called on a verifier thread, or right away when every
+    // signature is already known; returns true and drops the task if the
+    // queue is full
+    bool Add(const std::vector<std::shared_ptr<rai::Block>>&,
+             const std::function<void(bool)>&);
+    bool Add(const std::vector<std::shared_ptr<rai::Block>>&,
+             const std::vector<rai::SignatureCheck>&,
+             const std::function<void(bool)>&);
+    void Stop();
+    size_t Size() const;
+    void Status(rai::Ptree&) const;
+
+    static size_t constexpr MAX_BATCH = 64;
+    static size_t constexpr MAX_TASKS = 256 * 1024;
+
+private:
+    void Run_();
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<rai::SignatureTask> tasks_;
+    bool stopped_;
+    uint64_t batches_;
+    uint64_t signatures_;
+    uint64_t dropped_;
+    std::vector<std::thread> threads_;
+};
+}  // namespace rai
@@ -1,8 +1,16 @@
 #include <rai/rai_node/cli.hpp>
 
+#include <atomic>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
 #include <rai/common/parameters.hpp>
+#include <rai/common/runner.hpp>
+#include <rai/node/network.hpp>
+#include <rai/secure/ledger.hpp>
+#include <rai/secure/snapshot.hpp>
 #include <rai/secure/util.hpp>
 #include <rai/rai_node/daemon.hpp>
 
@@ -217,6 +225,263 @@ rai::ErrorCode ProcessConfigCreate(
     return rai::ErrorCode::SUCCESS;
 }
 
+rai::ErrorCode GetSnapshotPath(const boost::program_options::variables_map& vm,
+                               boost::filesystem::path& snapshot_path)
+{
+    if (!vm.count("file"))
+    {
+        return rai::ErrorCode::CMD_MISS_FILE;
+    }
+
+    snapshot_path =
+        boost::filesystem::absolute(vm["file"].as<std::string>());
+    return rai::ErrorCode::SUCCESS;
+}
+
+void PrintSnapshotManifest(const rai::SnapshotManifest& manifest)
+{
+    std::cout << "ledger version:" << manifest.ledger_version_ << std::endl;
+    std::cout << "accounts:" << manifest.account_count_ << std::endl;
+    std::cout << "heads:" << manifest.heads_.StringHex() << std::endl;
+    std::cout << "size:" << manifest.size_ << std::endl;
+    std::cout << "checksum:" << manifest.checksum_.StringHex() << std::endl;
+}
+
+rai::ErrorCode ProcessSnapshotExport(
+    const boost::program_options::variables_map& vm,
+    const boost::filesystem::path& data_path)
+{
+    boost::filesystem::path snapshot_path;
+    rai::ErrorCode error_code = GetSnapshotPath(vm, snapshot_path);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    boost::filesystem::path ledger_path = data_path / "data.ldb";
+    if (!boost::filesystem::exists(ledger_path))
+    {
+        return rai::ErrorCode::SNAPSHOT_EXPORT;
+    }
+
+    // a running daemon may keep using the ledger, lmdb readers and the writer
+    // of another process do not block each other
+    rai::Store store(error_code, ledger_path);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    rai::SnapshotManifest manifest;
+    error_code = rai::SnapshotExport(store, snapshot_path, manifest);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    PrintSnapshotManifest(manifest);
+    std::cout << "Success, the snapshot was saved to:" << snapshot_path
+              << std::endl;
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode ProcessSnapshotImport(
+    const boost::program_options::variables_map& vm,
+    const boost::filesystem::path& data_path)
+{
+    boost::filesystem::path snapshot_path;
+    rai::ErrorCode error_code = GetSnapshotPath(vm, snapshot_path);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    rai::SnapshotManifest manifest;
+    error_code = rai::SnapshotImport(snapshot_path, data_path, manifest);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    PrintSnapshotManifest(manifest);
+    std::cout << "Success, the snapshot was imported to:"
+              << data_path / "data.ldb" << std::endl;
+
+    // bootstrap resumes every account from the imported heads
+    if (vm.count("daemon"))
+    {
+        return ProcessDaemon(vm, data_path);
+    }
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+void PrintLedgerCounters(const std::string& title,
+                         const rai::LedgerCounters& counters)
+{
+    rai::Ptree ptree;
+    counters.SerializeJson(ptree);
+    std::cout << title << ":" << std::endl;
+    for (const auto& i : ptree)
+    {
+        if (i.second.empty())
+        {
+            std::cout << "  " << i.first << ":" << i.second.data()
+                      << std::endl;
+            continue;
+        }
+        for (const auto& j : i.second)
+        {
+            std::cout << "  " << i.first << "." << j.first << ":"
+                      << j.second.data() << std::endl;
+        }
+    }
+}
+
+// The stored counters are compared with a full scan of the ledger, rebuild
+// replaces them with the scan result. The daemon must not be running.
+rai::ErrorCode ProcessLedgerCounters(
+    const boost::program_options::variables_map& vm,
+    const boost::filesystem::path& data_path, bool rebuild)
+{
+    boost::filesystem::path ledger_path = data_path / "data.ldb";
+    if (!boost::filesystem::exists(ledger_path))
+    {
+        return rai::ErrorCode::LEDGER_COUNTERS;
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, ledger_path);
+    IF_NOT_SUCCESS_RETURN(error_code);
+    rai::Ledger ledger(error_code, store, rai::LedgerType::NODE);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    rai::Transaction transaction(error_code, ledger, rebuild);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    rai::LedgerCounters stored;
+    bool error = ledger.LedgerCountersGet(transaction, stored);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_COUNTERS);
+    rai::LedgerCounters computed;
+    error = ledger.LedgerCountersCompute(transaction, computed);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_COUNTERS);
+
+    PrintLedgerCounters("stored", stored);
+    PrintLedgerCounters("computed", computed);
+    if (stored == computed)
+    {
+        std::cout << "Success, the ledger counters are consistent"
+                  << std::endl;
+        return rai::ErrorCode::SUCCESS;
+    }
+
+    if (!rebuild)
+    {
+        std::cout << "The ledger counters differ from the ledger, run "
+                     "ledger_counters_rebuild to repair them"
+                  << std::endl;
+        return rai::ErrorCode::LEDGER_COUNTERS;
+    }
+
+    error = ledger.LedgerCountersPut(transaction, computed);
+    if (error)
+    {
+        transaction.Abort();
+        return rai::ErrorCode::LEDGER_COUNTERS;
+    }
+    std::cout << "Success, the ledger counters were rebuilt" << std::endl;
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode ProcessStoreStats(
+    const boost::program_options::variables_map& vm,
+    const boost::filesystem::path& data_path)
+{
+    boost::filesystem::path ledger_path = data_path / "data.ldb";
+    if (!boost::filesystem::exists(ledger_path))
+    {
+        return rai::ErrorCode::STORE_STATS;
+    }
+
+    uint64_t samples = 0;
+    if (vm.count("samples"))
+    {
+        samples = vm["samples"].as<uint64_t>();
+    }
+
+    // lmdb readers of another process do not block a running daemon
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Store store(error_code, ledger_path);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    rai::Ptree stats;
+    error_code = store.Stats(stats, samples);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    std::stringstream stream;
+    boost::property_tree::write_json(stream, stats);
+    std::cout << stream.str();
+    return rai::ErrorCode::SUCCESS;
+}
+
+// Floods a local receiver from several generator sockets and reports the
+// datagrams received per second, for 1, 2, 4 ... up to <sockets> sockets
+rai::ErrorCode ProcessUdpReceiveBench(
+    const boost::program_options::variables_map& vm)
+{
+    uint64_t max_sockets = rai::UdpNetwork::DEFAULT_RECEIVE_SOCKETS;
+    if (vm.count("sockets"))
+    {
+        max_sockets = std::max<uint64_t>(1, vm["sockets"].as<uint64_t>());
+    }
+    size_t constexpr generators = 4;
+    size_t constexpr datagram_size = 512;
+    auto duration = std::chrono::seconds(3);
+
+    for (uint64_t sockets = 1; sockets <= max_sockets; sockets *= 2)
+    {
+        boost::asio::io_service service;
+        boost::asio::io_service::work work(service);
+        rai::Endpoint local(boost::asio::ip::address_v4::loopback(), 0);
+        rai::UdpSockets receiver(service, local, sockets);
+        std::atomic<uint64_t> received(0);
+        receiver.Start([&received](const rai::Endpoint&, const uint8_t*,
+                                   size_t) { ++received; });
+        rai::ServiceRunner runner(service, receiver.Size());
+
+        rai::Endpoint target = receiver.LocalEndpoint();
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> sent(0);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < generators; ++i)
+        {
+            threads.emplace_back([&stop, &sent, target]() {
+                boost::asio::io_service service_l;
+                boost::asio::ip::udp::socket socket(
+                    service_l, boost::asio::ip::udp::endpoint(
+                                   boost::asio::ip::udp::v4(), 0));
+                std::vector<uint8_t> bytes(datagram_size, 0);
+                boost::system::error_code ec;
+                while (!stop)
+                {
+                    socket.send_to(boost::asio::buffer(bytes), target, 0, ec);
+                    if (!ec)
+                    {
+                        ++sent;
+                    }
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(duration);
+        uint64_t received_l = received;
+        uint64_t sent_l = sent;
+        stop = true;
+        for (auto& i : threads)
+        {
+            i.join();
+        }
+        receiver.Stop();
+        service.stop();
+        runner.Join();
+
+        uint64_t seconds = duration.count();
+        std::cout << "sockets " << receiver.Size() << ": sent "
+                  << sent_l / seconds << "/s, received "
+                  << received_l / seconds << "/s" << std::endl;
+        if (receiver.Size() < sockets)
+        {
+            break;
+        }
+    }
+    return rai::ErrorCode::SUCCESS;
+}
+
 }  // namespace
 
 void rai::CliAddOptions(boost::program_options::options_description& desc){
@@ -234,6 +499,14 @@ void rai::CliAddOptions(boost::program_options::options_description& desc){
         ("config_create", "Generate the config.json file")
         ("forward_reward_to", boost::program_options::value<std::string>(), "Specify a wallet account to receive node reward")
         ("raw_key", "Specify daemon to start with raw private key")
+        ("snapshot_export", "Write a compacted ledger snapshot and its manifest to the directory <file>")
+        ("snapshot_import", "Verify and install the ledger snapshot in the directory <file>, then start the daemon if <daemon> is also given")
+        ("ledger_counters_verify", "Compare the stored ledger counters with a full scan of the ledger")
+        ("ledger_counters_rebuild", "Recompute the ledger counters with a full scan of the ledger and store them")
+        ("store_stats", "Show page usage of every ledger table, with key and value size histograms if <samples> is given")
+        ("samples", boost::program_options::value<uint64_t>(), "Define the number of entries sampled per table for store_stats")
+        ("udp_receive_bench", "Measure local udp receive throughput with 1, 2, 4 ... up to <sockets> receive sockets")
+        ("sockets", boost::program_options::value<uint64_t>(), "Define the maximum number of receive sockets for udp_receive_bench")
         ;
 
     // clang-format on
@@ -268,7 +541,11 @@ rai::ErrorCode rai::CliProcessOptions(
             return rai::ErrorCode::DATA_PATH;
         }
 
-        if (vm.count("daemon"))
+        if (vm.count("snapshot_import"))
+        {
+            error_code = ProcessSnapshotImport(vm, data_path);
+        }
+        else if (vm.count("daemon"))
         {
             error_code = ProcessDaemon(vm, data_path);
         }
@@ -292,6 +569,26 @@ rai::ErrorCode rai::CliProcessOptions(
         {
             error_code = ProcessConfigCreate(vm, data_path);
         }
+        else if (vm.count("snapshot_export"))
+        {
+            error_code = ProcessSnapshotExport(vm, data_path);
+        }
+        else if (vm.count("ledger_counters_verify"))
+        {
+            error_code = ProcessLedgerCounters(vm, data_path, false);
+        }
+        else if (vm.count("ledger_counters_rebuild"))
+        {
+            error_code = ProcessLedgerCounters(vm, data_path, true);
+        }
+        else if (vm.count("store_stats"))
+        {
+            error_code = ProcessStoreStats(vm, data_path);
+        }
+        else if (vm.count("udp_receive_bench"))
+        {
+            error_code = ProcessUdpReceiveBench(vm);
+        }
         else
         {
             error_code = rai::ErrorCode::UNKNOWN_COMMAND;
@@ -653,12 +653,37 @@ void rai::TokenRpcHandler::AccountTokensInfo()
         token_.ledger_.AccountTokenInfoLowerBound(transaction, account);
     rai::Iterator n =
         token_.ledger_.AccountTokenInfoUpperBound(transaction, account);
+    rai::Account account_l;
+    rai::Chain chain = rai::Chain::INVALID;
+    rai::TokenAddress address;
+    rai::AccountTokenInfo account_token_info;
     for (; i != n; ++i)
     {
-        rai::Account account_l;
-        rai::Chain chain;
-        rai::TokenAddress address;
-        rai::AccountTokenInfo account_token_info;
+        // the scan resumes after the last token on a fresh snapshot
+        if (count > 0 && count % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            rai::TokenKey last(chain, address);
+            i = rai::Iterator();
+            n = rai::Iterator();
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+            i = token_.ledger_.AccountTokenInfoLowerBound(
+                transaction, account, last.chain_, last.address_);
+            n = token_.ledger_.AccountTokenInfoUpperBound(transaction,
+                                                          account);
+            if (i != n
+                && !token_.ledger_.AccountTokenInfoGet(
+                    i, account_l, chain, address, account_token_info)
+                && rai::TokenKey(chain, address) == last)
+            {
+                ++i;
+            }
+            if (i == n)
+            {
+                break;
+            }
+        }
+
         error = token_.ledger_.AccountTokenInfoGet(i, account_l, chain, address,
                                                    account_token_info);
         if (error)
@@ -2083,8 +2108,25 @@ void rai::TokenRpcHandler::TokenReceivablesSummary()
         token_.ledger_.TokenReceivableLowerBound(transaction, account);
     rai::Iterator n =
         token_.ledger_.TokenReceivableUpperBound(transaction, account);
-    while (i != n)
-    {
+    rai::TokenKey last;
+    for (uint64_t count = 0; i != n; ++count)
+    {
+        // the scan resumes after the last token on a fresh snapshot
+        if (count > 0 && count % rai::Ledger::SCAN_RENEW_INTERVAL == 0)
+        {
+            i = rai::Iterator();
+            n = rai::Iterator();
+            error_code_ = transaction.Renew();
+            IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+            i = token_.ledger_.TokenReceivableUpperBound(transaction, account,
+                                                         last);
+            n = token_.ledger_.TokenReceivableUpperBound(transaction, account);
+            if (i == n)
+            {
+                break;
+            }
+        }
+
         rai::TokenReceivableKey key;
         rai::TokenReceivable receivable;
         error = token_.ledger_.TokenReceivableGet(i, key, receivable);
@@ -2097,6 +2139,7 @@ void rai::TokenRpcHandler::TokenReceivablesSummary()
         token_.TokenKeyToPtree(key.token_, entry);
         tokens.push_back(std::make_pair("", entry));
 
+        last = key.token_;
         i = token_.ledger_.TokenReceivableUpperBound(transaction, account,
                                                      key.token_);
     }
@@ -0,0 +1,203 @@
+#include <rai/secure/cache.hpp>
+
+rai::LedgerBlockCache::LedgerBlockCache(size_t size)
+    : shard_size_(std::max<size_t>(1, size / rai::LedgerBlockCache::SHARDS)),
+      epoch_(0),
+      hits_(0),
+      misses_(0)
+{
+}
+
+bool rai::LedgerBlockCache::Get(uint64_t epoch, const rai::BlockHash& hash,
+                                std::shared_ptr<rai::Block>& block)
+{
+    if (!Usable_(epoch))
+    {
+        return true;
+    }
+
+    Shard& shard = Shard_(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto& index = shard.entries_.get<1>();
+    auto it = index.find(hash);
+    if (it == index.end())
+    {
+        ++misses_;
+        return true;
+    }
+
+    shard.entries_.relocate(shard.entries_.begin(),
+                            shard.entries_.project<0>(it));
+    block = it->block_;
+    ++hits_;
+    return false;
+}
+
+bool rai::LedgerBlockCache::Get(uint64_t epoch, const rai::Account& account,
+                                uint64_t height,
+                                std::shared_ptr<rai::Block>& block)
+{
+    if (!Usable_(epoch))
+    {
+        return true;
+    }
+
+    rai::BlockHash hash;
+    {
+        HeightShard& shard = HeightShard_(account, height);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        auto& index = shard.entries_.get<1>();
+        auto it = index.find(boost::make_tuple(account, height));
+        if (it == index.end())
+        {
+            ++misses_;
+            return true;
+        }
+        shard.entries_.relocate(shard.entries_.begin(),
+                                shard.entries_.project<0>(it));
+        hash = it->hash_;
+    }
+
+    std::shared_ptr<rai::Block> block_l(nullptr);
+    bool error = Get(epoch, hash, block_l);
+    IF_ERROR_RETURN(error, true);
+    if (block_l->Account() != account || block_l->Height() != height)
+    {
+        assert(0);
+        return true;
+    }
+
+    block = block_l;
+    return false;
+}
+
+void rai::LedgerBlockCache::Put(uint64_t epoch,
+                                const std::shared_ptr<rai::Block>& block)
+{
+    if (block == nullptr)
+    {
+        return;
+    }
+
+    // fill the hash cache before the block is shared between threads
+    rai::BlockHash hash = block->Hash();
+    rai::Account account = block->Account();
+    uint64_t height = block->Height();
+
+    {
+        Shard& shard = Shard_(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        if (!Usable_(epoch))
+        {
+            return;
+        }
+        auto ret =
+            shard.entries_.push_front(rai::LedgerBlockCacheEntry{hash, block});
+        if (!ret.second)
+        {
+            shard.entries_.relocate(shard.entries_.begin(), ret.first);
+        }
+        while (shard.entries_.size() > shard_size_)
+        {
+            shard.entries_.pop_back();
+        }
+    }
+
+    {
+        HeightShard& shard = HeightShard_(account, height);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        if (!Usable_(epoch))
+        {
+            return;
+        }
+        auto ret = shard.entries_.push_front(
+            rai::LedgerBlockCacheHeightEntry{account, height, hash});
+        if (!ret.second)
+        {
+            shard.entries_.replace(
+                ret.first,
+                rai::LedgerBlockCacheHeightEntry{account, height, hash});
+            shard.entries_.relocate(shard.entries_.begin(), ret.first);
+        }
+        while (shard.entries_.size() > shard_size_)
+        {
+            shard.entries_.pop_back();
+        }
+    }
+}
+
+uint64_t rai::LedgerBlockCache::Epoch() const
+{
+    return epoch_;
+}
+
+void rai::LedgerBlockCache::InvalidateBegin()
+{
+    ++epoch_;
+}
+
+void rai::LedgerBlockCache::Invalidate(const rai::Block& block)
+{
+    rai::BlockHash hash = block.Hash();
+    {
+        Shard& shard = Shard_(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        shard.entries_.get<1>().erase(hash);
+    }
+
+    {
+        HeightShard& shard = HeightShard_(block.Account(), block.Height());
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        auto& index = shard.entries_.get<1>();
+        auto it = index.find(boost::make_tuple(block.Account(), block.Height()));
+        if (it != index.end() && it->hash_ == hash)
+        {
+            index.erase(it);
+        }
+    }
+}
+
+void rai::LedgerBlockCache::InvalidateEnd()
+{
+    ++epoch_;
+}
+
+void rai::LedgerBlockCache::Status(rai::Ptree& status) const
+{
+    size_t size = 0;
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        size += shard.entries_.size();
+    }
+
+    uint64_t hits = hits_;
+    uint64_t misses = misses_;
+    status.put("size", std::to_string(size));
+    status.put("capacity", std::to_string(shard_size_ * SHARDS));
+    status.put("hits", std::to_string(hits));
+    status.put("misses", std::to_string(misses));
+    status.put("hit_rate_percent",
+               std::to_string(hits + misses == 0
+                                  ? 0
+                                  : hits * 100 / (hits + misses)));
+}
+
+bool rai::LedgerBlockCache::Usable_(uint64_t epoch) const
+{
+    // an odd epoch means some added or deleted blocks are being committed
+    return epoch % 2 == 0 && epoch == epoch_;
+}
+
+rai::LedgerBlockCache::Shard& rai::LedgerBlockCache::Shard_(
+    const rai::BlockHash& hash)
+{
+    return shards_[hash.bytes[0] % rai::LedgerBlockCache::SHARDS];
+}
+
+rai::LedgerBlockCache::HeightShard& rai::LedgerBlockCache::HeightShard_(
+    const rai::Account& account, uint64_t height)
+{
+    return height_shards_[(account.bytes[0] + height)
+                          % rai::LedgerBlockCache::SHARDS];
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <rai/common/blocks.hpp>
+#include <rai/common/numbers.hpp>
+#include <rai/common/util.hpp>
+
+namespace rai
+{
+class LedgerBlockCacheEntry
+{
+public:
+    rai::BlockHash hash_;
+    std::shared_ptr<rai::Block> block_;
+};
+
+class LedgerBlockCacheHeightEntry
+{
+public:
+    rai::Account account_;
+    uint64_t height_;
+    rai::BlockHash hash_;
+};
+
+// Sharded LRU cache of deserialized ledger blocks, keyed by hash and by
+// (account, height). Readers pass the epoch sampled when their transaction
+// began, the cache is bypassed if any block was added or deleted since then.
+class LedgerBlockCache
+{
+public:
+    LedgerBlockCache(size_t);
+    bool Get(uint64_t, const rai::BlockHash&, std::shared_ptr<rai::Block>&);
+    bool Get(uint64_t, const rai::Account&, uint64_t,
+             std::shared_ptr<rai::Block>&);
+    void Put(uint64_t, const std::shared_ptr<rai::Block>&);
+    uint64_t Epoch() const;
+    void InvalidateBegin();
+    void Invalidate(const rai::Block&);
+    void InvalidateEnd();
+    void Status(rai::Ptree&) const;
+
+    static size_t constexpr SHARDS = 16;
+
+private:
+    class Shard
+    {
+    public:
+        mutable std::mutex mutex_;
+        boost::multi_index_container<
+            rai::LedgerBlockCacheEntry,
+            boost::multi_index::indexed_by<
+                boost::multi_index::sequenced<>,
+                boost::multi_index::hashed_unique<boost::multi_index::member<
+                    rai::LedgerBlockCacheEntry, rai::BlockHash,
+                    &rai::LedgerBlockCacheEntry::hash_>>>>
+            entries_;
+    };
+
+    class HeightShard
+    {
+    public:
+        mutable std::mutex mutex_;
+        boost::multi_index_container<
+            rai::LedgerBlockCacheHeightEntry,
+            boost::multi_index::indexed_by<
+                boost::multi_index::sequenced<>,
+                boost::multi_index::hashed_unique<
+                    boost::multi_index::composite_key<
+                        rai::LedgerBlockCacheHeightEntry,
+                        boost::multi_index::member<
+                            rai::LedgerBlockCacheHeightEntry, rai::Account,
+                            &rai::LedgerBlockCacheHeightEntry::account_>,
+                        boost::multi_index::member<
+                            rai::LedgerBlockCacheHeightEntry, uint64_t,
+                            &rai::LedgerBlockCacheHeightEntry::height_>>>>>
+            entries_;
+    };
+
+    bool Usable_(uint64_t) const;
+    Shard& Shard_(const rai::BlockHash&);
+    HeightShard& HeightShard_(const rai::Account&, uint64_t);
+
+    size_t shard_size_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::array<Shard, SHARDS> shards_;
+    std::array<HeightShard, SHARDS> height_shards_;
+};
+}  // namespace rai
@@ -0,0 +1,794 @@
+#include <rai/secure/engine.hpp>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+std::string rai::StoreEngineTypeToString(rai::StoreEngineType type)
+{
+    switch (type)
+    {
+        case rai::StoreEngineType::LMDB:
+        {
+            return "lmdb";
+        }
+        case rai::StoreEngineType::MEMORY:
+        {
+            return "memory";
+        }
+        default:
+        {
+            return "invalid";
+        }
+    }
+}
+
+rai::StoreEngineType rai::StringToStoreEngineType(const std::string& str)
+{
+    if (str == "lmdb")
+    {
+        return rai::StoreEngineType::LMDB;
+    }
+    else if (str == "memory")
+    {
+        return rai::StoreEngineType::MEMORY;
+    }
+    else
+    {
+        return rai::StoreEngineType::INVALID;
+    }
+}
+
+rai::LmdbEngine::LmdbEngine(MDB_env* env) : env_(env)
+{
+}
+
+rai::StoreEngineType rai::LmdbEngine::Type() const
+{
+    return rai::StoreEngineType::LMDB;
+}
+
+int rai::LmdbEngine::TxnBegin(MDB_txn* parent, bool write, MDB_txn** txn)
+{
+    return mdb_txn_begin(env_, parent, write ? 0 : MDB_RDONLY, txn);
+}
+
+int rai::LmdbEngine::TxnCommit(MDB_txn* txn)
+{
+    return mdb_txn_commit(txn);
+}
+
+void rai::LmdbEngine::TxnAbort(MDB_txn* txn)
+{
+    mdb_txn_abort(txn);
+}
+
+void rai::LmdbEngine::TxnReset(MDB_txn* txn)
+{
+    mdb_txn_reset(txn);
+}
+
+int rai::LmdbEngine::TxnRenew(MDB_txn* txn)
+{
+    return mdb_txn_renew(txn);
+}
+
+int rai::LmdbEngine::DbiOpen(MDB_txn* txn, const char* name,
+                             unsigned int flags, MDB_dbi* dbi)
+{
+    return mdb_dbi_open(txn, name, flags, dbi);
+}
+
+int rai::LmdbEngine::Get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
+                         MDB_val* value)
+{
+    return mdb_get(txn, dbi, key, value);
+}
+
+int rai::LmdbEngine::Put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
+                         MDB_val* value)
+{
+    return mdb_put(txn, dbi, key, value, 0);
+}
+
+int rai::LmdbEngine::Del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
+                         MDB_val* value)
+{
+    return mdb_del(txn, dbi, key, value);
+}
+
+int rai::LmdbEngine::Drop(MDB_txn* txn, MDB_dbi dbi, bool del)
+{
+    return mdb_drop(txn, dbi, del ? 1 : 0);
+}
+
+int rai::LmdbEngine::Stat(MDB_txn* txn, MDB_dbi dbi, MDB_stat* stat)
+{
+    return mdb_stat(txn, dbi, stat);
+}
+
+int rai::LmdbEngine::CursorOpen(MDB_txn* txn, MDB_dbi dbi,
+                                std::unique_ptr<rai::StoreCursor>& cursor)
+{
+    MDB_cursor* cursor_l = nullptr;
+    auto ret = mdb_cursor_open(txn, dbi, &cursor_l);
+    if (ret != MDB_SUCCESS)
+    {
+        return ret;
+    }
+
+    cursor.reset(new rai::LmdbCursor(cursor_l));
+    return MDB_SUCCESS;
+}
+
+uint64_t rai::LmdbEngine::TxnId(MDB_txn* txn)
+{
+    return mdb_txn_id(txn);
+}
+
+class rai::MemoryTable::Node
+{
+public:
+    Node(const rai::MemoryTable::EntryPtr& entry, size_t priority,
+         const rai::MemoryTable::NodePtr& left,
+         const rai::MemoryTable::NodePtr& right)
+        : entry_(entry),
+          priority_(priority),
+          left_(left),
+          right_(right),
+          size_(1),
+          bytes_(entry->first.size() + entry->second.size())
+    {
+        if (left_ != nullptr)
+        {
+            size_ += left_->size_;
+            bytes_ += left_->bytes_;
+        }
+        if (right_ != nullptr)
+        {
+            size_ += right_->size_;
+            bytes_ += right_->bytes_;
+        }
+    }
+
+    rai::MemoryTable::EntryPtr entry_;
+    size_t priority_;
+    rai::MemoryTable::NodePtr left_;
+    rai::MemoryTable::NodePtr right_;
+    size_t size_;
+    size_t bytes_;
+};
+
+rai::MemoryTable::MemoryTable()
+{
+}
+
+const rai::MemoryTable::Entry* rai::MemoryTable::Find(
+    const std::string& key) const
+{
+    const Node* node = root_.get();
+    while (node != nullptr)
+    {
+        int result = key.compare(node->entry_->first);
+        if (result == 0)
+        {
+            return node->entry_.get();
+        }
+        node = result < 0 ? node->left_.get() : node->right_.get();
+    }
+    return nullptr;
+}
+
+rai::MemoryTable::EntryPtr rai::MemoryTable::First() const
+{
+    const Node* node = root_.get();
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+    while (node->left_ != nullptr)
+    {
+        node = node->left_.get();
+    }
+    return node->entry_;
+}
+
+rai::MemoryTable::EntryPtr rai::MemoryTable::Last() const
+{
+    const Node* node = root_.get();
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+    while (node->right_ != nullptr)
+    {
+        node = node->right_.get();
+    }
+    return node->entry_;
+}
+
+rai::MemoryTable::EntryPtr rai::MemoryTable::LowerBound(
+    const std::string& key) const
+{
+    rai::MemoryTable::EntryPtr result;
+    const Node* node = root_.get();
+    while (node != nullptr)
+    {
+        if (node->entry_->first < key)
+        {
+            node = node->right_.get();
+        }
+        else
+        {
+            result = node->entry_;
+            node = node->left_.get();
+        }
+    }
+    return result;
+}
+
+rai::MemoryTable::EntryPtr rai::MemoryTable::UpperBound(
+    const std::string& key) const
+{
+    rai::MemoryTable::EntryPtr result;
+    const Node* node = root_.get();
+    while (node != nullptr)
+    {
+        if (node->entry_->first <= key)
+        {
+            node = node->right_.get();
+        }
+        else
+        {
+            result = node->entry_;
+            node = node->left_.get();
+        }
+    }
+    return result;
+}
+
+rai::MemoryTable::EntryPtr rai::MemoryTable::Below(
+    const std::string& key) const
+{
+    rai::MemoryTable::EntryPtr result;
+    const Node* node = root_.get();
+    while (node != nullptr)
+    {
+        if (node->entry_->first < key)
+        {
+            result = node->entry_;
+            node = node->right_.get();
+        }
+        else
+        {
+            node = node->left_.get();
+        }
+    }
+    return result;
+}
+
+void rai::MemoryTable::Put(const std::string& key, const std::string& value)
+{
+    NodePtr less;
+    NodePtr rest;
+    NodePtr equal;
+    NodePtr greater;
+    Split_(root_, key, false, less, rest);
+    Split_(rest, key, true, equal, greater);
+
+    size_t priority = equal != nullptr ? equal->priority_
+                                       : std::hash<std::string>()(key);
+    NodePtr node =
+        Make_(std::make_shared<const rai::MemoryTable::Entry>(key, value),
+              priority, nullptr, nullptr);
+    root_ = Merge_(Merge_(less, node), greater);
+}
+
+bool rai::MemoryTable::Del(const std::string& key)
+{
+    NodePtr less;
+    NodePtr rest;
+    NodePtr equal;
+    NodePtr greater;
+    Split_(root_, key, false, less, rest);
+    Split_(rest, key, true, equal, greater);
+    if (equal == nullptr)
+    {
+        return true;
+    }
+
+    root_ = Merge_(less, greater);
+    return false;
+}
+
+void rai::MemoryTable::Clear()
+{
+    root_ = nullptr;
+}
+
+size_t rai::MemoryTable::Size() const
+{
+    return root_ == nullptr ? 0 : root_->size_;
+}
+
+size_t rai::MemoryTable::Bytes() const
+{
+    return root_ == nullptr ? 0 : root_->bytes_;
+}
+
+rai::MemoryTable::NodePtr rai::MemoryTable::Make_(
+    const rai::MemoryTable::EntryPtr& entry, size_t priority,
+    const NodePtr& left, const NodePtr& right)
+{
+    return std::make_shared<const Node>(entry, priority, left, right);
+}
+
+// All the keys of the first tree must be less than those of the second
+rai::MemoryTable::NodePtr rai::MemoryTable::Merge_(const NodePtr& first,
+                                                   const NodePtr& second)
+{
+    if (first == nullptr)
+    {
+        return second;
+    }
+    if (second == nullptr)
+    {
+        return first;
+    }
+
+    if (first->priority_ > second->priority_)
+    {
+        return Make_(first->entry_, first->priority_, first->left_,
+                     Merge_(first->right_, second));
+    }
+    return Make_(second->entry_, second->priority_,
+                 Merge_(first, second->left_), second->right_);
+}
+
+void rai::MemoryTable::Split_(const NodePtr& node, const std::string& key,
+                              bool inclusive, NodePtr& left, NodePtr& right)
+{
+    if (node == nullptr)
+    {
+        left = nullptr;
+        right = nullptr;
+        return;
+    }
+
+    // the nodes of the tree are shared with other versions, only the path
+    // to the key is copied
+    NodePtr left_l;
+    NodePtr right_l;
+    const std::string& node_key = node->entry_->first;
+    if (inclusive ? node_key <= key : node_key < key)
+    {
+        Split_(node->right_, key, inclusive, left_l, right_l);
+        left = Make_(node->entry_, node->priority_, node->left_, left_l);
+        right = right_l;
+    }
+    else
+    {
+        Split_(node->left_, key, inclusive, left_l, right_l);
+        right = Make_(node->entry_, node->priority_, right_l, node->right_);
+        left = left_l;
+    }
+}
+
+rai::MemoryEngine::MemoryEngine() : txn_id_(0)
+{
+}
+
+rai::StoreEngineType rai::MemoryEngine::Type() const
+{
+    return rai::StoreEngineType::MEMORY;
+}
+
+int rai::MemoryEngine::TxnBegin(MDB_txn* parent, bool write, MDB_txn** txn)
+{
+    std::unique_ptr<rai::MemoryTransaction> txn_l(new rai::MemoryTransaction);
+    txn_l->parent_ = nullptr;
+    txn_l->write_ = write;
+
+    if (parent != nullptr)
+    {
+        // like lmdb, only write transactions can be nested
+        rai::MemoryTransaction* parent_l = Transaction_(parent);
+        if (!write || !parent_l->write_)
+        {
+            return EINVAL;
+        }
+        txn_l->parent_ = parent_l;
+        txn_l->id_ = parent_l->id_;
+        txn_l->tables_ = parent_l->tables_;
+        txn_l->modified_.assign(txn_l->tables_.size(), false);
+    }
+    else
+    {
+        if (write)
+        {
+            writer_mutex_.lock();
+        }
+        Snapshot_(*txn_l);
+    }
+
+    *txn = reinterpret_cast<MDB_txn*>(txn_l.release());
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::TxnCommit(MDB_txn* txn)
+{
+    std::unique_ptr<rai::MemoryTransaction> txn_l(Transaction_(txn));
+    if (!txn_l->write_)
+    {
+        return MDB_SUCCESS;
+    }
+
+    if (txn_l->parent_ != nullptr)
+    {
+        rai::MemoryTransaction& parent = *txn_l->parent_;
+        if (parent.tables_.size() < txn_l->tables_.size())
+        {
+            parent.tables_.resize(txn_l->tables_.size());
+            parent.modified_.resize(txn_l->tables_.size(), false);
+        }
+        for (size_t i = 0; i < txn_l->tables_.size(); ++i)
+        {
+            if (txn_l->modified_[i])
+            {
+                parent.tables_[i] = txn_l->tables_[i];
+                parent.modified_[i] = true;
+            }
+        }
+        return MDB_SUCCESS;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < txn_l->tables_.size(); ++i)
+        {
+            if (txn_l->modified_[i] && i < tables_.size())
+            {
+                tables_[i] = txn_l->tables_[i];
+            }
+        }
+        txn_id_ = txn_l->id_;
+    }
+    writer_mutex_.unlock();
+    return MDB_SUCCESS;
+}
+
+void rai::MemoryEngine::TxnAbort(MDB_txn* txn)
+{
+    std::unique_ptr<rai::MemoryTransaction> txn_l(Transaction_(txn));
+    if (txn_l->write_ && txn_l->parent_ == nullptr)
+    {
+        writer_mutex_.unlock();
+    }
+}
+
+void rai::MemoryEngine::TxnReset(MDB_txn* txn)
+{
+    rai::MemoryTransaction* txn_l = Transaction_(txn);
+    assert(!txn_l->write_);
+    txn_l->tables_.clear();
+    txn_l->modified_.clear();
+}
+
+int rai::MemoryEngine::TxnRenew(MDB_txn* txn)
+{
+    rai::MemoryTransaction* txn_l = Transaction_(txn);
+    if (txn_l->write_)
+    {
+        return EINVAL;
+    }
+    Snapshot_(*txn_l);
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::DbiOpen(MDB_txn* txn, const char* name,
+                               unsigned int flags, MDB_dbi* dbi)
+{
+    std::string name_l(name == nullptr ? "" : name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = names_.find(name_l);
+    if (it != names_.end())
+    {
+        *dbi = it->second;
+        return MDB_SUCCESS;
+    }
+
+    if (!(flags & MDB_CREATE))
+    {
+        return MDB_NOTFOUND;
+    }
+
+    // transactions that began earlier see the new table as empty
+    *dbi = static_cast<MDB_dbi>(tables_.size());
+    tables_.push_back(rai::MemoryTable());
+    names_[name_l] = *dbi;
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::Get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
+                           MDB_val* value)
+{
+    rai::MemoryTransaction* txn_l = Transaction_(txn);
+    if (dbi >= txn_l->tables_.size())
+    {
+        return MDB_NOTFOUND;
+    }
+
+    const rai::MemoryTable::Entry* entry = txn_l->tables_[dbi].Find(
+        std::string(reinterpret_cast<const char*>(key->mv_data),
+                    key->mv_size));
+    if (entry == nullptr)
+    {
+        return MDB_NOTFOUND;
+    }
+
+    value->mv_size = entry->second.size();
+    value->mv_data = const_cast<char*>(entry->second.data());
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::Put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
+                           MDB_val* value)
+{
+    rai::MemoryTransaction* txn_l = Transaction_(txn);
+    if (!txn_l->write_)
+    {
+        return EACCES;
+    }
+
+    // copy first, the arguments may point into the table being modified
+    std::string key_l(reinterpret_cast<const char*>(key->mv_data),
+                      key->mv_size);
+    std::string value_l(reinterpret_cast<const char*>(value->mv_data),
+                        value->mv_size);
+    rai::MemoryTable* table = Writable_(*txn_l, dbi);
+    table->Put(key_l, value_l);
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::Del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
+                           MDB_val* value)
+{
+    rai::MemoryTransaction* txn_l = Transaction_(txn);
+    if (!txn_l->write_)
+    {
+        return EACCES;
+    }
+
+    std::string key_l(reinterpret_cast<const char*>(key->mv_data),
+                      key->mv_size);
+    if (dbi >= txn_l->tables_.size()
+        || txn_l->tables_[dbi].Find(key_l) == nullptr)
+    {
+        return MDB_NOTFOUND;
+    }
+
+    rai::MemoryTable* table = Writable_(*txn_l, dbi);
+    table->Del(key_l);
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::Drop(MDB_txn* txn, MDB_dbi dbi, bool del)
+{
+    rai::MemoryTransaction* txn_l = Transaction_(txn);
+    if (!txn_l->write_)
+    {
+        return EACCES;
+    }
+
+    rai::MemoryTable* table = Writable_(*txn_l, dbi);
+    table->Clear();
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::Stat(MDB_txn* txn, MDB_dbi dbi, MDB_stat* stat)
+{
+    std::memset(stat, 0, sizeof(*stat));
+    stat->ms_psize = rai::MemoryEngine::PAGE_SIZE;
+
+    rai::MemoryTransaction* txn_l = Transaction_(txn);
+    if (dbi >= txn_l->tables_.size())
+    {
+        return MDB_SUCCESS;
+    }
+
+    const rai::MemoryTable& table = txn_l->tables_[dbi];
+    size_t bytes = table.Bytes();
+    stat->ms_depth = table.Size() == 0 ? 0 : 1;
+    stat->ms_entries = table.Size();
+    stat->ms_leaf_pages = (bytes + rai::MemoryEngine::PAGE_SIZE - 1)
+                          / rai::MemoryEngine::PAGE_SIZE;
+    return MDB_SUCCESS;
+}
+
+int rai::MemoryEngine::CursorOpen(MDB_txn* txn, MDB_dbi dbi,
+                                  std::unique_ptr<rai::StoreCursor>& cursor)
+{
+    cursor.reset(new rai::MemoryCursor(*Transaction_(txn), dbi));
+    return MDB_SUCCESS;
+}
+
+uint64_t rai::MemoryEngine::TxnId(MDB_txn* txn)
+{
+    return Transaction_(txn)->id_;
+}
+
+rai::MemoryTransaction* rai::MemoryEngine::Transaction_(MDB_txn* txn)
+{
+    assert(txn != nullptr);
+    return reinterpret_cast<rai::MemoryTransaction*>(txn);
+}
+
+void rai::MemoryEngine::Snapshot_(rai::MemoryTransaction& txn)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    txn.tables_ = tables_;
+    txn.modified_.assign(tables_.size(), false);
+    txn.id_ = txn.write_ ? txn_id_ + 1 : txn_id_;
+}
+
+rai::MemoryTable* rai::MemoryEngine::Writable_(rai::MemoryTransaction& txn,
+                                               MDB_dbi dbi)
+{
+    if (dbi >= txn.tables_.size())
+    {
+        txn.tables_.resize(dbi + 1);
+        txn.modified_.resize(dbi + 1, false);
+    }
+
+    // no copy, the modifications create new versions of the table
+    txn.modified_[dbi] = true;
+    return &txn.tables_[dbi];
+}
+
+rai::LmdbCursor::LmdbCursor(MDB_cursor* cursor) : cursor_(cursor)
+{
+}
+
+rai::LmdbCursor::~LmdbCursor()
+{
+    if (cursor_ != nullptr)
+    {
+        mdb_cursor_close(cursor_);
+    }
+}
+
+int rai::LmdbCursor::Get(MDB_val* key, MDB_val* value, MDB_cursor_op op)
+{
+    return mdb_cursor_get(cursor_, key, value, op);
+}
+
+rai::MemoryCursor::MemoryCursor(rai::MemoryTransaction& txn, MDB_dbi dbi)
+    : txn_(txn), dbi_(dbi)
+{
+}
+
+int rai::MemoryCursor::Get(MDB_val* key, MDB_val* value, MDB_cursor_op op)
+{
+    // every step is a fresh lookup in the live version of the table, so the
+    // cursor stays usable when the transaction modifies the table
+    rai::MemoryTable empty;
+    const rai::MemoryTable& table =
+        dbi_ < txn_.tables_.size() ? txn_.tables_[dbi_] : empty;
+    rai::MemoryTable::EntryPtr entry;
+    switch (op)
+    {
+        case MDB_FIRST:
+        {
+            entry = table.First();
+            break;
+        }
+        case MDB_LAST:
+        {
+            entry = table.Last();
+            break;
+        }
+        case MDB_SET:
+        case MDB_SET_KEY:
+        case MDB_SET_RANGE:
+        case MDB_GET_BOTH:
+        case MDB_GET_BOTH_RANGE:
+        {
+            std::string key_l(reinterpret_cast<const char*>(key->mv_data),
+                              key->mv_size);
+            entry = table.LowerBound(key_l);
+            if (op == MDB_SET_RANGE || entry == nullptr)
+            {
+                break;
+            }
+            if (entry->first != key_l)
+            {
+                entry = nullptr;
+                break;
+            }
+
+            // tables hold one value per key, lmdb compares it with the
+            // argument like a sorted duplicate
+            if (op == MDB_GET_BOTH || op == MDB_GET_BOTH_RANGE)
+            {
+                std::string value_l(
+                    reinterpret_cast<const char*>(value->mv_data),
+                    value->mv_size);
+                int result = value_l.compare(entry->second);
+                if (result > 0 || (op == MDB_GET_BOTH && result != 0))
+                {
+                    entry = nullptr;
+                }
+            }
+            break;
+        }
+        case MDB_NEXT:
+        case MDB_NEXT_NODUP:
+        {
+            // like lmdb, an unpositioned cursor moves to the first entry
+            entry = entry_ == nullptr ? table.First()
+                                      : table.UpperBound(entry_->first);
+            if (entry == nullptr)
+            {
+                return MDB_NOTFOUND;
+            }
+            break;
+        }
+        case MDB_PREV:
+        case MDB_PREV_NODUP:
+        {
+            entry = entry_ == nullptr ? table.Last()
+                                      : table.Below(entry_->first);
+            if (entry == nullptr)
+            {
+                return MDB_NOTFOUND;
+            }
+            break;
+        }
+        case MDB_NEXT_DUP:
+        case MDB_PREV_DUP:
+        {
+            // tables never hold duplicate keys
+            return MDB_NOTFOUND;
+        }
+        case MDB_FIRST_DUP:
+        case MDB_LAST_DUP:
+        case MDB_GET_MULTIPLE:
+        case MDB_NEXT_MULTIPLE:
+        {
+            // lmdb rejects them on tables without MDB_DUPSORT
+            return MDB_INCOMPATIBLE;
+        }
+        case MDB_GET_CURRENT:
+        {
+            if (entry_ == nullptr)
+            {
+                return EINVAL;
+            }
+            entry = entry_;
+            break;
+        }
+        default:
+        {
+            assert(0);
+            return EINVAL;
+        }
+    }
+
+    if (entry == nullptr)
+    {
+        entry_ = nullptr;
+        return MDB_NOTFOUND;
+    }
+    return Set_(entry, key, value);
+}
+
+int rai::MemoryCursor::Set_(const rai::MemoryTable::EntryPtr& entry,
+                            MDB_val* key, MDB_val* value)
+{
+    entry_ = entry;
+    key->mv_size = entry_->first.size();
+    key->mv_data = const_cast<char*>(entry_->first.data());
+    value->mv_size = entry_->second.size();
+    value->mv_data = const_cast<char*>(entry_->second.data());
+    return MDB_SUCCESS;
+}
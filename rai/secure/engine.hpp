@@ -0,0 +1,201 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <lmdb/libraries/liblmdb/lmdb.h>
+
+namespace rai
+{
+enum class StoreEngineType : uint32_t
+{
+    INVALID = 0,
+    LMDB    = 1,
+    MEMORY  = 2,
+};
+std::string StoreEngineTypeToString(rai::StoreEngineType);
+rai::StoreEngineType StringToStoreEngineType(const std::string&);
+
+// Ordered cursor over one table with the semantics of mdb_cursor_get
+class StoreCursor
+{
+public:
+    virtual ~StoreCursor() = default;
+    virtual int Get(MDB_val*, MDB_val*, MDB_cursor_op) = 0;
+};
+
+// Storage engine behind rai::Store. The lmdb types are kept as the common
+// vocabulary: MDB_txn* and MDB_dbi are opaque handles owned by the engine and
+// every call returns an lmdb status code (MDB_SUCCESS, MDB_NOTFOUND, ...)
+class StoreEngine
+{
+public:
+    virtual ~StoreEngine() = default;
+    virtual rai::StoreEngineType Type() const = 0;
+    virtual int TxnBegin(MDB_txn*, bool, MDB_txn**) = 0;
+    virtual int TxnCommit(MDB_txn*) = 0;
+    virtual void TxnAbort(MDB_txn*) = 0;
+    virtual void TxnReset(MDB_txn*) = 0;
+    virtual int TxnRenew(MDB_txn*) = 0;
+    virtual int DbiOpen(MDB_txn*, const char*, unsigned int, MDB_dbi*) = 0;
+    virtual int Get(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) = 0;
+    virtual int Put(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) = 0;
+    virtual int Del(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) = 0;
+    virtual int Drop(MDB_txn*, MDB_dbi, bool) = 0;
+    virtual int Stat(MDB_txn*, MDB_dbi, MDB_stat*) = 0;
+    virtual int CursorOpen(MDB_txn*, MDB_dbi,
+                           std::unique_ptr<rai::StoreCursor>&) = 0;
+    // id a write transaction commits as, or the id of the last commit seen
+    // by a read transaction
+    virtual uint64_t TxnId(MDB_txn*) = 0;
+};
+
+class LmdbEngine : public rai::StoreEngine
+{
+public:
+    LmdbEngine(MDB_env*);
+    rai::StoreEngineType Type() const override;
+    int TxnBegin(MDB_txn*, bool, MDB_txn**) override;
+    int TxnCommit(MDB_txn*) override;
+    void TxnAbort(MDB_txn*) override;
+    void TxnReset(MDB_txn*) override;
+    int TxnRenew(MDB_txn*) override;
+    int DbiOpen(MDB_txn*, const char*, unsigned int, MDB_dbi*) override;
+    int Get(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) override;
+    int Put(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) override;
+    int Del(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) override;
+    int Drop(MDB_txn*, MDB_dbi, bool) override;
+    int Stat(MDB_txn*, MDB_dbi, MDB_stat*) override;
+    int CursorOpen(MDB_txn*, MDB_dbi,
+                   std::unique_ptr<rai::StoreCursor>&) override;
+    uint64_t TxnId(MDB_txn*) override;
+
+private:
+    MDB_env* env_;
+};
+
+// Immutable ordered map, a modification returns a new version sharing all
+// but the path from the root to the changed entry. Copying a version is
+// O(1) and a modification O(log n) whatever the size of the table
+class MemoryTable
+{
+public:
+    typedef std::pair<std::string, std::string> Entry;
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    MemoryTable();
+    // nullptr if the key is not found
+    const rai::MemoryTable::Entry* Find(const std::string&) const;
+    rai::MemoryTable::EntryPtr First() const;
+    rai::MemoryTable::EntryPtr Last() const;
+    // first entry with a key not less than the argument
+    rai::MemoryTable::EntryPtr LowerBound(const std::string&) const;
+    // first entry with a key greater than the argument
+    rai::MemoryTable::EntryPtr UpperBound(const std::string&) const;
+    // last entry with a key less than the argument
+    rai::MemoryTable::EntryPtr Below(const std::string&) const;
+    void Put(const std::string&, const std::string&);
+    // returns true if the key is not found
+    bool Del(const std::string&);
+    void Clear();
+    size_t Size() const;
+    // total size of the keys and values
+    size_t Bytes() const;
+
+private:
+    class Node;
+    typedef std::shared_ptr<const Node> NodePtr;
+
+    // treap: ordered by key, a heap by the priority derived from the key
+    static NodePtr Make_(const rai::MemoryTable::EntryPtr&, size_t,
+                         const NodePtr&, const NodePtr&);
+    static NodePtr Merge_(const NodePtr&, const NodePtr&);
+    // the left part gets the keys less than the argument, or not greater
+    // than it when the bool is true
+    static void Split_(const NodePtr&, const std::string&, bool, NodePtr&,
+                       NodePtr&);
+
+    NodePtr root_;
+};
+
+class MemoryTransaction
+{
+public:
+    rai::MemoryTransaction* parent_;
+    bool write_;
+    uint64_t id_;
+    // the versions of the tables seen by this transaction
+    std::vector<rai::MemoryTable> tables_;
+    // tables modified by this transaction
+    std::vector<bool> modified_;
+};
+
+// Ordered maps with lmdb-like semantics: one writer at a time, readers see
+// the snapshot taken when they began. Tables are persistent maps, so a
+// snapshot costs O(number of tables) and a write O(log n). Nothing is
+// written to disk, it suits tests, benchmarks and ephemeral nodes
+class MemoryEngine : public rai::StoreEngine
+{
+public:
+    MemoryEngine();
+    rai::StoreEngineType Type() const override;
+    int TxnBegin(MDB_txn*, bool, MDB_txn**) override;
+    int TxnCommit(MDB_txn*) override;
+    void TxnAbort(MDB_txn*) override;
+    void TxnReset(MDB_txn*) override;
+    int TxnRenew(MDB_txn*) override;
+    int DbiOpen(MDB_txn*, const char*, unsigned int, MDB_dbi*) override;
+    int Get(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) override;
+    int Put(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) override;
+    int Del(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) override;
+    int Drop(MDB_txn*, MDB_dbi, bool) override;
+    int Stat(MDB_txn*, MDB_dbi, MDB_stat*) override;
+    int CursorOpen(MDB_txn*, MDB_dbi,
+                   std::unique_ptr<rai::StoreCursor>&) override;
+    uint64_t TxnId(MDB_txn*) override;
+
+    static size_t constexpr PAGE_SIZE = 4096;
+
+private:
+    static rai::MemoryTransaction* Transaction_(MDB_txn*);
+    void Snapshot_(rai::MemoryTransaction&);
+    rai::MemoryTable* Writable_(rai::MemoryTransaction&, MDB_dbi);
+
+    mutable std::mutex mutex_;
+    std::vector<rai::MemoryTable> tables_;
+    std::unordered_map<std::string, MDB_dbi> names_;
+    uint64_t txn_id_;
+    std::mutex writer_mutex_;
+};
+
+class LmdbCursor : public rai::StoreCursor
+{
+public:
+    LmdbCursor(MDB_cursor*);
+    ~LmdbCursor();
+    int Get(MDB_val*, MDB_val*, MDB_cursor_op) override;
+
+private:
+    MDB_cursor* cursor_;
+};
+
+// Supports every cursor operation lmdb allows on tables without
+// MDB_DUPSORT, the others fail with MDB_INCOMPATIBLE like lmdb
+class MemoryCursor : public rai::StoreCursor
+{
+public:
+    MemoryCursor(rai::MemoryTransaction&, MDB_dbi);
+    int Get(MDB_val*, MDB_val*, MDB_cursor_op) override;
+
+private:
+    int Set_(const rai::MemoryTable::EntryPtr&, MDB_val*, MDB_val*);
+
+    rai::MemoryTransaction& txn_;
+    MDB_dbi dbi_;
+    // kept alive here, the transaction may modify or delete the entry while
+    // the cursor is open
+    rai::MemoryTable::EntryPtr entry_;
+};
+}  // namespace rai
@@ -1,5 +1,30 @@
 #include <rai/secure/ledger.hpp>
 
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <rai/common/stat.hpp>
+
+namespace
+{
+// Positions of the keys that still have to be read, sorted in key order
+void SortKeys(const std::vector<rai::uint256_union>& keys,
+              std::vector<size_t>& positions,
+              std::vector<rai::MdbVal>& sorted)
+{
+    std::sort(positions.begin(), positions.end(),
+              [&keys](size_t x, size_t y) -> bool {
+                  return keys[x].bytes < keys[y].bytes;
+              });
+    sorted.clear();
+    sorted.reserve(positions.size());
+    for (auto i : positions)
+    {
+        sorted.emplace_back(keys[i]);
+    }
+}
+}  // namespace
+
 rai::RepWeightOpration::RepWeightOpration(bool add,
                                           const rai::Account& representative,
                                           const rai::Amount& weight)
@@ -7,30 +32,452 @@ rai::RepWeightOpration::RepWeightOpration(bool add,
 {
 }
 
+void rai::LedgerCounters::Add(rai::LedgerCounterType type, uint32_t index,
+                              const rai::uint128_t& value)
+{
+    values_[rai::LedgerCounterKey(type, index)] += value;
+}
+
+rai::uint128_t rai::LedgerCounters::Get(rai::LedgerCounterType type,
+                                        uint32_t index) const
+{
+    auto it = values_.find(rai::LedgerCounterKey(type, index));
+    if (it == values_.end())
+    {
+        return 0;
+    }
+    return it->second;
+}
+
+void rai::LedgerCounters::SerializeJson(rai::Ptree& ptree) const
+{
+    rai::uint128_t blocks = Get(rai::LedgerCounterType::BLOCKS);
+    rai::uint128_t confirmed = Get(rai::LedgerCounterType::CONFIRMED_BLOCKS);
+    ptree.put("blocks", rai::uint128_union(blocks).StringDec());
+    ptree.put("confirmed_blocks", rai::uint128_union(confirmed).StringDec());
+    ptree.put("unconfirmed_blocks",
+              rai::uint128_union(blocks > confirmed ? blocks - confirmed : 0)
+                  .StringDec());
+
+    rai::Ptree types;
+    rai::Ptree opcodes;
+    for (const auto& i : values_)
+    {
+        if (i.first.first == rai::LedgerCounterType::BLOCK_TYPE)
+        {
+            types.put(rai::BlockTypeToString(
+                          static_cast<rai::BlockType>(i.first.second)),
+                      rai::uint128_union(i.second).StringDec());
+        }
+        else if (i.first.first == rai::LedgerCounterType::BLOCK_OPCODE)
+        {
+            opcodes.put(rai::BlockOpcodeToString(
+                            static_cast<rai::BlockOpcode>(i.first.second)),
+                        rai::uint128_union(i.second).StringDec());
+        }
+    }
+    ptree.put_child("block_types", types);
+    ptree.put_child("block_opcodes", opcodes);
+
+    ptree.put("receivables",
+              rai::uint128_union(Get(rai::LedgerCounterType::RECEIVABLES))
+                  .StringDec());
+    rai::Amount amount(Get(rai::LedgerCounterType::RECEIVABLE_AMOUNT));
+    ptree.put("receivable_amount", amount.StringDec());
+    ptree.put("receivable_amount_in_rai", amount.StringBalance(rai::RAI));
+    ptree.put("forks", rai::uint128_union(Get(rai::LedgerCounterType::FORKS))
+                           .StringDec());
+}
+
+bool rai::LedgerCounters::operator==(const rai::LedgerCounters& other) const
+{
+    // absent and zero counters are equal
+    for (const auto& i : values_)
+    {
+        if (other.Get(i.first.first, i.first.second) != i.second)
+        {
+            return false;
+        }
+    }
+    for (const auto& i : other.values_)
+    {
+        if (Get(i.first.first, i.first.second) != i.second)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool rai::LedgerCounters::operator!=(const rai::LedgerCounters& other) const
+{
+    return !(*this == other);
+}
+
+rai::RetentionPolicy::RetentionPolicy() : max_age_(0), max_per_account_(0)
+{
+}
+
+rai::RetentionPolicy::RetentionPolicy(uint64_t max_age,
+                                      uint32_t max_per_account)
+    : max_age_(max_age), max_per_account_(max_per_account)
+{
+}
+
+void rai::TransactionInfo::SerializeJson(
+    rai::Ptree& ptree, const std::chrono::steady_clock::time_point& now) const
+{
+    std::ostringstream thread;
+    thread << thread_;
+    ptree.put("id", std::to_string(id_));
+    ptree.put("site", site_);
+    ptree.put("write", write_ ? "true" : "false");
+    ptree.put("thread", thread.str());
+    ptree.put("age_ms",
+              std::to_string(std::chrono::duration_cast<
+                                 std::chrono::milliseconds>(now - start_)
+                                 .count()));
+}
+
+size_t constexpr rai::TransactionRegistry::SHARDS;
+
+rai::TransactionRegistry::TransactionRegistry() : next_id_(1), reported_(0)
+{
+}
+
+uint64_t rai::TransactionRegistry::Add(const char* site, bool write)
+{
+    rai::TransactionInfo info;
+    info.id_ = next_id_.fetch_add(1, std::memory_order_relaxed);
+    info.site_ = site;
+    info.write_ = write;
+    info.thread_ = std::this_thread::get_id();
+    info.start_ = std::chrono::steady_clock::now();
+    info.reported_ = false;
+
+    Shard& shard = Shard_(info.id_);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    shard.transactions_[info.id_] = info;
+    return info.id_;
+}
+
+void rai::TransactionRegistry::Remove(uint64_t id)
+{
+    Shard& shard = Shard_(id);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    shard.transactions_.erase(id);
+}
+
+void rai::TransactionRegistry::Renew(uint64_t id)
+{
+    auto now = std::chrono::steady_clock::now();
+    Shard& shard = Shard_(id);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto it = shard.transactions_.find(id);
+    if (it != shard.transactions_.end())
+    {
+        it->second.start_ = now;
+        it->second.reported_ = false;
+    }
+}
+
+size_t rai::TransactionRegistry::Size() const
+{
+    size_t size = 0;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        size += shard.transactions_.size();
+    }
+    return size;
+}
+
+uint64_t rai::TransactionRegistry::OldestAge() const
+{
+    auto now = std::chrono::steady_clock::now();
+    auto oldest = now;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        for (const auto& i : shard.transactions_)
+        {
+            if (i.second.start_ < oldest)
+            {
+                oldest = i.second.start_;
+            }
+        }
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - oldest)
+        .count();
+}
+
+std::vector<rai::TransactionInfo> rai::TransactionRegistry::Report(
+    uint64_t age)
+{
+    std::vector<rai::TransactionInfo> result;
+    auto cutoff =
+        std::chrono::steady_clock::now() - std::chrono::milliseconds(age);
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        for (auto& i : shard.transactions_)
+        {
+            if (i.second.reported_ || i.second.start_ > cutoff)
+            {
+                continue;
+            }
+            i.second.reported_ = true;
+            result.push_back(i.second);
+        }
+    }
+    reported_ += result.size();
+    return result;
+}
+
+void rai::TransactionRegistry::Status(rai::Ptree& ptree, bool verbose) const
+{
+    auto now = std::chrono::steady_clock::now();
+    ptree.put("reported", std::to_string(reported_.load()));
+    std::vector<rai::TransactionInfo> transactions = Transactions_();
+    std::sort(transactions.begin(), transactions.end(),
+              [](const rai::TransactionInfo& x,
+                 const rai::TransactionInfo& y) -> bool {
+                  return x.start_ < y.start_;
+              });
+
+    ptree.put("open", std::to_string(transactions.size()));
+    size_t reads = 0;
+    for (const auto& i : transactions)
+    {
+        if (!i.write_)
+        {
+            ++reads;
+        }
+    }
+    ptree.put("open_read", std::to_string(reads));
+
+    if (transactions.empty())
+    {
+        ptree.put("oldest_age_ms", "0");
+        ptree.put("oldest", "");
+    }
+    else
+    {
+        rai::Ptree oldest;
+        transactions.front().SerializeJson(oldest, now);
+        ptree.put("oldest_age_ms", oldest.get<std::string>("age_ms"));
+        ptree.put_child("oldest", oldest);
+    }
+
+    if (!verbose)
+    {
+        return;
+    }
+
+    rai::Ptree transactions_ptree;
+    for (const auto& i : transactions)
+    {
+        rai::Ptree entry;
+        i.SerializeJson(entry, now);
+        transactions_ptree.push_back(std::make_pair("", entry));
+    }
+    ptree.put_child("transactions", transactions_ptree);
+}
+
+rai::TransactionRegistry::Shard& rai::TransactionRegistry::Shard_(uint64_t id)
+{
+    return shards_[id % rai::TransactionRegistry::SHARDS];
+}
+
+std::vector<rai::TransactionInfo> rai::TransactionRegistry::Transactions_()
+    const
+{
+    std::vector<rai::TransactionInfo> result;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        for (const auto& i : shard.transactions_)
+        {
+            result.push_back(i.second);
+        }
+    }
+    return result;
+}
+
 rai::Transaction::Transaction(rai::ErrorCode& error_code, rai::Ledger& ledger,
-                              bool write)
+                              bool write, const char* site)
     : ledger_(ledger),
+      parent_(nullptr),
+      registry_id_(ledger.transaction_registry_.Add(site, write)),
       write_(write),
       aborted_(false),
-      mdb_transaction_(error_code, ledger.store_.env_, nullptr, write)
+      cache_epoch_(ledger.block_cache_.Epoch()),
+      account_info_epoch_(ledger.account_info_cache_.Epoch()),
+      mdb_transaction_(error_code, ledger.store_.env_, nullptr, write),
+      committed_(false),
+      commit_error_(false),
+      blocks_put_(false),
+      swept_rollbacks_(0)
+{
+}
+
+rai::Transaction::Transaction(rai::ErrorCode& error_code,
+                              rai::Transaction& parent)
+    : ledger_(parent.ledger_),
+      parent_(&parent),
+      registry_id_(0),
+      write_(true),
+      aborted_(false),
+      cache_epoch_(parent.cache_epoch_),
+      account_info_epoch_(parent.account_info_epoch_),
+      mdb_transaction_(error_code, parent.ledger_.store_.env_,
+                       parent.mdb_transaction_, true),
+      committed_(false),
+      commit_error_(false),
+      blocks_put_(false),
+      swept_rollbacks_(0)
 {
+    assert(parent.write_);
 }
 
 rai::Transaction::~Transaction()
+{
+    if (parent_ == nullptr)
+    {
+        ledger_.transaction_registry_.Remove(registry_id_);
+    }
+
+    if (!aborted_ && !committed_)
+    {
+        Commit();
+    }
+}
+
+bool rai::Transaction::Commit()
 {
     if (aborted_)
     {
-        return;
+        return true;
+    }
+    if (committed_)
+    {
+        return commit_error_;
+    }
+    committed_ = true;
+
+    if (parent_ != nullptr)
+    {
+        commit_error_ = mdb_transaction_.Commit();
+        if (commit_error_)
+        {
+            rai::Stats::Add(rai::ErrorCode::MDB_TXN_COMMIT,
+                            "Transaction::Commit");
+            return true;
+        }
+        parent_->rep_weight_operations_.insert(
+            parent_->rep_weight_operations_.end(),
+            rep_weight_operations_.begin(), rep_weight_operations_.end());
+        parent_->blocks_put_ = parent_->blocks_put_ || blocks_put_;
+        parent_->blocks_deleted_.insert(parent_->blocks_deleted_.end(),
+                                        blocks_deleted_.begin(),
+                                        blocks_deleted_.end());
+        for (const auto& i : account_info_overlay_)
+        {
+            parent_->account_info_overlay_[i.first] = i.second;
+        }
+        for (const auto& i : counter_deltas_)
+        {
+            auto& delta = parent_->counter_deltas_[i.first];
+            delta.first += i.second.first;
+            delta.second += i.second.second;
+        }
+        parent_->swept_rollbacks_ += swept_rollbacks_;
+        return false;
+    }
+
+    if (!counter_deltas_.empty())
+    {
+        bool error = ledger_.LedgerCountersCommit_(*this);
+        if (error)
+        {
+            rai::Stats::Add(rai::ErrorCode::LEDGER_COUNTERS,
+                            "Transaction::Commit");
+        }
+    }
+
+    if (write_ && ledger_.memory_tables_snapshot_)
+    {
+        ledger_.MemoryTablesCommit_(*this);
+    }
+
+    // readers must not put stale entries back to the caches while the
+    // transaction is being committed
+    bool invalidate_blocks = blocks_put_ || !blocks_deleted_.empty();
+    bool update_account_infos = !account_info_overlay_.empty();
+    if (invalidate_blocks)
+    {
+        ledger_.block_cache_.InvalidateBegin();
     }
+    if (update_account_infos)
+    {
+        ledger_.account_info_cache_.UpdateBegin();
+    }
+    commit_error_ = mdb_transaction_.Commit();
+    if (invalidate_blocks)
+    {
+        for (const auto& block : blocks_deleted_)
+        {
+            ledger_.block_cache_.Invalidate(*block);
+        }
+        ledger_.block_cache_.InvalidateEnd();
+    }
+    if (update_account_infos)
+    {
+        // after a failed commit the entries are dropped, the store still
+        // holds the previous infos
+        for (const auto& i : account_info_overlay_)
+        {
+            ledger_.account_info_cache_.Update(
+                i.first, i.second.first && !commit_error_, i.second.second);
+        }
+        ledger_.account_info_cache_.UpdateEnd();
+    }
+    if (commit_error_)
+    {
+        rai::Stats::Add(rai::ErrorCode::MDB_TXN_COMMIT, "Transaction::Commit");
+        return true;
+    }
+
     ledger_.RepWeightsCommit_(rep_weight_operations_);
+    ledger_.swept_rollbacks_ += swept_rollbacks_;
+    return false;
 }
 
 void rai::Transaction::Abort()
 {
     aborted_ = true;
+    account_info_overlay_.clear();
+    counter_deltas_.clear();
     mdb_transaction_.Abort();
 }
 
+rai::ErrorCode rai::Transaction::Renew()
+{
+    if (write_ || aborted_)
+    {
+        return rai::ErrorCode::MDB_TXN_BEGIN;
+    }
+
+    uint64_t cache_epoch = ledger_.block_cache_.Epoch();
+    uint64_t account_info_epoch = ledger_.account_info_cache_.Epoch();
+    bool error = mdb_transaction_.Renew();
+    IF_ERROR_RETURN(error, rai::ErrorCode::MDB_TXN_BEGIN);
+    cache_epoch_ = cache_epoch;
+    account_info_epoch_ = account_info_epoch;
+    ledger_.transaction_registry_.Renew(registry_id_);
+    return rai::ErrorCode::SUCCESS;
+}
+
 rai::Iterator::Iterator() : store_it_(nullptr)
 {
 }
@@ -66,6 +513,140 @@ bool rai::Iterator::operator!=(const rai::Iterator& other) const
     return store_it_ != other.store_it_;
 }
 
+rai::AccountInfoCache::AccountInfoCache(size_t size)
+    : shard_size_(std::max<size_t>(1, size / rai::AccountInfoCache::SHARDS)),
+      epoch_(0),
+      hits_(0),
+      misses_(0)
+{
+}
+
+bool rai::AccountInfoCache::Get(uint64_t epoch, const rai::Account& account,
+                                rai::AccountInfo& info)
+{
+    if (!Usable_(epoch))
+    {
+        return true;
+    }
+
+    Shard& shard = Shard_(account);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto& index = shard.entries_.get<1>();
+    auto it = index.find(account);
+    if (it == index.end())
+    {
+        ++misses_;
+        return true;
+    }
+
+    shard.entries_.relocate(shard.entries_.begin(),
+                            shard.entries_.project<0>(it));
+    info = it->info_;
+    ++hits_;
+    return false;
+}
+
+void rai::AccountInfoCache::Put(uint64_t epoch, const rai::Account& account,
+                                const rai::AccountInfo& info)
+{
+    Shard& shard = Shard_(account);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    if (!Usable_(epoch))
+    {
+        return;
+    }
+
+    auto ret = shard.entries_.push_front(
+        rai::AccountInfoCacheEntry{account, info});
+    if (!ret.second)
+    {
+        shard.entries_.relocate(shard.entries_.begin(), ret.first);
+    }
+    while (shard.entries_.size() > shard_size_)
+    {
+        shard.entries_.pop_back();
+    }
+}
+
+uint64_t rai::AccountInfoCache::Epoch() const
+{
+    return epoch_;
+}
+
+void rai::AccountInfoCache::UpdateBegin()
+{
+    ++epoch_;
+}
+
+void rai::AccountInfoCache::Update(const rai::Account& account, bool exists,
+                                   const rai::AccountInfo& info)
+{
+    Shard& shard = Shard_(account);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+    auto& index = shard.entries_.get<1>();
+    auto it = index.find(account);
+    if (!exists)
+    {
+        if (it != index.end())
+        {
+            index.erase(it);
+        }
+        return;
+    }
+
+    if (it != index.end())
+    {
+        index.replace(it, rai::AccountInfoCacheEntry{account, info});
+        shard.entries_.relocate(shard.entries_.begin(),
+                                shard.entries_.project<0>(it));
+        return;
+    }
+
+    shard.entries_.push_front(rai::AccountInfoCacheEntry{account, info});
+    while (shard.entries_.size() > shard_size_)
+    {
+        shard.entries_.pop_back();
+    }
+}
+
+void rai::AccountInfoCache::UpdateEnd()
+{
+    ++epoch_;
+}
+
+void rai::AccountInfoCache::Status(rai::Ptree& status) const
+{
+    size_t size = 0;
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        size += shard.entries_.size();
+    }
+
+    uint64_t hits = hits_;
+    uint64_t misses = misses_;
+    status.put("size", std::to_string(size));
+    status.put("capacity", std::to_string(shard_size_ * SHARDS));
+    status.put("hits", std::to_string(hits));
+    status.put("misses", std::to_string(misses));
+    status.put("hit_rate_percent",
+               std::to_string(hits + misses == 0
+                                  ? 0
+                                  : hits * 100 / (hits + misses)));
+}
+
+bool rai::AccountInfoCache::Usable_(uint64_t epoch) const
+{
+    // an odd epoch means a transaction is being committed
+    return epoch % 2 == 0 && epoch == epoch_;
+}
+
+rai::AccountInfoCache::Shard& rai::AccountInfoCache::Shard_(
+    const rai::Account& account)
+{
+    return shards_[account.bytes[0] % rai::AccountInfoCache::SHARDS];
+}
+
 rai::AccountInfo::AccountInfo()
     : type_(rai::BlockType::INVALID),
       forks_(0),
@@ -296,6 +877,12 @@ bool rai::BindingKey::Deserialize(rai::Stream& stream)
     return false;
 }
 
+bool rai::BindingKey::operator==(const rai::BindingKey& other) const
+{
+    return account_ == other.account_ && chain_ == other.chain_
+           && height_ == other.height_;
+}
+
 rai::TokenKey::TokenKey() : chain_(rai::Chain::INVALID), address_(0)
 {
 }
@@ -2237,18 +2824,49 @@ bool rai::RewardableInfo::Deserialize(rai::Stream& stream)
     return false;
 }
 
-rai::WalletInfo::WalletInfo()
-    : version_(0), index_(0), salt_(0), key_(0), seed_(0), check_(0)
+rai::AccountDelegation::AccountDelegation()
+    : type_(rai::BlockType::INVALID), representative_(0), balance_(0)
 {
 }
 
-void rai::WalletInfo::Serialize(rai::Stream& stream) const
+rai::AccountDelegation::AccountDelegation(rai::BlockType type,
+                                          const rai::Account& representative,
+                                          const rai::Amount& balance)
+    : type_(type), representative_(representative), balance_(balance)
 {
-    rai::Write(stream, version_);
-    rai::Write(stream, index_);
-    rai::Write(stream, selected_account_id_);
-    rai::Write(stream, salt_.bytes);
-    rai::Write(stream, key_.bytes);
+}
+
+void rai::AccountDelegation::Serialize(rai::Stream& stream) const
+{
+    rai::Write(stream, type_);
+    rai::Write(stream, representative_.bytes);
+    rai::Write(stream, balance_.bytes);
+}
+
+bool rai::AccountDelegation::Deserialize(rai::Stream& stream)
+{
+    bool error = false;
+    error = rai::Read(stream, type_);
+    IF_ERROR_RETURN(error, true);
+    error = rai::Read(stream, representative_.bytes);
+    IF_ERROR_RETURN(error, true);
+    error = rai::Read(stream, balance_.bytes);
+    IF_ERROR_RETURN(error, true);
+    return false;
+}
+
+rai::WalletInfo::WalletInfo()
+    : version_(0), index_(0), salt_(0), key_(0), seed_(0), check_(0)
+{
+}
+
+void rai::WalletInfo::Serialize(rai::Stream& stream) const
+{
+    rai::Write(stream, version_);
+    rai::Write(stream, index_);
+    rai::Write(stream, selected_account_id_);
+    rai::Write(stream, salt_.bytes);
+    rai::Write(stream, key_.bytes);
     rai::Write(stream, seed_.bytes);
     rai::Write(stream, check_.bytes);
 }
@@ -2294,30 +2912,67 @@ bool rai::WalletAccountInfo::Deserialize(rai::Stream& stream)
 
 rai::Ledger::Ledger(rai::ErrorCode& error_code, rai::Store& store,
                     rai::LedgerType type, bool enable_rich_list,
-                    bool enable_delegator_list)
+                    bool enable_delegator_list,
+                    size_t account_info_cache_size, bool dense_block_index)
     : store_(store),
       total_rep_weight_(0),
       enable_rich_list_(enable_rich_list),
-      enable_delegator_list_(enable_delegator_list)
+      enable_delegator_list_(enable_delegator_list),
+      block_cache_(rai::Ledger::BLOCK_CACHE_SIZE),
+      account_info_cache_(account_info_cache_size),
+      dense_block_index_(type == rai::LedgerType::NODE && dense_block_index),
+      block_index_migrated_(false),
+      memory_tables_snapshot_(type == rai::LedgerType::NODE),
+      memory_tables_synced_(false),
+      receivables_indexed_(type == rai::LedgerType::NODE),
+      counters_enabled_(type == rai::LedgerType::NODE),
+      pruned_blocks_(0),
+      pruned_pages_(0),
+      prune_passes_(0),
+      retention_indexed_(type == rai::LedgerType::NODE),
+      swept_rollbacks_(0),
+      swept_forks_(0),
+      sweep_passes_(0),
+      sweep_start_(std::chrono::steady_clock::now()),
+      reader_checks_(0),
+      stale_readers_(0)
 {
     IF_NOT_SUCCESS_RETURN_VOID(error_code);
-    rai::Transaction transaction(error_code, *this, true);
-    IF_NOT_SUCCESS_RETURN_VOID(error_code);
-    if (type == rai::LedgerType::NODE)
-    {
-        InitMemoryTables_(transaction);
-    }
-    else if (type == rai::LedgerType::WALLET)
-    {
-        error_code = UpgradeWallet(transaction);
-    }
-    else
+    bool scan = false;
     {
+        rai::Transaction transaction(error_code, *this, true);
+        IF_NOT_SUCCESS_RETURN_VOID(error_code);
+        if (type == rai::LedgerType::NODE)
+        {
+            error_code = UpgradeNode(transaction);
+            if (error_code == rai::ErrorCode::SUCCESS)
+            {
+                scan = InitMemoryTables_(transaction);
+            }
+        }
+        else if (type == rai::LedgerType::WALLET)
+        {
+            error_code = UpgradeWallet(transaction);
+        }
+        else
+        {
+        }
+
+        if (error_code != rai::ErrorCode::SUCCESS)
+        {
+            transaction.Abort();
+        }
     }
 
-    if (error_code != rai::ErrorCode::SUCCESS)
+    // the shards of the scan only see committed data, so it must not start
+    // before the upgrades above are committed
+    if (scan)
     {
-        transaction.Abort();
+        rai::ErrorCode error_code_l = ScanMemoryTables_();
+        if (error_code_l != rai::ErrorCode::SUCCESS)
+        {
+            rai::Stats::Add(error_code_l, "Ledger::Ledger");
+        }
     }
 }
 
@@ -2335,12 +2990,35 @@ bool rai::Ledger::AccountInfoPut(rai::Transaction& transaction,
         rai::VectorStream stream(bytes);
         account_info.Serialize(stream);
     }
+    uint64_t confirmed = 0;
+    if (counters_enabled_)
+    {
+        rai::AccountInfo previous;
+        bool error = AccountInfoGet(transaction, account, previous);
+        confirmed = error ? 0 : ConfirmedBlocks_(previous);
+    }
+
     rai::MdbVal key(account);
     rai::MdbVal value(bytes.size(), bytes.data());
     bool error =
         store_.Put(transaction.mdb_transaction_, store_.accounts_, key, value);
     IF_ERROR_RETURN(error, error);
 
+    if (counters_enabled_)
+    {
+        uint64_t confirmed_new = ConfirmedBlocks_(account_info);
+        if (confirmed_new != confirmed)
+        {
+            bool add = confirmed_new > confirmed;
+            LedgerCounterAdd_(
+                transaction, rai::LedgerCounterType::CONFIRMED_BLOCKS, 0,
+                add ? confirmed_new - confirmed : confirmed - confirmed_new,
+                add);
+        }
+    }
+
+    transaction.account_info_overlay_[account] =
+        std::make_pair(true, account_info);
     return false;
 }
 
@@ -2348,6 +3026,21 @@ bool rai::Ledger::AccountInfoGet(rai::Transaction& transaction,
                                  const rai::Account& account,
                                  rai::AccountInfo& account_info) const
 {
+    bool exists = false;
+    if (!AccountInfoOverlayGet_(transaction, account, exists, account_info))
+    {
+        return !exists;
+    }
+
+    // no other transaction can commit while a write transaction is open, so
+    // the cache always matches the snapshot of the write transaction
+    uint64_t epoch = transaction.write_ ? account_info_cache_.Epoch()
+                                        : transaction.account_info_epoch_;
+    if (!account_info_cache_.Get(epoch, account, account_info))
+    {
+        return false;
+    }
+
     rai::MdbVal key(account);
     rai::MdbVal value;
     bool error =
@@ -2357,7 +3050,50 @@ bool rai::Ledger::AccountInfoGet(rai::Transaction& transaction,
         return true;
     }
     rai::BufferStream stream(value.Data(), value.Size());
-    return account_info.Deserialize(stream);
+    error = account_info.Deserialize(stream);
+    IF_ERROR_RETURN(error, error);
+
+    account_info_cache_.Put(epoch, account, account_info);
+    return false;
+}
+
+bool rai::Ledger::AccountInfoGetMany(
+    rai::Transaction& transaction, const std::vector<rai::Account>& accounts,
+    std::vector<rai::AccountInfo>& infos) const
+{
+    infos.clear();
+    infos.resize(accounts.size());
+
+    uint64_t epoch = transaction.write_ ? account_info_cache_.Epoch()
+                                        : transaction.account_info_epoch_;
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < accounts.size(); ++i)
+    {
+        bool exists = false;
+        if (!AccountInfoOverlayGet_(transaction, accounts[i], exists,
+                                    infos[i]))
+        {
+            continue;
+        }
+        if (!account_info_cache_.Get(epoch, accounts[i], infos[i]))
+        {
+            continue;
+        }
+        positions.push_back(i);
+    }
+
+    std::vector<rai::MdbVal> keys;
+    SortKeys(accounts, positions, keys);
+    return store_.GetMany(
+        transaction.mdb_transaction_, store_.accounts_, keys,
+        [&](size_t index, const rai::MdbVal& value) -> bool {
+            size_t i = positions[index];
+            rai::BufferStream stream(value.Data(), value.Size());
+            bool error = infos[i].Deserialize(stream);
+            IF_ERROR_RETURN(error, error);
+            account_info_cache_.Put(epoch, accounts[i], infos[i]);
+            return false;
+        });
 }
 
 bool rai::Ledger::AccountInfoGet(const rai::Iterator& it, rai::Account& account,
@@ -2388,9 +3124,29 @@ bool rai::Ledger::AccountInfoDel(rai::Transaction& transaction,
         return true;
     }
 
+    rai::AccountInfo previous;
+    if (counters_enabled_)
+    {
+        bool error = AccountInfoGet(transaction, account, previous);
+        IF_ERROR_RETURN(error, error);
+    }
+
     rai::MdbVal key(account);
-    return store_.Del(transaction.mdb_transaction_, store_.accounts_, key,
-                      nullptr);
+    bool error = store_.Del(transaction.mdb_transaction_, store_.accounts_,
+                            key, nullptr);
+    IF_ERROR_RETURN(error, error);
+
+    uint64_t confirmed = ConfirmedBlocks_(previous);
+    if (counters_enabled_ && confirmed > 0)
+    {
+        LedgerCounterAdd_(transaction,
+                          rai::LedgerCounterType::CONFIRMED_BLOCKS, 0,
+                          confirmed, false);
+    }
+
+    transaction.account_info_overlay_[account] =
+        std::make_pair(false, rai::AccountInfo());
+    return false;
 }
 
 rai::Iterator rai::Ledger::AccountInfoBegin(rai::Transaction& transaction)
@@ -2409,8 +3165,9 @@ bool rai::Ledger::AccountCount(rai::Transaction& transaction,
                                size_t& count) const
 {
     MDB_stat stat;
-    auto ret = mdb_stat(transaction.mdb_transaction_, store_.accounts_, &stat);
-    if (ret != MDB_SUCCESS)
+    bool error =
+        store_.Stat(transaction.mdb_transaction_, store_.accounts_, stat);
+    if (error)
     {
         assert(0);
         return true;
@@ -2980,7 +3737,13 @@ rai::Iterator rai::Ledger::BindingLowerBound(rai::Transaction& transaction,
                                              rai::Chain chain) const
 {
     uint64_t height = std::numeric_limits<uint64_t>::max();
-    rai::BindingKey binding_key(account, chain, height);
+    return BindingLowerBound(transaction,
+                             rai::BindingKey(account, chain, height));
+}
+
+rai::Iterator rai::Ledger::BindingLowerBound(
+    rai::Transaction& transaction, const rai::BindingKey& binding_key) const
+{
     std::vector<uint8_t> bytes_key;
     {
         rai::VectorStream stream(bytes_key);
@@ -3126,14 +3889,21 @@ bool rai::Ledger::AccountTokenInfoGet(const rai::Iterator& it,
 
 rai::Iterator rai::Ledger::AccountTokenInfoLowerBound(
     rai::Transaction& transaction, const rai::Account& account) const
+{
+    return AccountTokenInfoLowerBound(transaction, account,
+                                      static_cast<rai::Chain>(0),
+                                      rai::TokenAddress(0));
+}
+
+rai::Iterator rai::Ledger::AccountTokenInfoLowerBound(
+    rai::Transaction& transaction, const rai::Account& account,
+    rai::Chain chain, const rai::TokenAddress& address) const
 {
     std::vector<uint8_t> bytes_key;
     {
         rai::VectorStream stream(bytes_key);
         rai::Write(stream, account.bytes);
-        uint32_t chain = 0;
         rai::Write(stream, chain);
-        rai::TokenAddress address(0);
         rai::Write(stream, address.bytes);
     }
     rai::MdbVal key(bytes_key.size(), bytes_key.data());
@@ -4524,9 +5294,9 @@ rai::Iterator rai::Ledger::OrderIndexLowerBound(
 bool rai::Ledger::OrderCount(rai::Transaction& transaction, size_t& count) const
 {
     MDB_stat stat;
-    auto ret =
-        mdb_stat(transaction.mdb_transaction_, store_.order_info_, &stat);
-    if (ret != MDB_SUCCESS)
+    bool error =
+        store_.Stat(transaction.mdb_transaction_, store_.order_info_, stat);
+    if (error)
     {
         return true;
     }
@@ -5288,8 +6058,14 @@ bool rai::Ledger::BlockPut(rai::Transaction& transaction,
     bool error =
         store_.Put(transaction.mdb_transaction_, store_.blocks_, key, value);
     IF_ERROR_RETURN(error, error);
+    transaction.blocks_put_ = true;
+    if (counters_enabled_)
+    {
+        LedgerCountersBlock_(transaction, block, true);
+    }
 
-    if (block.Height() % rai::Ledger::BLOCKS_PER_INDEX == 0)
+    if (dense_block_index_
+        || block.Height() % rai::Ledger::BLOCKS_PER_INDEX == 0)
     {
         error = BlockIndexPut_(transaction, block.Account(), block.Height(),
                                block.Hash());
@@ -5303,6 +6079,13 @@ bool rai::Ledger::BlockGet(rai::Transaction& transaction,
                            const rai::BlockHash& hash,
                            std::shared_ptr<rai::Block>& block) const
 {
+    // write transactions may see uncommitted blocks, bypass the cache
+    if (!transaction.write_
+        && !block_cache_.Get(transaction.cache_epoch_, hash, block))
+    {
+        return false;
+    }
+
     rai::MdbVal key(hash);
     rai::MdbVal value;
     bool error =
@@ -5311,12 +6094,18 @@ bool rai::Ledger::BlockGet(rai::Transaction& transaction,
 
     rai::BufferStream stream(value.Data(), value.Size());
     rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-    block = rai::DeserializeBlockUnverify(error_code, stream);
+    std::shared_ptr<rai::Block> block_l =
+        rai::DeserializeBlockUnverify(error_code, stream);
     if (error_code != rai::ErrorCode::SUCCESS)
     {
         return true;
     }
 
+    if (!transaction.write_)
+    {
+        block_cache_.Put(transaction.cache_epoch_, block_l);
+    }
+    block = block_l;
     return false;
 }
 
@@ -5348,8 +6137,31 @@ bool rai::Ledger::BlockGet(rai::Transaction& transaction,
                            const rai::Account& account, uint64_t height,
                            std::shared_ptr<rai::Block>& block) const
 {
+    if (!transaction.write_
+        && !block_cache_.Get(transaction.cache_epoch_, account, height, block))
+    {
+        return false;
+    }
+
+    rai::BlockHash hash;
+    bool error = BlockIndexGet_(transaction, account, height, hash);
+    if (!error)
+    {
+        error = BlockGet(transaction, hash, block);
+        // entries left from a run with the dense index may point at blocks
+        // rolled back since, the sparse walk below still finds the height
+        if (!error || block_index_migrated_)
+        {
+            return error;
+        }
+    }
+    if (block_index_migrated_)
+    {
+        return true;
+    }
+
     rai::AccountInfo info;
-    bool error = AccountInfoGet(transaction, account, info);
+    error = AccountInfoGet(transaction, account, info);
     IF_ERROR_RETURN(error, error);
 
     if (height < info.tail_height_ || height > info.head_height_)
@@ -5387,6 +6199,10 @@ bool rai::Ledger::BlockGet(rai::Transaction& transaction,
             IF_ERROR_RETURN(error, true);
             if (height == block_l->Height() && account == block_l->Account())
             {
+                if (!transaction.write_)
+                {
+                    block_cache_.Put(transaction.cache_epoch_, block_l);
+                }
                 block = block_l;
                 return false;
             }
@@ -5410,6 +6226,10 @@ bool rai::Ledger::BlockGet(rai::Transaction& transaction,
             IF_ERROR_RETURN(error, error);
             if (height == block_l->Height() && account == block_l->Account())
             {
+                if (!transaction.write_)
+                {
+                    block_cache_.Put(transaction.cache_epoch_, block_l);
+                }
                 block = block_l;
                 return false;
             }
@@ -5426,8 +6246,23 @@ bool rai::Ledger::BlockGet(rai::Transaction& transaction,
                            std::shared_ptr<rai::Block>& block,
                            rai::BlockHash& successor) const
 {
+    rai::BlockHash hash;
+    bool error = BlockIndexGet_(transaction, account, height, hash);
+    if (!error)
+    {
+        error = BlockGet(transaction, hash, block, successor);
+        if (!error || block_index_migrated_)
+        {
+            return error;
+        }
+    }
+    if (block_index_migrated_)
+    {
+        return true;
+    }
+
     rai::AccountInfo info;
-    bool error = AccountInfoGet(transaction, account, info);
+    error = AccountInfoGet(transaction, account, info);
     IF_ERROR_RETURN(error, error);
 
     if (height < info.tail_height_ || height > info.head_height_)
@@ -5512,22 +6347,133 @@ bool rai::Ledger::BlockDel(rai::Transaction& transaction,
     std::shared_ptr<rai::Block> block(nullptr);
     bool error = BlockGet(transaction, hash, block);
     IF_ERROR_RETURN(error, error);
-    if (block->Height() % rai::Ledger::BLOCKS_PER_INDEX == 0)
+    if (dense_block_index_
+        || block->Height() % rai::Ledger::BLOCKS_PER_INDEX == 0)
     {
         error = BlockIndexDel_(transaction, block->Account(), block->Height());
-        IF_ERROR_RETURN(error, error);
+        // heights not yet visited by the migration have no index entry
+        if (error && block->Height() % rai::Ledger::BLOCKS_PER_INDEX == 0)
+        {
+            return true;
+        }
     }
 
     rai::MdbVal key(hash);
-    return store_.Del(transaction.mdb_transaction_, store_.blocks_, key,
-                      nullptr);
+    error = store_.Del(transaction.mdb_transaction_, store_.blocks_, key,
+                       nullptr);
+    IF_ERROR_RETURN(error, error);
+    if (counters_enabled_)
+    {
+        LedgerCountersBlock_(transaction, *block, false);
+    }
+    transaction.blocks_deleted_.push_back(block);
+    return false;
+}
+
+bool rai::Ledger::BlockGetMany(
+    rai::Transaction& transaction, const std::vector<rai::BlockHash>& hashes,
+    std::vector<std::shared_ptr<rai::Block>>& blocks) const
+{
+    blocks.clear();
+    blocks.resize(hashes.size(), nullptr);
+
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        // write transactions may see uncommitted blocks, bypass the cache
+        if (!transaction.write_
+            && !block_cache_.Get(transaction.cache_epoch_, hashes[i],
+                                 blocks[i]))
+        {
+            continue;
+        }
+        positions.push_back(i);
+    }
+
+    std::vector<rai::MdbVal> keys;
+    SortKeys(hashes, positions, keys);
+    return store_.GetMany(
+        transaction.mdb_transaction_, store_.blocks_, keys,
+        [&](size_t index, const rai::MdbVal& value) -> bool {
+            rai::BufferStream stream(value.Data(), value.Size());
+            rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+            std::shared_ptr<rai::Block> block =
+                rai::DeserializeBlockUnverify(error_code, stream);
+            if (error_code != rai::ErrorCode::SUCCESS)
+            {
+                return true;
+            }
+            if (!transaction.write_)
+            {
+                block_cache_.Put(transaction.cache_epoch_, block);
+            }
+            blocks[positions[index]] = block;
+            return false;
+        });
+}
+
+bool rai::Ledger::BlockViewGet(rai::Transaction& transaction,
+                               const rai::BlockHash& hash,
+                               rai::BlockView& view) const
+{
+    rai::BlockHash successor;
+    return BlockViewGet(transaction, hash, view, successor);
+}
+
+bool rai::Ledger::BlockViewGet(rai::Transaction& transaction,
+                               const rai::BlockHash& hash,
+                               rai::BlockView& view,
+                               rai::BlockHash& successor) const
+{
+    // the view points into the memory map, it is only valid until the end of
+    // the transaction or the next write in it
+    rai::MdbVal key(hash);
+    rai::MdbVal value;
+    bool error =
+        store_.Get(transaction.mdb_transaction_, store_.blocks_, key, value);
+    IF_ERROR_RETURN(error, error);
+
+    error = view.Parse(value.Data(), value.Size());
+    IF_ERROR_RETURN(error, error);
+
+    rai::BufferStream stream(view.Data() + view.Size(),
+                             value.Size() - view.Size());
+    return rai::Read(stream, successor.bytes);
+}
+
+bool rai::Ledger::BlocksRange(
+    rai::Transaction& transaction, const rai::Account& account, uint64_t height,
+    uint64_t count, std::vector<std::shared_ptr<rai::Block>>& blocks) const
+{
+    blocks.clear();
+    if (count == 0)
+    {
+        return false;
+    }
+
+    std::shared_ptr<rai::Block> block(nullptr);
+    rai::BlockHash successor;
+    bool error = BlockGet(transaction, account, height, block, successor);
+    IF_ERROR_RETURN(error, error);
+    blocks.push_back(block);
+
+    // follow the successor links instead of looking up the index per height
+    while (blocks.size() < count && !successor.IsZero())
+    {
+        error = BlockGet(transaction, successor, block, successor);
+        IF_ERROR_RETURN(error, error);
+        blocks.push_back(block);
+    }
+
+    return false;
 }
 
 bool rai::Ledger::BlockCount(rai::Transaction& transaction, size_t& count) const
 {
     MDB_stat stat;
-    auto ret = mdb_stat(transaction.mdb_transaction_, store_.blocks_, &stat);
-    if (ret != MDB_SUCCESS)
+    bool error =
+        store_.Stat(transaction.mdb_transaction_, store_.blocks_, stat);
+    if (error)
     {
         assert(0);
         return true;
@@ -5594,8 +6540,9 @@ bool rai::Ledger::BlockSuccessorGet(rai::Transaction& transaction,
 bool rai::Ledger::Empty(rai::Transaction& transaction) const
 {
     MDB_stat stat;
-    auto ret = mdb_stat(transaction.mdb_transaction_, store_.accounts_, &stat);
-    if (ret != MDB_SUCCESS)
+    bool error =
+        store_.Stat(transaction.mdb_transaction_, store_.accounts_, stat);
+    if (error)
     {
         assert(0);
         return false;
@@ -5605,8 +6552,8 @@ bool rai::Ledger::Empty(rai::Transaction& transaction) const
         return false;
     }
 
-    ret = mdb_stat(transaction.mdb_transaction_, store_.blocks_, &stat);
-    if (ret != MDB_SUCCESS)
+    error = store_.Stat(transaction.mdb_transaction_, store_.blocks_, stat);
+    if (error)
     {
         assert(0);
         return false;
@@ -5634,11 +6581,27 @@ bool rai::Ledger::ForkPut(rai::Transaction& transaction,
         rai::Write(stream, account.bytes);
         rai::Write(stream, height);
     }
+    uint64_t timestamp = rai::CurrentTimestamp();
     std::vector<uint8_t> bytes_value;
     {
         rai::VectorStream stream(bytes_value);
         first.Serialize(stream);
         second.Serialize(stream);
+        rai::Write(stream, timestamp);
+    }
+
+    // a fork at the same height is replaced
+    bool exists = (counters_enabled_ || retention_indexed_)
+                  && ForkExists(transaction, account, height);
+    if (retention_indexed_ && exists)
+    {
+        uint64_t previous = 0;
+        if (!ForkTimestamp_(transaction, account, height, previous))
+        {
+            bool error =
+                ForkExpiryDel_(transaction, account, height, previous);
+            IF_ERROR_RETURN(error, error);
+        }
     }
 
     rai::MdbVal key(bytes_key.size(), bytes_key.data());
@@ -5647,6 +6610,18 @@ bool rai::Ledger::ForkPut(rai::Transaction& transaction,
         store_.Put(transaction.mdb_transaction_, store_.forks_, key, value);
     IF_ERROR_RETURN(error, error);
 
+    if (retention_indexed_)
+    {
+        error = ForkExpiryPut_(transaction, account, height, timestamp);
+        IF_ERROR_RETURN(error, error);
+    }
+
+    if (counters_enabled_ && !exists)
+    {
+        LedgerCounterAdd_(transaction, rai::LedgerCounterType::FORKS, 0, 1,
+                          true);
+    }
+
     return false;
 }
 
@@ -5756,9 +6731,28 @@ bool rai::Ledger::ForkDel(rai::Transaction& transaction,
         rai::Write(stream, account.bytes);
         rai::Write(stream, height);
     }
+    // forks stored before the ledger upgrade carry no timestamp
+    uint64_t timestamp = 0;
+    bool indexed = retention_indexed_
+                   && !ForkTimestamp_(transaction, account, height, timestamp);
+
     rai::MdbVal key(bytes_key.size(), bytes_key.data());
-    return store_.Del(transaction.mdb_transaction_, store_.forks_, key,
-                      nullptr);
+    bool error =
+        store_.Del(transaction.mdb_transaction_, store_.forks_, key, nullptr);
+    IF_ERROR_RETURN(error, error);
+
+    if (indexed)
+    {
+        error = ForkExpiryDel_(transaction, account, height, timestamp);
+        IF_ERROR_RETURN(error, error);
+    }
+
+    if (counters_enabled_)
+    {
+        LedgerCounterAdd_(transaction, rai::LedgerCounterType::FORKS, 0, 1,
+                          false);
+    }
+    return false;
 }
 
 bool rai::Ledger::ForkExists(rai::Transaction& transaction,
@@ -5886,6 +6880,21 @@ bool rai::Ledger::ReceivableInfoPut(rai::Transaction& transaction,
                             key, value);
     IF_ERROR_RETURN(error, error);
 
+    if (receivables_indexed_)
+    {
+        error = ReceivableIndexPut_(transaction, destination, hash, info);
+        IF_ERROR_RETURN(error, error);
+    }
+
+    if (counters_enabled_)
+    {
+        LedgerCounterAdd_(transaction, rai::LedgerCounterType::RECEIVABLES, 0,
+                          1, true);
+        LedgerCounterAdd_(transaction,
+                          rai::LedgerCounterType::RECEIVABLE_AMOUNT, 0,
+                          info.amount_.Number(), true);
+    }
+
     return false;
 }
 
@@ -5962,6 +6971,35 @@ bool rai::Ledger::ReceivableInfosGet(rai::Transaction& transaction,
                                      rai::ReceivableInfosAll& receivables,
                                      size_t max_size)
 {
+    if (receivables_indexed_ && type != rai::ReceivableInfosType::ALL)
+    {
+        // the confirmation state is part of the index key
+        rai::StoreIterator store_i(transaction.mdb_transaction_,
+                                   store_.receivables_index_);
+        rai::Iterator i(std::move(store_i));
+        rai::Iterator n(rai::StoreIterator(nullptr));
+        for (; i != n; ++i)
+        {
+            rai::Account account;
+            rai::ReceivableInfosType type_l;
+            rai::BlockHash hash;
+            rai::ReceivableInfo info;
+            bool error = ReceivableIndexGet(i, account, type_l, hash, info);
+            IF_ERROR_RETURN(error, true);
+            if (type_l != type)
+            {
+                continue;
+            }
+
+            receivables.emplace(info, std::make_pair(account, hash));
+            if (receivables.size() > max_size)
+            {
+                receivables.erase(std::prev(receivables.end()));
+            }
+        }
+        return false;
+    }
+
     rai::StoreIterator store_i(transaction.mdb_transaction_,
                                store_.receivables_);
     rai::Iterator i(std::move(store_i));
@@ -6028,16 +7066,58 @@ bool rai::Ledger::ReceivableInfosGet(rai::Transaction& transaction,
                                      rai::ReceivableInfos& receivables,
                                      size_t max_size, size_t max_search)
 {
-    size_t count = 0;
-    rai::Iterator i = ReceivableInfoLowerBound(transaction, account);
-    rai::Iterator n = ReceivableInfoUpperBound(transaction, account);
-    for (; i != n; ++i)
+    if (receivables_indexed_)
     {
-        if (count >= max_search)
+        // each state range is ordered by amount, the top entries come first
+        std::vector<rai::ReceivableInfosType> types;
+        if (type == rai::ReceivableInfosType::ALL)
         {
-            break;
+            types = {rai::ReceivableInfosType::CONFIRMED,
+                     rai::ReceivableInfosType::NOT_CONFIRMED};
         }
-        ++count;
+        else
+        {
+            types = {type};
+        }
+
+        for (auto type_l : types)
+        {
+            size_t count = 0;
+            rai::Iterator i =
+                ReceivableIndexLowerBound(transaction, account, type_l);
+            rai::Iterator n =
+                ReceivableIndexUpperBound(transaction, account, type_l);
+            for (; i != n && count < max_size && count < max_search; ++i)
+            {
+                ++count;
+                rai::Account ignore;
+                rai::ReceivableInfosType ignore_type;
+                rai::BlockHash hash;
+                rai::ReceivableInfo info;
+                bool error =
+                    ReceivableIndexGet(i, ignore, ignore_type, hash, info);
+                IF_ERROR_RETURN(error, true);
+                receivables.emplace(info, hash);
+            }
+        }
+
+        while (receivables.size() > max_size)
+        {
+            receivables.erase(std::prev(receivables.end()));
+        }
+        return false;
+    }
+
+    size_t count = 0;
+    rai::Iterator i = ReceivableInfoLowerBound(transaction, account);
+    rai::Iterator n = ReceivableInfoUpperBound(transaction, account);
+    for (; i != n; ++i)
+    {
+        if (count >= max_search)
+        {
+            break;
+        }
+        ++count;
 
         rai::Account ignore;
         rai::BlockHash hash;
@@ -6102,6 +7182,19 @@ bool rai::Ledger::ReceivableInfoDel(rai::Transaction& transaction,
         return true;
     }
 
+    rai::ReceivableInfo info;
+    if (receivables_indexed_ || counters_enabled_)
+    {
+        bool error = ReceivableInfoGet(transaction, destination, hash, info);
+        IF_ERROR_RETURN(error, error);
+    }
+
+    if (receivables_indexed_)
+    {
+        bool error = ReceivableIndexDel_(transaction, destination, hash, info);
+        IF_ERROR_RETURN(error, error);
+    }
+
     std::vector<uint8_t> bytes_key;
     {
         rai::VectorStream stream(bytes_key);
@@ -6109,17 +7202,28 @@ bool rai::Ledger::ReceivableInfoDel(rai::Transaction& transaction,
         rai::Write(stream, hash.bytes);
     }
     rai::MdbVal key(bytes_key.size(), bytes_key.data());
-    return store_.Del(transaction.mdb_transaction_, store_.receivables_, key,
-                      nullptr);
+    bool error = store_.Del(transaction.mdb_transaction_, store_.receivables_,
+                            key, nullptr);
+    IF_ERROR_RETURN(error, error);
+
+    if (counters_enabled_)
+    {
+        LedgerCounterAdd_(transaction, rai::LedgerCounterType::RECEIVABLES, 0,
+                          1, false);
+        LedgerCounterAdd_(transaction,
+                          rai::LedgerCounterType::RECEIVABLE_AMOUNT, 0,
+                          info.amount_.Number(), false);
+    }
+    return false;
 }
 
 bool rai::Ledger::ReceivableInfoCount(rai::Transaction& transaction,
                                       size_t& count) const
 {
     MDB_stat stat;
-    auto ret =
-        mdb_stat(transaction.mdb_transaction_, store_.receivables_, &stat);
-    if (ret != MDB_SUCCESS)
+    bool error =
+        store_.Stat(transaction.mdb_transaction_, store_.receivables_, stat);
+    if (error)
     {
         assert(0);
         return true;
@@ -6161,6 +7265,157 @@ rai::Iterator rai::Ledger::ReceivableInfoUpperBound(
     return rai::Iterator(std::move(store_it));
 }
 
+bool rai::Ledger::ReceivableIndexGet(const rai::Iterator& it,
+                                     rai::Account& destination,
+                                     rai::ReceivableInfosType& type,
+                                     rai::BlockHash& hash,
+                                     rai::ReceivableInfo& info) const
+{
+    auto data = it.store_it_->first.Data();
+    auto size = it.store_it_->first.Size();
+    if (data == nullptr || size == 0)
+    {
+        return true;
+    }
+    rai::BufferStream stream_key(data, size);
+    bool error = rai::Read(stream_key, destination.bytes);
+    IF_ERROR_RETURN(error, true);
+    uint8_t type_l;
+    error = rai::Read(stream_key, type_l);
+    IF_ERROR_RETURN(error, true);
+    type = static_cast<rai::ReceivableInfosType>(type_l);
+    rai::Amount ignore;
+    error = rai::Read(stream_key, ignore.bytes);
+    IF_ERROR_RETURN(error, true);
+    error = rai::Read(stream_key, hash.bytes);
+    IF_ERROR_RETURN(error, true);
+
+    data = it.store_it_->second.Data();
+    size = it.store_it_->second.Size();
+    if (data == nullptr || size == 0)
+    {
+        return true;
+    }
+    rai::BufferStream stream_value(data, size);
+    return info.Deserialize(stream_value);
+}
+
+rai::Iterator rai::Ledger::ReceivableIndexLowerBound(
+    rai::Transaction& transaction, const rai::Account& account,
+    rai::ReceivableInfosType type)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, account.bytes);
+        rai::Write(stream, static_cast<uint8_t>(type));
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    rai::StoreIterator store_it(transaction.mdb_transaction_,
+                                store_.receivables_index_, key);
+    return rai::Iterator(std::move(store_it));
+}
+
+rai::Iterator rai::Ledger::ReceivableIndexUpperBound(
+    rai::Transaction& transaction, const rai::Account& account,
+    rai::ReceivableInfosType type)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, account.bytes);
+        uint8_t next_type = static_cast<uint8_t>(type) + 1;
+        rai::Write(stream, next_type);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    rai::StoreIterator store_it(transaction.mdb_transaction_,
+                                store_.receivables_index_, key);
+    return rai::Iterator(std::move(store_it));
+}
+
+bool rai::Ledger::ReceivablesConfirmedSet(rai::Transaction& transaction,
+                                          const rai::Account& source,
+                                          uint64_t from, uint64_t to,
+                                          bool confirmed)
+{
+    if (!transaction.write_)
+    {
+        return true;
+    }
+
+    if (!receivables_indexed_ || from > to)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, source.bytes);
+        rai::Write(stream, from);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+
+    std::vector<std::pair<rai::Account, rai::BlockHash>> receivables;
+    rai::StoreIterator i(transaction.mdb_transaction_,
+                         store_.receivable_sources_, key);
+    rai::StoreIterator n(nullptr);
+    for (; i != n; ++i)
+    {
+        rai::BufferStream stream_key(i->first.Data(), i->first.Size());
+        rai::Account account;
+        uint64_t height;
+        bool error = rai::Read(stream_key, account.bytes);
+        IF_ERROR_RETURN(error, true);
+        error = rai::Read(stream_key, height);
+        IF_ERROR_RETURN(error, true);
+        if (account != source || height > to)
+        {
+            break;
+        }
+
+        rai::BufferStream stream_value(i->second.Data(), i->second.Size());
+        rai::Account destination;
+        rai::BlockHash hash;
+        error = rai::Read(stream_value, destination.bytes);
+        IF_ERROR_RETURN(error, true);
+        error = rai::Read(stream_value, hash.bytes);
+        IF_ERROR_RETURN(error, true);
+        receivables.emplace_back(destination, hash);
+    }
+
+    rai::ReceivableInfosType from_type =
+        confirmed ? rai::ReceivableInfosType::NOT_CONFIRMED
+                  : rai::ReceivableInfosType::CONFIRMED;
+    rai::ReceivableInfosType to_type =
+        confirmed ? rai::ReceivableInfosType::CONFIRMED
+                  : rai::ReceivableInfosType::NOT_CONFIRMED;
+    for (const auto& receivable : receivables)
+    {
+        rai::ReceivableInfo info;
+        bool error = ReceivableInfoGet(transaction, receivable.first,
+                                       receivable.second, info);
+        if (error)
+        {
+            // already received
+            continue;
+        }
+
+        ReceivableIndexEntryDel_(transaction, receivable.first, from_type,
+                                 receivable.second, info.amount_);
+        error = ReceivableIndexEntryPut_(transaction, receivable.first,
+                                         to_type, receivable.second, info);
+        IF_ERROR_RETURN(error, true);
+    }
+
+    return false;
+}
+
+bool rai::Ledger::ReceivablesIndexed() const
+{
+    return receivables_indexed_;
+}
+
 bool rai::Ledger::RewardableInfoPut(rai::Transaction& transaction,
                                     const rai::Account& representative,
                                     const rai::BlockHash& hash,
@@ -6265,12 +7520,18 @@ bool rai::Ledger::RewardableInfoDel(rai::Transaction& transaction,
 
 rai::Iterator rai::Ledger::RewardableInfoLowerBound(
     rai::Transaction& transaction, const rai::Account& account)
+{
+    return RewardableInfoLowerBound(transaction, account, rai::BlockHash(0));
+}
+
+rai::Iterator rai::Ledger::RewardableInfoLowerBound(
+    rai::Transaction& transaction, const rai::Account& account,
+    const rai::BlockHash& hash)
 {
     std::vector<uint8_t> bytes_key;
     {
         rai::VectorStream stream(bytes_key);
         rai::Write(stream, account.bytes);
-        rai::BlockHash hash(0);
         rai::Write(stream, hash.bytes);
     }
     rai::MdbVal key(bytes_key.size(), bytes_key.data());
@@ -6304,10 +7565,23 @@ bool rai::Ledger::RollbackBlockPut(rai::Transaction& transaction,
         return true;
     }
 
+    if (retention_indexed_)
+    {
+        // a block rolled back again replaces the older entry
+        std::shared_ptr<rai::Block> previous(nullptr);
+        if (!RollbackBlockGet(transaction, hash, previous))
+        {
+            bool error = RollbackBlockDel_(transaction, hash);
+            IF_ERROR_RETURN(error, error);
+        }
+    }
+
+    uint64_t timestamp = rai::CurrentTimestamp();
     std::vector<uint8_t> bytes;
     {
         rai::VectorStream stream(bytes);
         block.Serialize(stream);
+        rai::Write(stream, timestamp);
     }
     rai::MdbVal key(hash);
     rai::MdbVal value(bytes.size(), bytes.data());
@@ -6315,6 +7589,18 @@ bool rai::Ledger::RollbackBlockPut(rai::Transaction& transaction,
         store_.Put(transaction.mdb_transaction_, store_.rollbacks_, key, value);
     IF_ERROR_RETURN(error, error);
 
+    if (retention_indexed_)
+    {
+        error =
+            RollbackExpiryPut_(transaction, hash, block.Account(), timestamp);
+        IF_ERROR_RETURN(error, error);
+
+        size_t removed = 0;
+        error = RollbackAccountLimit_(transaction, block.Account(), removed);
+        IF_ERROR_RETURN(error, error);
+        transaction.swept_rollbacks_ += removed;
+    }
+
     return false;
 }
 
@@ -6899,239 +8185,2065 @@ std::vector<rai::DelegatorListEntry> rai::Ledger::GetDelegatorList(
     return result;
 }
 
-rai::ErrorCode rai::Ledger::UpgradeWallet(rai::Transaction& transaction)
+void rai::Ledger::BlockCacheStatus(rai::Ptree& status) const
 {
-    uint32_t version = 0;
-    bool error = VersionGet(transaction, version);
-    if (error)
+    block_cache_.Status(status);
+}
+
+void rai::Ledger::AccountInfoCacheStatus(rai::Ptree& status) const
+{
+    account_info_cache_.Status(status);
+}
+
+void rai::Ledger::ReadTransactionPoolStatus(rai::Ptree& status) const
+{
+    store_.env_.ReadTransactionPoolStatus(status);
+}
+
+void rai::Ledger::SyncStatus(rai::Ptree& status) const
+{
+    store_.env_.SyncStatus(status);
+}
+
+rai::ErrorCode rai::Ledger::TransactionsCheck(
+    std::vector<rai::TransactionInfo>& long_transactions)
+{
+    ++reader_checks_;
+    int dead = 0;
+    bool error = store_.env_.ReaderCheck(dead);
+    IF_ERROR_RETURN(error, rai::ErrorCode::MDB_READER_CHECK);
+    if (dead > 0)
     {
-        version = 1;
+        stale_readers_ += dead;
+    }
+
+    // lmdb has no way to abort a transaction owned by another thread, so
+    // long transactions are only reported
+    long_transactions = transaction_registry_.Report(
+        rai::Ledger::LONG_TRANSACTION_AGE);
+    for (const auto& i : long_transactions)
+    {
+        rai::Stats::Add(rai::ErrorCode::LONG_TRANSACTION, i.site_);
+    }
+    return rai::ErrorCode::SUCCESS;
+}
+
+void rai::Ledger::TransactionsStatus(rai::Ptree& status, bool verbose) const
+{
+    status.put("long_transaction_age_ms",
+               std::to_string(rai::Ledger::LONG_TRANSACTION_AGE));
+    status.put("reader_checks", std::to_string(reader_checks_.load()));
+    status.put("stale_readers_cleared", std::to_string(stale_readers_.load()));
+    transaction_registry_.Status(status, verbose);
+}
+
+rai::ErrorCode rai::Ledger::MemoryTablesCheckpoint()
+{
+    if (!memory_tables_snapshot_)
+    {
+        return rai::ErrorCode::SUCCESS;
     }
 
     rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
-    switch (version)
+    rai::Transaction transaction(error_code, *this, true);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    error_code = MemoryTablesCheckpoint_(transaction, false);
+    if (error_code != rai::ErrorCode::SUCCESS)
     {
-        case 1:
-        {
-            error_code = UpgradeWalletV1V2(transaction);
-            IF_NOT_SUCCESS_RETURN(error_code);
-        }
-        case 2:
-        {
-            break;
-        }
-        default:
-        {
-            return rai::ErrorCode::LEDGER_UNKNOWN_VERSION;
-        }
+        transaction.Abort();
+    }
+    return error_code;
+}
+
+rai::ErrorCode rai::Ledger::ParallelScan(MDB_dbi dbi, size_t shards,
+                                         const rai::ScanCallback& callback)
+{
+    if (shards == 0 || shards > rai::Ledger::MAX_SCAN_SHARDS)
+    {
+        return rai::ErrorCode::LEDGER_PARALLEL_SCAN;
+    }
+
+    std::atomic<bool> stopped(false);
+    std::vector<rai::ErrorCode> results(shards, rai::ErrorCode::SUCCESS);
+    std::vector<std::thread> threads;
+    for (size_t shard = 0; shard < shards; ++shard)
+    {
+        threads.emplace_back([&, shard]() {
+            results[shard] =
+                ParallelScanShard_(dbi, shard, shards, stopped, callback);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
     }
 
+    for (auto result : results)
+    {
+        IF_NOT_SUCCESS_RETURN(result);
+    }
     return rai::ErrorCode::SUCCESS;
 }
 
-rai::ErrorCode rai::Ledger::UpgradeWalletV1V2(rai::Transaction& transaction)
+size_t rai::Ledger::ParallelScanShards()
 {
-    uint64_t count = 0;
-    for (auto i = AccountInfoBegin(transaction),
-              n = AccountInfoEnd(transaction);
-         i != n; ++i)
+    size_t shards = std::thread::hardware_concurrency();
+    return std::max<size_t>(
+        1, std::min<size_t>(shards, rai::Ledger::MAX_SCAN_SHARDS));
+}
+
+rai::ErrorCode rai::Ledger::BlockIndexMigrate(size_t max_blocks,
+                                              bool& finished)
+{
+    finished = !dense_block_index_ || block_index_migrated_;
+    if (finished)
+    {
+        return rai::ErrorCode::SUCCESS;
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
     {
+        rai::Transaction transaction(error_code, *this, true);
+        IF_NOT_SUCCESS_RETURN(error_code);
+
         rai::Account account;
-        rai::AccountInfo info;
-        bool error = AccountInfoGet(i, account, info);
+        uint64_t height = 0;
+        bool error = BlockIndexMigrationGet_(transaction, account, height);
         if (error)
         {
-            return rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET;
-        }
-
-        if (info.head_height_ == rai::Block::INVALID_HEIGHT)
-        {
-            continue;
+            transaction.Abort();
+            return rai::ErrorCode::LEDGER_BLOCK_INDEX_MIGRATION;
         }
 
-        rai::BlockHash hash(info.head_);
-        while (!hash.IsZero())
+        size_t count = 0;
+        while (count < max_blocks)
         {
-            std::shared_ptr<rai::Block> block(nullptr);
-            error = BlockGet(transaction, hash, block);
+            rai::Account next(account);
+            rai::AccountInfo info;
+            error = NextAccountInfo(transaction, next, info);
             if (error)
             {
-                return rai::ErrorCode::LEDGER_BLOCK_GET;
+                finished = true;
+                break;
+            }
+            if (next != account)
+            {
+                account = next;
+                height = 0;
+            }
+
+            if (info.Valid() && height < info.tail_height_)
+            {
+                height = info.tail_height_;
             }
 
-            if (block->Opcode() == rai::BlockOpcode::RECEIVE)
+            if (info.Valid() && height <= info.head_height_)
             {
-                error = SourcePut(transaction, block->Link());
+                std::shared_ptr<rai::Block> first(nullptr);
+                rai::BlockHash successor;
+                error = BlockGet(transaction, account, height, first,
+                                 successor);
+                rai::BlockHash hash = error ? rai::BlockHash(0) : first->Hash();
+                while (!error)
+                {
+                    if (height % rai::Ledger::BLOCKS_PER_INDEX != 0)
+                    {
+                        error = BlockIndexPut_(transaction, account, height,
+                                               hash);
+                        IF_ERROR_BREAK(error);
+                    }
+                    ++count;
+                    ++height;
+                    if (successor.IsZero() || count >= max_blocks)
+                    {
+                        break;
+                    }
+                    hash = successor;
+                    rai::BlockView block;
+                    error = BlockViewGet(transaction, hash, block, successor);
+                    if (!error && block.Height() != height)
+                    {
+                        assert(0);
+                        error = true;
+                    }
+                }
                 if (error)
                 {
-                    return rai::ErrorCode::LEDGER_SOURCE_PUT;
+                    transaction.Abort();
+                    return rai::ErrorCode::LEDGER_BLOCK_INDEX_MIGRATION;
                 }
-                ++count;
+                if (height <= info.head_height_)
+                {
+                    break;
+                }
+            }
+
+            if (account == rai::Account::Max())
+            {
+                finished = true;
+                break;
             }
-            hash = block->Previous();
+            account += 1;
+            height = 0;
         }
-    }
 
-    bool error = VersionPut(transaction, 2);
+        if (finished)
+        {
+            error = BlockIndexMigrationDel_(transaction);
+        }
+        else
+        {
+            error = BlockIndexMigrationPut_(transaction, account, height);
+        }
+        if (error)
+        {
+            transaction.Abort();
+            return rai::ErrorCode::LEDGER_BLOCK_INDEX_MIGRATION;
+        }
+    }
+
+    if (finished)
+    {
+        block_index_migrated_ = true;
+    }
+    return rai::ErrorCode::SUCCESS;
+}
+
+bool rai::Ledger::BlockIndexDense() const
+{
+    return block_index_migrated_;
+}
+
+rai::ErrorCode rai::Ledger::Prune(uint64_t depth, uint64_t age,
+                                  size_t max_blocks, rai::Account& cursor,
+                                  bool& finished)
+{
+    finished = false;
+    // the sparse index walk needs the blocks below the tail
+    if (!receivables_indexed_ || !BlockIndexDense())
+    {
+        finished = true;
+        return rai::ErrorCode::SUCCESS;
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Transaction transaction(error_code, *this, true);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    uint64_t pages_before = 0;
+    bool error = PrunablePages_(transaction, pages_before);
+    if (error)
+    {
+        transaction.Abort();
+        return rai::ErrorCode::LEDGER_PRUNE;
+    }
+
+    uint64_t now = rai::CurrentTimestamp();
+    uint64_t max_timestamp = now > age ? now - age : 0;
+    size_t count = 0;
+    // bounds the accounts visited when there is nothing to prune
+    size_t visited = 0;
+    rai::Account account(cursor);
+    while (count < max_blocks && visited < max_blocks * 4)
+    {
+        rai::AccountInfo info;
+        error = NextAccountInfo(transaction, account, info);
+        if (error)
+        {
+            finished = true;
+            break;
+        }
+        ++visited;
+
+        size_t pruned = 0;
+        error_code = PruneAccount_(transaction, account, info, depth,
+                                   max_timestamp, max_blocks - count, pruned);
+        if (error_code != rai::ErrorCode::SUCCESS)
+        {
+            transaction.Abort();
+            return error_code;
+        }
+        count += pruned;
+        if (count >= max_blocks)
+        {
+            // the account may have more blocks to prune
+            break;
+        }
+
+        if (account == rai::Account::Max())
+        {
+            finished = true;
+            break;
+        }
+        account += 1;
+    }
+
+    uint64_t pages_after = 0;
+    error = PrunablePages_(transaction, pages_after);
+    if (error)
+    {
+        transaction.Abort();
+        return rai::ErrorCode::LEDGER_PRUNE;
+    }
+
+    cursor = finished ? rai::Account(0) : account;
+    pruned_blocks_ += count;
+    if (pages_before > pages_after)
+    {
+        pruned_pages_ += pages_before - pages_after;
+    }
+    if (finished)
+    {
+        ++prune_passes_;
+    }
+    return rai::ErrorCode::SUCCESS;
+}
+
+void rai::Ledger::PruneStatus(rai::Ptree& status) const
+{
+    status.put("pruned_blocks", std::to_string(pruned_blocks_));
+    status.put("freed_pages", std::to_string(pruned_pages_));
+    status.put("passes", std::to_string(prune_passes_));
+}
+
+bool rai::Ledger::LedgerCountersGet(rai::Transaction& transaction,
+                                    rai::LedgerCounters& counters) const
+{
+    counters.values_.clear();
+    rai::StoreIterator i(transaction.mdb_transaction_, store_.ledger_counters_);
+    rai::StoreIterator n(nullptr);
+    for (; i != n; ++i)
+    {
+        uint32_t type = 0;
+        uint32_t index = 0;
+        rai::BufferStream stream_key(i->first.Data(), i->first.Size());
+        bool error = rai::Read(stream_key, type);
+        IF_ERROR_RETURN(error, error);
+        error = rai::Read(stream_key, index);
+        IF_ERROR_RETURN(error, error);
+
+        rai::uint128_union value;
+        rai::BufferStream stream_value(i->second.Data(), i->second.Size());
+        error = rai::Read(stream_value, value.bytes);
+        IF_ERROR_RETURN(error, error);
+        counters.Add(static_cast<rai::LedgerCounterType>(type), index,
+                     value.Number());
+    }
+
+    // changes of the open write transaction are not written yet
+    for (rai::Transaction* t = &transaction; t != nullptr; t = t->parent_)
+    {
+        for (const auto& delta : t->counter_deltas_)
+        {
+            rai::uint128_t& value = counters.values_[delta.first];
+            value += delta.second.first;
+            value = value > delta.second.second ? value - delta.second.second
+                                                : 0;
+        }
+    }
+    return false;
+}
+
+bool rai::Ledger::LedgerCountersCompute(rai::Transaction& transaction,
+                                        rai::LedgerCounters& counters) const
+{
+    counters.values_.clear();
+    counters.Add(rai::LedgerCounterType::BLOCKS, 0, 0);
+    for (rai::StoreIterator i(transaction.mdb_transaction_, store_.blocks_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        rai::BufferStream stream(i->second.Data(), i->second.Size());
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        std::shared_ptr<rai::Block> block =
+            rai::DeserializeBlockUnverify(error_code, stream);
+        if (error_code != rai::ErrorCode::SUCCESS)
+        {
+            return true;
+        }
+        counters.Add(rai::LedgerCounterType::BLOCKS, 0, 1);
+        counters.Add(rai::LedgerCounterType::BLOCK_TYPE,
+                     static_cast<uint32_t>(block->Type()), 1);
+        counters.Add(rai::LedgerCounterType::BLOCK_OPCODE,
+                     static_cast<uint32_t>(block->Opcode()), 1);
+    }
+
+    uint64_t confirmed = 0;
+    for (rai::StoreIterator i(transaction.mdb_transaction_, store_.accounts_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        rai::AccountInfo info;
+        rai::BufferStream stream(i->second.Data(), i->second.Size());
+        bool error = info.Deserialize(stream);
+        IF_ERROR_RETURN(error, error);
+        confirmed += ConfirmedBlocks_(info);
+    }
+    counters.Add(rai::LedgerCounterType::CONFIRMED_BLOCKS, 0, confirmed);
+
+    uint64_t receivables = 0;
+    rai::uint128_t amount = 0;
+    for (rai::StoreIterator i(transaction.mdb_transaction_,
+                              store_.receivables_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        rai::ReceivableInfo info;
+        rai::BufferStream stream(i->second.Data(), i->second.Size());
+        bool error = info.Deserialize(stream);
+        IF_ERROR_RETURN(error, error);
+        ++receivables;
+        amount += info.amount_.Number();
+    }
+    counters.Add(rai::LedgerCounterType::RECEIVABLES, 0, receivables);
+    counters.Add(rai::LedgerCounterType::RECEIVABLE_AMOUNT, 0, amount);
+
+    MDB_stat stat;
+    bool error = store_.Stat(transaction.mdb_transaction_, store_.forks_, stat);
+    IF_ERROR_RETURN(error, error);
+    counters.Add(rai::LedgerCounterType::FORKS, 0, stat.ms_entries);
+
+    return false;
+}
+
+bool rai::Ledger::LedgerCountersPut(rai::Transaction& transaction,
+                                    const rai::LedgerCounters& counters)
+{
+    if (!transaction.write_ || transaction.parent_ != nullptr)
+    {
+        return true;
+    }
+
+    bool error =
+        store_.Drop(transaction.mdb_transaction_, store_.ledger_counters_);
+    IF_ERROR_RETURN(error, error);
+
+    for (const auto& i : counters.values_)
+    {
+        std::vector<uint8_t> bytes;
+        {
+            rai::VectorStream stream(bytes);
+            rai::Write(stream, static_cast<uint32_t>(i.first.first));
+            rai::Write(stream, i.first.second);
+        }
+        rai::uint128_union value(i.second);
+        rai::MdbVal key(bytes.size(), bytes.data());
+        error = store_.Put(transaction.mdb_transaction_,
+                           store_.ledger_counters_, key, rai::MdbVal(value));
+        IF_ERROR_RETURN(error, error);
+    }
+
+    // the counters already cover the changes made by this transaction
+    transaction.counter_deltas_.clear();
+    return false;
+}
+
+void rai::Ledger::RetentionSet(const rai::RetentionPolicy& rollbacks,
+                               const rai::RetentionPolicy& forks)
+{
+    std::lock_guard<std::mutex> lock(retention_mutex_);
+    rollback_retention_ = rollbacks;
+    fork_retention_ = forks;
+}
+
+rai::RetentionPolicy rai::Ledger::RollbackRetention() const
+{
+    std::lock_guard<std::mutex> lock(retention_mutex_);
+    return rollback_retention_;
+}
+
+rai::RetentionPolicy rai::Ledger::ForkRetention() const
+{
+    std::lock_guard<std::mutex> lock(retention_mutex_);
+    return fork_retention_;
+}
+
+// Deletes up to max_entries expired rollbacks and forks, oldest first, in one
+// write transaction. finished is set when nothing expired is left.
+rai::ErrorCode rai::Ledger::RetentionSweep(size_t max_entries, bool& finished)
+{
+    finished = false;
+    rai::RetentionPolicy rollbacks = RollbackRetention();
+    rai::RetentionPolicy forks = ForkRetention();
+    if (!retention_indexed_ || (rollbacks.max_age_ == 0 && forks.max_age_ == 0))
+    {
+        finished = true;
+        return rai::ErrorCode::SUCCESS;
+    }
+
+    size_t rollbacks_count = 0;
+    size_t forks_count = 0;
+    {
+        rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+        rai::Transaction transaction(error_code, *this, true);
+        IF_NOT_SUCCESS_RETURN(error_code);
+
+        uint64_t now = rai::CurrentTimestamp();
+        if (rollbacks.max_age_ > 0 && now > rollbacks.max_age_)
+        {
+            error_code = SweepRollbacks_(transaction, now - rollbacks.max_age_,
+                                         max_entries, rollbacks_count);
+            if (error_code != rai::ErrorCode::SUCCESS)
+            {
+                transaction.Abort();
+                return error_code;
+            }
+        }
+
+        if (forks.max_age_ > 0 && now > forks.max_age_
+            && rollbacks_count < max_entries)
+        {
+            error_code =
+                SweepForks_(transaction, now - forks.max_age_,
+                            max_entries - rollbacks_count, forks_count);
+            if (error_code != rai::ErrorCode::SUCCESS)
+            {
+                transaction.Abort();
+                return error_code;
+            }
+        }
+    }
+
+    // counted once the transaction is committed
+    swept_rollbacks_ += rollbacks_count;
+    swept_forks_ += forks_count;
+    finished = rollbacks_count + forks_count < max_entries;
+    if (finished)
+    {
+        ++sweep_passes_;
+    }
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::RetentionStatus(rai::Ptree& status)
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Transaction transaction(error_code, *this, false);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    MDB_stat stat;
+    bool error =
+        store_.Stat(transaction.mdb_transaction_, store_.rollbacks_, stat);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+    status.put("rollbacks", std::to_string(stat.ms_entries));
+    status.put("rollbacks_pages",
+               std::to_string(stat.ms_branch_pages + stat.ms_leaf_pages
+                              + stat.ms_overflow_pages));
+    error = store_.Stat(transaction.mdb_transaction_, store_.forks_, stat);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+    status.put("forks", std::to_string(stat.ms_entries));
+    status.put("forks_pages",
+               std::to_string(stat.ms_branch_pages + stat.ms_leaf_pages
+                              + stat.ms_overflow_pages));
+
+    rai::RetentionPolicy rollbacks = RollbackRetention();
+    rai::RetentionPolicy forks = ForkRetention();
+    status.put("rollback_max_age", std::to_string(rollbacks.max_age_));
+    status.put("rollback_max_per_account",
+               std::to_string(rollbacks.max_per_account_));
+    status.put("fork_max_age", std::to_string(forks.max_age_));
+    status.put("fork_max_per_account", std::to_string(forks.max_per_account_));
+
+    uint64_t swept_rollbacks = swept_rollbacks_;
+    uint64_t swept_forks = swept_forks_;
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+                           std::chrono::steady_clock::now() - sweep_start_)
+                           .count();
+    elapsed = std::max<uint64_t>(elapsed, 1);
+    status.put("swept_rollbacks", std::to_string(swept_rollbacks));
+    status.put("swept_forks", std::to_string(swept_forks));
+    status.put("rollbacks_swept_per_hour",
+               std::to_string(swept_rollbacks * 3600 / elapsed));
+    status.put("forks_swept_per_hour",
+               std::to_string(swept_forks * 3600 / elapsed));
+    status.put("passes", std::to_string(sweep_passes_));
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::UpgradeWallet(rai::Transaction& transaction)
+{
+    uint32_t version = 0;
+    bool error = VersionGet(transaction, version);
+    if (error)
+    {
+        version = 1;
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    switch (version)
+    {
+        case 1:
+        {
+            error_code = UpgradeWalletV1V2(transaction);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 2:
+        {
+            break;
+        }
+        default:
+        {
+            return rai::ErrorCode::LEDGER_UNKNOWN_VERSION;
+        }
+    }
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::UpgradeNode(rai::Transaction& transaction)
+{
+    uint32_t version = 0;
+    bool error = VersionGet(transaction, version);
+    if (error)
+    {
+        version = 1;
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    switch (version)
+    {
+        case 1:
+        {
+            error_code = UpgradeNodeV1V2(transaction);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 2:
+        {
+            error_code = UpgradeNodeV2V3(transaction);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 3:
+        {
+            error_code = UpgradeNodeV3V4(transaction);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 4:
+        {
+            error_code = UpgradeNodeV4V5(transaction);
+            IF_NOT_SUCCESS_RETURN(error_code);
+        }
+        case 5:
+        {
+            break;
+        }
+        default:
+        {
+            return rai::ErrorCode::LEDGER_UNKNOWN_VERSION;
+        }
+    }
+
+    rai::Account account;
+    uint64_t height = 0;
+    bool migrated = BlockIndexMigrationGet_(transaction, account, height);
+    if (dense_block_index_)
+    {
+        block_index_migrated_ = migrated;
+        return rai::ErrorCode::SUCCESS;
+    }
+
+    // heights stored while the dense index is off are indexed again by
+    // BlockIndexMigrate once it is turned on
+    if (migrated)
+    {
+        bool error =
+            BlockIndexMigrationPut_(transaction, rai::Account(0), 0);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_BLOCK_INDEX_MIGRATION);
+    }
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::UpgradeNodeV1V2(rai::Transaction& transaction)
+{
+    size_t count = 0;
+    bool error = AccountCount(transaction, count);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_BLOCK_INDEX_MIGRATION);
+
+    // the missing heights are indexed online by BlockIndexMigrate
+    if (count > 0)
+    {
+        error = BlockIndexMigrationPut_(transaction, rai::Account(0), 0);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_BLOCK_INDEX_MIGRATION);
+    }
+
+    error = VersionPut(transaction, 2);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_VERSION_PUT);
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::UpgradeNodeV2V3(rai::Transaction& transaction)
+{
+    uint64_t count = 0;
+    rai::StoreIterator i(transaction.mdb_transaction_, store_.receivables_);
+    rai::StoreIterator n(nullptr);
+    for (; i != n; ++i)
+    {
+        rai::BufferStream stream_key(i->first.Data(), i->first.Size());
+        rai::Account destination;
+        rai::BlockHash hash;
+        bool error = rai::Read(stream_key, destination.bytes);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RECEIVABLES_INDEX);
+        error = rai::Read(stream_key, hash.bytes);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RECEIVABLES_INDEX);
+
+        rai::ReceivableInfo info;
+        rai::BufferStream stream_value(i->second.Data(), i->second.Size());
+        error = info.Deserialize(stream_value);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RECEIVABLES_INDEX);
+
+        error = ReceivableIndexPut_(transaction, destination, hash, info);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RECEIVABLES_INDEX);
+        ++count;
+    }
+
+    bool error = VersionPut(transaction, 3);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_VERSION_PUT);
+
+    std::cout << "Upgrade node ledger from V2 to V3, indexed " << count
+              << " receivables" << std::endl;
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::UpgradeNodeV3V4(rai::Transaction& transaction)
+{
+    rai::LedgerCounters counters;
+    bool error = LedgerCountersCompute(transaction, counters);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_COUNTERS);
+    error = LedgerCountersPut(transaction, counters);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_COUNTERS);
+
+    error = VersionPut(transaction, 4);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_VERSION_PUT);
+
+    std::cout << "Upgrade node ledger from V3 to V4, counted "
+              << rai::uint128_union(
+                     counters.Get(rai::LedgerCounterType::BLOCKS))
+                     .StringDec()
+              << " blocks" << std::endl;
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+// Entries stored before V5 have no timestamp, they are stamped with the
+// upgrade time and expire one retention period later
+rai::ErrorCode rai::Ledger::UpgradeNodeV4V5(rai::Transaction& transaction)
+{
+    std::vector<rai::BlockHash> hashes;
+    for (rai::StoreIterator i(transaction.mdb_transaction_, store_.rollbacks_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        rai::BlockHash hash;
+        rai::BufferStream stream(i->first.Data(), i->first.Size());
+        bool error = rai::Read(stream, hash.bytes);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        hashes.push_back(hash);
+    }
+
+    for (const auto& hash : hashes)
+    {
+        std::shared_ptr<rai::Block> block(nullptr);
+        bool error = RollbackBlockGet(transaction, hash, block);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        error = RollbackBlockPut(transaction, hash, *block);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+    }
+
+    std::vector<std::pair<rai::Account, uint64_t>> forks;
+    for (rai::StoreIterator i(transaction.mdb_transaction_, store_.forks_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        rai::Account account;
+        uint64_t height = 0;
+        rai::BufferStream stream(i->first.Data(), i->first.Size());
+        bool error = rai::Read(stream, account.bytes);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        error = rai::Read(stream, height);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        forks.emplace_back(account, height);
+    }
+
+    for (const auto& fork : forks)
+    {
+        std::shared_ptr<rai::Block> first(nullptr);
+        std::shared_ptr<rai::Block> second(nullptr);
+        bool error =
+            ForkGet(transaction, fork.first, fork.second, first, second);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        error = ForkPut(transaction, fork.first, fork.second, *first, *second);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+    }
+
+    bool error = VersionPut(transaction, 5);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_VERSION_PUT);
+
+    std::cout << "Upgrade node ledger from V4 to V5, indexed " << hashes.size()
+              << " rollbacks and " << forks.size() << " forks" << std::endl;
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::UpgradeWalletV1V2(rai::Transaction& transaction)
+{
+    uint64_t count = 0;
+    for (auto i = AccountInfoBegin(transaction),
+              n = AccountInfoEnd(transaction);
+         i != n; ++i)
+    {
+        rai::Account account;
+        rai::AccountInfo info;
+        bool error = AccountInfoGet(i, account, info);
+        if (error)
+        {
+            return rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET;
+        }
+
+        if (info.head_height_ == rai::Block::INVALID_HEIGHT)
+        {
+            continue;
+        }
+
+        rai::BlockHash hash(info.head_);
+        while (!hash.IsZero())
+        {
+            rai::BlockView block;
+            error = BlockViewGet(transaction, hash, block);
+            if (error)
+            {
+                return rai::ErrorCode::LEDGER_BLOCK_GET;
+            }
+
+            // the view is invalidated by the write below
+            hash = block.Previous();
+            if (block.Opcode() == rai::BlockOpcode::RECEIVE)
+            {
+                error = SourcePut(transaction, block.Link());
+                if (error)
+                {
+                    return rai::ErrorCode::LEDGER_SOURCE_PUT;
+                }
+                ++count;
+            }
+        }
+    }
+
+    bool error = VersionPut(transaction, 2);
+    if (error)
+    {
+        return rai::ErrorCode::LEDGER_VERSION_PUT;
+    }
+
+    std::cout << "Upgrade wallet ledger from V1 to V2, put " << count
+              << " receivable sources to the ledger" << std::endl;
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+bool rai::Ledger::BlockIndexPut_(rai::Transaction& transaction,
+                                 const rai::Account& account, uint64_t height,
+                                 const rai::BlockHash& hash)
+{
+    std::vector<uint8_t> bytes;
+    {
+        rai::VectorStream stream(bytes);
+        rai::Write(stream, account.bytes);
+        rai::Write(stream, height);
+    }
+    rai::MdbVal key(bytes.size(), bytes.data());
+    rai::MdbVal value(hash);
+    bool error = store_.Put(transaction.mdb_transaction_, store_.blocks_index_,
+                            key, value);
+    IF_ERROR_RETURN(error, error);
+
+    return false;
+}
+
+bool rai::Ledger::AccountInfoOverlayGet_(rai::Transaction& transaction,
+                                         const rai::Account& account,
+                                         bool& exists,
+                                         rai::AccountInfo& info) const
+{
+    for (rai::Transaction* i = &transaction; i != nullptr; i = i->parent_)
+    {
+        auto it = i->account_info_overlay_.find(account);
+        if (it != i->account_info_overlay_.end())
+        {
+            exists = it->second.first;
+            if (exists)
+            {
+                info = it->second.second;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool rai::Ledger::BlockIndexGet_(rai::Transaction& transaction,
+                                 const rai::Account& account, uint64_t height,
+                                 rai::BlockHash& hash) const
+{
+    std::vector<uint8_t> bytes;
+    {
+        rai::VectorStream stream(bytes);
+        rai::Write(stream, account.bytes);
+        rai::Write(stream, height);
+    }
+    rai::MdbVal key(bytes.size(), bytes.data());
+    rai::MdbVal value;
+    bool error = store_.Get(transaction.mdb_transaction_, store_.blocks_index_,
+                            key, value);
+    IF_ERROR_RETURN(error, error);
+    assert(value.Size() == sizeof(hash));
+
+    hash = value.uint256_union();
+    return false;
+}
+
+bool rai::Ledger::BlockIndexDel_(rai::Transaction& transaction,
+                                 const rai::Account& account, uint64_t height)
+{
+    std::vector<uint8_t> bytes;
+    {
+        rai::VectorStream stream(bytes);
+        rai::Write(stream, account.bytes);
+        rai::Write(stream, height);
+    }
+    rai::MdbVal key(bytes.size(), bytes.data());
+    return store_.Del(transaction.mdb_transaction_, store_.blocks_index_, key,
+                      nullptr);
+}
+
+bool rai::Ledger::BlockIndexMigrationPut_(rai::Transaction& transaction,
+                                          const rai::Account& account,
+                                          uint64_t height)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, rai::MetaKey::BLOCK_INDEX_MIGRATION);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+
+    std::vector<uint8_t> bytes_value;
+    {
+        rai::VectorStream stream(bytes_value);
+        rai::Write(stream, account.bytes);
+        rai::Write(stream, height);
+    }
+    rai::MdbVal value(bytes_value.size(), bytes_value.data());
+    return store_.Put(transaction.mdb_transaction_, store_.meta_, key, value);
+}
+
+bool rai::Ledger::BlockIndexMigrationGet_(rai::Transaction& transaction,
+                                          rai::Account& account,
+                                          uint64_t& height) const
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, rai::MetaKey::BLOCK_INDEX_MIGRATION);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+
+    rai::MdbVal value;
+    bool error =
+        store_.Get(transaction.mdb_transaction_, store_.meta_, key, value);
+    IF_ERROR_RETURN(error, error);
+
+    rai::BufferStream stream(value.Data(), value.Size());
+    error = rai::Read(stream, account.bytes);
+    IF_ERROR_RETURN(error, error);
+    return rai::Read(stream, height);
+}
+
+bool rai::Ledger::BlockIndexMigrationDel_(rai::Transaction& transaction)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, rai::MetaKey::BLOCK_INDEX_MIGRATION);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    return store_.Del(transaction.mdb_transaction_, store_.meta_, key,
+                      nullptr);
+}
+
+void rai::Ledger::RepWeightsCommit_(
+    const std::vector<rai::RepWeightOpration>& ops)
+{
+    std::lock_guard<std::mutex> lock(rep_weights_mutex_);
+    for (const auto& op : ops)
+    {
+        if (op.weight_.IsZero())
+        {
+            continue;
+        }
+
+        if (op.add_)
+        {
+            if (rep_weights_.find(op.representative_) == rep_weights_.end())
+            {
+                rep_weights_[op.representative_] = op.weight_;
+            }
+            else
+            {
+                rep_weights_[op.representative_] += op.weight_;
+                assert(rep_weights_[op.representative_] > op.weight_);
+            }
+            total_rep_weight_ += op.weight_;
+        }
+        else
+        {
+            if (rep_weights_.find(op.representative_) == rep_weights_.end())
+            {
+                assert(0);
+                continue;
+            }
+            if (op.weight_ > rep_weights_[op.representative_])
+            {
+                assert(0);
+                rep_weights_.erase(op.representative_);
+                total_rep_weight_ -= rep_weights_[op.representative_];
+            }
+            else if (op.weight_ == rep_weights_[op.representative_])
+            {
+                rep_weights_.erase(op.representative_);
+                total_rep_weight_ -= op.weight_;
+            }
+            else
+            {
+                rep_weights_[op.representative_] -= op.weight_;
+                total_rep_weight_ -= op.weight_;
+            }
+        }
+    }
+}
+
+bool rai::Ledger::InitMemoryTables_(rai::Transaction& transaction)
+{
+    std::lock_guard<std::mutex> lock_rep_weights(rep_weights_mutex_);
+    std::lock_guard<std::mutex> lock_rich_list(rich_list_mutex_);
+    std::lock_guard<std::mutex> lock_delegator_list(delegator_list_mutex_);
+
+    // the marker is the id of the last commit that kept the snapshot and the
+    // change log up to date, every top level write of the ledger advances
+    // it; any commit after it (an older binary, a tool writing to the store
+    // directly) may have been missed
+    uint64_t marker = 0;
+    bool error = MetaUint64Get_(transaction,
+                                rai::MetaKey::MEMORY_TABLES_SEQUENCE, marker);
+    uint64_t last_commit = store_.TxnId(transaction.mdb_transaction_) - 1;
+    if (!error && marker == last_commit)
+    {
+        rai::ErrorCode error_code = LoadMemoryTables_(transaction);
+        if (error_code == rai::ErrorCode::SUCCESS)
+        {
+            memory_tables_synced_ = true;
+            return false;
+        }
+        rai::Stats::Add(error_code, "Ledger::InitMemoryTables_");
+
+        rep_weights_.clear();
+        total_rep_weight_.Clear();
+        rich_list_.clear();
+        delegator_list_.clear();
+    }
+
+    // no usable snapshot, fall back to a full scan
+    return true;
+}
+
+rai::ErrorCode rai::Ledger::ScanMemoryTables_()
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Transaction transaction(error_code, *this, true);
+    IF_NOT_SUCCESS_RETURN(error_code);
+    {
+        std::lock_guard<std::mutex> lock_rep_weights(rep_weights_mutex_);
+        std::lock_guard<std::mutex> lock_rich_list(rich_list_mutex_);
+        std::lock_guard<std::mutex> lock_delegator_list(
+            delegator_list_mutex_);
+        error_code = ScanMemoryTables_(transaction);
+    }
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        transaction.Abort();
+    }
+    return error_code;
+}
+
+rai::ErrorCode rai::Ledger::ScanMemoryTables_(rai::Transaction& transaction)
+{
+    MetaDel_(transaction, rai::MetaKey::MEMORY_TABLES_SEQUENCE);
+    bool error =
+        store_.Drop(transaction.mdb_transaction_, store_.account_delegations_);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT);
+
+    // the head blocks are read on one thread per key range, the transaction
+    // has not written the accounts or blocks so the shards see its state
+    size_t shards = rai::Ledger::ParallelScanShards();
+    std::vector<std::vector<std::pair<rai::Account, rai::AccountDelegation>>>
+        results(shards);
+    rai::ErrorCode error_code = ParallelScan(
+        store_.accounts_, shards,
+        [&](size_t shard, rai::Transaction& transaction_l,
+            rai::Iterator& i) -> rai::ErrorCode {
+            rai::Account account;
+            rai::AccountInfo info;
+            bool error = AccountInfoGet(i, account, info);
+            IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET);
+
+            if (info.head_height_ == rai::Block::INVALID_HEIGHT)
+            {
+                assert(0);
+                return rai::ErrorCode::SUCCESS;
+            }
+            rai::BlockView block;
+            error = BlockViewGet(transaction_l, info.head_, block);
+            IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_BLOCK_GET);
+
+            results[shard].emplace_back(
+                account, rai::AccountDelegation(block.Type(),
+                                                block.Representative(),
+                                                block.Balance()));
+            return rai::ErrorCode::SUCCESS;
+        });
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    for (const auto& result : results)
+    {
+        for (const auto& i : result)
+        {
+            ApplyAccountDelegation_(i.first, i.second);
+            if (!memory_tables_snapshot_)
+            {
+                continue;
+            }
+
+            std::vector<uint8_t> bytes;
+            {
+                rai::VectorStream stream(bytes);
+                i.second.Serialize(stream);
+            }
+            rai::MdbVal key(i.first);
+            rai::MdbVal value(bytes.size(), bytes.data());
+            bool error = store_.Put(transaction.mdb_transaction_,
+                                    store_.account_delegations_, key, value);
+            IF_ERROR_RETURN(error,
+                            rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT);
+        }
+    }
+
+    if (!memory_tables_snapshot_)
+    {
+        return rai::ErrorCode::SUCCESS;
+    }
+    error = store_.Drop(transaction.mdb_transaction_, store_.accounts_changed_);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT);
+    error_code = MemoryTablesCheckpoint_(transaction, false);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    memory_tables_synced_ = true;
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::Ledger::LoadMemoryTables_(rai::Transaction& transaction)
+{
+    std::unordered_set<rai::Account> changed;
+    for (rai::StoreIterator i(transaction.mdb_transaction_,
+                              store_.accounts_changed_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        changed.insert(i->first.uint256_union());
+    }
+
+    for (rai::StoreIterator i(transaction.mdb_transaction_,
+                              store_.account_delegations_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        rai::Account account = i->first.uint256_union();
+        if (changed.find(account) != changed.end())
+        {
+            continue;
+        }
+
+        rai::AccountDelegation delegation;
+        rai::BufferStream stream(i->second.Data(), i->second.Size());
+        bool error = delegation.Deserialize(stream);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT);
+        ApplyAccountDelegation_(account, delegation);
+    }
+
+    // the accounts changed since the checkpoint are replayed by the
+    // checkpoint itself
+    return MemoryTablesCheckpoint_(transaction, true);
+}
+
+rai::ErrorCode rai::Ledger::MemoryTablesCheckpoint_(
+    rai::Transaction& transaction, bool apply)
+{
+    std::vector<rai::Account> changed;
+    for (rai::StoreIterator i(transaction.mdb_transaction_,
+                              store_.accounts_changed_),
+         n(nullptr);
+         i != n; ++i)
+    {
+        changed.push_back(i->first.uint256_union());
+    }
+
+    for (const auto& account : changed)
+    {
+        rai::MdbVal key(account);
+        rai::AccountDelegation delegation;
+        bool error =
+            AccountDelegationCurrent_(transaction, account, delegation);
+        if (error)
+        {
+            // the account was rolled back entirely
+            store_.Del(transaction.mdb_transaction_,
+                       store_.account_delegations_, key, nullptr);
+            continue;
+        }
+
+        if (apply)
+        {
+            ApplyAccountDelegation_(account, delegation);
+        }
+        std::vector<uint8_t> bytes;
+        {
+            rai::VectorStream stream(bytes);
+            delegation.Serialize(stream);
+        }
+        rai::MdbVal value(bytes.size(), bytes.data());
+        error = store_.Put(transaction.mdb_transaction_,
+                           store_.account_delegations_, key, value);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT);
+    }
+
+    bool error =
+        store_.Drop(transaction.mdb_transaction_, store_.accounts_changed_);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT);
+
+    error = MetaUint64Put_(transaction, rai::MetaKey::MEMORY_TABLES_SEQUENCE,
+                           store_.TxnId(transaction.mdb_transaction_));
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT);
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+void rai::Ledger::ApplyAccountDelegation_(
+    const rai::Account& account, const rai::AccountDelegation& delegation)
+{
+    bool has_representative = delegation.type_ != rai::BlockType::REP_BLOCK;
+    if (has_representative && !delegation.balance_.IsZero())
+    {
+        rep_weights_[delegation.representative_] += delegation.balance_;
+        total_rep_weight_ += delegation.balance_;
+    }
+
+    if (enable_delegator_list_ && has_representative)
+    {
+        UpdateDelegatorList_(account, delegation.representative_,
+                             delegation.balance_, delegation.type_);
+    }
+
+    if (enable_rich_list_ && delegation.type_ == rai::BlockType::TX_BLOCK)
+    {
+        UpdateRichList_(account, delegation.balance_);
+    }
+}
+
+bool rai::Ledger::AccountDelegationCurrent_(
+    rai::Transaction& transaction, const rai::Account& account,
+    rai::AccountDelegation& delegation) const
+{
+    rai::AccountInfo info;
+    bool error = AccountInfoGet(transaction, account, info);
+    IF_ERROR_RETURN(error, error);
+    if (info.head_height_ == rai::Block::INVALID_HEIGHT)
+    {
+        return true;
+    }
+
+    rai::BlockView block;
+    error = BlockViewGet(transaction, info.head_, block);
+    IF_ERROR_RETURN(error, error);
+
+    delegation = rai::AccountDelegation(block.Type(), block.Representative(),
+                                        block.Balance());
+    return false;
+}
+
+bool rai::Ledger::AccountsChangedPut_(rai::Transaction& transaction)
+{
+    bool error = false;
+    uint8_t empty = 0;
+    for (const auto& i : transaction.account_info_overlay_)
+    {
+        rai::MdbVal key(i.first);
+        rai::MdbVal value(0, &empty);
+        error = store_.Put(transaction.mdb_transaction_,
+                           store_.accounts_changed_, key, value);
+        IF_ERROR_BREAK(error);
+    }
+    return error;
+}
+
+void rai::Ledger::MemoryTablesCommit_(rai::Transaction& transaction)
+{
+    bool error = false;
+    if (!transaction.account_info_overlay_.empty())
+    {
+        error = AccountsChangedPut_(transaction);
+    }
+
+    // the marker follows every top level commit once the tables are in sync
+    // with the store, so only commits made outside of the ledger leave it
+    // behind
+    if (!error && memory_tables_synced_)
+    {
+        error =
+            MetaUint64Put_(transaction, rai::MetaKey::MEMORY_TABLES_SEQUENCE,
+                           store_.TxnId(transaction.mdb_transaction_));
+    }
+
     if (error)
     {
-        return rai::ErrorCode::LEDGER_VERSION_PUT;
+        // the snapshot can no longer be trusted, rescan at next startup
+        memory_tables_synced_ = false;
+        rai::Stats::Add(rai::ErrorCode::LEDGER_MEMORY_TABLES_SNAPSHOT,
+                        "Ledger::MemoryTablesCommit_");
+        MetaDel_(transaction, rai::MetaKey::MEMORY_TABLES_SEQUENCE);
+    }
+}
+
+bool rai::Ledger::MetaUint64Put_(rai::Transaction& transaction,
+                                 rai::MetaKey meta_key, uint64_t value)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, meta_key);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+
+    std::vector<uint8_t> bytes_value;
+    {
+        rai::VectorStream stream(bytes_value);
+        rai::Write(stream, value);
+    }
+    rai::MdbVal value_l(bytes_value.size(), bytes_value.data());
+    return store_.Put(transaction.mdb_transaction_, store_.meta_, key,
+                      value_l);
+}
+
+bool rai::Ledger::MetaUint64Get_(rai::Transaction& transaction,
+                                 rai::MetaKey meta_key, uint64_t& value) const
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, meta_key);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+
+    rai::MdbVal value_l;
+    bool error =
+        store_.Get(transaction.mdb_transaction_, store_.meta_, key, value_l);
+    IF_ERROR_RETURN(error, error);
+
+    rai::BufferStream stream(value_l.Data(), value_l.Size());
+    return rai::Read(stream, value);
+}
+
+bool rai::Ledger::MetaDel_(rai::Transaction& transaction,
+                           rai::MetaKey meta_key)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, meta_key);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    return store_.Del(transaction.mdb_transaction_, store_.meta_, key,
+                      nullptr);
+}
+
+rai::ErrorCode rai::Ledger::ParallelScanShard_(
+    MDB_dbi dbi, size_t shard, size_t shards, std::atomic<bool>& stopped,
+    const rai::ScanCallback& callback)
+{
+    // shard covers the keys whose first byte is in [begin, end)
+    size_t begin = shard * 256 / shards;
+    size_t end = (shard + 1) * 256 / shards;
+    if (begin == end)
+    {
+        return rai::ErrorCode::SUCCESS;
+    }
+
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Transaction transaction(error_code, *this, false);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    uint8_t begin_key = static_cast<uint8_t>(begin);
+    rai::MdbVal key(sizeof(begin_key), &begin_key);
+    rai::Iterator i(
+        rai::StoreIterator(transaction.mdb_transaction_, dbi, key));
+    rai::Iterator n(rai::StoreIterator(nullptr));
+    for (; i != n; ++i)
+    {
+        if (stopped)
+        {
+            // the failed shard reports the error
+            break;
+        }
+
+        const rai::MdbVal& current = i.store_it_->first;
+        if (current.Size() == 0)
+        {
+            continue;
+        }
+        if (end < 256 && current.Data()[0] >= end)
+        {
+            break;
+        }
+
+        error_code = callback(shard, transaction, i);
+        if (error_code != rai::ErrorCode::SUCCESS)
+        {
+            stopped = true;
+            break;
+        }
+    }
+
+    return error_code;
+}
+
+bool rai::Ledger::ReceivableIndexPut_(rai::Transaction& transaction,
+                                      const rai::Account& destination,
+                                      const rai::BlockHash& hash,
+                                      const rai::ReceivableInfo& info)
+{
+    rai::BlockView block;
+    bool error = BlockViewGet(transaction, hash, block);
+    IF_ERROR_RETURN(error, error);
+    // the view is invalidated by the writes below
+    rai::Account source = block.Account();
+    uint64_t height = block.Height();
+
+    rai::AccountInfo source_info;
+    error = AccountInfoGet(transaction, source, source_info);
+    rai::ReceivableInfosType type =
+        !error && source_info.Confirmed(height)
+            ? rai::ReceivableInfosType::CONFIRMED
+            : rai::ReceivableInfosType::NOT_CONFIRMED;
+    error =
+        ReceivableIndexEntryPut_(transaction, destination, type, hash, info);
+    IF_ERROR_RETURN(error, error);
+
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, source.bytes);
+        rai::Write(stream, height);
+    }
+    std::vector<uint8_t> bytes_value;
+    {
+        rai::VectorStream stream(bytes_value);
+        rai::Write(stream, destination.bytes);
+        rai::Write(stream, hash.bytes);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    rai::MdbVal value(bytes_value.size(), bytes_value.data());
+    return store_.Put(transaction.mdb_transaction_, store_.receivable_sources_,
+                      key, value);
+}
+
+bool rai::Ledger::ReceivableIndexDel_(rai::Transaction& transaction,
+                                      const rai::Account& destination,
+                                      const rai::BlockHash& hash,
+                                      const rai::ReceivableInfo& info)
+{
+    // the entry exists in one of the two states
+    ReceivableIndexEntryDel_(transaction, destination,
+                             rai::ReceivableInfosType::CONFIRMED, hash,
+                             info.amount_);
+    ReceivableIndexEntryDel_(transaction, destination,
+                             rai::ReceivableInfosType::NOT_CONFIRMED, hash,
+                             info.amount_);
+
+    rai::BlockView block;
+    bool error = BlockViewGet(transaction, hash, block);
+    if (error)
+    {
+        // the source entry is skipped by ReceivablesConfirmedSet once the
+        // receivable is gone
+        return false;
+    }
+
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, block.Account().bytes);
+        rai::Write(stream, block.Height());
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    store_.Del(transaction.mdb_transaction_, store_.receivable_sources_, key,
+               nullptr);
+    return false;
+}
+
+bool rai::Ledger::ReceivableIndexEntryPut_(rai::Transaction& transaction,
+                                           const rai::Account& destination,
+                                           rai::ReceivableInfosType type,
+                                           const rai::BlockHash& hash,
+                                           const rai::ReceivableInfo& info)
+{
+    rai::Amount inverse(std::numeric_limits<rai::uint128_t>::max()
+                        - info.amount_.Number());
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, destination.bytes);
+        rai::Write(stream, static_cast<uint8_t>(type));
+        rai::Write(stream, inverse.bytes);
+        rai::Write(stream, hash.bytes);
+    }
+    std::vector<uint8_t> bytes_value;
+    {
+        rai::VectorStream stream(bytes_value);
+        info.Serialize(stream);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    rai::MdbVal value(bytes_value.size(), bytes_value.data());
+    return store_.Put(transaction.mdb_transaction_, store_.receivables_index_,
+                      key, value);
+}
+
+bool rai::Ledger::ReceivableIndexEntryDel_(rai::Transaction& transaction,
+                                           const rai::Account& destination,
+                                           rai::ReceivableInfosType type,
+                                           const rai::BlockHash& hash,
+                                           const rai::Amount& amount)
+{
+    rai::Amount inverse(std::numeric_limits<rai::uint128_t>::max()
+                        - amount.Number());
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, destination.bytes);
+        rai::Write(stream, static_cast<uint8_t>(type));
+        rai::Write(stream, inverse.bytes);
+        rai::Write(stream, hash.bytes);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    return store_.Del(transaction.mdb_transaction_, store_.receivables_index_,
+                      key, nullptr);
+}
+
+bool rai::Ledger::ReceivableSourceExists_(rai::Transaction& transaction,
+                                          const rai::Account& source,
+                                          uint64_t height) const
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, source.bytes);
+        rai::Write(stream, height);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    rai::MdbVal value;
+    bool error = store_.Get(transaction.mdb_transaction_,
+                            store_.receivable_sources_, key, value);
+    return !error;
+}
+
+rai::ErrorCode rai::Ledger::PruneAccount_(rai::Transaction& transaction,
+                                          const rai::Account& account,
+                                          rai::AccountInfo& info,
+                                          uint64_t depth,
+                                          uint64_t max_timestamp,
+                                          size_t max_blocks, size_t& pruned)
+{
+    pruned = 0;
+    if (!info.Valid()
+        || info.confirmed_height_ == rai::Block::INVALID_HEIGHT)
+    {
+        return rai::ErrorCode::SUCCESS;
+    }
+
+    // the latest confirmed block is always kept
+    depth = std::max<uint64_t>(depth, 1);
+    if (info.confirmed_height_ + 1 <= depth)
+    {
+        return rai::ErrorCode::SUCCESS;
+    }
+    uint64_t horizon = info.confirmed_height_ + 1 - depth;
+
+    uint64_t height = info.tail_height_;
+    rai::BlockHash hash(info.tail_);
+    while (height < horizon && pruned < max_blocks)
+    {
+        std::shared_ptr<rai::Block> block(nullptr);
+        rai::BlockHash successor;
+        bool error = BlockGet(transaction, hash, block, successor);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_BLOCK_GET);
+        if (block->Height() != height || successor.IsZero())
+        {
+            assert(0);
+            return rai::ErrorCode::LEDGER_PRUNE;
+        }
+
+        if (block->Timestamp() > max_timestamp)
+        {
+            break;
+        }
+
+        // unreceived sends and unclaimed rewards need their blocks, the
+        // tail stops there to stay contiguous
+        if (ReceivableSourceExists_(transaction, account, height))
+        {
+            break;
+        }
+        if (block->HasRepresentative())
+        {
+            rai::RewardableInfo rewardable;
+            error = RewardableInfoGet(transaction, block->Representative(),
+                                      hash, rewardable);
+            if (!error)
+            {
+                break;
+            }
+        }
+
+        error = BlockDel(transaction, hash);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_PRUNE);
+        ++pruned;
+        ++height;
+        hash = successor;
     }
 
-    std::cout << "Upgrade wallet ledger from V1 to V2, put " << count
-              << " receivable sources to the ledger" << std::endl;
+    if (pruned == 0)
+    {
+        return rai::ErrorCode::SUCCESS;
+    }
 
+    info.tail_ = hash;
+    info.tail_height_ = height;
+    bool error = AccountInfoPut(transaction, account, info);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_PRUNE);
     return rai::ErrorCode::SUCCESS;
 }
 
-bool rai::Ledger::BlockIndexPut_(rai::Transaction& transaction,
-                                 const rai::Account& account, uint64_t height,
-                                 const rai::BlockHash& hash)
+void rai::Ledger::LedgerCounterAdd_(rai::Transaction& transaction,
+                                    rai::LedgerCounterType type,
+                                    uint32_t index,
+                                    const rai::uint128_t& value, bool add)
 {
-    std::vector<uint8_t> bytes;
+    auto& delta =
+        transaction.counter_deltas_[rai::LedgerCounterKey(type, index)];
+    if (add)
     {
-        rai::VectorStream stream(bytes);
+        delta.first += value;
+    }
+    else
+    {
+        delta.second += value;
+    }
+}
+
+void rai::Ledger::LedgerCountersBlock_(rai::Transaction& transaction,
+                                       const rai::Block& block, bool add)
+{
+    LedgerCounterAdd_(transaction, rai::LedgerCounterType::BLOCKS, 0, 1, add);
+    LedgerCounterAdd_(transaction, rai::LedgerCounterType::BLOCK_TYPE,
+                      static_cast<uint32_t>(block.Type()), 1, add);
+    LedgerCounterAdd_(transaction, rai::LedgerCounterType::BLOCK_OPCODE,
+                      static_cast<uint32_t>(block.Opcode()), 1, add);
+}
+
+// One read-modify-write per changed counter, a counter that would drop below
+// zero has drifted and is clamped, the ledger_counters command repairs it
+bool rai::Ledger::LedgerCountersCommit_(rai::Transaction& transaction)
+{
+    bool result = false;
+    for (const auto& i : transaction.counter_deltas_)
+    {
+        if (i.second.first == i.second.second)
+        {
+            continue;
+        }
+
+        std::vector<uint8_t> bytes;
+        {
+            rai::VectorStream stream(bytes);
+            rai::Write(stream, static_cast<uint32_t>(i.first.first));
+            rai::Write(stream, i.first.second);
+        }
+        rai::MdbVal key(bytes.size(), bytes.data());
+        rai::MdbVal value;
+        rai::uint128_union current(0);
+        bool error = store_.Get(transaction.mdb_transaction_,
+                                store_.ledger_counters_, key, value);
+        if (!error)
+        {
+            rai::BufferStream stream(value.Data(), value.Size());
+            error = rai::Read(stream, current.bytes);
+            IF_ERROR_RETURN(error, error);
+        }
+
+        rai::uint128_t number = current.Number() + i.second.first;
+        if (number < i.second.second)
+        {
+            result = true;
+            number = 0;
+        }
+        else
+        {
+            number -= i.second.second;
+        }
+
+        rai::uint128_union updated(number);
+        error = store_.Put(transaction.mdb_transaction_,
+                           store_.ledger_counters_, key, rai::MdbVal(updated));
+        IF_ERROR_RETURN(error, error);
+    }
+
+    transaction.counter_deltas_.clear();
+    return result;
+}
+
+bool rai::Ledger::RollbackBlockDel_(rai::Transaction& transaction,
+                                    const rai::BlockHash& hash)
+{
+    rai::MdbVal key(hash);
+    rai::MdbVal value;
+    bool error =
+        store_.Get(transaction.mdb_transaction_, store_.rollbacks_, key, value);
+    IF_ERROR_RETURN(error, error);
+
+    rai::BufferStream stream(value.Data(), value.Size());
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    std::shared_ptr<rai::Block> block =
+        rai::DeserializeBlockUnverify(error_code, stream);
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        return true;
+    }
+    // rollbacks stored before the ledger upgrade carry no timestamp
+    uint64_t timestamp = 0;
+    bool indexed = retention_indexed_ && !rai::Read(stream, timestamp);
+
+    error = store_.Del(transaction.mdb_transaction_, store_.rollbacks_, key,
+                       nullptr);
+    IF_ERROR_RETURN(error, error);
+
+    if (indexed)
+    {
+        error =
+            RollbackExpiryDel_(transaction, hash, block->Account(), timestamp);
+        IF_ERROR_RETURN(error, error);
+    }
+    return false;
+}
+
+bool rai::Ledger::RollbackExpiryPut_(rai::Transaction& transaction,
+                                     const rai::BlockHash& hash,
+                                     const rai::Account& account,
+                                     uint64_t timestamp)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, timestamp);
+        rai::Write(stream, hash.bytes);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    rai::MdbVal value(account);
+    bool error = store_.Put(transaction.mdb_transaction_,
+                            store_.rollbacks_expiry_, key, value);
+    IF_ERROR_RETURN(error, error);
+
+    bytes_key.clear();
+    {
+        rai::VectorStream stream(bytes_key);
         rai::Write(stream, account.bytes);
-        rai::Write(stream, height);
+        rai::Write(stream, timestamp);
+        rai::Write(stream, hash.bytes);
     }
-    rai::MdbVal key(bytes.size(), bytes.data());
-    rai::MdbVal value(hash);
-    bool error = store_.Put(transaction.mdb_transaction_, store_.blocks_index_,
-                            key, value);
+    uint8_t junk = 0;
+    rai::MdbVal value_account(sizeof(junk), &junk);
+    rai::MdbVal key_account(bytes_key.size(), bytes_key.data());
+    return store_.Put(transaction.mdb_transaction_, store_.rollbacks_account_,
+                      key_account, value_account);
+}
+
+bool rai::Ledger::RollbackExpiryDel_(rai::Transaction& transaction,
+                                     const rai::BlockHash& hash,
+                                     const rai::Account& account,
+                                     uint64_t timestamp)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, timestamp);
+        rai::Write(stream, hash.bytes);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    bool error = store_.Del(transaction.mdb_transaction_,
+                            store_.rollbacks_expiry_, key, nullptr);
     IF_ERROR_RETURN(error, error);
 
+    bytes_key.clear();
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, account.bytes);
+        rai::Write(stream, timestamp);
+        rai::Write(stream, hash.bytes);
+    }
+    rai::MdbVal key_account(bytes_key.size(), bytes_key.data());
+    return store_.Del(transaction.mdb_transaction_, store_.rollbacks_account_,
+                      key_account, nullptr);
+}
+
+// Keeps the newest max_per_account rollbacks of the account
+bool rai::Ledger::RollbackAccountLimit_(rai::Transaction& transaction,
+                                        const rai::Account& account,
+                                        size_t& removed)
+{
+    removed = 0;
+    uint32_t limit = RollbackRetention().max_per_account_;
+    if (limit == 0)
+    {
+        return false;
+    }
+
+    std::vector<rai::BlockHash> hashes;
+    rai::MdbVal begin(account);
+    rai::StoreIterator i(transaction.mdb_transaction_,
+                         store_.rollbacks_account_, begin);
+    rai::StoreIterator n(nullptr);
+    for (; i != n; ++i)
+    {
+        rai::Account account_l;
+        uint64_t timestamp = 0;
+        rai::BlockHash hash;
+        rai::BufferStream stream(i->first.Data(), i->first.Size());
+        bool error = rai::Read(stream, account_l.bytes);
+        IF_ERROR_RETURN(error, error);
+        if (account_l != account)
+        {
+            break;
+        }
+        error = rai::Read(stream, timestamp);
+        IF_ERROR_RETURN(error, error);
+        error = rai::Read(stream, hash.bytes);
+        IF_ERROR_RETURN(error, error);
+        hashes.push_back(hash);
+    }
+
+    for (size_t j = 0; j + limit < hashes.size(); ++j)
+    {
+        bool error = RollbackBlockDel_(transaction, hashes[j]);
+        IF_ERROR_RETURN(error, error);
+        ++removed;
+    }
     return false;
 }
 
-bool rai::Ledger::BlockIndexGet_(rai::Transaction& transaction,
+bool rai::Ledger::ForkTimestamp_(rai::Transaction& transaction,
                                  const rai::Account& account, uint64_t height,
-                                 rai::BlockHash& hash) const
+                                 uint64_t& timestamp) const
 {
-    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> bytes_key;
     {
-        rai::VectorStream stream(bytes);
+        rai::VectorStream stream(bytes_key);
         rai::Write(stream, account.bytes);
         rai::Write(stream, height);
     }
-    rai::MdbVal key(bytes.size(), bytes.data());
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
     rai::MdbVal value;
-    bool error = store_.Get(transaction.mdb_transaction_, store_.blocks_index_,
-                            key, value);
+    bool error =
+        store_.Get(transaction.mdb_transaction_, store_.forks_, key, value);
     IF_ERROR_RETURN(error, error);
-    assert(value.Size() == sizeof(hash));
 
-    hash = value.uint256_union();
-    return false;
+    rai::BufferStream stream(value.Data(), value.Size());
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    for (int i = 0; i < 2; ++i)
+    {
+        rai::DeserializeBlockUnverify(error_code, stream);
+        if (error_code != rai::ErrorCode::SUCCESS)
+        {
+            return true;
+        }
+    }
+    return rai::Read(stream, timestamp);
 }
 
-bool rai::Ledger::BlockIndexDel_(rai::Transaction& transaction,
-                                 const rai::Account& account, uint64_t height)
+bool rai::Ledger::ForkExpiryPut_(rai::Transaction& transaction,
+                                 const rai::Account& account, uint64_t height,
+                                 uint64_t timestamp)
 {
-    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> bytes_key;
     {
-        rai::VectorStream stream(bytes);
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, timestamp);
         rai::Write(stream, account.bytes);
         rai::Write(stream, height);
     }
-    rai::MdbVal key(bytes.size(), bytes.data());
-    return store_.Del(transaction.mdb_transaction_, store_.blocks_index_, key,
+    uint8_t junk = 0;
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    rai::MdbVal value(sizeof(junk), &junk);
+    return store_.Put(transaction.mdb_transaction_, store_.forks_expiry_, key,
+                      value);
+}
+
+bool rai::Ledger::ForkExpiryDel_(rai::Transaction& transaction,
+                                 const rai::Account& account, uint64_t height,
+                                 uint64_t timestamp)
+{
+    std::vector<uint8_t> bytes_key;
+    {
+        rai::VectorStream stream(bytes_key);
+        rai::Write(stream, timestamp);
+        rai::Write(stream, account.bytes);
+        rai::Write(stream, height);
+    }
+    rai::MdbVal key(bytes_key.size(), bytes_key.data());
+    return store_.Del(transaction.mdb_transaction_, store_.forks_expiry_, key,
                       nullptr);
 }
 
-void rai::Ledger::RepWeightsCommit_(
-    const std::vector<rai::RepWeightOpration>& ops)
+rai::ErrorCode rai::Ledger::SweepRollbacks_(rai::Transaction& transaction,
+                                            uint64_t max_timestamp,
+                                            size_t max_entries, size_t& count)
 {
-    std::lock_guard<std::mutex> lock(rep_weights_mutex_);
-    for (const auto& op : ops)
+    count = 0;
+    std::vector<std::tuple<uint64_t, rai::BlockHash, rai::Account>> expired;
+    for (rai::StoreIterator i(transaction.mdb_transaction_,
+                              store_.rollbacks_expiry_),
+         n(nullptr);
+         i != n && expired.size() < max_entries; ++i)
     {
-        if (op.weight_.IsZero())
+        uint64_t timestamp = 0;
+        rai::BlockHash hash;
+        rai::Account account;
+        rai::BufferStream stream(i->first.Data(), i->first.Size());
+        bool error = rai::Read(stream, timestamp);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        if (timestamp > max_timestamp)
         {
-            continue;
+            break;
         }
+        error = rai::Read(stream, hash.bytes);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        rai::BufferStream stream_value(i->second.Data(), i->second.Size());
+        error = rai::Read(stream_value, account.bytes);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        expired.emplace_back(timestamp, hash, account);
+    }
 
-        if (op.add_)
-        {
-            if (rep_weights_.find(op.representative_) == rep_weights_.end())
-            {
-                rep_weights_[op.representative_] = op.weight_;
-            }
-            else
-            {
-                rep_weights_[op.representative_] += op.weight_;
-                assert(rep_weights_[op.representative_] > op.weight_);
-            }
-            total_rep_weight_ += op.weight_;
-        }
-        else
+    for (const auto& i : expired)
+    {
+        bool error = RollbackBlockDel_(transaction, std::get<1>(i));
+        if (error)
         {
-            if (rep_weights_.find(op.representative_) == rep_weights_.end())
-            {
-                assert(0);
-                continue;
-            }
-            if (op.weight_ > rep_weights_[op.representative_])
-            {
-                assert(0);
-                rep_weights_.erase(op.representative_);
-                total_rep_weight_ -= rep_weights_[op.representative_];
-            }
-            else if (op.weight_ == rep_weights_[op.representative_])
-            {
-                rep_weights_.erase(op.representative_);
-                total_rep_weight_ -= op.weight_;
-            }
-            else
-            {
-                rep_weights_[op.representative_] -= op.weight_;
-                total_rep_weight_ -= op.weight_;
-            }
+            // the rollback itself is gone, drop the index entries
+            error = RollbackExpiryDel_(transaction, std::get<1>(i),
+                                       std::get<2>(i), std::get<0>(i));
+            IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
         }
+        ++count;
     }
+    return rai::ErrorCode::SUCCESS;
 }
 
-rai::ErrorCode rai::Ledger::InitMemoryTables_(rai::Transaction& transaction)
+rai::ErrorCode rai::Ledger::SweepForks_(rai::Transaction& transaction,
+                                        uint64_t max_timestamp,
+                                        size_t max_entries, size_t& count)
 {
-    std::lock_guard<std::mutex> lock_rep_weights(rep_weights_mutex_);
-    std::lock_guard<std::mutex> lock_rich_list(rich_list_mutex_);
-    std::lock_guard<std::mutex> lock_delegator_list(delegator_list_mutex_);
-
-    for (auto i = AccountInfoBegin(transaction),
-              n = AccountInfoEnd(transaction);
-         i != n; ++i)
+    count = 0;
+    std::vector<std::tuple<uint64_t, rai::Account, uint64_t>> expired;
+    for (rai::StoreIterator i(transaction.mdb_transaction_,
+                              store_.forks_expiry_),
+         n(nullptr);
+         i != n && expired.size() < max_entries; ++i)
     {
+        uint64_t timestamp = 0;
         rai::Account account;
-        rai::AccountInfo info;
-        bool error = AccountInfoGet(i, account, info);
-        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET);
-
-        if (info.head_height_ == rai::Block::INVALID_HEIGHT)
+        uint64_t height = 0;
+        rai::BufferStream stream(i->first.Data(), i->first.Size());
+        bool error = rai::Read(stream, timestamp);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        if (timestamp > max_timestamp)
         {
-            assert(0);
-            continue;
+            break;
         }
-        std::shared_ptr<rai::Block> block(nullptr);
-        error = BlockGet(transaction, info.head_, block);
-        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_BLOCK_GET);
+        error = rai::Read(stream, account.bytes);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        error = rai::Read(stream, height);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+        expired.emplace_back(timestamp, account, height);
+    }
 
-        if (block->HasRepresentative() && !block->Balance().IsZero())
+    for (const auto& i : expired)
+    {
+        const rai::Account& account = std::get<1>(i);
+        bool error = ForkDel(transaction, account, std::get<2>(i));
+        if (error)
         {
-            rep_weights_[block->Representative()] += block->Balance();
-            total_rep_weight_ += block->Balance();
+            // the fork itself is gone, drop the index entry
+            error = ForkExpiryDel_(transaction, account, std::get<2>(i),
+                                   std::get<0>(i));
+            IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+            ++count;
+            continue;
         }
+        ++count;
 
-        if (enable_delegator_list_ && block->HasRepresentative())
+        // the fork count limits how many forks the account may keep
+        rai::AccountInfo info;
+        error = AccountInfoGet(transaction, account, info);
+        if (error || info.forks_ == 0)
         {
-            UpdateDelegatorList_(account, block->Representative(),
-                                 block->Balance(), block->Type());
+            continue;
         }
+        --info.forks_;
+        error = AccountInfoPut(transaction, account, info);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_RETENTION);
+    }
+    return rai::ErrorCode::SUCCESS;
+}
 
-        if (enable_rich_list_ && block->Type() == rai::BlockType::TX_BLOCK)
-        {
-            UpdateRichList_(block->Account(), block->Balance());
-        }
+uint64_t rai::Ledger::ConfirmedBlocks_(const rai::AccountInfo& info)
+{
+    if (!info.Valid() || info.confirmed_height_ == rai::Block::INVALID_HEIGHT
+        || info.confirmed_height_ < info.tail_height_)
+    {
+        return 0;
     }
+    return info.confirmed_height_ - info.tail_height_ + 1;
+}
 
-    return rai::ErrorCode::SUCCESS;
+bool rai::Ledger::PrunablePages_(rai::Transaction& transaction,
+                                 uint64_t& pages) const
+{
+    pages = 0;
+    for (auto dbi : {store_.blocks_, store_.blocks_index_})
+    {
+        MDB_stat stat;
+        bool error = store_.Stat(transaction.mdb_transaction_, dbi, stat);
+        IF_ERROR_RETURN(error, true);
+        pages += stat.ms_branch_pages + stat.ms_leaf_pages
+                 + stat.ms_overflow_pages;
+    }
+    return false;
 }
 
 void rai::Ledger::UpdateRichList_(const rai::Account& account,
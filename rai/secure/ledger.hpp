@@ -1,6 +1,11 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
 #include <unordered_map>
 #include <string>
+#include <thread>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -13,6 +18,7 @@
 #include <rai/common/numbers.hpp>
 #include <rai/secure/util.hpp>
 #include <rai/secure/store.hpp>
+#include <rai/secure/cache.hpp>
 
 namespace rai
 {
@@ -31,23 +37,211 @@ private:
     rai::Amount weight_;
 };
 
+class AccountInfo
+{
+public:
+    AccountInfo();
+    AccountInfo(rai::BlockType, const rai::BlockHash&); // first block
+    void Serialize(rai::Stream&) const;
+    bool Deserialize(rai::Stream&);
+    bool Confirmed(uint64_t) const;
+    bool Valid() const;
+    bool Restricted(uint32_t) const;
+
+    rai::BlockType type_;
+    uint16_t forks_;
+    uint64_t head_height_;
+    uint64_t tail_height_;
+    uint64_t confirmed_height_;
+    rai::BlockHash head_;
+    rai::BlockHash tail_;
+};
+
+class AccountInfoCacheEntry
+{
+public:
+    rai::Account account_;
+    rai::AccountInfo info_;
+};
+
+// Sharded LRU cache of committed account infos, written through when a
+// transaction commits. Readers pass the epoch sampled when their transaction
+// began, the cache is bypassed if any transaction has committed since then.
+class AccountInfoCache
+{
+public:
+    AccountInfoCache(size_t);
+    bool Get(uint64_t, const rai::Account&, rai::AccountInfo&);
+    void Put(uint64_t, const rai::Account&, const rai::AccountInfo&);
+    uint64_t Epoch() const;
+    void UpdateBegin();
+    void Update(const rai::Account&, bool, const rai::AccountInfo&);
+    void UpdateEnd();
+    void Status(rai::Ptree&) const;
+
+    static size_t constexpr SHARDS = 16;
+
+private:
+    class Shard
+    {
+    public:
+        mutable std::mutex mutex_;
+        boost::multi_index_container<
+            rai::AccountInfoCacheEntry,
+            boost::multi_index::indexed_by<
+                boost::multi_index::sequenced<>,
+                boost::multi_index::hashed_unique<boost::multi_index::member<
+                    rai::AccountInfoCacheEntry, rai::Account,
+                    &rai::AccountInfoCacheEntry::account_>>>>
+            entries_;
+    };
+
+    bool Usable_(uint64_t) const;
+    Shard& Shard_(const rai::Account&);
+
+    size_t shard_size_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::array<Shard, SHARDS> shards_;
+};
+
+enum class LedgerCounterType : uint32_t
+{
+    INVALID           = 0,
+    BLOCKS            = 1,
+    BLOCK_TYPE        = 2,  // index: rai::BlockType
+    BLOCK_OPCODE      = 3,  // index: rai::BlockOpcode
+    CONFIRMED_BLOCKS  = 4,
+    RECEIVABLES       = 5,
+    RECEIVABLE_AMOUNT = 6,
+    FORKS             = 7,
+};
+typedef std::pair<rai::LedgerCounterType, uint32_t> LedgerCounterKey;
+
+class LedgerCounters
+{
+public:
+    void Add(rai::LedgerCounterType, uint32_t, const rai::uint128_t&);
+    rai::uint128_t Get(rai::LedgerCounterType, uint32_t = 0) const;
+    void SerializeJson(rai::Ptree&) const;
+    bool operator==(const rai::LedgerCounters&) const;
+    bool operator!=(const rai::LedgerCounters&) const;
+
+    std::map<rai::LedgerCounterKey, rai::uint128_t> values_;
+};
+
+// Limits for the rollbacks and forks tables, 0 disables a limit
+class RetentionPolicy
+{
+public:
+    RetentionPolicy();
+    RetentionPolicy(uint64_t, uint32_t);
+
+    // seconds since the entry was stored
+    uint64_t max_age_;
+    uint32_t max_per_account_;
+};
+
+class TransactionInfo
+{
+public:
+    void SerializeJson(rai::Ptree&,
+                       const std::chrono::steady_clock::time_point&) const;
+
+    uint64_t id_;
+    // function that created the transaction
+    const char* site_;
+    bool write_;
+    std::thread::id thread_;
+    // when the current snapshot was taken
+    std::chrono::steady_clock::time_point start_;
+    bool reported_;
+};
+
+// Open top-level transactions. A read transaction pins the pages of its
+// snapshot, a stuck reader makes the file grow under write load. Sharded by
+// id, so beginning and ending transactions on many threads rarely contend
+class TransactionRegistry
+{
+public:
+    TransactionRegistry();
+    uint64_t Add(const char*, bool);
+    void Remove(uint64_t);
+    void Renew(uint64_t);
+    size_t Size() const;
+    // milliseconds since the oldest snapshot was taken, 0 if none is open
+    uint64_t OldestAge() const;
+    // transactions open longer than the milliseconds given, each one is
+    // returned only once
+    std::vector<rai::TransactionInfo> Report(uint64_t);
+    void Status(rai::Ptree&, bool) const;
+
+    static size_t constexpr SHARDS = 16;
+
+private:
+    class Shard
+    {
+    public:
+        mutable std::mutex mutex_;
+        std::unordered_map<uint64_t, rai::TransactionInfo> transactions_;
+    };
+
+    Shard& Shard_(uint64_t);
+    std::vector<rai::TransactionInfo> Transactions_() const;
+
+    std::atomic<uint64_t> next_id_;
+    std::atomic<uint64_t> reported_;
+    std::array<Shard, SHARDS> shards_;
+};
+
 class Transaction
 {
 public:
-    Transaction(rai::ErrorCode&, rai::Ledger&, bool);
+    Transaction(rai::ErrorCode&, rai::Ledger&, bool,
+                const char* = RAI_CALLER_FUNCTION);
+    // Nested write transaction, changes are merged into the parent on success
+    Transaction(rai::ErrorCode&, rai::Transaction&);
     Transaction(const rai::Transaction&) = delete;
     ~Transaction();
     rai::Transaction& operator=(const rai::Transaction&) = delete;
     void Abort();
+    // Commits now instead of at destruction, returns true if nothing was
+    // committed. After a failed top-level commit the caches and the in-memory
+    // rep weights are left as they were. The transaction must not be used
+    // afterwards
+    bool Commit();
+    // Read-only transactions: releases the snapshot and takes a new one, so
+    // long scans can resume from their last key without pinning old pages.
+    // Iterators opened before must not be used afterwards
+    rai::ErrorCode Renew();
 
 private:
     friend class rai::Ledger;
 
     rai::Ledger& ledger_;
+    rai::Transaction* parent_;
+    uint64_t registry_id_;
     bool write_;
     bool aborted_;
+    bool committed_;
+    bool commit_error_;
+    // sampled before the snapshot is taken, a commit racing with the begin
+    // then makes the caches unusable instead of looking older than it is
+    uint64_t cache_epoch_;
+    uint64_t account_info_epoch_;
     rai::MdbTransaction mdb_transaction_;
     std::vector<rai::RepWeightOpration> rep_weight_operations_;
+    bool blocks_put_;
+    std::vector<std::shared_ptr<rai::Block>> blocks_deleted_;
+    // pending account info writes, the bool is false for deleted accounts
+    std::unordered_map<rai::Account, std::pair<bool, rai::AccountInfo>>
+        account_info_overlay_;
+    // pending counter changes (added, subtracted), written before commit
+    std::map<rai::LedgerCounterKey, std::pair<rai::uint128_t, rai::uint128_t>>
+        counter_deltas_;
+    // rollbacks removed by the per account limit, counted once committed
+    uint64_t swept_rollbacks_;
 
 };
 
@@ -72,26 +266,6 @@ private:
 
 };
 
-class AccountInfo
-{
-public:
-    AccountInfo();
-    AccountInfo(rai::BlockType, const rai::BlockHash&); // first block
-    void Serialize(rai::Stream&) const;
-    bool Deserialize(rai::Stream&);
-    bool Confirmed(uint64_t) const;
-    bool Valid() const;
-    bool Restricted(uint32_t) const;
-
-    rai::BlockType type_;
-    uint16_t forks_;
-    uint64_t head_height_;
-    uint64_t tail_height_;
-    uint64_t confirmed_height_;
-    rai::BlockHash head_;
-    rai::BlockHash tail_;
-};
-
 class AliasInfo
 {
 public:
@@ -142,6 +316,7 @@ public:
     BindingKey(const rai::Account&, rai::Chain, uint64_t);
     void Serialize(rai::Stream&) const;
     bool Deserialize(rai::Stream&);
+    bool operator==(const rai::BindingKey&) const;
 
     rai::Account account_;
     rai::Chain chain_;
@@ -704,6 +879,20 @@ public:
     uint64_t valid_timestamp_;
 };
 
+// An account's contribution to rep weights, rich list and delegator list
+class AccountDelegation
+{
+public:
+    AccountDelegation();
+    AccountDelegation(rai::BlockType, const rai::Account&, const rai::Amount&);
+    void Serialize(rai::Stream&) const;
+    bool Deserialize(rai::Stream&);
+
+    rai::BlockType type_;
+    rai::Account representative_;
+    rai::Amount balance_;
+};
+
 class WalletInfo
 {
 public:
@@ -731,10 +920,18 @@ public:
     rai::PublicKey public_key_;
 };
 
+// Called for each entry of a parallel scan with the shard index, the shard's
+// read transaction and an iterator positioned at the entry
+typedef std::function<rai::ErrorCode(size_t, rai::Transaction&,
+                                     rai::Iterator&)>
+    ScanCallback;
+
 enum class MetaKey : uint32_t
 {
     VERSION            = 0,
     SELECTED_WALLET_ID = 1,
+    BLOCK_INDEX_MIGRATION = 2,
+    MEMORY_TABLES_SEQUENCE = 4,
 };
 
 typedef std::multimap<rai::ReceivableInfo, rai::BlockHash,
@@ -803,6 +1000,8 @@ class Ledger
 {
 public:
     Ledger(rai::ErrorCode&, rai::Store&, rai::LedgerType, bool = false,
+           bool = false,
+           size_t = rai::Ledger::DEFAULT_ACCOUNT_INFO_CACHE_SIZE,
            bool = false);
 
     bool AccountInfoPut(rai::Transaction&, const rai::Account&,
@@ -811,6 +1010,10 @@ public:
                         rai::AccountInfo&) const;
     bool AccountInfoGet(const rai::Iterator&, rai::Account&,
                         rai::AccountInfo&) const;
+    // results follow the order of the accounts, missing ones are not Valid()
+    bool AccountInfoGetMany(rai::Transaction&,
+                            const std::vector<rai::Account>&,
+                            std::vector<rai::AccountInfo>&) const;
     bool AccountInfoDel(rai::Transaction&, const rai::Account&);
     rai::Iterator AccountInfoBegin(rai::Transaction&);
     rai::Iterator AccountInfoEnd(rai::Transaction&);
@@ -865,6 +1068,8 @@ public:
                                     rai::Chain) const;
     rai::Iterator BindingLowerBound(rai::Transaction&,
                                     const rai::Account&) const;
+    rai::Iterator BindingLowerBound(rai::Transaction&,
+                                    const rai::BindingKey&) const;
     rai::Iterator BindingUpperBound(rai::Transaction&, const rai::Account&,
                                     rai::Chain) const;
     rai::Iterator BindingUpperBound(rai::Transaction&,
@@ -879,6 +1084,9 @@ public:
                              rai::TokenAddress&, rai::AccountTokenInfo&) const;
     rai::Iterator AccountTokenInfoLowerBound(rai::Transaction&,
                                              const rai::Account&) const;
+    rai::Iterator AccountTokenInfoLowerBound(rai::Transaction&,
+                                             const rai::Account&, rai::Chain,
+                                             const rai::TokenAddress&) const;
     rai::Iterator AccountTokenInfoUpperBound(rai::Transaction&,
                                              const rai::Account&) const;
     bool AccountTokenLinkPut(rai::Transaction&, const rai::AccountTokenLink&,
@@ -1139,6 +1347,15 @@ public:
                   std::shared_ptr<rai::Block>&) const;
     bool BlockGet(rai::Transaction&, const rai::Account&, uint64_t,
                   std::shared_ptr<rai::Block>&, rai::BlockHash&) const;
+    // results follow the order of the hashes, missing blocks are nullptr
+    bool BlockGetMany(rai::Transaction&, const std::vector<rai::BlockHash>&,
+                      std::vector<std::shared_ptr<rai::Block>>&) const;
+    bool BlockViewGet(rai::Transaction&, const rai::BlockHash&,
+                      rai::BlockView&) const;
+    bool BlockViewGet(rai::Transaction&, const rai::BlockHash&,
+                      rai::BlockView&, rai::BlockHash&) const;
+    bool BlocksRange(rai::Transaction&, const rai::Account&, uint64_t,
+                     uint64_t, std::vector<std::shared_ptr<rai::Block>>&) const;
     bool BlockDel(rai::Transaction&, const rai::BlockHash&);
     bool BlockCount(rai::Transaction&, size_t&) const;
     bool BlockExists(rai::Transaction&, const rai::BlockHash&) const;
@@ -1185,6 +1402,18 @@ public:
                                            const rai::Account&);
     rai::Iterator ReceivableInfoUpperBound(rai::Transaction&,
                                            const rai::Account&);
+    bool ReceivableIndexGet(const rai::Iterator&, rai::Account&,
+                            rai::ReceivableInfosType&, rai::BlockHash&,
+                            rai::ReceivableInfo&) const;
+    rai::Iterator ReceivableIndexLowerBound(rai::Transaction&,
+                                            const rai::Account&,
+                                            rai::ReceivableInfosType);
+    rai::Iterator ReceivableIndexUpperBound(rai::Transaction&,
+                                            const rai::Account&,
+                                            rai::ReceivableInfosType);
+    bool ReceivablesConfirmedSet(rai::Transaction&, const rai::Account&,
+                                 uint64_t, uint64_t, bool);
+    bool ReceivablesIndexed() const;
     bool RewardableInfoPut(rai::Transaction&, const rai::Account&,
                            const rai::BlockHash&, const rai::RewardableInfo&);
     bool RewardableInfoGet(rai::Transaction&, const rai::Account&,
@@ -1195,6 +1424,9 @@ public:
                            const rai::BlockHash&);
     rai::Iterator RewardableInfoLowerBound(rai::Transaction&,
                                            const rai::Account&);
+    rai::Iterator RewardableInfoLowerBound(rai::Transaction&,
+                                           const rai::Account&,
+                                           const rai::BlockHash&);
     rai::Iterator RewardableInfoUpperBound(rai::Transaction&,
                                            const rai::Account&);
     bool RollbackBlockPut(rai::Transaction&, const rai::BlockHash&,
@@ -1237,9 +1469,51 @@ public:
     void UpdateDelegatorList(const rai::Block&);
     std::vector<rai::DelegatorListEntry> GetDelegatorList(const rai::Account&,
                                                           uint64_t);
+    void BlockCacheStatus(rai::Ptree&) const;
+    void AccountInfoCacheStatus(rai::Ptree&) const;
+    void ReadTransactionPoolStatus(rai::Ptree&) const;
+    void SyncStatus(rai::Ptree&) const;
+    rai::ErrorCode TransactionsCheck(std::vector<rai::TransactionInfo>&);
+    void TransactionsStatus(rai::Ptree&, bool) const;
+    rai::ErrorCode BlockIndexMigrate(size_t, bool&);
+    rai::ErrorCode MemoryTablesCheckpoint();
+    bool BlockIndexDense() const;
+    rai::ErrorCode ParallelScan(MDB_dbi, size_t, const rai::ScanCallback&);
+    static size_t ParallelScanShards();
+    rai::ErrorCode Prune(uint64_t, uint64_t, size_t, rai::Account&, bool&);
+    void PruneStatus(rai::Ptree&) const;
+    bool LedgerCountersGet(rai::Transaction&, rai::LedgerCounters&) const;
+    bool LedgerCountersCompute(rai::Transaction&, rai::LedgerCounters&) const;
+    bool LedgerCountersPut(rai::Transaction&, const rai::LedgerCounters&);
+    void RetentionSet(const rai::RetentionPolicy&, const rai::RetentionPolicy&);
+    rai::RetentionPolicy RollbackRetention() const;
+    rai::RetentionPolicy ForkRetention() const;
+    rai::ErrorCode RetentionSweep(size_t, bool&);
+    rai::ErrorCode RetentionStatus(rai::Ptree&);
+
+    static size_t constexpr DEFAULT_ACCOUNT_INFO_CACHE_SIZE = 256 * 1024;
+    static size_t constexpr BLOCK_INDEX_MIGRATION_BATCH = 16 * 1024;
+    // shards split the key space on the first key byte
+    static size_t constexpr MAX_SCAN_SHARDS = 256;
+    static uint64_t constexpr DEFAULT_PRUNE_DEPTH = 1024;
+    static uint64_t constexpr DEFAULT_PRUNE_AGE = 30 * 24 * 3600;
+    static size_t constexpr PRUNE_BATCH = 512;
+    static uint64_t constexpr DEFAULT_ROLLBACK_MAX_AGE = 7 * 24 * 3600;
+    static uint32_t constexpr DEFAULT_ROLLBACK_MAX_PER_ACCOUNT = 64;
+    static uint64_t constexpr DEFAULT_FORK_MAX_AGE = 30 * 24 * 3600;
+    static size_t constexpr RETENTION_SWEEP_BATCH = 512;
+    // milliseconds a transaction may stay open before it is reported
+    static uint64_t constexpr LONG_TRANSACTION_AGE = 60 * 1000;
+    // items a long read scan visits before it renews its snapshot
+    static size_t constexpr SCAN_RENEW_INTERVAL = 256;
 
     rai::ErrorCode UpgradeWallet(rai::Transaction&);
     rai::ErrorCode UpgradeWalletV1V2(rai::Transaction&);
+    rai::ErrorCode UpgradeNode(rai::Transaction&);
+    rai::ErrorCode UpgradeNodeV1V2(rai::Transaction&);
+    rai::ErrorCode UpgradeNodeV2V3(rai::Transaction&);
+    rai::ErrorCode UpgradeNodeV3V4(rai::Transaction&);
+    rai::ErrorCode UpgradeNodeV4V5(rai::Transaction&);
 
 private:
     friend class rai::Transaction;
@@ -1249,13 +1523,76 @@ private:
     bool BlockIndexGet_(rai::Transaction&, const rai::Account&, uint64_t,
                         rai::BlockHash&) const;
     bool BlockIndexDel_(rai::Transaction&, const rai::Account&, uint64_t);
+    bool BlockIndexMigrationPut_(rai::Transaction&, const rai::Account&,
+                                 uint64_t);
+    bool BlockIndexMigrationGet_(rai::Transaction&, rai::Account&,
+                                 uint64_t&) const;
+    bool BlockIndexMigrationDel_(rai::Transaction&);
+    bool AccountInfoOverlayGet_(rai::Transaction&, const rai::Account&,
+                                bool&, rai::AccountInfo&) const;
     void RepWeightsCommit_(const std::vector<rai::RepWeightOpration>&);
-    rai::ErrorCode InitMemoryTables_(rai::Transaction&);
+    // returns true if the snapshot is unusable and a scan is needed
+    bool InitMemoryTables_(rai::Transaction&);
+    rai::ErrorCode ScanMemoryTables_();
+    rai::ErrorCode ScanMemoryTables_(rai::Transaction&);
+    rai::ErrorCode LoadMemoryTables_(rai::Transaction&);
+    rai::ErrorCode MemoryTablesCheckpoint_(rai::Transaction&, bool);
+    void ApplyAccountDelegation_(const rai::Account&,
+                                 const rai::AccountDelegation&);
+    bool AccountDelegationCurrent_(rai::Transaction&, const rai::Account&,
+                                   rai::AccountDelegation&) const;
+    bool AccountsChangedPut_(rai::Transaction&);
+    void MemoryTablesCommit_(rai::Transaction&);
+    bool MetaUint64Put_(rai::Transaction&, rai::MetaKey, uint64_t);
+    bool MetaUint64Get_(rai::Transaction&, rai::MetaKey, uint64_t&) const;
+    bool MetaDel_(rai::Transaction&, rai::MetaKey);
+    rai::ErrorCode ParallelScanShard_(MDB_dbi, size_t, size_t,
+                                      std::atomic<bool>&,
+                                      const rai::ScanCallback&);
+    bool ReceivableIndexPut_(rai::Transaction&, const rai::Account&,
+                             const rai::BlockHash&, const rai::ReceivableInfo&);
+    bool ReceivableIndexDel_(rai::Transaction&, const rai::Account&,
+                             const rai::BlockHash&, const rai::ReceivableInfo&);
+    bool ReceivableIndexEntryPut_(rai::Transaction&, const rai::Account&,
+                                  rai::ReceivableInfosType,
+                                  const rai::BlockHash&,
+                                  const rai::ReceivableInfo&);
+    bool ReceivableIndexEntryDel_(rai::Transaction&, const rai::Account&,
+                                  rai::ReceivableInfosType,
+                                  const rai::BlockHash&, const rai::Amount&);
+    bool ReceivableSourceExists_(rai::Transaction&, const rai::Account&,
+                                 uint64_t) const;
+    rai::ErrorCode PruneAccount_(rai::Transaction&, const rai::Account&,
+                                 rai::AccountInfo&, uint64_t, uint64_t, size_t,
+                                 size_t&);
+    bool PrunablePages_(rai::Transaction&, uint64_t&) const;
+    void LedgerCounterAdd_(rai::Transaction&, rai::LedgerCounterType, uint32_t,
+                           const rai::uint128_t&, bool);
+    void LedgerCountersBlock_(rai::Transaction&, const rai::Block&, bool);
+    bool LedgerCountersCommit_(rai::Transaction&);
+    static uint64_t ConfirmedBlocks_(const rai::AccountInfo&);
+    bool RollbackBlockDel_(rai::Transaction&, const rai::BlockHash&);
+    bool RollbackExpiryPut_(rai::Transaction&, const rai::BlockHash&,
+                            const rai::Account&, uint64_t);
+    bool RollbackExpiryDel_(rai::Transaction&, const rai::BlockHash&,
+                            const rai::Account&, uint64_t);
+    bool RollbackAccountLimit_(rai::Transaction&, const rai::Account&,
+                               size_t&);
+    bool ForkTimestamp_(rai::Transaction&, const rai::Account&, uint64_t,
+                        uint64_t&) const;
+    bool ForkExpiryPut_(rai::Transaction&, const rai::Account&, uint64_t,
+                        uint64_t);
+    bool ForkExpiryDel_(rai::Transaction&, const rai::Account&, uint64_t,
+                        uint64_t);
+    rai::ErrorCode SweepRollbacks_(rai::Transaction&, uint64_t, size_t,
+                                   size_t&);
+    rai::ErrorCode SweepForks_(rai::Transaction&, uint64_t, size_t, size_t&);
     void UpdateRichList_(const rai::Account&, const rai::Amount&);
     void UpdateDelegatorList_(const rai::Account&, const rai::Account&,
                               const rai::Amount&, rai::BlockType);
 
     static uint32_t constexpr BLOCKS_PER_INDEX = 8;
+    static size_t constexpr BLOCK_CACHE_SIZE = 64 * 1024;
     const rai::Amount RICH_LIST_MINIMUM = rai::Amount(10 * rai::RAI);
 
     rai::Store& store_;
@@ -1270,5 +1607,43 @@ private:
     bool enable_delegator_list_;
     mutable std::mutex delegator_list_mutex_;
     rai::DelegatorList delegator_list_;
+
+    mutable rai::LedgerBlockCache block_cache_;
+    mutable rai::AccountInfoCache account_info_cache_;
+
+    // node ledgers configured with dense_block_index index every height,
+    // other ledgers only index every BLOCKS_PER_INDEX heights
+    bool dense_block_index_;
+    std::atomic<bool> block_index_migrated_;
+
+    // node ledgers keep a snapshot of the in-memory tables on disk
+    bool memory_tables_snapshot_;
+    // set once the tables are loaded or scanned, the snapshot marker is only
+    // advanced while it holds
+    std::atomic<bool> memory_tables_synced_;
+
+    // node ledgers index receivables by confirmation state and amount
+    bool receivables_indexed_;
+
+    // node ledgers keep the ledger_counters table up to date
+    bool counters_enabled_;
+
+    std::atomic<uint64_t> pruned_blocks_;
+    std::atomic<uint64_t> pruned_pages_;
+    std::atomic<uint64_t> prune_passes_;
+
+    // node ledgers index rollbacks and forks by the time they were stored
+    bool retention_indexed_;
+    mutable std::mutex retention_mutex_;
+    rai::RetentionPolicy rollback_retention_;
+    rai::RetentionPolicy fork_retention_;
+    std::atomic<uint64_t> swept_rollbacks_;
+    std::atomic<uint64_t> swept_forks_;
+    std::atomic<uint64_t> sweep_passes_;
+    std::chrono::steady_clock::time_point sweep_start_;
+
+    rai::TransactionRegistry transaction_registry_;
+    std::atomic<uint64_t> reader_checks_;
+    std::atomic<uint64_t> stale_readers_;
 };
 }  // namespace rai
\ No newline at end of file
@@ -1,8 +1,119 @@
 #include <rai/secure/lmdb.hpp>
 
+size_t constexpr rai::MdbEnv::MAX_READ_TRANSACTION_POOL_SIZE;
+
+std::string rai::StoreDurabilityToString(rai::StoreDurability durability)
+{
+    switch (durability)
+    {
+        case rai::StoreDurability::FULL:
+        {
+            return "full";
+        }
+        case rai::StoreDurability::META_ASYNC:
+        {
+            return "meta_async";
+        }
+        case rai::StoreDurability::PERIODIC:
+        {
+            return "periodic";
+        }
+        default:
+        {
+            return "invalid";
+        }
+    }
+}
+
+rai::StoreDurability rai::StringToStoreDurability(const std::string& str)
+{
+    if (str == "full")
+    {
+        return rai::StoreDurability::FULL;
+    }
+    else if (str == "meta_async")
+    {
+        return rai::StoreDurability::META_ASYNC;
+    }
+    else if (str == "periodic")
+    {
+        return rai::StoreDurability::PERIODIC;
+    }
+    else
+    {
+        return rai::StoreDurability::INVALID;
+    }
+}
+
+rai::MdbEnvOptions::MdbEnvOptions()
+    : engine_(rai::StoreEngineType::LMDB),
+      durability_(rai::StoreDurability::FULL),
+      map_size_(rai::MdbEnvOptions::DEFAULT_MAP_SIZE),
+      sync_interval_(rai::MdbEnvOptions::DEFAULT_SYNC_INTERVAL),
+      sync_commits_(rai::MdbEnvOptions::DEFAULT_SYNC_COMMITS)
+{
+}
+
+rai::MdbEnvOptions::MdbEnvOptions(rai::StoreEngineType engine)
+    : MdbEnvOptions()
+{
+    engine_ = engine;
+}
+
 rai::MdbEnv::MdbEnv(rai::ErrorCode& error_code,
-                    const boost::filesystem::path& path, int max_dbs)
+                    const boost::filesystem::path& path, int max_dbs,
+                    const rai::MdbEnvOptions& options)
+    : env_(nullptr),
+      read_transaction_pool_size_(rai::MdbEnv::READ_TRANSACTION_POOL_SIZE),
+      acquires_(0),
+      reuses_(0),
+      acquire_time_total_(0),
+      acquire_time_max_(0),
+      options_(options),
+      sync_stopped_(false),
+      commits_(0),
+      synced_commits_(0),
+      syncs_(0),
+      sync_failures_(0),
+      sync_time_max_(0),
+      last_sync_(std::chrono::steady_clock::now()),
+      unsynced_since_(last_sync_)
 {
+    if (options.engine_ == rai::StoreEngineType::MEMORY)
+    {
+        engine_.reset(new rai::MemoryEngine);
+        return;
+    }
+    else if (options.engine_ != rai::StoreEngineType::LMDB)
+    {
+        error_code = rai::ErrorCode::STORE_ENGINE;
+        return;
+    }
+
+    unsigned int flags = MDB_NOSUBDIR | MDB_NOTLS;
+    switch (options.durability_)
+    {
+        case rai::StoreDurability::FULL:
+        {
+            break;
+        }
+        case rai::StoreDurability::META_ASYNC:
+        {
+            flags |= MDB_NOMETASYNC;
+            break;
+        }
+        case rai::StoreDurability::PERIODIC:
+        {
+            flags |= MDB_NOSYNC;
+            break;
+        }
+        default:
+        {
+            error_code = rai::ErrorCode::STORE_DURABILITY;
+            return;
+        }
+    }
+
     if (!path.has_parent_path())
     {
         error_code = rai::ErrorCode::DATA_PATH;
@@ -13,9 +124,11 @@ rai::MdbEnv::MdbEnv(rai::ErrorCode& error_code,
     auto error = mdb_env_create(&env_);
     if (error)
     {
+        env_ = nullptr;
         error_code = rai::ErrorCode::MDB_ENV_CREATE;
         return;
     }
+    engine_.reset(new rai::LmdbEngine(env_));
 
     error = mdb_env_set_maxdbs(env_, max_dbs);
     if (error)
@@ -24,26 +137,50 @@ rai::MdbEnv::MdbEnv(rai::ErrorCode& error_code,
         return;
     }
 
-    error = mdb_env_set_mapsize(env_, 1ULL * 1024 * 1024 * 1024 * 128);
+    error = mdb_env_set_mapsize(env_, options.map_size_);
     if (error)
     {
         error_code = rai::ErrorCode::MDB_ENV_SET_MAPSIZE;
         return;
     }
 
-    error = mdb_env_open(env_, path.string().c_str(), MDB_NOSUBDIR | MDB_NOTLS,
-                         00600);
+    error = mdb_env_set_maxreaders(env_, rai::MdbEnv::MAX_READERS);
+    if (error)
+    {
+        error_code = rai::ErrorCode::MDB_ENV_SET_MAXREADERS;
+        return;
+    }
+
+    error = mdb_env_open(env_, path.string().c_str(), flags, 00600);
     if (error)
     {
         error_code = rai::ErrorCode::MDB_ENV_OPEN;
         return;
     }
+
+    if (options.durability_ == rai::StoreDurability::PERIODIC)
+    {
+        sync_thread_ = std::thread([this]() { SyncRun_(); });
+    }
 }
 
 rai::MdbEnv::~MdbEnv()
 {
+    SyncStop_();
+
+    for (auto txn : read_transactions_)
+    {
+        engine_->TxnAbort(txn);
+    }
+    read_transactions_.clear();
+
     if (env_)
     {
+        // MDB_NOSYNC skips the sync on close, flush what is left
+        if (options_.durability_ == rai::StoreDurability::PERIODIC)
+        {
+            mdb_env_sync(env_, 1);
+        }
         mdb_env_close(env_);
         env_ = nullptr;
     }
@@ -54,6 +191,277 @@ rai::MdbEnv::operator MDB_env*() const
     return env_;
 }
 
+MDB_txn* rai::MdbEnv::ReadTransactionAcquire()
+{
+    auto start = std::chrono::steady_clock::now();
+    MDB_txn* txn = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!read_transactions_.empty())
+        {
+            txn = read_transactions_.back();
+            read_transactions_.pop_back();
+        }
+    }
+
+    bool reused = false;
+    if (txn != nullptr)
+    {
+        auto ret = engine_->TxnRenew(txn);
+        if (ret == MDB_SUCCESS)
+        {
+            reused = true;
+        }
+        else
+        {
+            engine_->TxnAbort(txn);
+            txn = nullptr;
+        }
+    }
+
+    if (txn == nullptr)
+    {
+        auto ret = engine_->TxnBegin(nullptr, false, &txn);
+        if (ret != MDB_SUCCESS)
+        {
+            return nullptr;
+        }
+    }
+
+    uint64_t duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++acquires_;
+    if (reused)
+    {
+        ++reuses_;
+    }
+    acquire_time_total_ += duration;
+    if (duration > acquire_time_max_)
+    {
+        acquire_time_max_ = duration;
+    }
+    return txn;
+}
+
+void rai::MdbEnv::ReadTransactionRelease(MDB_txn* txn)
+{
+    if (txn == nullptr)
+    {
+        return;
+    }
+
+    engine_->TxnReset(txn);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (read_transactions_.size() < read_transaction_pool_size_)
+        {
+            read_transactions_.push_back(txn);
+            return;
+        }
+    }
+    engine_->TxnAbort(txn);
+}
+
+void rai::MdbEnv::ReadTransactionPoolSize(size_t size)
+{
+    std::vector<MDB_txn*> txns;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        read_transaction_pool_size_ = std::min(
+            size, rai::MdbEnv::MAX_READ_TRANSACTION_POOL_SIZE);
+        while (read_transactions_.size() > read_transaction_pool_size_)
+        {
+            txns.push_back(read_transactions_.back());
+            read_transactions_.pop_back();
+        }
+    }
+
+    for (auto txn : txns)
+    {
+        engine_->TxnAbort(txn);
+    }
+}
+
+void rai::MdbEnv::ReadTransactionPoolStatus(rai::Ptree& status) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    status.put("pool_size", read_transaction_pool_size_);
+    status.put("idle", read_transactions_.size());
+    status.put("acquires", acquires_);
+    status.put("reuses", reuses_);
+    status.put("acquire_time_average_us",
+               acquires_ == 0 ? 0 : acquire_time_total_ / acquires_);
+    status.put("acquire_time_max_us", acquire_time_max_);
+}
+
+bool rai::MdbEnv::ReaderCheck(int& dead)
+{
+    dead = 0;
+    if (env_ == nullptr)
+    {
+        return false;
+    }
+
+    return mdb_reader_check(env_, &dead) != MDB_SUCCESS;
+}
+
+rai::StoreEngine& rai::MdbEnv::Engine() const
+{
+    return *engine_;
+}
+
+int rai::MdbEnv::DbiOpen(MDB_txn* txn, const char* name, unsigned int flags,
+                         MDB_dbi* dbi)
+{
+    int ret = engine_->DbiOpen(txn, name, flags, dbi);
+    if (ret == MDB_SUCCESS && name != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tables_.emplace_back(name, *dbi);
+    }
+    return ret;
+}
+
+std::vector<std::pair<std::string, MDB_dbi>> rai::MdbEnv::Tables() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tables_;
+}
+
+boost::filesystem::path rai::MdbEnv::Path() const
+{
+    const char* path = nullptr;
+    if (env_ == nullptr || mdb_env_get_path(env_, &path) != MDB_SUCCESS
+        || path == nullptr)
+    {
+        return boost::filesystem::path();
+    }
+    return boost::filesystem::path(path);
+}
+
+void rai::MdbEnv::WriteCommitted()
+{
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    if (commits_ == synced_commits_)
+    {
+        unsynced_since_ = std::chrono::steady_clock::now();
+    }
+    ++commits_;
+    if (options_.durability_ == rai::StoreDurability::PERIODIC
+        && options_.sync_commits_ > 0
+        && commits_ - synced_commits_ >= options_.sync_commits_)
+    {
+        sync_condition_.notify_all();
+    }
+}
+
+void rai::MdbEnv::SyncStatus(rai::Ptree& status) const
+{
+    auto now = std::chrono::steady_clock::now();
+    status.put("engine", rai::StoreEngineTypeToString(engine_->Type()));
+    status.put("durability",
+               rai::StoreDurabilityToString(options_.durability_));
+    status.put("map_size", std::to_string(options_.map_size_));
+    if (options_.durability_ == rai::StoreDurability::PERIODIC)
+    {
+        status.put("sync_interval", options_.sync_interval_);
+        status.put("sync_commits", options_.sync_commits_);
+    }
+
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    status.put("commits", commits_);
+    if (options_.durability_ != rai::StoreDurability::PERIODIC)
+    {
+        return;
+    }
+    // the lag bounds the window of commits a system crash can lose
+    uint64_t lag = 0;
+    if (commits_ != synced_commits_)
+    {
+        lag = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  now - unsynced_since_)
+                  .count();
+    }
+    status.put("unsynced_commits", commits_ - synced_commits_);
+    status.put("sync_lag_ms", lag);
+    status.put("last_sync_ms_ago",
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   now - last_sync_)
+                   .count());
+    status.put("syncs", syncs_);
+    status.put("sync_failures", sync_failures_);
+    status.put("sync_time_max_us", sync_time_max_);
+}
+
+void rai::MdbEnv::SyncRun_()
+{
+    std::unique_lock<std::mutex> lock(sync_mutex_);
+    while (!sync_stopped_)
+    {
+        sync_condition_.wait_for(
+            lock, std::chrono::milliseconds(options_.sync_interval_), [&]() {
+                return sync_stopped_
+                       || (options_.sync_commits_ > 0
+                           && commits_ - synced_commits_
+                                  >= options_.sync_commits_);
+            });
+        if (sync_stopped_)
+        {
+            break;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t commits = commits_;
+        if (commits == synced_commits_)
+        {
+            last_sync_ = start;
+            continue;
+        }
+
+        lock.unlock();
+        int ret = mdb_env_sync(env_, 1);
+        auto end = std::chrono::steady_clock::now();
+        lock.lock();
+
+        if (ret != MDB_SUCCESS)
+        {
+            ++sync_failures_;
+            continue;
+        }
+        ++syncs_;
+        synced_commits_ = commits;
+        last_sync_ = start;
+        if (commits_ != synced_commits_)
+        {
+            // committed while syncing, may not be covered
+            unsynced_since_ = start;
+        }
+        uint64_t duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+                .count();
+        if (duration > sync_time_max_)
+        {
+            sync_time_max_ = duration;
+        }
+    }
+}
+
+void rai::MdbEnv::SyncStop_()
+{
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex_);
+        sync_stopped_ = true;
+    }
+    sync_condition_.notify_all();
+    if (sync_thread_.joinable())
+    {
+        sync_thread_.join();
+    }
+}
+
 rai::MdbVal::MdbVal() : value_{0, nullptr}
 {
 }
@@ -111,21 +519,32 @@ rai::MdbVal::operator const MDB_val&() const
 rai::MdbTransaction::MdbTransaction(rai::ErrorCode& error_code,
                                     rai::MdbEnv& env, MDB_txn* parent,
                                     bool write)
-    : env_(env)
+    : handle_(nullptr),
+      env_(env),
+      pooled_(!write && parent == nullptr),
+      top_write_(write && parent == nullptr)
 {
-    auto error = mdb_txn_begin(env_, parent, write ? 0 : MDB_RDONLY, &handle_);
+    if (pooled_)
+    {
+        handle_ = env_.ReadTransactionAcquire();
+        if (handle_ == nullptr)
+        {
+            error_code = rai::ErrorCode::MDB_TXN_BEGIN;
+        }
+        return;
+    }
+
+    auto error = env_.Engine().TxnBegin(parent, write, &handle_);
     if (error)
     {
+        handle_ = nullptr;
         error_code = rai::ErrorCode::MDB_TXN_BEGIN;
     }
 }
 
 rai::MdbTransaction::~MdbTransaction()
 {
-    if (handle_)
-    {
-        mdb_txn_commit(handle_);
-    }
+    Commit();
 }
 
 rai::MdbTransaction::operator MDB_txn*() const
@@ -135,25 +554,73 @@ rai::MdbTransaction::operator MDB_txn*() const
 
 void rai::MdbTransaction::Abort()
 {
-    if (handle_)
+    if (handle_ && pooled_)
+    {
+        env_.ReadTransactionRelease(handle_);
+        handle_ = nullptr;
+    }
+    else if (handle_)
+    {
+        env_.Engine().TxnAbort(handle_);
+        handle_ = nullptr;
+    }
+}
+
+bool rai::MdbTransaction::Commit()
+{
+    if (handle_ && pooled_)
     {
-        mdb_txn_abort(handle_);
+        env_.ReadTransactionRelease(handle_);
         handle_ = nullptr;
     }
+    else if (handle_)
+    {
+        auto ret = env_.Engine().TxnCommit(handle_);
+        handle_ = nullptr;
+        if (ret != MDB_SUCCESS)
+        {
+            return true;
+        }
+        if (top_write_)
+        {
+            env_.WriteCommitted();
+        }
+    }
+    return false;
 }
 
+bool rai::MdbTransaction::Renew()
+{
+    if (handle_ == nullptr || !pooled_)
+    {
+        return true;
+    }
 
-rai::StoreIterator::StoreIterator(MDB_txn* txn, MDB_dbi dbi) : cursor_(nullptr)
+    env_.Engine().TxnReset(handle_);
+    auto ret = env_.Engine().TxnRenew(handle_);
+    if (ret != MDB_SUCCESS)
+    {
+        env_.Engine().TxnAbort(handle_);
+        handle_ = nullptr;
+        return true;
+    }
+    return false;
+}
+
+
+rai::StoreIterator::StoreIterator(const rai::MdbTransaction& txn,
+                                  MDB_dbi dbi)
+    : cursor_(nullptr)
 {
-    auto ret = mdb_cursor_open(txn, dbi, &cursor_);
+    auto ret = txn.env_.Engine().CursorOpen(txn, dbi, cursor_);
     assert(ret == 0);
-    ret = mdb_cursor_get(cursor_, &current_.first.value_,
-                         &current_.second.value_, MDB_FIRST);
+    ret = cursor_->Get(&current_.first.value_, &current_.second.value_,
+                       MDB_FIRST);
     assert(ret == 0 || ret == MDB_NOTFOUND);
     if (ret == 0)
     {
-        ret = mdb_cursor_get(cursor_, &current_.first.value_,
-                            &current_.second.value_, MDB_GET_CURRENT);
+        ret = cursor_->Get(&current_.first.value_, &current_.second.value_,
+                           MDB_GET_CURRENT);
         assert(ret == 0 || ret == MDB_NOTFOUND);
     }
     else
@@ -166,19 +633,20 @@ rai::StoreIterator::StoreIterator(std::nullptr_t) : cursor_(nullptr)
 {
 }
 
-rai::StoreIterator::StoreIterator(MDB_txn* txn, MDB_dbi dbi, const MDB_val& key)
+rai::StoreIterator::StoreIterator(const rai::MdbTransaction& txn,
+                                  MDB_dbi dbi, const MDB_val& key)
     : cursor_(nullptr)
 {
-    auto ret = mdb_cursor_open(txn, dbi, &cursor_);
+    auto ret = txn.env_.Engine().CursorOpen(txn, dbi, cursor_);
     assert(ret == 0);
     current_.first.value_ = key;
-    ret = mdb_cursor_get(cursor_, &current_.first.value_,
-                         &current_.second.value_, MDB_SET_RANGE);
+    ret = cursor_->Get(&current_.first.value_, &current_.second.value_,
+                       MDB_SET_RANGE);
     assert(ret == 0 || ret == MDB_NOTFOUND);
     if (ret == 0)
     {
-        ret = mdb_cursor_get(cursor_, &current_.first.value_,
-                            &current_.second.value_, MDB_GET_CURRENT);
+        ret = cursor_->Get(&current_.first.value_, &current_.second.value_,
+                           MDB_GET_CURRENT);
         assert(ret == 0 || ret == MDB_NOTFOUND);
     }
     else
@@ -189,17 +657,12 @@ rai::StoreIterator::StoreIterator(MDB_txn* txn, MDB_dbi dbi, const MDB_val& key)
 
 rai::StoreIterator::StoreIterator(rai::StoreIterator&& other)
 {
-    cursor_ = other.cursor_;
-    other.cursor_ = nullptr;
+    cursor_ = std::move(other.cursor_);
     current_ = other.current_;
 }
 
 rai::StoreIterator::~StoreIterator()
 {
-    if (cursor_ != nullptr)
-    {
-        mdb_cursor_close(cursor_);
-    }
 }
 
 rai::StoreIterator& rai::StoreIterator::operator++()
@@ -209,8 +672,8 @@ rai::StoreIterator& rai::StoreIterator::operator++()
         Clear();
         return *this;
     }
-    auto ret = mdb_cursor_get(cursor_, &current_.first.value_,
-                              &current_.second.value_, MDB_NEXT);
+    auto ret = cursor_->Get(&current_.first.value_, &current_.second.value_,
+                            MDB_NEXT);
     assert(ret == 0 || ret == MDB_NOTFOUND);
     if (ret != 0)
     {
@@ -226,8 +689,8 @@ void rai::StoreIterator::NextDup()
         Clear();
         return;
     }
-    auto ret = mdb_cursor_get(cursor_, &current_.first.value_,
-                              &current_.second.value_, MDB_NEXT_DUP);
+    auto ret = cursor_->Get(&current_.first.value_, &current_.second.value_,
+                            MDB_NEXT_DUP);
     assert(ret == 0 || ret == MDB_NOTFOUND);
     if (ret != 0)
     {
@@ -237,12 +700,7 @@ void rai::StoreIterator::NextDup()
 
 rai::StoreIterator& rai::StoreIterator::operator=(rai::StoreIterator&& other)
 {
-    if (cursor_ != nullptr)
-    {
-        mdb_cursor_close(cursor_);
-    }
-    cursor_ = other.cursor_;
-    other.cursor_ = nullptr;
+    cursor_ = std::move(other.cursor_);
     current_ = other.current_;
     other.Clear();
     return *this;
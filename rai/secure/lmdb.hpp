@@ -1,19 +1,106 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 #include <boost/filesystem.hpp>
 #include <lmdb/libraries/liblmdb/lmdb.h>
 #include <rai/common/errors.hpp>
 #include <rai/common/numbers.hpp>
+#include <rai/common/util.hpp>
+#include <rai/secure/engine.hpp>
 
 namespace rai
 {
+enum class StoreDurability : uint32_t
+{
+    INVALID    = 0,
+    FULL       = 1,  // every commit is synced
+    META_ASYNC = 2,  // MDB_NOMETASYNC, the last commit may be lost
+    PERIODIC   = 3,  // MDB_NOSYNC, synced by a background thread
+};
+std::string StoreDurabilityToString(rai::StoreDurability);
+rai::StoreDurability StringToStoreDurability(const std::string&);
+
+class MdbEnvOptions
+{
+public:
+    MdbEnvOptions();
+    explicit MdbEnvOptions(rai::StoreEngineType);
+
+    static uint64_t constexpr DEFAULT_MAP_SIZE =
+        1ULL * 1024 * 1024 * 1024 * 128;
+    static uint64_t constexpr DEFAULT_SYNC_INTERVAL = 1000;  // milliseconds
+    static uint64_t constexpr DEFAULT_SYNC_COMMITS = 1000;
+
+    rai::StoreEngineType engine_;
+    rai::StoreDurability durability_;
+    uint64_t map_size_;
+    // periodic durability: sync after the interval or after the number of
+    // commits, whichever comes first; 0 disables the commit trigger
+    uint64_t sync_interval_;
+    uint64_t sync_commits_;
+};
+
 class MdbEnv
 {
 public:
-    MdbEnv(rai::ErrorCode&, const boost::filesystem::path&, int);
+    MdbEnv(rai::ErrorCode&, const boost::filesystem::path&, int,
+           const rai::MdbEnvOptions& = rai::MdbEnvOptions());
     ~MdbEnv();
     operator MDB_env*() const;
+    rai::StoreEngine& Engine() const;
+    int DbiOpen(MDB_txn*, const char*, unsigned int, MDB_dbi*);
+    MDB_txn* ReadTransactionAcquire();
+    void ReadTransactionRelease(MDB_txn*);
+    void ReadTransactionPoolSize(size_t);
+    void ReadTransactionPoolStatus(rai::Ptree&) const;
+    boost::filesystem::path Path() const;
+    void WriteCommitted();
+    void SyncStatus(rai::Ptree&) const;
+    // name and handle of every table opened on the environment
+    std::vector<std::pair<std::string, MDB_dbi>> Tables() const;
+    // clears reader slots left by dead processes, no-op for other engines
+    bool ReaderCheck(int&);
+
+    static size_t constexpr READ_TRANSACTION_POOL_SIZE = 64;
+    // every pooled read transaction keeps its reader slot, the rest covers
+    // the verifier threads, the parallel scan shards, rpc and bootstrap
+    static unsigned int constexpr MAX_READERS = 1024;
+    static size_t constexpr MAX_READ_TRANSACTION_POOL_SIZE = MAX_READERS / 4;
+
+    // nullptr unless the engine is lmdb
     MDB_env* env_;
+
+private:
+    std::unique_ptr<rai::StoreEngine> engine_;
+    // reset read-only transactions waiting to be renewed, MDB_NOTLS allows
+    // them to be reused by any thread
+    mutable std::mutex mutex_;
+    std::vector<MDB_txn*> read_transactions_;
+    size_t read_transaction_pool_size_;
+    uint64_t acquires_;
+    uint64_t reuses_;
+    uint64_t acquire_time_total_;
+    uint64_t acquire_time_max_;
+    std::vector<std::pair<std::string, MDB_dbi>> tables_;
+
+    void SyncRun_();
+    void SyncStop_();
+
+    rai::MdbEnvOptions options_;
+    mutable std::mutex sync_mutex_;
+    std::condition_variable sync_condition_;
+    bool sync_stopped_;
+    uint64_t commits_;
+    uint64_t synced_commits_;
+    uint64_t syncs_;
+    uint64_t sync_failures_;
+    uint64_t sync_time_max_;
+    std::chrono::steady_clock::time_point last_sync_;
+    // when the oldest commit not covered by a sync happened
+    std::chrono::steady_clock::time_point unsynced_since_;
+    std::thread sync_thread_;
 };
 
 class MdbVal
@@ -43,17 +130,26 @@ public:
     rai::MdbTransaction& operator=(const rai::MdbTransaction&) = delete;
     operator MDB_txn*() const;
     void Abort();
+    // returns true if the commit failed, the changes are then discarded
+    bool Commit();
+    // top-level read transactions only: drops the snapshot and takes a new
+    // one, cursors opened before are invalidated
+    bool Renew();
 
     MDB_txn* handle_;
     rai::MdbEnv& env_;
+
+private:
+    bool pooled_;
+    bool top_write_;
 };
 
 class StoreIterator
 {
 public:
-    StoreIterator(MDB_txn*, MDB_dbi);
+    StoreIterator(const rai::MdbTransaction&, MDB_dbi);
     StoreIterator(std::nullptr_t);
-    StoreIterator(MDB_txn*, MDB_dbi, const MDB_val&);
+    StoreIterator(const rai::MdbTransaction&, MDB_dbi, const MDB_val&);
     StoreIterator(rai::StoreIterator&&);
     StoreIterator(const rai::StoreIterator&) = delete;
     ~StoreIterator();
@@ -69,7 +165,7 @@ public:
     void Clear();
 
 private:
-    MDB_cursor* cursor_;
+    std::unique_ptr<rai::StoreCursor> cursor_;
     std::pair<rai::MdbVal, rai::MdbVal> current_;
 };
 };
\ No newline at end of file
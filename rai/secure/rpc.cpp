@@ -626,6 +626,23 @@ bool rai::RpcHandler::GetChainOrId_(rai::Chain& chain)
     return GetChainById_(chain);
 }
 
+// The optional count is the number of entries sampled per table for the key
+// and value size histograms
+void rai::RpcHandler::StoreStats_(rai::Store& store)
+{
+    uint64_t samples = 0;
+    if (request_.get_optional<std::string>("count"))
+    {
+        bool error = GetCount_(samples);
+        IF_ERROR_RETURN_VOID(error);
+    }
+
+    rai::Ptree stats;
+    error_code_ = store.Stats(stats, samples);
+    IF_NOT_SUCCESS_RETURN_VOID(error_code_);
+    response_.put_child("stats", stats);
+}
+
 std::unique_ptr<rai::Rpc> rai::MakeRpc(boost::asio::io_service& service,
                                        const rai::RpcConfig& config,
                                        const rai::RpcHandlerMaker& maker)
@@ -7,6 +7,7 @@
 #include <rai/common/errors.hpp>
 #include <rai/common/util.hpp>
 #include <rai/common/blocks.hpp>
+#include <rai/secure/store.hpp>
 
 namespace rai
 {
@@ -103,6 +104,7 @@ protected:
     bool GetChain_(rai::Chain&);
     bool GetChainById_(rai::Chain&);
     bool GetChainOrId_(rai::Chain&);
+    void StoreStats_(rai::Store&);
 };
 
 std::unique_ptr<rai::Rpc> MakeRpc(boost::asio::io_service&,
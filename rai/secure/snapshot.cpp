@@ -0,0 +1,321 @@
+#include <rai/secure/snapshot.hpp>
+
+#include <fstream>
+#include <blake2/blake2.h>
+#include <boost/property_tree/json_parser.hpp>
+#include <rai/common/parameters.hpp>
+#include <rai/secure/ledger.hpp>
+#include <rai/secure/util.hpp>
+
+namespace
+{
+boost::filesystem::path LockFile(const boost::filesystem::path& file)
+{
+    return boost::filesystem::path(file.string() + "-lock");
+}
+
+rai::ErrorCode InspectLedger(rai::Ledger& ledger,
+                             rai::SnapshotManifest& manifest)
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::Transaction transaction(error_code, ledger, false);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    bool error = ledger.VersionGet(transaction, manifest.ledger_version_);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_VERSION);
+
+    size_t count = 0;
+    error = ledger.AccountCount(transaction, count);
+    IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_ACCOUNT_COUNT);
+    manifest.account_count_ = count;
+
+    blake2b_state state;
+    int ret = blake2b_init(&state, sizeof(manifest.heads_.bytes));
+    assert(0 == ret);
+    for (auto i = ledger.AccountInfoBegin(transaction),
+              n = ledger.AccountInfoEnd(transaction);
+         i != n; ++i)
+    {
+        rai::Account account;
+        rai::AccountInfo info;
+        error = ledger.AccountInfoGet(i, account, info);
+        IF_ERROR_RETURN(error, rai::ErrorCode::LEDGER_ACCOUNT_INFO_GET);
+
+        std::vector<uint8_t> bytes;
+        {
+            rai::VectorStream stream(bytes);
+            rai::Write(stream, account.bytes);
+            rai::Write(stream, info.head_height_);
+            rai::Write(stream, info.head_.bytes);
+        }
+        ret = blake2b_update(&state, bytes.data(), bytes.size());
+        assert(0 == ret);
+    }
+    ret = blake2b_final(&state, manifest.heads_.bytes.data(),
+                        sizeof(manifest.heads_.bytes));
+    assert(0 == ret);
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+// Opens the copied ledger file on its own, so the manifest always describes
+// exactly what was written
+rai::ErrorCode Inspect(const boost::filesystem::path& file,
+                       rai::SnapshotManifest& manifest)
+{
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    {
+        rai::Store store(error_code, file);
+        rai::Ledger ledger(error_code, store, rai::LedgerType::INVALID);
+        if (error_code == rai::ErrorCode::SUCCESS)
+        {
+            error_code = InspectLedger(ledger, manifest);
+        }
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::remove(LockFile(file), ec);
+    return error_code;
+}
+
+bool Checksum(const boost::filesystem::path& file, uint64_t& size,
+              rai::uint256_union& checksum)
+{
+    std::ifstream stream(file.string(), std::ios::in | std::ios::binary);
+    if (!stream)
+    {
+        return true;
+    }
+
+    blake2b_state state;
+    int ret = blake2b_init(&state, sizeof(checksum.bytes));
+    assert(0 == ret);
+
+    size = 0;
+    std::vector<char> buffer(1024 * 1024);
+    while (stream)
+    {
+        stream.read(buffer.data(), buffer.size());
+        std::streamsize count = stream.gcount();
+        if (count <= 0)
+        {
+            break;
+        }
+        ret = blake2b_update(&state, buffer.data(), count);
+        assert(0 == ret);
+        size += count;
+    }
+    if (stream.bad())
+    {
+        return true;
+    }
+
+    ret = blake2b_final(&state, checksum.bytes.data(), sizeof(checksum.bytes));
+    assert(0 == ret);
+    return false;
+}
+}  // namespace
+
+rai::SnapshotManifest::SnapshotManifest()
+    : network_(rai::NetworkString()),
+      ledger_version_(0),
+      account_count_(0),
+      heads_(0),
+      size_(0),
+      checksum_(0)
+{
+}
+
+rai::ErrorCode rai::SnapshotManifest::DeserializeJson(const rai::Ptree& ptree)
+{
+    try
+    {
+        uint32_t version = 0;
+        bool error =
+            rai::StringToUint(ptree.get<std::string>("version"), version);
+        if (error || version != rai::SnapshotManifest::VERSION)
+        {
+            return rai::ErrorCode::SNAPSHOT_MANIFEST;
+        }
+
+        network_ = ptree.get<std::string>("network");
+
+        error = rai::StringToUint(ptree.get<std::string>("ledger_version"),
+                                  ledger_version_);
+        IF_ERROR_RETURN(error, rai::ErrorCode::SNAPSHOT_MANIFEST);
+
+        error = rai::StringToUint(ptree.get<std::string>("account_count"),
+                                  account_count_);
+        IF_ERROR_RETURN(error, rai::ErrorCode::SNAPSHOT_MANIFEST);
+
+        error = heads_.DecodeHex(ptree.get<std::string>("heads"));
+        IF_ERROR_RETURN(error, rai::ErrorCode::SNAPSHOT_MANIFEST);
+
+        error = rai::StringToUint(ptree.get<std::string>("size"), size_);
+        IF_ERROR_RETURN(error, rai::ErrorCode::SNAPSHOT_MANIFEST);
+
+        error = checksum_.DecodeHex(ptree.get<std::string>("checksum"));
+        IF_ERROR_RETURN(error, rai::ErrorCode::SNAPSHOT_MANIFEST);
+    }
+    catch (...)
+    {
+        return rai::ErrorCode::SNAPSHOT_MANIFEST;
+    }
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+void rai::SnapshotManifest::SerializeJson(rai::Ptree& ptree) const
+{
+    ptree.put("version", std::to_string(rai::SnapshotManifest::VERSION));
+    ptree.put("network", network_);
+    ptree.put("ledger_version", std::to_string(ledger_version_));
+    ptree.put("account_count", std::to_string(account_count_));
+    ptree.put("heads", heads_.StringHex());
+    ptree.put("size", std::to_string(size_));
+    ptree.put("checksum", checksum_.StringHex());
+}
+
+bool rai::SnapshotManifest::Match(const rai::SnapshotManifest& other) const
+{
+    return network_ == other.network_
+           && ledger_version_ == other.ledger_version_
+           && account_count_ == other.account_count_ && heads_ == other.heads_
+           && size_ == other.size_ && checksum_ == other.checksum_;
+}
+
+rai::ErrorCode rai::SnapshotExport(rai::Store& store,
+                                   const boost::filesystem::path& dir,
+                                   rai::SnapshotManifest& manifest)
+{
+    if (store.env_.Engine().Type() != rai::StoreEngineType::LMDB)
+    {
+        return rai::ErrorCode::STORE_ENGINE;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(dir, ec);
+    if (ec)
+    {
+        return rai::ErrorCode::DATA_PATH;
+    }
+
+    boost::filesystem::path file = dir / "data.ldb";
+    boost::filesystem::path manifest_file = dir / "manifest.json";
+    if (boost::filesystem::exists(file)
+        || boost::filesystem::exists(manifest_file))
+    {
+        return rai::ErrorCode::SNAPSHOT_EXISTS;
+    }
+
+    // the copy runs inside one read-only transaction and skips free pages,
+    // writers are not blocked while it is in progress
+    auto ret = mdb_env_copy2(store.env_, file.string().c_str(), MDB_CP_COMPACT);
+    if (ret != MDB_SUCCESS)
+    {
+        boost::filesystem::remove(file, ec);
+        return rai::ErrorCode::SNAPSHOT_EXPORT;
+    }
+
+    rai::SnapshotManifest manifest_l;
+    rai::ErrorCode error_code = Inspect(file, manifest_l);
+    if (error_code == rai::ErrorCode::SUCCESS)
+    {
+        bool error = Checksum(file, manifest_l.size_, manifest_l.checksum_);
+        if (error)
+        {
+            error_code = rai::ErrorCode::SNAPSHOT_EXPORT;
+        }
+    }
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        boost::filesystem::remove(file, ec);
+        return error_code;
+    }
+
+    std::fstream stream;
+    error_code = rai::WriteObject(manifest_l, manifest_file, stream);
+    stream.close();
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        boost::filesystem::remove(file, ec);
+        boost::filesystem::remove(manifest_file, ec);
+        return error_code;
+    }
+
+    manifest = manifest_l;
+    return rai::ErrorCode::SUCCESS;
+}
+
+rai::ErrorCode rai::SnapshotImport(const boost::filesystem::path& dir,
+                                   const boost::filesystem::path& data_path,
+                                   rai::SnapshotManifest& manifest)
+{
+    rai::SnapshotManifest expected;
+    try
+    {
+        rai::Ptree ptree;
+        boost::property_tree::read_json((dir / "manifest.json").string(),
+                                        ptree);
+        rai::ErrorCode error_code = expected.DeserializeJson(ptree);
+        IF_NOT_SUCCESS_RETURN(error_code);
+    }
+    catch (...)
+    {
+        return rai::ErrorCode::SNAPSHOT_MANIFEST;
+    }
+
+    if (expected.network_ != rai::NetworkString())
+    {
+        return rai::ErrorCode::SNAPSHOT_MANIFEST;
+    }
+
+    boost::filesystem::path target = data_path / "data.ldb";
+    if (boost::filesystem::exists(target))
+    {
+        return rai::ErrorCode::SNAPSHOT_LEDGER_EXISTS;
+    }
+
+    // verify a private copy so the source snapshot is never modified and a
+    // half written ledger never appears under the final name
+    boost::filesystem::path file = data_path / "data.ldb.import";
+    boost::system::error_code ec;
+    boost::filesystem::remove(file, ec);
+    boost::filesystem::remove(LockFile(file), ec);
+    boost::filesystem::copy_file(dir / "data.ldb", file, ec);
+    if (ec)
+    {
+        boost::filesystem::remove(file, ec);
+        return rai::ErrorCode::SNAPSHOT_IMPORT;
+    }
+
+    rai::SnapshotManifest manifest_l;
+    bool error = Checksum(file, manifest_l.size_, manifest_l.checksum_);
+    if (error || manifest_l.size_ != expected.size_
+        || manifest_l.checksum_ != expected.checksum_)
+    {
+        boost::filesystem::remove(file, ec);
+        return rai::ErrorCode::SNAPSHOT_CHECKSUM;
+    }
+
+    rai::ErrorCode error_code = Inspect(file, manifest_l);
+    if (error_code == rai::ErrorCode::SUCCESS && !manifest_l.Match(expected))
+    {
+        error_code = rai::ErrorCode::SNAPSHOT_MANIFEST;
+    }
+    if (error_code != rai::ErrorCode::SUCCESS)
+    {
+        boost::filesystem::remove(file, ec);
+        return error_code;
+    }
+
+    boost::filesystem::rename(file, target, ec);
+    if (ec)
+    {
+        boost::filesystem::remove(file, ec);
+        return rai::ErrorCode::SNAPSHOT_IMPORT;
+    }
+
+    manifest = manifest_l;
+    return rai::ErrorCode::SUCCESS;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <rai/common/errors.hpp>
+#include <rai/common/numbers.hpp>
+#include <rai/common/util.hpp>
+#include <rai/secure/store.hpp>
+
+namespace rai
+{
+// Describes a compacted ledger copy, the heads digest is a blake2b hash over
+// (account, head height, head) of every account in key order
+class SnapshotManifest
+{
+public:
+    SnapshotManifest();
+    rai::ErrorCode DeserializeJson(const rai::Ptree&);
+    void SerializeJson(rai::Ptree&) const;
+    bool Match(const rai::SnapshotManifest&) const;
+
+    static uint32_t constexpr VERSION = 1;
+
+    std::string network_;
+    uint32_t ledger_version_;
+    uint64_t account_count_;
+    rai::uint256_union heads_;
+    uint64_t size_;
+    rai::uint256_union checksum_;
+};
+
+// Writes <dir>/data.ldb with MDB_CP_COMPACT and its manifest.json, the copy
+// is taken from a single read transaction so it is always consistent
+rai::ErrorCode SnapshotExport(rai::Store&, const boost::filesystem::path&,
+                              rai::SnapshotManifest&);
+// Verifies the snapshot in the directory and installs it as
+// <data_path>/data.ldb, an existing ledger is never overwritten
+rai::ErrorCode SnapshotImport(const boost::filesystem::path&,
+                              const boost::filesystem::path&,
+                              rai::SnapshotManifest&);
+}  // namespace rai
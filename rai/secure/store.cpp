@@ -1,8 +1,90 @@
 #include <rai/secure/store.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace
+{
+// the default lmdb key order
+int Compare(const MDB_val& x, const MDB_val& y)
+{
+    size_t size = std::min(x.mv_size, y.mv_size);
+    int ret = size == 0 ? 0 : std::memcmp(x.mv_data, y.mv_data, size);
+    if (ret != 0)
+    {
+        return ret;
+    }
+    if (x.mv_size == y.mv_size)
+    {
+        return 0;
+    }
+    return x.mv_size < y.mv_size ? -1 : 1;
+}
+
+// power of two bucket holding the size, 0 only holds empty values
+uint64_t SizeBucket(size_t size)
+{
+    uint64_t bucket = 1;
+    while (bucket < size)
+    {
+        bucket <<= 1;
+    }
+    return size == 0 ? 0 : bucket;
+}
+
+rai::Ptree HistogramPtree(const std::map<uint64_t, uint64_t>& histogram)
+{
+    rai::Ptree ptree;
+    for (const auto& i : histogram)
+    {
+        rai::Ptree entry;
+        entry.put("max_size", std::to_string(i.first));
+        entry.put("count", std::to_string(i.second));
+        ptree.push_back(std::make_pair("", entry));
+    }
+    return ptree;
+}
+
+// every record of the free list table (dbi 0) is a page number list whose
+// first element is its length
+bool FreePages(MDB_txn* txn, uint64_t& pages)
+{
+    pages = 0;
+    MDB_cursor* cursor = nullptr;
+    int ret = mdb_cursor_open(txn, 0, &cursor);
+    if (ret != MDB_SUCCESS)
+    {
+        return true;
+    }
+
+    MDB_val key;
+    MDB_val value;
+    while (mdb_cursor_get(cursor, &key, &value, MDB_NEXT) == MDB_SUCCESS)
+    {
+        size_t count = 0;
+        if (value.mv_size >= sizeof(count))
+        {
+            std::memcpy(&count, value.mv_data, sizeof(count));
+            pages += count;
+        }
+    }
+    mdb_cursor_close(cursor);
+    return false;
+}
+}  // namespace
+
 rai::Store::Store(rai::ErrorCode& error_code,
-                  const boost::filesystem::path& path)
-    : env_(error_code, path, 128),
+                  const boost::filesystem::path& path,
+                  rai::StoreEngineType engine)
+    : Store(error_code, path, rai::MdbEnvOptions(engine))
+{
+}
+
+rai::Store::Store(rai::ErrorCode& error_code,
+                  const boost::filesystem::path& path,
+                  const rai::MdbEnvOptions& options)
+    : env_(error_code, path, 128, options),
       accounts_(0),
       blocks_(0),
       blocks_index_(0),
@@ -46,7 +128,15 @@ rai::Store::Store(rai::ErrorCode& error_code,
       token_wrap_(0),
       token_unwrap_(0),
       chain_head_(0),
-      wrapped_tokens_(0)
+      wrapped_tokens_(0),
+      account_delegations_(0),
+      accounts_changed_(0),
+      receivables_index_(0),
+      receivable_sources_(0),
+      ledger_counters_(0),
+      rollbacks_expiry_(0),
+      rollbacks_account_(0),
+      forks_expiry_(0)
 {
     if (error_code != rai::ErrorCode::SUCCESS)
     {
@@ -59,98 +149,98 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    auto ret = mdb_dbi_open(transaction, "accounts", MDB_CREATE, &accounts_);
+    auto ret = env_.DbiOpen(transaction, "accounts", MDB_CREATE, &accounts_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "blocks", MDB_CREATE, &blocks_);
+    ret = env_.DbiOpen(transaction, "blocks", MDB_CREATE, &blocks_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "blocks_index", MDB_CREATE, &blocks_index_);
+    ret = env_.DbiOpen(transaction, "blocks_index", MDB_CREATE, &blocks_index_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "meta", MDB_CREATE, &meta_);
+    ret = env_.DbiOpen(transaction, "meta", MDB_CREATE, &meta_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "receivables", MDB_CREATE, &receivables_);
+    ret = env_.DbiOpen(transaction, "receivables", MDB_CREATE, &receivables_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "rewardables", MDB_CREATE, &rewardables_);
+    ret = env_.DbiOpen(transaction, "rewardables", MDB_CREATE, &rewardables_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "rollbacks", MDB_CREATE, &rollbacks_);
+    ret = env_.DbiOpen(transaction, "rollbacks", MDB_CREATE, &rollbacks_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "forks", MDB_CREATE, &forks_);
+    ret = env_.DbiOpen(transaction, "forks", MDB_CREATE, &forks_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "wallets", MDB_CREATE, &wallets_);
+    ret = env_.DbiOpen(transaction, "wallets", MDB_CREATE, &wallets_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "sources", MDB_CREATE, &sources_);
+    ret = env_.DbiOpen(transaction, "sources", MDB_CREATE, &sources_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "alias", MDB_CREATE, &alias_);
+    ret = env_.DbiOpen(transaction, "alias", MDB_CREATE, &alias_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "alias_block", MDB_CREATE, &alias_block_);
+    ret = env_.DbiOpen(transaction, "alias_block", MDB_CREATE, &alias_block_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "alias_index", MDB_CREATE, &alias_index_);
+    ret = env_.DbiOpen(transaction, "alias_index", MDB_CREATE, &alias_index_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "alias_dns_index", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "alias_dns_index", MDB_CREATE,
                        &alias_dns_index_);
     if (ret != MDB_SUCCESS)
     {
@@ -158,7 +248,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "account_tokens_info", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "account_tokens_info", MDB_CREATE,
                        &account_tokens_info_);
     if (ret != MDB_SUCCESS)
     {
@@ -166,7 +256,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_block", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "token_block", MDB_CREATE,
                        &token_block_);
     if (ret != MDB_SUCCESS)
     {
@@ -174,7 +264,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "account_token_link", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "account_token_link", MDB_CREATE,
                        &account_token_link_);
     if (ret != MDB_SUCCESS)
     {
@@ -182,7 +272,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "account_token_info", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "account_token_info", MDB_CREATE,
                        &account_token_info_);
     if (ret != MDB_SUCCESS)
     {
@@ -190,14 +280,14 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_info", MDB_CREATE, &token_info_);
+    ret = env_.DbiOpen(transaction, "token_info", MDB_CREATE, &token_info_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_receivable", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "token_receivable", MDB_CREATE,
                        &token_receivable_);
     if (ret != MDB_SUCCESS)
     {
@@ -206,7 +296,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
     }
 
     ret =
-        mdb_dbi_open(transaction, "token_id_info", MDB_CREATE, &token_id_info_);
+        env_.DbiOpen(transaction, "token_id_info", MDB_CREATE, &token_id_info_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
@@ -214,14 +304,14 @@ rai::Store::Store(rai::ErrorCode& error_code,
     }
 
     ret =
-        mdb_dbi_open(transaction, "token_holders", MDB_CREATE, &token_holders_);
+        env_.DbiOpen(transaction, "token_holders", MDB_CREATE, &token_holders_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "account_token_id", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "account_token_id", MDB_CREATE,
                        &account_token_id_);
     if (ret != MDB_SUCCESS)
     {
@@ -229,7 +319,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_transfer", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "token_transfer", MDB_CREATE,
                        &token_transfer_);
     if (ret != MDB_SUCCESS)
     {
@@ -237,7 +327,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_id_transfer", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "token_id_transfer", MDB_CREATE,
                        &token_id_transfer_);
     if (ret != MDB_SUCCESS)
     {
@@ -245,7 +335,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "swap_main_account", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "swap_main_account", MDB_CREATE,
                        &swap_main_account_);
     if (ret != MDB_SUCCESS)
     {
@@ -253,7 +343,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "account_swap_info", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "account_swap_info", MDB_CREATE,
                        &account_swap_info_);
     if (ret != MDB_SUCCESS)
     {
@@ -261,28 +351,28 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "order_info", MDB_CREATE, &order_info_);
+    ret = env_.DbiOpen(transaction, "order_info", MDB_CREATE, &order_info_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "order_index", MDB_CREATE, &order_index_);
+    ret = env_.DbiOpen(transaction, "order_index", MDB_CREATE, &order_index_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "swap_info", MDB_CREATE, &swap_info_);
+    ret = env_.DbiOpen(transaction, "swap_info", MDB_CREATE, &swap_info_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "inquiry_waiting", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "inquiry_waiting", MDB_CREATE,
                        &inquiry_waiting_);
     if (ret != MDB_SUCCESS)
     {
@@ -290,14 +380,14 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "take_waiting", MDB_CREATE, &take_waiting_);
+    ret = env_.DbiOpen(transaction, "take_waiting", MDB_CREATE, &take_waiting_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "order_swap_index", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "order_swap_index", MDB_CREATE,
                        &order_swap_index_);
     if (ret != MDB_SUCCESS)
     {
@@ -305,7 +395,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_swap_index", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "token_swap_index", MDB_CREATE,
                        &token_swap_index_);
     if (ret != MDB_SUCCESS)
     {
@@ -313,7 +403,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "take_nack_block", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "take_nack_block", MDB_CREATE,
                        &take_nack_block_);
     if (ret != MDB_SUCCESS)
     {
@@ -321,7 +411,7 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "maker_swap_index", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "maker_swap_index", MDB_CREATE,
                        &maker_swap_index_);
     if (ret != MDB_SUCCESS)
     {
@@ -330,14 +420,14 @@ rai::Store::Store(rai::ErrorCode& error_code,
     }
 
     ret =
-        mdb_dbi_open(transaction, "binding_count", MDB_CREATE, &binding_count_);
+        env_.DbiOpen(transaction, "binding_count", MDB_CREATE, &binding_count_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "binding_entries", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "binding_entries", MDB_CREATE,
                        &binding_entries_);
     if (ret != MDB_SUCCESS)
     {
@@ -345,53 +435,116 @@ rai::Store::Store(rai::ErrorCode& error_code,
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_map", MDB_CREATE, &token_map_);
+    ret = env_.DbiOpen(transaction, "token_map", MDB_CREATE, &token_map_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_unmap", MDB_CREATE, &token_unmap_);
+    ret = env_.DbiOpen(transaction, "token_unmap", MDB_CREATE, &token_unmap_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_wrap", MDB_CREATE, &token_wrap_);
+    ret = env_.DbiOpen(transaction, "token_wrap", MDB_CREATE, &token_wrap_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "token_unwrap", MDB_CREATE, &token_unwrap_);
+    ret = env_.DbiOpen(transaction, "token_unwrap", MDB_CREATE, &token_unwrap_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "chain_head", MDB_CREATE, &chain_head_);
+    ret = env_.DbiOpen(transaction, "chain_head", MDB_CREATE, &chain_head_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
 
-    ret = mdb_dbi_open(transaction, "wrapped_tokens", MDB_CREATE,
+    ret = env_.DbiOpen(transaction, "wrapped_tokens", MDB_CREATE,
                        &wrapped_tokens_);
     if (ret != MDB_SUCCESS)
     {
         error_code = rai::ErrorCode::MDB_DBI_OPEN;
         return;
     }
+
+    ret = env_.DbiOpen(transaction, "account_delegations", MDB_CREATE,
+                       &account_delegations_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
+
+    ret = env_.DbiOpen(transaction, "accounts_changed", MDB_CREATE,
+                       &accounts_changed_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
+
+    ret = env_.DbiOpen(transaction, "receivables_index", MDB_CREATE,
+                       &receivables_index_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
+
+    ret = env_.DbiOpen(transaction, "receivable_sources", MDB_CREATE,
+                       &receivable_sources_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
+
+    ret = env_.DbiOpen(transaction, "ledger_counters", MDB_CREATE,
+                       &ledger_counters_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
+
+    ret = env_.DbiOpen(transaction, "rollbacks_expiry", MDB_CREATE,
+                       &rollbacks_expiry_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
+
+    ret = env_.DbiOpen(transaction, "rollbacks_account", MDB_CREATE,
+                       &rollbacks_account_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
+
+    ret = env_.DbiOpen(transaction, "forks_expiry", MDB_CREATE, &forks_expiry_);
+    if (ret != MDB_SUCCESS)
+    {
+        error_code = rai::ErrorCode::MDB_DBI_OPEN;
+        return;
+    }
 }
 
 bool rai::Store::Put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* value)
 {
-    auto ret = mdb_put(txn, dbi, key, value, 0);
+    auto ret = env_.Engine().Put(txn, dbi, key, value);
     if (ret != MDB_SUCCESS)
     {
         return true;
@@ -403,7 +556,7 @@ bool rai::Store::Put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* value)
 bool rai::Store::Get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
                      MDB_val* value) const
 {
-    auto ret = mdb_get(txn, dbi, key, value);
+    auto ret = env_.Engine().Get(txn, dbi, key, value);
     assert(ret == MDB_SUCCESS || ret == MDB_NOTFOUND);
     if (ret != MDB_SUCCESS)
     {
@@ -415,7 +568,7 @@ bool rai::Store::Get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key,
 
 bool rai::Store::Del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* value)
 {
-    auto ret = mdb_del(txn, dbi, key, value);
+    auto ret = env_.Engine().Del(txn, dbi, key, value);
     assert(ret == MDB_SUCCESS || ret == MDB_NOTFOUND);
     if (ret != MDB_SUCCESS)
     {
@@ -426,3 +579,215 @@ bool rai::Store::Del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* value)
 }
 
 
+
+bool rai::Store::Drop(MDB_txn* txn, MDB_dbi dbi)
+{
+    auto ret = env_.Engine().Drop(txn, dbi, false);
+    if (ret != MDB_SUCCESS)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+bool rai::Store::Stat(MDB_txn* txn, MDB_dbi dbi, MDB_stat& stat) const
+{
+    auto ret = env_.Engine().Stat(txn, dbi, &stat);
+    if (ret != MDB_SUCCESS)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+uint64_t rai::Store::TxnId(MDB_txn* txn) const
+{
+    return env_.Engine().TxnId(txn);
+}
+
+rai::ErrorCode rai::Store::Stats(rai::Ptree& stats, size_t samples)
+{
+    samples = std::min(samples, rai::Store::MAX_STATS_SAMPLES);
+    rai::ErrorCode error_code = rai::ErrorCode::SUCCESS;
+    rai::MdbTransaction transaction(error_code, env_, nullptr, false);
+    IF_NOT_SUCCESS_RETURN(error_code);
+
+    stats.put("engine", rai::StoreEngineTypeToString(env_.Engine().Type()));
+    uint64_t page_size = rai::MemoryEngine::PAGE_SIZE;
+    if (env_.env_ != nullptr)
+    {
+        MDB_envinfo info;
+        MDB_stat stat;
+        if (mdb_env_info(env_.env_, &info) != MDB_SUCCESS
+            || mdb_env_stat(env_.env_, &stat) != MDB_SUCCESS)
+        {
+            return rai::ErrorCode::STORE_STATS;
+        }
+        page_size = stat.ms_psize;
+
+        uint64_t free_pages = 0;
+        bool error = FreePages(transaction, free_pages);
+        IF_ERROR_RETURN(error, rai::ErrorCode::STORE_STATS);
+
+        uint64_t last_page = info.me_last_pgno;
+        rai::Ptree env;
+        env.put("map_size", std::to_string(info.me_mapsize));
+        env.put("page_size", std::to_string(page_size));
+        env.put("last_page", std::to_string(last_page));
+        env.put("used_size", std::to_string((last_page + 1) * page_size));
+        env.put("free_pages", std::to_string(free_pages));
+        env.put("free_size", std::to_string(free_pages * page_size));
+        env.put("last_transaction", std::to_string(info.me_last_txnid));
+        env.put("readers", std::to_string(info.me_numreaders));
+        env.put("max_readers", std::to_string(info.me_maxreaders));
+        env.put("main_depth", std::to_string(stat.ms_depth));
+        stats.put_child("env", env);
+    }
+
+    std::vector<std::pair<uint64_t, rai::Ptree>> tables;
+    uint64_t total_pages = 0;
+    for (const auto& i : env_.Tables())
+    {
+        MDB_stat stat;
+        bool error = Stat(transaction, i.second, stat);
+        IF_ERROR_RETURN(error, rai::ErrorCode::STORE_STATS);
+
+        uint64_t pages =
+            stat.ms_branch_pages + stat.ms_leaf_pages + stat.ms_overflow_pages;
+        total_pages += pages;
+        rai::Ptree table;
+        table.put("name", i.first);
+        table.put("entries", std::to_string(stat.ms_entries));
+        table.put("depth", std::to_string(stat.ms_depth));
+        table.put("branch_pages", std::to_string(stat.ms_branch_pages));
+        table.put("leaf_pages", std::to_string(stat.ms_leaf_pages));
+        table.put("overflow_pages", std::to_string(stat.ms_overflow_pages));
+        table.put("size", std::to_string(pages * page_size));
+
+        if (samples > 0 && stat.ms_entries > 0)
+        {
+            // start at a random key so large tables are not only sampled at
+            // their head, then wrap around to the first key
+            rai::uint256_union start;
+            rai::random_pool.GenerateBlock(start.bytes.data(),
+                                           start.bytes.size());
+            rai::MdbVal start_key(start);
+            std::map<uint64_t, uint64_t> keys;
+            std::map<uint64_t, uint64_t> values;
+            size_t count = 0;
+            for (rai::StoreIterator j(transaction, i.second, start_key),
+                 n(nullptr);
+                 j != n && count < samples; ++j, ++count)
+            {
+                ++keys[SizeBucket(j->first.Size())];
+                ++values[SizeBucket(j->second.Size())];
+            }
+            for (rai::StoreIterator j(transaction, i.second), n(nullptr);
+                 j != n && count < samples; ++j, ++count)
+            {
+                if (Compare(j->first, start_key) >= 0)
+                {
+                    break;
+                }
+                ++keys[SizeBucket(j->first.Size())];
+                ++values[SizeBucket(j->second.Size())];
+            }
+            table.put("samples", std::to_string(count));
+            table.put_child("key_sizes", HistogramPtree(keys));
+            table.put_child("value_sizes", HistogramPtree(values));
+        }
+        tables.emplace_back(pages, table);
+    }
+
+    std::stable_sort(tables.begin(), tables.end(),
+                     [](const std::pair<uint64_t, rai::Ptree>& x,
+                        const std::pair<uint64_t, rai::Ptree>& y) {
+                         return x.first > y.first;
+                     });
+    rai::Ptree tables_ptree;
+    for (const auto& i : tables)
+    {
+        rai::Ptree entry(i.second);
+        if (total_pages > 0)
+        {
+            entry.put("percent", std::to_string(i.first * 100 / total_pages));
+        }
+        tables_ptree.push_back(std::make_pair("", entry));
+    }
+    stats.put("table_count", std::to_string(tables.size()));
+    stats.put("total_pages", std::to_string(total_pages));
+    stats.put("total_size", std::to_string(total_pages * page_size));
+    stats.put_child("tables", tables_ptree);
+
+    return rai::ErrorCode::SUCCESS;
+}
+
+// The keys must be sorted. One cursor walks the table forward: nearby keys
+// are reached with a few MDB_NEXT steps and the rest with MDB_SET_RANGE, so
+// pages shared by neighbouring keys are only visited once
+bool rai::Store::GetMany(MDB_txn* txn, MDB_dbi dbi,
+                         const std::vector<rai::MdbVal>& keys,
+                         const rai::StoreGetManyCallback& callback) const
+{
+    if (keys.empty())
+    {
+        return false;
+    }
+
+    std::unique_ptr<rai::StoreCursor> cursor;
+    auto ret = env_.Engine().CursorOpen(txn, dbi, cursor);
+    if (ret != MDB_SUCCESS)
+    {
+        return true;
+    }
+
+    MDB_val key{0, nullptr};
+    MDB_val value{0, nullptr};
+    bool positioned = false;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        const MDB_val& target = keys[i].value_;
+        assert(i == 0 || Compare(keys[i - 1].value_, target) <= 0);
+
+        size_t steps = 0;
+        while (positioned && Compare(key, target) < 0
+               && steps++ < rai::Store::GET_MANY_STEPS)
+        {
+            ret = cursor->Get(&key, &value, MDB_NEXT);
+            if (ret == MDB_NOTFOUND)
+            {
+                // the remaining keys are past the last entry
+                return false;
+            }
+            if (ret != MDB_SUCCESS)
+            {
+                return true;
+            }
+        }
+
+        if (!positioned || Compare(key, target) < 0)
+        {
+            key = target;
+            ret = cursor->Get(&key, &value, MDB_SET_RANGE);
+            if (ret == MDB_NOTFOUND)
+            {
+                return false;
+            }
+            if (ret != MDB_SUCCESS)
+            {
+                return true;
+            }
+            positioned = true;
+        }
+
+        if (Compare(key, target) == 0)
+        {
+            bool error = callback(i, rai::MdbVal(value));
+            IF_ERROR_RETURN(error, error);
+        }
+    }
+
+    return false;
+}
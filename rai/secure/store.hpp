@@ -1,4 +1,6 @@
 #pragma once
+#include <functional>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <lmdb/libraries/liblmdb/lmdb.h>
 #include <rai/common/errors.hpp>
@@ -8,15 +10,34 @@
 
 namespace rai
 {
+// Called with the position of a found key in the sorted key list, the value
+// is only valid during the call
+typedef std::function<bool(size_t, const rai::MdbVal&)> StoreGetManyCallback;
 
 class Store
 {
 public:
-    Store(rai::ErrorCode&, const boost::filesystem::path&);
+    Store(rai::ErrorCode&, const boost::filesystem::path&,
+          rai::StoreEngineType = rai::StoreEngineType::LMDB);
+    Store(rai::ErrorCode&, const boost::filesystem::path&,
+          const rai::MdbEnvOptions&);
     Store(const rai::Store&) = delete;
     bool Put(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*);
     bool Get(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*) const;
     bool Del(MDB_txn*, MDB_dbi, MDB_val*, MDB_val*);
+    bool Drop(MDB_txn*, MDB_dbi);
+    bool Stat(MDB_txn*, MDB_dbi, MDB_stat&) const;
+    uint64_t TxnId(MDB_txn*) const;
+    bool GetMany(MDB_txn*, MDB_dbi, const std::vector<rai::MdbVal>&,
+                 const rai::StoreGetManyCallback&) const;
+    // Page usage of every table, largest first, and the lmdb environment.
+    // With samples > 0 key and value sizes of up to that many entries per
+    // table are added as power of two histograms.
+    rai::ErrorCode Stats(rai::Ptree&, size_t = 0);
+
+    // cursor steps tried before seeking to the next key again
+    static size_t constexpr GET_MANY_STEPS = 4;
+    static size_t constexpr MAX_STATS_SAMPLES = 1000000;
 
     rai::MdbEnv env_;
 
@@ -59,13 +80,13 @@ public:
 
     /***************************************************************************
      Key: rai::BlockHash
-     Value: rai::Block
+     Value: rai::Block, uint64_t (timestamp, optional)
      **************************************************************************/
     MDB_dbi rollbacks_;
 
     /***************************************************************************
      Key: rai::Account, uint64_t
-     Value: rai::Block,rai::Block
+     Value: rai::Block,rai::Block, uint64_t (timestamp, optional)
      **************************************************************************/
     MDB_dbi forks_;
 
@@ -291,5 +312,63 @@ public:
      **************************************************************************/
     MDB_dbi token_unwrap_index_;
 
+    /***************************************************************************
+     Snapshot of the accounts' contributions to the in-memory tables
+     Key: rai::Account
+     Value: rai::AccountDelegation
+     **************************************************************************/
+    MDB_dbi account_delegations_;
+
+    /***************************************************************************
+     Accounts changed since the last snapshot checkpoint
+     Key: rai::Account
+     Value: empty
+     **************************************************************************/
+    MDB_dbi accounts_changed_;
+
+    /***************************************************************************
+     Receivables ordered by confirmation state and amount (node ledger only)
+     Key: rai::Account (destination), uint8_t (rai::ReceivableInfosType),
+          rai::Amount (max - amount), rai::BlockHash
+     Value: rai::ReceivableInfo
+     **************************************************************************/
+    MDB_dbi receivables_index_;
+
+    /***************************************************************************
+     Source blocks of receivables (node ledger only)
+     Key: rai::Account (source), uint64_t (height)
+     Value: rai::Account (destination), rai::BlockHash
+     **************************************************************************/
+    MDB_dbi receivable_sources_;
+
+    /***************************************************************************
+     Counters maintained with every block, receivable and fork change (node
+     ledger only)
+     Key: uint32_t (rai::LedgerCounterType), uint32_t (index)
+     Value: rai::uint128_union
+     **************************************************************************/
+    MDB_dbi ledger_counters_;
+
+    /***************************************************************************
+     Expiry order of rollbacks (node ledger only)
+     Key: uint64_t (timestamp), rai::BlockHash
+     Value: rai::Account
+     **************************************************************************/
+    MDB_dbi rollbacks_expiry_;
+
+    /***************************************************************************
+     Rollbacks of each account (node ledger only)
+     Key: rai::Account, uint64_t (timestamp), rai::BlockHash
+     Value: uint8_t
+     **************************************************************************/
+    MDB_dbi rollbacks_account_;
+
+    /***************************************************************************
+     Expiry order of forks (node ledger only)
+     Key: uint64_t (timestamp), rai::Account, uint64_t (height)
+     Value: uint8_t
+     **************************************************************************/
+    MDB_dbi forks_expiry_;
+
 };
 } // namespace rai
\ No newline at end of file